@@ -57,6 +57,10 @@ function (make_bin)
     endif()
 
 
+    foreach(GLSL_INCLUDE_DIR ${GLSL_INCLUDE_DIRS})
+        list(APPEND GLSL_INCLUDE_FLAGS -I${GLSL_INCLUDE_DIR})
+    endforeach()
+
     foreach(GLSL ${NEW_APP_SHADERS})
         file(RELATIVE_PATH REL_GLSL_PATH ${CMAKE_CURRENT_LIST_DIR} ${GLSL})
         set(SPIRV "${CMAKE_CURRENT_BINARY_DIR}/${REL_GLSL_PATH}.spv")
@@ -66,7 +70,7 @@ function (make_bin)
                 OUTPUT ${SPIRV}
                 COMMAND ${CMAKE_COMMAND} -E make_directory ${SPIRV_DIR}
                 COMMAND ${CMAKE_COMMAND} -E copy ${GLSL} ${SPIRV_DIR}/${GLSL_FILE}
-                COMMAND ${GLSL_VALIDATOR} -V -Os ${GLSL} -o ${SPIRV}
+                COMMAND ${GLSL_VALIDATOR} -V -Os ${GLSL_INCLUDE_FLAGS} ${GLSL} -o ${SPIRV}
                 DEPENDS ${GLSL})
 
         list(APPEND SPIRV_BINARY_FILES ${SPIRV})
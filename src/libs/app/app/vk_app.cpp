@@ -3,6 +3,7 @@
 #include "vk_app.hpp"
 
 #include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -70,6 +71,8 @@ ERROR_TYPE vk_app::run_main_loop()
     }
 
     vkDeviceWaitIdle(vk_utils::context::get().device());
+    m_defragmenter.finish();
+    m_deletion_queue.flush();
 
     RAISE_ERROR_OK();
 }
@@ -77,6 +80,13 @@ ERROR_TYPE vk_app::run_main_loop()
 
 ERROR_TYPE vk_app::cleanup()
 {
+    vk_utils::set_uniform_pool(nullptr);
+    vk_utils::set_mip_generator(nullptr);
+    vk_utils::set_defragmenter(nullptr);
+    vk_utils::set_upload_context(nullptr);
+    vk_utils::set_staging_ring(nullptr);
+    vk_utils::set_deletion_queue(nullptr);
+
     RAISE_ERROR_OK();
 }
 
@@ -97,44 +107,74 @@ ERROR_TYPE vk_app::init_vulkan()
     context_info.required_device_extensions.names = m_app_info.device_extensions.data();
     context_info.required_device_extensions.count = m_app_info.device_extensions.size();
 
+    if (!m_app_info.memory_statistics_dump_path.empty()) {
+        context_info.memory_statistics_dump_path = m_app_info.memory_statistics_dump_path.c_str();
+        context_info.memory_statistics_dump_period = m_app_info.memory_statistics_dump_period;
+    }
+
+    context_info.track_host_allocations = m_app_info.track_host_allocations;
+
     context_info.surface_create_callback = [this](VkInstance instance, VkSurfaceKHR* surface) {
         auto res = glfwCreateWindowSurface(instance, m_window, nullptr, surface);
         return res;
     };
 
     PASS_ERROR(vk_utils::context::init(m_app_info.app_name.c_str(), context_info));
+    vk_utils::set_deletion_queue(&m_deletion_queue);
     PASS_ERROR(create_swapchain());
     PASS_ERROR(request_swapchain_images());
 
     m_swapchain_data.image_acquired_semaphores.resize(m_swapchain_data.swapchain_images.size());
     m_swapchain_data.render_finished_semaphores.resize(m_swapchain_data.swapchain_images.size());
-    m_swapchain_data.render_finished_fences.resize(m_swapchain_data.swapchain_images.size());
 
     VkSemaphoreCreateInfo semaphores_info{};
     semaphores_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     semaphores_info.pNext = nullptr;
     semaphores_info.flags = 0;
 
-    VkFenceCreateInfo fences_info{};
-    fences_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fences_info.pNext = nullptr;
-    fences_info.flags = 0;
-
     for (size_t i = 0; i < m_swapchain_data.swapchain_images.size(); ++i) {
         m_swapchain_data.image_acquired_semaphores[i].init(vk_utils::context::get().device(), &semaphores_info);
         m_swapchain_data.render_finished_semaphores[i].init(vk_utils::context::get().device(), &semaphores_info);
-        m_swapchain_data.render_finished_fences[i].init(vk_utils::context::get().device(), &fences_info);
     }
 
-    m_swapchain_data.frames_in_flight_fences.resize(m_swapchain_data.swapchain_images.size(), nullptr);
+    m_swapchain_data.frames_submissions.resize(m_swapchain_data.swapchain_images.size());
+    m_swapchain_data.images_submissions.resize(m_swapchain_data.swapchain_images.size());
     m_swapchain_data.frames_count = m_swapchain_data.swapchain_images.size();
 
+    PASS_ERROR(init_frame_services());
     PASS_ERROR(on_vulkan_initialized());
 
     RAISE_ERROR_OK();
 }
 
 
+ERROR_TYPE vk_app::init_frame_services()
+{
+    vk_utils::staging_ring* staging_ring{nullptr};
+
+    if (m_app_info.staging_ring_size > 0) {
+        PASS_ERROR(m_staging_ring.init(m_app_info.staging_ring_size, m_swapchain_data.frames_count));
+        staging_ring = &m_staging_ring;
+    }
+
+    PASS_ERROR(m_upload_context.init(staging_ring));
+    PASS_ERROR(m_defragmenter.init());
+    PASS_ERROR(m_mip_generator.init());
+    PASS_ERROR(m_uniform_pool.init(m_app_info.uniform_pool_block_size, m_swapchain_data.frames_count, &m_upload_context));
+
+    vk_utils::set_staging_ring(staging_ring);
+    vk_utils::set_upload_context(&m_upload_context);
+    vk_utils::set_defragmenter(&m_defragmenter);
+    m_defragmenter.set_on_moved([this]() {
+        HANDLE_ERROR(on_resources_moved());
+    });
+    vk_utils::set_mip_generator(&m_mip_generator);
+    vk_utils::set_uniform_pool(&m_uniform_pool);
+
+    RAISE_ERROR_OK();
+}
+
+
 ERROR_TYPE vk_app::create_swapchain()
 {
     if (m_swapchain_data.swapchain_info.has_value()) {
@@ -160,10 +200,16 @@ ERROR_TYPE vk_app::create_swapchain()
                     m_surface_capabilities.maxImageCount);
         }
 
-        if (m_swapchain_data.swapchain.reset(vk_utils::context::get().device(), &*m_swapchain_data.swapchain_info) != VK_SUCCESS) {
+        vk_utils::swapchain_handler swapchain{};
+
+        if (swapchain.init(vk_utils::context::get().device(), &*m_swapchain_data.swapchain_info) != VK_SUCCESS) {
             RAISE_ERROR_FATAL(-1, "cannot reset swapchain.");
         }
 
+        // the old swapchain images may still be presented or rendered to by frames in flight.
+        m_deletion_queue.retire(std::move(m_swapchain_data.swapchain));
+        m_swapchain_data.swapchain = std::move(swapchain);
+
         RAISE_ERROR_OK();
     }
 
@@ -300,6 +346,7 @@ ERROR_TYPE vk_app::request_swapchain_images()
         }
     }
 
+    m_deletion_queue.retire(std::move(m_swapchain_data.swapchain_images_views));
     m_swapchain_data.swapchain_images_views = std::move(image_views);
 
     RAISE_ERROR_OK();
@@ -333,6 +380,12 @@ ERROR_TYPE app::vk_app::on_window_size_changed(int w, int h)
 }
 
 
+ERROR_TYPE app::vk_app::on_resources_moved()
+{
+    RAISE_ERROR_OK();
+}
+
+
 ERROR_TYPE app::vk_app::on_window_focus_changed(int focused)
 {
     RAISE_ERROR_OK();
@@ -395,11 +448,44 @@ void app::vk_app::window_maximized_callback(GLFWwindow* window, int maximized)
 }
 
 
+ERROR_TYPE vk_app::check_fragmentation()
+{
+    if (m_app_info.defragmentation_check_period == 0 || ++m_frames_since_fragmentation_check < m_app_info.defragmentation_check_period) {
+        RAISE_ERROR_OK();
+    }
+
+    m_frames_since_fragmentation_check = 0;
+
+    if (m_defragmenter.is_running()) {
+        RAISE_ERROR_OK();
+    }
+
+    VkDeviceSize block_bytes{0};
+    VkDeviceSize allocation_bytes{0};
+
+    for (const auto& heap : vk_utils::context::get().get_memory_statistics().heaps) {
+        if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0) {
+            block_bytes += heap.block_bytes;
+            allocation_bytes += heap.allocation_bytes;
+        }
+    }
+
+    if (block_bytes > 0 && static_cast<float>(block_bytes - allocation_bytes) > m_app_info.defragmentation_unused_ratio * static_cast<float>(block_bytes)) {
+        PASS_ERROR(m_defragmenter.begin());
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
 ERROR_TYPE vk_app::begin_frame()
 {
     VkResult result;
     size_t acquire_image_tries{0};
 
+    // the acquire semaphore of the frame is reused once its previous submission completed.
+    vk_utils::context::get().wait(m_swapchain_data.frames_submissions[m_swapchain_data.current_frame]);
+
     do {
         result = vkAcquireNextImageKHR(
             vk_utils::context::get().device(),
@@ -411,7 +497,6 @@ ERROR_TYPE vk_app::begin_frame()
 
         if (result != VK_SUCCESS) {
             if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-                vkDeviceWaitIdle(vk_utils::context::get().device());
                 PASS_ERROR(create_swapchain());
                 HANDLE_ERROR(request_swapchain_images());
                 HANDLE_ERROR(on_swapchain_recreated());
@@ -432,16 +517,10 @@ ERROR_TYPE vk_app::begin_frame()
 
 ERROR_TYPE vk_app::finish_frame(VkCommandBuffer cmd_buffer)
 {
-    if (m_swapchain_data.frames_in_flight_fences[m_swapchain_data.current_image] != nullptr) {
-        vkWaitForFences(
-            vk_utils::context::get().device(),
-            1,
-            &m_swapchain_data.frames_in_flight_fences[m_swapchain_data.current_image],
-            true,
-            UINT64_MAX);
-    }
+    const auto& ctx = vk_utils::context::get();
+    const auto graphics_queue = ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS);
 
-    m_swapchain_data.frames_in_flight_fences[m_swapchain_data.current_image] = m_swapchain_data.render_finished_fences[m_swapchain_data.current_frame];
+    ctx.wait(m_swapchain_data.images_submissions[m_swapchain_data.current_image]);
 
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -455,16 +534,35 @@ ERROR_TYPE vk_app::finish_frame(VkCommandBuffer cmd_buffer)
     submit_info.pCommandBuffers = &cmd_buffer;
     submit_info.commandBufferCount = 1;
 
-    vkResetFences(
-        vk_utils::context::get().device(),
-        1,
-        m_swapchain_data.render_finished_fences[m_swapchain_data.current_frame]);
+    // uniform data written during the frame is copied by the uploads.
+    HANDLE_ERROR(m_uniform_pool.flush());
+
+    // uploads recorded during the frame are submitted ahead of it.
+    if (auto* upload_context = vk_utils::get_upload_context(); upload_context != nullptr) {
+        HANDLE_ERROR(upload_context->flush());
+    }
+
+    vk_utils::submission_token frame_submission{};
+    if (const auto e = ctx.submit(graphics_queue, submit_info, frame_submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit frame.");
+    }
+
+    m_swapchain_data.frames_submissions[m_swapchain_data.current_frame] = frame_submission;
+    m_swapchain_data.images_submissions[m_swapchain_data.current_image] = frame_submission;
+
+    if (auto* staging_ring = vk_utils::get_staging_ring(); staging_ring != nullptr) {
+        staging_ring->end_frame();
+    }
+
+    HANDLE_ERROR(check_fragmentation());
+
+    if (auto* defragmenter = vk_utils::get_defragmenter(); defragmenter != nullptr) {
+        HANDLE_ERROR(defragmenter->update());
+    }
+
+    m_deletion_queue.end_frame(frame_submission);
 
-    vkQueueSubmit(
-        vk_utils::context::get().queue(vk_utils::context::QUEUE_TYPE_GRAPHICS),
-        1,
-        &submit_info,
-        m_swapchain_data.render_finished_fences[m_swapchain_data.current_frame]);
+    vk_utils::context::end_frame();
 
     VkResult result{};
     VkPresentInfoKHR present_info{};
@@ -480,11 +578,10 @@ ERROR_TYPE vk_app::finish_frame(VkCommandBuffer cmd_buffer)
     present_info.waitSemaphoreCount = 1;
     present_info.pResults = &result;
 
-    vkQueuePresentKHR(vk_utils::context::get().queue(vk_utils::context::QUEUE_TYPE_GRAPHICS), &present_info);
+    ctx.present(graphics_queue, present_info);
 
     if (result != VK_SUCCESS) {
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-            vkDeviceWaitIdle(vk_utils::context::get().device());
             PASS_ERROR(create_swapchain());
             HANDLE_ERROR(request_swapchain_images());
             HANDLE_ERROR(on_swapchain_recreated());
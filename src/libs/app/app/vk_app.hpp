@@ -3,6 +3,12 @@
 #include <app/base_app.hpp>
 
 #include <vk_utils/handlers.hpp>
+#include <vk_utils/deletion_queue.hpp>
+#include <vk_utils/defragmenter.hpp>
+#include <vk_utils/mip_generator.hpp>
+#include <vk_utils/staging_ring.hpp>
+#include <vk_utils/uniform_pool.hpp>
+#include <vk_utils/upload_context.hpp>
 
 #include <optional>
 
@@ -44,6 +50,20 @@ namespace app
 
             std::vector<const char*> instance_extensions{};
             std::vector<const char*> device_extensions{};
+
+            // vk_utils::context memory statistics are dumped periodically as json lines when the path is set.
+            std::string memory_statistics_dump_path{};
+            float memory_statistics_dump_period{10.0f};
+            bool track_host_allocations{false};
+
+            // staging memory of uploads recorded during frames, 0 disables the staging ring.
+            VkDeviceSize staging_ring_size{32 * 1024 * 1024};
+            VkDeviceSize uniform_pool_block_size{256 * 1024};
+
+            // registered resources are defragmented once the unused part of the device local memory blocks exceeds
+            // defragmentation_unused_ratio, checked every defragmentation_check_period frames, 0 disables the checks.
+            uint32_t defragmentation_check_period{600};
+            float defragmentation_unused_ratio{0.25f};
         };
 
         struct swapchain_data
@@ -56,8 +76,9 @@ namespace app
             std::vector<vk_utils::img_view_handler> swapchain_images_views{};
             std::vector<vk_utils::semaphore_handler> image_acquired_semaphores{};
             std::vector<vk_utils::semaphore_handler> render_finished_semaphores{};
-            std::vector<vk_utils::fence_handler> render_finished_fences{};
-            std::vector<VkFence> frames_in_flight_fences{};
+            // last graphics submission of every frame and swapchain image.
+            std::vector<vk_utils::submission_token> frames_submissions{};
+            std::vector<vk_utils::submission_token> images_submissions{};
 
             uint32_t current_image{0};
             uint32_t current_frame{0};
@@ -69,6 +90,7 @@ namespace app
         ERROR_TYPE cleanup() override;
 
         ERROR_TYPE init_vulkan();
+        ERROR_TYPE init_frame_services();
         ERROR_TYPE create_swapchain();
         ERROR_TYPE request_swapchain_images();
 
@@ -82,6 +104,9 @@ namespace app
         virtual ERROR_TYPE draw_frame() = 0;
 
         virtual ERROR_TYPE on_window_size_changed(int w, int h);
+        // a defragmentation pass moved registered resources, command buffers and descriptor sets recorded with
+        // their previous handles are recorded again here, the previous handles stay valid until the pass completed.
+        virtual ERROR_TYPE on_resources_moved();
 
         virtual ERROR_TYPE on_mouse_moved(int x, int y)
         {
@@ -115,6 +140,14 @@ namespace app
         VkSurfaceCapabilitiesKHR m_surface_capabilities{};
         swapchain_data m_swapchain_data{};
         app_data m_app_info{};
+        // swapchain dependent objects replaced on recreation are retired here, frames in flight may still use them.
+        vk_utils::deletion_queue m_deletion_queue{};
+        // installed into vk_utils and driven by finish_frame, sized to the frames in flight.
+        vk_utils::staging_ring m_staging_ring{};
+        vk_utils::upload_context m_upload_context{};
+        vk_utils::defragmenter m_defragmenter{};
+        vk_utils::mip_generator m_mip_generator{};
+        vk_utils::uniform_pool m_uniform_pool{};
 
     private:
         enum frame_state
@@ -131,8 +164,11 @@ namespace app
         static void cursor_enter_callback(GLFWwindow*, int);
         static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
+        ERROR_TYPE check_fragmentation();
+
         GLFWwindow* m_window{};
 
         uint32_t m_frame_state = WINDOW_OK_BIT;
+        uint64_t m_frames_since_fragmentation_check{0};
     };
 } // namespace app
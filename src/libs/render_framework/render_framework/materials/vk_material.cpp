@@ -61,25 +61,40 @@ void vk_material_impl::apply(VkCommandBuffer cmd_buffer)
     update_descriptor_sets();
 
     m_curr_apply_command_buffer = cmd_buffer;
+    m_dynamic_offsets.clear();
 
     for (const auto* parameters_list : m_parameters_lists) {
         const auto* plist_impl = static_cast<const vk_parameters_list_impl*>(parameters_list->get_impl());
         plist_impl->visit(this);
     }
 
+    if (m_descriptor_set.handlers_count() > 0) {
+        vkCmdBindDescriptorSets(
+            cmd_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipeline_layout,
+            0,
+            m_descriptor_set.handlers_count(),
+            m_descriptor_set,
+            m_dynamic_offsets.size(),
+            m_dynamic_offsets.data());
+    }
+
     m_curr_apply_command_buffer = nullptr;
 }
 
 
 void vk_material_impl::accept(vk_uniform_parameters_list_impl* impl)
 {
-    impl->flush(m_curr_apply_command_buffer);
+    impl->flush();
+    m_dynamic_offsets.push_back(impl->get_dynamic_offset());
 }
 
 
 void vk_material_impl::accept(const vk_uniform_parameters_list_impl* impl) const
 {
-    const_cast<vk_uniform_parameters_list_impl*>(impl)->flush(m_curr_apply_command_buffer);
+    const_cast<vk_uniform_parameters_list_impl*>(impl)->flush();
+    m_dynamic_offsets.push_back(impl->get_dynamic_offset());
 }
 
 
@@ -148,6 +163,7 @@ void vk_material_builder::create(material& material)
     PASS_ERROR(create_buffers_data());
     PASS_ERROR(create_textures_data());
     PASS_ERROR(create_descriptor_set_layouts());
+    PASS_ERROR(create_pipeline_layout());
     PASS_ERROR(create_descriptor_pool());
     PASS_ERROR(allocate_descriptor_sets());
     PASS_ERROR(write_descriptors_into_sets());
@@ -212,19 +228,24 @@ void vk_material_builder::accept(const vk_push_constant_parameters_list_impl* pa
 void vk_material_builder::add_buffer_descriptor_data(
     const vk_uniform_parameters_list_impl* params_list) const
 {
-    if (m_pool_sizes.size() <= 1) {
+    // uniform lists are bound at the slice of the current frame with dynamic offsets.
+    if (m_descriptor_buffer_infos.empty()) {
         m_pool_sizes.emplace_back() = {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = 0
         };
 
         m_descriptor_sets_layout_bindings.emplace_back() = {
             .binding = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .descriptorCount = 0,
             .stageFlags = m_vk_stages_flags
         };
     }
 
+    m_pool_sizes.back().descriptorCount++;
+    m_descriptor_sets_layout_bindings.back().descriptorCount++;
+
     m_descriptor_buffer_infos.emplace_back() = {
         .buffer = params_list->get_buffer(),
         .offset = params_list->get_buffer_offset(),
@@ -409,7 +430,7 @@ void vk_material_builder::write_descriptors_into_sets()
             .dstBinding = 0,
             .dstArrayElement = 0,
             .descriptorCount = static_cast<uint32_t>(m_descriptor_buffer_infos.size()),
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .pBufferInfo = m_descriptor_buffer_infos.data(),
         };
     }
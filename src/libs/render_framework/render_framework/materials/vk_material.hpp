@@ -37,6 +37,8 @@ namespace render_framework
             std::unordered_map<size_t, const texture*> m_textures_write_cache;
 
             VkCommandBuffer m_curr_apply_command_buffer{nullptr};
+            // offsets of the uniform lists slices, in binding order.
+            mutable std::vector<uint32_t> m_dynamic_offsets;
             VkShaderStageFlags m_stages;
             std::vector<const parameters_list*> m_parameters_lists;
             std::vector<vk_utils::shader_module_handler> m_modules;
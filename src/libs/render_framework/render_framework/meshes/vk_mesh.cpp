@@ -4,14 +4,40 @@
 
 #include <vk_utils/tools.hpp>
 #include <vk_utils/context.hpp>
+#include <vk_utils/deletion_queue.hpp>
 
 #include <cstring>
+#include <initializer_list>
+#include <vector>
 
 using namespace render_framework;
 using namespace detail;
 
 namespace
 {
+    constexpr VkDeviceSize default_arena_vertex_block_size = 64 * 1024 * 1024;
+    constexpr VkDeviceSize default_arena_index_block_size = 16 * 1024 * 1024;
+
+
+    // the ranges may still be read by submitted frames or uploads, they are freed once those completed.
+    void free_deferred(
+        const std::shared_ptr<render_framework::vk_mesh_arena>& arena,
+        const render_framework::vk_mesh_arena::allocation& vertex_allocation,
+        const render_framework::vk_mesh_arena::allocation& index_allocation)
+    {
+        if (auto* deletion_queue = vk_utils::get_deletion_queue(); deletion_queue != nullptr) {
+            deletion_queue->defer([arena, vertex_allocation, index_allocation]() {
+                arena->free(vertex_allocation);
+                arena->free(index_allocation);
+            });
+
+            return;
+        }
+
+        arena->free(vertex_allocation);
+        arena->free(index_allocation);
+    }
+
     ERROR_TYPE get_vertex_element_data(
         vertex_format::attribute_type attr_type,
         size_t elements_count,
@@ -132,6 +158,19 @@ namespace
 
         RAISE_ERROR_OK();
     }
+
+
+    uint32_t get_index_size(VkIndexType index_type)
+    {
+        switch (index_type) {
+            case VK_INDEX_TYPE_UINT32:
+                return sizeof(uint32_t);
+            case VK_INDEX_TYPE_UINT16:
+                return sizeof(uint16_t);
+            default:
+                return sizeof(uint8_t);
+        }
+    }
 }
 
 
@@ -140,15 +179,23 @@ vk_mesh_impl::vk_mesh_impl(
     VkIndexType index_format,
     VkVertexInputBindingDescription input_binding,
     const std::vector<VkVertexInputAttributeDescription>& input_attrs,
-    vk_utils::vma_buffer_handler vertex_buffer,
-    vk_utils::vma_buffer_handler index_buffer)
+    std::shared_ptr<vk_mesh_arena> arena,
+    const vk_mesh_arena::allocation& vertex_allocation,
+    const vk_mesh_arena::allocation& index_allocation)
     : m_vertex_format(vertex_format)
     , m_index_format(index_format)
     , m_input_binding_description(input_binding)
     , m_vert_input_descriptions(input_attrs)
-    , m_vertex_buffer(std::move(vertex_buffer))
-    , m_index_buffer(std::move(index_buffer))
+    , m_arena(std::move(arena))
+    , m_vertex_allocation(vertex_allocation)
+    , m_index_allocation(index_allocation)
+{
+}
+
+
+vk_mesh_impl::~vk_mesh_impl()
 {
+    free_deferred(m_arena, m_vertex_allocation, m_index_allocation);
 }
 
 
@@ -160,13 +207,37 @@ const render_framework::vertex_format& vk_mesh_impl::get_format() const
 
 VkBuffer vk_mesh_impl::get_vertex_buffer() const
 {
-    return m_vertex_buffer;
+    return m_arena->get_buffer(m_vertex_allocation);
+}
+
+
+VkDeviceSize vk_mesh_impl::get_vertex_buffer_offset() const
+{
+    return m_vertex_allocation.offset;
+}
+
+
+int32_t vk_mesh_impl::get_vertex_offset() const
+{
+    return m_vertex_allocation.offset / m_input_binding_description.stride;
 }
 
 
 VkBuffer vk_mesh_impl::get_index_buffer() const
 {
-    return m_index_buffer;
+    return m_arena->get_buffer(m_index_allocation);
+}
+
+
+VkDeviceSize vk_mesh_impl::get_index_buffer_offset() const
+{
+    return m_index_allocation.offset;
+}
+
+
+uint32_t vk_mesh_impl::get_first_index() const
+{
+    return m_index_allocation.offset / get_index_size(m_index_format);
 }
 
 
@@ -200,6 +271,13 @@ ERROR_TYPE vk_mesh_builder::create(mesh& mesh)
 {
     std::unique_ptr<void, std::function<void(void*)>> clear_guard{nullptr, [this](void*) {clear();}};
 
+    // builders without a command buffer record into the upload context, which also owns the staging memory then.
+    if (m_command_buffer == nullptr && vk_utils::get_upload_context() != nullptr) {
+        m_upload_context = vk_utils::get_upload_context();
+        m_queue_family = m_upload_context->get_queue_family_index();
+        PASS_ERROR(m_upload_context->get_command_buffer(m_command_buffer));
+    }
+
     PASS_ERROR(create_vertex_inputs());
     PASS_ERROR(create_mesh_buffers());
     PASS_ERROR(write_buffers_data());
@@ -211,8 +289,12 @@ ERROR_TYPE vk_mesh_builder::create(mesh& mesh)
         index_type,
         m_input_binding_description,
         m_vert_input_descriptions,
-        std::move(m_vertex_buffer),
-        std::move(m_index_buffer));
+        m_arena,
+        m_vertex_allocation,
+        m_index_allocation);
+
+    m_vertex_allocation = {};
+    m_index_allocation = {};
 
     RAISE_ERROR_OK();
 }
@@ -258,29 +340,24 @@ ERROR_TYPE vk_mesh_builder::create_mesh_buffers()
         RAISE_ERROR_WARN(-1, "vertex data wasn't settled.");
     }
 
-    PASS_ERROR(load_staging_buffer_data(m_vertex_staging_buffer, m_vertex_data.get_size(), m_vertex_data.get()));
+    if (m_arena == nullptr) {
+        m_arena = std::make_shared<vk_mesh_arena>(default_arena_vertex_block_size, default_arena_index_block_size, m_queue_family);
+    }
 
-    PASS_ERROR(vk_utils::create_buffer(
-        m_vertex_buffer,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY,
-        m_vertex_data.get_size(),
-        nullptr,
-        m_queue_family));
+    PASS_ERROR(m_arena->allocate(vk_mesh_arena::BUFFER_TYPE_VERTEX, m_vertex_data.get_size(), m_vertex_format_size, m_vertex_allocation));
+    PASS_ERROR(write_buffer_data(
+        m_vertex_allocation, m_vertex_staging_buffer, m_vertex_data.get_size(), m_vertex_data.get(), m_vertex_staging, m_vertex_staging_offset));
 
     if (m_index_data.get() == nullptr) {
         RAISE_ERROR_OK();
     }
 
-    PASS_ERROR(load_staging_buffer_data(m_index_staging_buffer, m_index_data.get_size(), m_index_data.get()));
+    VkIndexType index_type{};
+    PASS_ERROR(get_index_type(m_index_format, index_type));
 
-    PASS_ERROR(vk_utils::create_buffer(
-        m_index_buffer,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY,
-        m_index_data.get_size(),
-        nullptr,
-        m_queue_family));
+    PASS_ERROR(m_arena->allocate(vk_mesh_arena::BUFFER_TYPE_INDEX, m_index_data.get_size(), get_index_size(index_type), m_index_allocation));
+    PASS_ERROR(write_buffer_data(
+        m_index_allocation, m_index_staging_buffer, m_index_data.get_size(), m_index_data.get(), m_index_staging, m_index_staging_offset));
 
     m_force_reset_staging_buffers = false;
 
@@ -294,39 +371,74 @@ void vk_mesh_builder::clear()
 
     m_vert_input_descriptions.clear();
 
-    m_vertex_buffer = std::move(vk_utils::vma_buffer_handler{});
-    m_index_buffer = std::move(vk_utils::vma_buffer_handler{});
+    // allocations of a failed create are given back.
+    if (m_arena != nullptr) {
+        free_deferred(m_arena, m_vertex_allocation, m_index_allocation);
+    }
+
+    m_vertex_allocation = {};
+    m_index_allocation = {};
+    m_vertex_staging = nullptr;
+    m_index_staging = nullptr;
+
+    if (m_upload_context != nullptr) {
+        m_command_buffer = nullptr;
+        m_upload_context = nullptr;
+    }
 
     mesh_builder::clear();
 }
 
 
+ERROR_TYPE vk_mesh_builder::write_buffer_data(
+    const vk_mesh_arena::allocation& allocation,
+    vk_utils::staging_buffer& staging_buffer,
+    size_t data_size,
+    void* data_to_copy,
+    VkBuffer& out_staging,
+    VkDeviceSize& out_staging_offset)
+{
+    out_staging = nullptr;
+    out_staging_offset = 0;
+
+    // mapped device local ranges need no staging copy nor an ownership transfer.
+    if (auto* mapped_data = m_arena->get_mapped_data(allocation); mapped_data != nullptr) {
+        std::memcpy(mapped_data, data_to_copy, data_size);
+        m_arena->flush(allocation);
+        RAISE_ERROR_OK();
+    }
+
+    if (m_upload_context != nullptr) {
+        PASS_ERROR(m_upload_context->allocate_staging(data_size, sizeof(uint32_t), data_to_copy, out_staging, out_staging_offset));
+        RAISE_ERROR_OK();
+    }
+
+    PASS_ERROR(load_staging_buffer_data(staging_buffer, data_size, data_to_copy));
+
+    out_staging = staging_buffer.get_buffer();
+    out_staging_offset = staging_buffer.get_offset();
+
+    RAISE_ERROR_OK();
+}
+
+
 ERROR_TYPE vk_mesh_builder::load_staging_buffer_data(
-    vk_utils::vma_buffer_handler& buffer,
+    vk_utils::staging_buffer& buffer,
     size_t data_size,
     void* data_to_copy)
 {
-    if (static_cast<VkBuffer>(buffer) != nullptr &&
-        buffer.get_alloc_info().size >= data_size &&
+    if (buffer.is_dedicated() &&
+        buffer.get_size() >= data_size &&
        !m_force_reset_staging_buffers) {
-        void* mapped_data{nullptr};
-        vmaMapMemory(vk_utils::context::get().allocator(), buffer, &mapped_data);
-        std::memcpy(mapped_data, data_to_copy, data_size);
-        vmaFlushAllocation(vk_utils::context::get().allocator(), buffer, 0, data_size);
-        return;
+        std::memcpy(buffer.get_mapped_data(), data_to_copy, data_size);
+        buffer.flush();
+        RAISE_ERROR_OK();
     }
 
-    vk_utils::vma_buffer_handler new_buffer;
-
-    PASS_ERROR(vk_utils::create_buffer(
-        new_buffer,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU,
-        data_size,
-        data_to_copy,
-        m_queue_family));
+    PASS_ERROR(buffer.init(data_size, sizeof(uint32_t), vk_utils::get_staging_ring(), data_to_copy));
 
-    buffer = std::move(new_buffer);
+    // the copy is submitted by the command buffer owner, so ring memory is reclaimed by frames.
+    buffer.release_after_frame();
 
     RAISE_ERROR_OK();
 }
@@ -334,23 +446,112 @@ ERROR_TYPE vk_mesh_builder::load_staging_buffer_data(
 
 ERROR_TYPE vk_mesh_builder::write_buffers_data()
 {
-    VkBufferCopy buffer_copy{
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = m_vertex_data.get_size()
-    };
+    const bool copy_vertices = m_vertex_staging != nullptr;
+    const bool copy_indices = m_index_data.get() != nullptr && m_index_staging != nullptr;
+
+    if (copy_vertices) {
+        VkBufferCopy buffer_copy{
+            .srcOffset = m_vertex_staging_offset,
+            .dstOffset = m_vertex_allocation.offset,
+            .size = m_vertex_data.get_size()
+        };
+
+        vkCmdCopyBuffer(m_command_buffer, m_vertex_staging, m_vertex_allocation.buffer, 1, &buffer_copy);
+    }
+
+    if (copy_indices) {
+        VkBufferCopy buffer_copy{
+            .srcOffset = m_index_staging_offset,
+            .dstOffset = m_index_allocation.offset,
+            .size = m_index_data.get_size()
+        };
+
+        vkCmdCopyBuffer(m_command_buffer, m_index_staging, m_index_allocation.buffer, 1, &buffer_copy);
+    }
+
+    const uint32_t graphics_family = vk_utils::context::get().queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS);
+    vk_utils::queue_ownership_transfer release{m_queue_family, graphics_family};
+
+    if (!copy_vertices && !copy_indices) {
+        RAISE_ERROR_OK();
+    }
+
+    // on the graphics family the copies are only made visible to the vertex input of the following draws.
+    if (!release.is_required()) {
+        std::vector<VkBufferMemoryBarrier> buffer_barriers{};
+
+        if (copy_vertices) {
+            buffer_barriers.push_back({
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .pNext = nullptr,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = m_vertex_allocation.buffer,
+                .offset = m_vertex_allocation.offset,
+                .size = m_vertex_data.get_size(),
+            });
+        }
+
+        if (copy_indices) {
+            buffer_barriers.push_back({
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .pNext = nullptr,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_INDEX_READ_BIT,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = m_index_allocation.buffer,
+                .offset = m_index_allocation.offset,
+                .size = m_index_data.get_size(),
+            });
+        }
+
+        vkCmdPipelineBarrier(
+            m_command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            0,
+            nullptr,
+            buffer_barriers.size(),
+            buffer_barriers.data(),
+            0,
+            nullptr);
+
+        RAISE_ERROR_OK();
+    }
+
+    if (m_pending_acquire.get_src_queue_family_index() != m_queue_family) {
+        m_pending_acquire = vk_utils::queue_ownership_transfer{m_queue_family, graphics_family};
+    }
 
-    vkCmdCopyBuffer(m_command_buffer, m_vertex_staging_buffer, m_vertex_buffer, 1, &buffer_copy);
+    for (auto* ownership_transfer : {&release, &m_pending_acquire}) {
+        if (copy_vertices) {
+            ownership_transfer->add_buffer(
+                m_vertex_allocation.buffer, m_vertex_allocation.offset, m_vertex_data.get_size(), VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        }
 
-    if (m_index_data.get() != nullptr) {
-        buffer_copy.size = m_index_data.get_size();
-        vkCmdCopyBuffer(m_command_buffer, m_index_staging_buffer, m_index_buffer, 1, &buffer_copy);
+        if (copy_indices) {
+            ownership_transfer->add_buffer(
+                m_index_allocation.buffer, m_index_allocation.offset, m_index_data.get_size(), VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_INDEX_READ_BIT);
+        }
     }
 
+    release.record_release(m_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
     RAISE_ERROR_OK();
 }
 
 
+void vk_mesh_builder::record_acquire(VkCommandBuffer graphics_command_buffer, VkPipelineStageFlags dst_stages)
+{
+    m_pending_acquire.record_acquire(graphics_command_buffer, dst_stages);
+    m_pending_acquire.clear();
+}
+
+
 vk_mesh_builder& vk_mesh_builder::set_command_buffer(VkCommandBuffer command_buffer)
 {
     m_command_buffer = command_buffer;
@@ -358,6 +559,13 @@ vk_mesh_builder& vk_mesh_builder::set_command_buffer(VkCommandBuffer command_buf
 }
 
 
+vk_mesh_builder& vk_mesh_builder::set_arena(std::shared_ptr<vk_mesh_arena> arena)
+{
+    m_arena = std::move(arena);
+    return *this;
+}
+
+
 vk_mesh_builder& vk_mesh_builder::set_queue_family_index(uint32_t queue_family_index)
 {
     m_force_reset_staging_buffers = m_queue_family == queue_family_index;
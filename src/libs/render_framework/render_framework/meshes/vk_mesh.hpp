@@ -1,7 +1,13 @@
 #pragma once
 
 #include <render_framework/meshes/mesh.hpp>
+#include <render_framework/meshes/vk_mesh_arena.hpp>
 #include <vk_utils/handlers.hpp>
+#include <vk_utils/staging_ring.hpp>
+#include <vk_utils/transfer_upload.hpp>
+#include <vk_utils/upload_context.hpp>
+
+#include <memory>
 
 
 namespace render_framework
@@ -16,15 +22,23 @@ namespace render_framework
                 VkIndexType index_format,
                 VkVertexInputBindingDescription input_binding,
                 const std::vector<VkVertexInputAttributeDescription>& input_attrs,
-                vk_utils::vma_buffer_handler vertex_buffer,
-                vk_utils::vma_buffer_handler index_buffer);
+                std::shared_ptr<vk_mesh_arena> arena,
+                const vk_mesh_arena::allocation& vertex_allocation,
+                const vk_mesh_arena::allocation& index_allocation);
 
-            ~vk_mesh_impl() override = default;
+            ~vk_mesh_impl() override;
 
             const vertex_format& get_format() const override;
 
+            // buffers are shared with other meshes of the arena,
+            // bind them at offset 0 and draw with get_vertex_offset()/get_first_index() or bind them at the buffer offsets.
             VkBuffer get_vertex_buffer() const;
+            VkDeviceSize get_vertex_buffer_offset() const;
+            int32_t get_vertex_offset() const;
+
             VkBuffer get_index_buffer() const;
+            VkDeviceSize get_index_buffer_offset() const;
+            uint32_t get_first_index() const;
             VkIndexType get_index_format() const;
 
             const VkVertexInputBindingDescription* get_input_bindings() const;
@@ -35,8 +49,9 @@ namespace render_framework
 
             VkVertexInputBindingDescription m_input_binding_description{};
             std::vector<VkVertexInputAttributeDescription> m_vert_input_descriptions{};
-            vk_utils::vma_buffer_handler m_vertex_buffer{};
-            vk_utils::vma_buffer_handler m_index_buffer{};
+            std::shared_ptr<vk_mesh_arena> m_arena{};
+            vk_mesh_arena::allocation m_vertex_allocation{};
+            vk_mesh_arena::allocation m_index_allocation{};
         };
     }
 
@@ -48,6 +63,15 @@ namespace render_framework
 
         vk_mesh_builder& set_command_buffer(VkCommandBuffer);
         vk_mesh_builder& set_queue_family_index(uint32_t);
+        // meshes created by builders sharing an arena share their vertex and index buffers,
+        // a builder without an arena creates its own on first use.
+        vk_mesh_builder& set_arena(std::shared_ptr<vk_mesh_arena>);
+
+        // without a command buffer meshes are recorded into the upload context when one is set, see vk_utils::set_upload_context.
+        // a builder recording for a queue family other than the graphics one, e.g. the dedicated transfer one,
+        // releases the written buffers to the graphics family. the matching acquire barriers are recorded here
+        // into a graphics command buffer which is submitted after the builder one, waiting on its semaphore at dst_stages.
+        void record_acquire(VkCommandBuffer graphics_command_buffer, VkPipelineStageFlags dst_stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 
         virtual ~vk_mesh_builder() = default;
         ERROR_TYPE create(mesh& mesh) override;
@@ -59,24 +83,39 @@ namespace render_framework
         ERROR_TYPE create_vertex_inputs();
         ERROR_TYPE create_mesh_buffers();
         ERROR_TYPE write_buffers_data();
+        ERROR_TYPE write_buffer_data(
+            const vk_mesh_arena::allocation& allocation,
+            vk_utils::staging_buffer& staging_buffer,
+            size_t data_size,
+            void* data_to_copy,
+            VkBuffer& out_staging,
+            VkDeviceSize& out_staging_offset);
         ERROR_TYPE load_staging_buffer_data(
-            vk_utils::vma_buffer_handler& buffer,
+            vk_utils::staging_buffer& buffer,
             size_t data_size,
             void* data_to_copy);
 
         bool m_force_reset_staging_buffers{false};
         VkCommandBuffer m_command_buffer{nullptr};
         uint32_t m_queue_family{};
+        vk_utils::upload_context* m_upload_context{nullptr};
+        vk_utils::queue_ownership_transfer m_pending_acquire{};
 
         VkVertexInputBindingDescription m_input_binding_description{};
         std::vector<VkVertexInputAttributeDescription> m_vert_input_descriptions{};
         uint32_t m_vertex_format_size{0};
 
-        vk_utils::vma_buffer_handler m_vertex_buffer{};
-        vk_utils::vma_buffer_handler m_index_buffer{};
-
-        vk_utils::vma_buffer_handler m_vertex_staging_buffer{};
-        vk_utils::vma_buffer_handler m_index_staging_buffer{};
+        std::shared_ptr<vk_mesh_arena> m_arena{};
+        vk_mesh_arena::allocation m_vertex_allocation{};
+        vk_mesh_arena::allocation m_index_allocation{};
+        // staging copy sources, null for ranges written directly.
+        VkBuffer m_vertex_staging{nullptr};
+        VkDeviceSize m_vertex_staging_offset{0};
+        VkBuffer m_index_staging{nullptr};
+        VkDeviceSize m_index_staging_offset{0};
+
+        vk_utils::staging_buffer m_vertex_staging_buffer{};
+        vk_utils::staging_buffer m_index_staging_buffer{};
     };
 }
 
@@ -0,0 +1,154 @@
+
+
+#include "vk_mesh_arena.hpp"
+
+#include <vk_utils/tools.hpp>
+#include <vk_utils/context.hpp>
+
+#include <algorithm>
+
+using namespace render_framework;
+
+
+vk_mesh_arena::vk_mesh_arena(VkDeviceSize vertex_block_size, VkDeviceSize index_block_size, uint32_t queue_family_index)
+    : m_block_sizes{vertex_block_size, index_block_size}
+    , m_queue_family_index(queue_family_index)
+    , m_defragmenter(vk_utils::get_defragmenter())
+{
+}
+
+
+vk_mesh_arena::~vk_mesh_arena()
+{
+    if (m_defragmenter == nullptr) {
+        return;
+    }
+
+    for (const auto& blocks : m_blocks) {
+        for (const auto& block : blocks) {
+            m_defragmenter->unregister(block.defragmentation_id);
+        }
+    }
+}
+
+
+ERROR_TYPE vk_mesh_arena::allocate(buffer_type type, VkDeviceSize size, VkDeviceSize alignment, allocation& out_allocation)
+{
+    if (type >= BUFFER_TYPE_MAX_ENUM || size == 0) {
+        RAISE_ERROR_WARN(-1, "invalid mesh arena allocation.");
+    }
+
+    auto& blocks = m_blocks[type];
+    VkDeviceSize offset = 0;
+    uint32_t block_index = 0;
+
+    for (; block_index < blocks.size(); ++block_index) {
+        if (blocks[block_index].ranges.allocate(size, alignment, offset)) {
+            break;
+        }
+    }
+
+    if (block_index == blocks.size()) {
+        PASS_ERROR(create_block(type, std::max(m_block_sizes[type], size)));
+
+        if (!blocks.back().ranges.allocate(size, alignment, offset)) {
+            RAISE_ERROR_WARN(-1, "cannot allocate mesh arena range.");
+        }
+    }
+
+    out_allocation = {
+        .buffer = blocks[block_index].buffer,
+        .offset = offset,
+        .size = size,
+        .type = type,
+        .block_index = block_index,
+    };
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_mesh_arena::free(const allocation& allocation)
+{
+    if (allocation.buffer == nullptr) {
+        return;
+    }
+
+    m_blocks[allocation.type][allocation.block_index].ranges.free(allocation.offset, allocation.size);
+}
+
+
+VkBuffer vk_mesh_arena::get_buffer(const allocation& allocation) const
+{
+    if (allocation.buffer == nullptr) {
+        return nullptr;
+    }
+
+    return m_blocks[allocation.type][allocation.block_index].buffer;
+}
+
+
+uint8_t* vk_mesh_arena::get_mapped_data(const allocation& allocation) const
+{
+    if (allocation.buffer == nullptr || (m_defragmenter != nullptr && m_defragmenter->is_running())) {
+        return nullptr;
+    }
+
+    auto* mapped_data = static_cast<uint8_t*>(m_blocks[allocation.type][allocation.block_index].buffer.get_alloc_info().pMappedData);
+
+    return mapped_data != nullptr ? mapped_data + allocation.offset : nullptr;
+}
+
+
+void vk_mesh_arena::flush(const allocation& allocation) const
+{
+    const auto& buffer = m_blocks[allocation.type][allocation.block_index].buffer;
+    vmaFlushAllocation(vk_utils::context::get().allocator(), buffer, allocation.offset, allocation.size);
+}
+
+
+uint32_t vk_mesh_arena::get_blocks_count(buffer_type type) const
+{
+    return m_blocks[type].size();
+}
+
+
+void vk_mesh_arena::set_on_moved(std::function<void()> on_moved)
+{
+    m_on_moved = std::move(on_moved);
+}
+
+
+ERROR_TYPE vk_mesh_arena::create_block(buffer_type type, VkDeviceSize size)
+{
+    const VkBufferUsageFlags usage = type == BUFFER_TYPE_VERTEX ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+    block new_block{};
+
+    // transfer source for defragmentation copies.
+    const VkBufferUsageFlags block_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
+
+    if (!vk_utils::create_direct_write_buffer(new_block.buffer, block_usage, size, m_queue_family_index, vk_utils::MEMORY_TAG_GEOMETRY)) {
+        PASS_ERROR(vk_utils::create_buffer(
+            new_block.buffer,
+            block_usage,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            size,
+            nullptr,
+            m_queue_family_index,
+            vk_utils::MEMORY_TAG_GEOMETRY));
+    }
+
+    new_block.ranges = vk_utils::range_allocator{size};
+    auto& added_block = m_blocks[type].emplace_back(std::move(new_block));
+
+    if (m_defragmenter != nullptr) {
+        added_block.defragmentation_id = m_defragmenter->register_buffer(added_block.buffer, [this]() {
+            if (m_on_moved) {
+                m_on_moved();
+            }
+        });
+    }
+
+    RAISE_ERROR_OK();
+}
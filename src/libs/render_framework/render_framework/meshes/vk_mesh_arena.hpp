@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/defragmenter.hpp>
+#include <vk_utils/range_allocator.hpp>
+#include <errors/error_handler.hpp>
+
+#include <deque>
+#include <functional>
+
+namespace render_framework
+{
+    // Large device local vertex and index buffers shared by meshes.
+    // ranges are sub-allocated per buffer by a range_allocator, vertex ranges are aligned to the vertex stride,
+    // so meshes of one format sharing a buffer are drawn from one binding with vertexOffset/firstIndex.
+    // blocks are registered for defragmentation, so users look buffers up with get_buffer() instead of keeping allocation.buffer.
+    // on devices with host visible device local memory blocks are persistently mapped and ranges are written without staging.
+    class vk_mesh_arena
+    {
+    public:
+        enum buffer_type
+        {
+            BUFFER_TYPE_VERTEX,
+            BUFFER_TYPE_INDEX,
+            BUFFER_TYPE_MAX_ENUM
+        };
+
+        struct allocation
+        {
+            VkBuffer buffer{nullptr};
+            VkDeviceSize offset{0};
+            VkDeviceSize size{0};
+            buffer_type type{BUFFER_TYPE_VERTEX};
+            uint32_t block_index{0};
+        };
+
+        // ranges larger than the block size get a block of their own size.
+        vk_mesh_arena(VkDeviceSize vertex_block_size, VkDeviceSize index_block_size, uint32_t queue_family_index = -1);
+        vk_mesh_arena(const vk_mesh_arena&) = delete;
+        vk_mesh_arena& operator=(const vk_mesh_arena&) = delete;
+        ~vk_mesh_arena();
+
+        ERROR_TYPE allocate(buffer_type type, VkDeviceSize size, VkDeviceSize alignment, allocation& out_allocation);
+        // the range must not be used by pending commands anymore.
+        void free(const allocation& allocation);
+
+        VkBuffer get_buffer(const allocation& allocation) const;
+        // nullptr when the range has to be written by a transfer, also while a defragmentation could still copy over it.
+        uint8_t* get_mapped_data(const allocation& allocation) const;
+        void flush(const allocation& allocation) const;
+        uint32_t get_blocks_count(buffer_type type) const;
+        // called when a defragmentation moved one of the blocks, users which recorded get_buffer() results
+        // into command buffers record them again, the previous buffer stays valid until the move completed.
+        void set_on_moved(std::function<void()> on_moved);
+
+    private:
+        struct block
+        {
+            vk_utils::vma_buffer_handler buffer{};
+            vk_utils::range_allocator ranges{};
+            vk_utils::defragmenter::resource_id defragmentation_id{0};
+        };
+
+        ERROR_TYPE create_block(buffer_type type, VkDeviceSize size);
+
+        VkDeviceSize m_block_sizes[BUFFER_TYPE_MAX_ENUM]{};
+        // blocks keep their addresses while registered for defragmentation.
+        std::deque<block> m_blocks[BUFFER_TYPE_MAX_ENUM]{};
+        uint32_t m_queue_family_index{};
+        vk_utils::defragmenter* m_defragmenter{nullptr};
+        std::function<void()> m_on_moved{};
+    };
+} // namespace render_framework
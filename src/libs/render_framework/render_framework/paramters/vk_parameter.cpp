@@ -1,8 +1,10 @@
 #include <render_framework/paramters/vk_parameter.hpp>
 
 #include <vk_utils/context.hpp>
+#include <vk_utils/deletion_queue.hpp>
 #include <vk_utils/tools.hpp>
 
+#include <cassert>
 #include <cstring>
 
 using namespace render_framework;
@@ -38,6 +40,12 @@ namespace
         auto padding = alignment - size & (alignment - 1);
         return size + padding;
     }
+
+
+    uint32_t all_slices_mask(uint32_t slices_count)
+    {
+        return slices_count >= 32 ? ~0u : (1u << slices_count) - 1;
+    }
 }
 
 
@@ -46,7 +54,7 @@ detail::vk_parameters_list_impl::vk_parameters_list_impl(
     : m_parameters_data(std::move(parameters))
     , m_parameters_map(std::move(parameters_map))
 {
-    m_data_buffer.reserve(buffer_size);
+    m_data_buffer.resize(buffer_size);
 }
 
 
@@ -61,52 +69,107 @@ detail::vk_uniform_parameters_list_impl::vk_uniform_parameters_list_impl(
     std::vector<parameter_data>& parameters,
     std::unordered_map<const parameter*, size_t>& parameters_map,
     size_t buffer_size,
-    vk_utils::vma_buffer_handler staging_buffer,
-    vk_utils::vma_buffer_handler uniform_buffer)
+    vk_utils::uniform_pool* pool,
+    const vk_utils::uniform_pool::allocation& allocation,
+    size_t slice_size)
     : vk_parameters_list_impl(parameters, parameters_map, buffer_size)
-    , m_staging_buffer(std::move(staging_buffer))
-    , m_uniform_buffer(std::move(uniform_buffer))
+    , m_pool(pool)
+    , m_allocation(allocation)
+    , m_slice_size(slice_size)
+{
+    m_pending_slices.resize(m_parameters_data.size(), all_slices_mask(m_pool->get_frames_count()));
+}
+
+
+detail::vk_uniform_parameters_list_impl::~vk_uniform_parameters_list_impl()
 {
+    // slices may still be read by frames in flight.
+    if (auto* deletion_queue = vk_utils::get_deletion_queue(); deletion_queue != nullptr) {
+        deletion_queue->defer([pool = m_pool, allocation = m_allocation]() {
+            pool->free(allocation);
+        });
+
+        return;
+    }
+
+    m_pool->free(m_allocation);
 }
 
 
 void detail::vk_uniform_parameters_list_impl::on_parameter_updated(const parameter* parameter, const uint8_t* value)
 {
     vk_parameters_list_impl::on_parameter_updated(parameter, value);
+    m_pending_slices[m_parameters_map[parameter]] = all_slices_mask(m_pool->get_frames_count());
     m_dirty = true;
 }
 
 
-void detail::vk_uniform_parameters_list_impl::flush(VkCommandBuffer command_buffer)
+void detail::vk_uniform_parameters_list_impl::flush()
 {
     if (!m_dirty) {
         return;
     }
 
-    void* mapped_memory{nullptr};
-
-    vmaMapMemory(vk_utils::context::get().allocator(), m_staging_buffer, &mapped_memory);
-
-    std::memcpy(mapped_memory, m_data_buffer.data(), m_data_buffer.size());
-    
-    vmaFlushAllocation(
-        vk_utils::context::get().allocator(),
-        m_staging_buffer,
-        0,
-        VK_WHOLE_SIZE);
-    
-    VkBufferCopy buffer_copy{
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = m_data_buffer.size()
+    // slices of previous frames may still be read, the current frame slice is not submitted yet.
+    if (m_slice_frame != m_pool->get_frame_index()) {
+        m_slice = (m_slice + 1) % m_pool->get_frames_count();
+        m_slice_frame = m_pool->get_frame_index();
+    }
+
+    auto* slice_data = m_pool->get_mapped_data(m_allocation) + get_dynamic_offset();
+    const uint32_t slice_bit = 1u << m_slice;
+
+    size_t range_begin{0};
+    size_t range_end{0};
+
+    m_written_bytes = 0;
+
+    auto write_range = [&]() {
+        std::memcpy(slice_data + range_begin, m_data_buffer.data() + range_begin, range_end - range_begin);
+        m_pool->mark_written(m_allocation, get_dynamic_offset() + range_begin, range_end - range_begin);
+        m_written_bytes += range_end - range_begin;
     };
 
-    vkCmdCopyBuffer(
-        command_buffer,
-        m_staging_buffer,
-        m_uniform_buffer,
-        1,
-        &buffer_copy);
+#ifndef NDEBUG
+    size_t pending_bytes{0};
+    size_t aligned_pending_bytes{0};
+#endif
+
+    // parameters are laid out in order, padding between adjacent ones is copied with them.
+    for (size_t i = 0; i < m_parameters_data.size(); ++i) {
+        if ((m_pending_slices[i] & slice_bit) == 0) {
+            continue;
+        }
+
+        m_pending_slices[i] &= ~slice_bit;
+
+        const auto& data_view = m_parameters_data[i];
+
+#ifndef NDEBUG
+        pending_bytes += data_view.data_size;
+        aligned_pending_bytes += align(data_view.data_size, buffer_alignment);
+#endif
+
+        if (range_end != range_begin && data_view.data_offset > align(range_end, buffer_alignment)) {
+            write_range();
+            range_begin = range_end;
+        }
+
+        if (range_end == range_begin) {
+            range_begin = data_view.data_offset;
+        }
+
+        range_end = data_view.data_offset + data_view.data_size;
+    }
+
+    if (range_end != range_begin) {
+        write_range();
+    }
+
+#ifndef NDEBUG
+    // only updated parameters and the padding between adjacent ones may be written.
+    assert(m_written_bytes >= pending_bytes && m_written_bytes <= aligned_pending_bytes);
+#endif
 
     m_dirty = false;
 }
@@ -126,13 +189,13 @@ void detail::vk_uniform_parameters_list_impl::visit(const detail::vk_parameters_
 
 VkBuffer detail::vk_uniform_parameters_list_impl::get_buffer() const
 {
-    return m_uniform_buffer;
+    return m_pool->get_buffer(m_allocation);
 }
 
 
 size_t detail::vk_uniform_parameters_list_impl::get_buffer_offset() const
 {
-    return 0;
+    return m_allocation.offset;
 }
 
 
@@ -142,6 +205,18 @@ size_t detail::vk_uniform_parameters_list_impl::get_buffer_size() const
 }
 
 
+size_t detail::vk_uniform_parameters_list_impl::get_written_bytes() const
+{
+    return m_written_bytes;
+}
+
+
+uint32_t detail::vk_uniform_parameters_list_impl::get_dynamic_offset() const
+{
+    return static_cast<uint32_t>(m_slice * m_slice_size);
+}
+
+
 detail::vk_push_constant_parameters_list_impl::vk_push_constant_parameters_list_impl(
     std::vector<parameter_data>& parameters, 
     std::unordered_map<const parameter*, size_t>& parameters_map, 
@@ -184,30 +259,32 @@ size_t detail::vk_push_constant_parameters_list_impl::get_buffer_size() const
 }
 
 
+vk_uniform_parameters_list_builder& vk_uniform_parameters_list_builder::set_pool(vk_utils::uniform_pool* pool)
+{
+    m_pool = pool;
+    return *this;
+}
+
+
 ERROR_TYPE vk_uniform_parameters_list_builder::create(parameters_list& reslut)
 {
     parameters_list_args args{};
     PASS_ERROR(get_paramters_list_args(args));
 
-    vk_utils::vma_buffer_handler uniform_buffer;
-    vk_utils::vma_buffer_handler uniform_staging_buffer;
+    auto* pool = m_pool != nullptr ? m_pool : vk_utils::get_uniform_pool();
+
+    if (pool == nullptr) {
+        RAISE_ERROR_WARN(-1, "uniform parameters lists require a uniform pool.");
+    }
 
-    PASS_ERROR(vk_utils::create_buffer(
-        uniform_buffer,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY,
-        args.buffer_size,
-        nullptr));
+    // dynamic offsets are multiples of the minimal uniform buffer offset alignment.
+    const size_t slice_size = align(args.buffer_size, pool->get_alignment());
 
-    PASS_ERROR(vk_utils::create_buffer(
-        uniform_staging_buffer,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU,
-        args.buffer_size,
-        nullptr));
+    vk_utils::uniform_pool::allocation allocation{};
+    PASS_ERROR(pool->allocate(slice_size * pool->get_frames_count(), allocation));
 
     reslut = parameters_list::create<detail::vk_uniform_parameters_list_impl>(
-        args.params_data, args.parameters_map, args.buffer_size, std::move(uniform_staging_buffer), std::move(uniform_buffer));
+        args.params_data, args.parameters_map, args.buffer_size, pool, allocation, slice_size);
 
     RAISE_ERROR_OK();
 }
@@ -3,7 +3,9 @@
 #include <render_framework/paramters/parameter.hpp>
 
 #include <vk_utils/handlers.hpp>
+#include <vk_utils/uniform_pool.hpp>
 
+#include <memory>
 #include <unordered_map>
 
 namespace render_framework
@@ -56,6 +58,10 @@ namespace render_framework
         };
 
 
+        // Uniform data in a pool range with one slice per frame in flight, bound as a dynamic uniform buffer.
+        // every flush of updated data writes the next slice, so slices read by previous frames are left untouched.
+        // only parameters updated since the slice was last written are copied, adjacent ones as one range.
+        // lists are flushed before the pool, a list flushed again within the frame rewrites the same slice.
         class vk_uniform_parameters_list_impl : public vk_parameters_list_impl
         {
         public:
@@ -67,22 +73,34 @@ namespace render_framework
                 std::vector<parameter_data>& parameters,
                 std::unordered_map<const parameter*, size_t>& parameters_map,
                 size_t buffer_size,
-                vk_utils::vma_buffer_handler staging_buffer,
-                vk_utils::vma_buffer_handler uniform_buffer);
+                vk_utils::uniform_pool* pool,
+                const vk_utils::uniform_pool::allocation& allocation,
+                size_t slice_size);
 
-            ~vk_uniform_parameters_list_impl() override = default;
+            ~vk_uniform_parameters_list_impl() override;
 
             virtual void on_parameter_updated(const parameter* parameter, const uint8_t* value) override;
 
             VkBuffer get_buffer() const;
             size_t get_buffer_offset() const;
             size_t get_buffer_size() const;
+            // offset of the slice written by the last flush.
+            uint32_t get_dynamic_offset() const;
+            // bytes copied into the slice by the last flush.
+            size_t get_written_bytes() const;
 
-            void flush(VkCommandBuffer);
+            void flush();
 
         private:
-            vk_utils::vma_buffer_handler m_staging_buffer;
-            vk_utils::vma_buffer_handler m_uniform_buffer;
+            vk_utils::uniform_pool* m_pool;
+            vk_utils::uniform_pool::allocation m_allocation;
+            size_t m_slice_size{0};
+            uint32_t m_slice{0};
+            // pool frame the current slice was selected in.
+            uint64_t m_slice_frame{UINT64_MAX};
+            // per parameter, slices not holding its last value yet.
+            std::vector<uint32_t> m_pending_slices;
+            size_t m_written_bytes{0};
 
             bool m_dirty = true;
         };
@@ -136,7 +154,13 @@ namespace render_framework
     class vk_uniform_parameters_list_builder : public vk_parameters_list_builder
     {
     public:
+        // lists are allocated from the pool set by vk_utils::set_uniform_pool unless another one is set,
+        // the pool has to outlive them.
+        vk_uniform_parameters_list_builder& set_pool(vk_utils::uniform_pool*);
         virtual ERROR_TYPE create(parameters_list&);
+
+    protected:
+        vk_utils::uniform_pool* m_pool{nullptr};
     };
      
 
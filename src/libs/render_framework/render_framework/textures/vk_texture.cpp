@@ -1,6 +1,8 @@
 #include "vk_texture.hpp"
 
 #include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
+#include <vk_utils/upload_context.hpp>
 
 
 using namespace render_framework;
@@ -13,7 +15,21 @@ detail::vk_texture_impl::vk_texture_impl(
     : m_image(std::move(image))
     , m_image_view(std::move(image_view))
     , m_image_sampler(std::move(image_sampler))
+    , m_defragmenter(vk_utils::get_defragmenter())
 {
+    if (m_defragmenter != nullptr) {
+        m_defragmentation_id = m_defragmenter->register_image(m_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, [this]() {
+            on_image_moved();
+        });
+    }
+}
+
+
+detail::vk_texture_impl::~vk_texture_impl()
+{
+    if (m_defragmenter != nullptr) {
+        m_defragmenter->unregister(m_defragmentation_id);
+    }
 }
 
 
@@ -35,6 +51,17 @@ VkSampler vk_texture_impl::get_sampler() const
 }
 
 
+// materials write the texture view into their descriptor sets on apply, so they pick up the new view on their own.
+void vk_texture_impl::on_image_moved()
+{
+    vk_utils::image_view_handler image_view{};
+    HANDLE_ERROR(vk_utils::create_image_view(m_image, image_view));
+
+    m_defragmenter->retire(std::move(m_image_view));
+    m_image_view = std::move(image_view);
+}
+
+
 vk_texture_builder::vk_texture_builder(uint32_t queue_family)
 {
     set_queue_family(queue_family);
@@ -71,6 +98,21 @@ vk_texture_builder& vk_texture_builder::set_queue_family(uint32_t queue_family)
 
 ERROR_TYPE vk_texture_builder::create(texture& result)
 {
+    // without an explicit command buffer the upload is recorded into the upload context and submitted by its next flush.
+    if (auto* upload_context = vk_utils::get_upload_context(); m_command_buffer == nullptr && upload_context != nullptr) {
+        VkCommandBuffer command_buffer{nullptr};
+        PASS_ERROR(upload_context->get_command_buffer(command_buffer));
+
+        vk_utils::vma_image_handler image{};
+        vk_utils::image_view_handler image_view{};
+        vk_utils::sampler_handler image_sampler{};
+
+        PASS_ERROR(create_vk_texture(image, image_view, image_sampler, upload_context->get_queue_family_index(), command_buffer));
+
+        result = texture::create<vk_texture_impl>(std::move(image), std::move(image_view), std::move(image_sampler));
+        RAISE_ERROR_OK();
+    }
+
     if (m_queue_family == -1) {
         RAISE_ERROR_WARN(-1, "invalid queue family.");
     }
@@ -119,8 +161,12 @@ ERROR_TYPE vk_texture_builder::create(texture& result)
         .signalSemaphoreCount = 0
     };
 
-    vkQueueSubmit(m_queue, 1, &submit_info, nullptr);
-    vkQueueWaitIdle(m_queue);
+    vk_utils::submission_token submission{};
+    if (const auto e = vk_utils::context::get().submit(m_queue, submit_info, submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit texture upload.");
+    }
+
+    vk_utils::context::get().wait(submission);
 
     if (cmd_buffer.handlers_count() > 0) {
         m_command_buffer = nullptr;
@@ -3,6 +3,7 @@
 #include <render_framework/textures/texture.hpp>
 
 #include <vk_utils/handlers.hpp>
+#include <vk_utils/defragmenter.hpp>
 
 
 namespace render_framework
@@ -17,16 +18,21 @@ namespace render_framework
                 vk_utils::image_view_handler image_view,
                 vk_utils::sampler_handler image_sampler);
 
-            ~vk_texture_impl() override = default;
+            ~vk_texture_impl() override;
 
             VkImage get_image() const;
             VkImageView get_image_view() const;
             VkSampler get_sampler() const;
 
         private:
+            void on_image_moved();
+
             vk_utils::vma_image_handler m_image;
             vk_utils::image_view_handler m_image_view;
             vk_utils::sampler_handler m_image_sampler;
+
+            vk_utils::defragmenter* m_defragmenter{nullptr};
+            vk_utils::defragmenter::resource_id m_defragmentation_id{0};
         };
     }
 
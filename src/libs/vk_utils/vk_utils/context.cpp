@@ -36,11 +36,119 @@ namespace
 #include <vector>
 #include <cstring>
 #include <optional>
+#include <memory>
 
 namespace
 {
     std::optional<vk_utils::context> ctx;
 
+
+    void write_tag_statistics_json(FILE* file, const vk_utils::memory_tag_statistics (&tags)[vk_utils::MEMORY_TAG_MAX_ENUM])
+    {
+        fprintf(file, "{");
+
+        for (uint32_t tag = 0; tag < vk_utils::MEMORY_TAG_MAX_ENUM; ++tag) {
+            fprintf(
+                file,
+                "%s\"%s\":{\"allocation_count\":%u,\"allocation_bytes\":%llu,\"peak_allocation_bytes\":%llu}",
+                tag > 0 ? "," : "",
+                vk_utils::get_memory_tag_name(static_cast<vk_utils::memory_tag>(tag)),
+                tags[tag].allocation_count,
+                static_cast<unsigned long long>(tags[tag].allocation_bytes),
+                static_cast<unsigned long long>(tags[tag].peak_allocation_bytes));
+        }
+
+        fprintf(file, "}");
+    }
+
+
+    void write_host_allocation_statistics_json(FILE* file, const char* name, const vk_utils::host_allocation_statistics& stats, bool first)
+    {
+        fprintf(
+            file,
+            "%s\"%s\":{\"allocation_count\":%u,\"allocation_bytes\":%llu,\"peak_allocation_bytes\":%llu}",
+            first ? "" : ",",
+            name,
+            stats.allocation_count,
+            static_cast<unsigned long long>(stats.allocation_bytes),
+            static_cast<unsigned long long>(stats.peak_allocation_bytes));
+    }
+
+
+    void write_host_statistics_json(FILE* file, const vk_utils::host_memory_statistics& host)
+    {
+        fprintf(file, "{\"objects\":{");
+
+        for (uint32_t object = 0; object < vk_utils::HOST_OBJECT_MAX_ENUM; ++object) {
+            write_host_allocation_statistics_json(file, vk_utils::get_host_object_name(static_cast<vk_utils::host_object>(object)), host.objects[object], object == 0);
+        }
+
+        fprintf(file, "},\"scopes\":{");
+
+        for (uint32_t scope = 0; scope < vk_utils::HOST_ALLOCATION_SCOPES_COUNT; ++scope) {
+            write_host_allocation_statistics_json(file, vk_utils::get_host_allocation_scope_name(static_cast<VkSystemAllocationScope>(scope)), host.scopes[scope], scope == 0);
+        }
+
+        fprintf(file, "},\"internal\":{");
+
+        for (uint32_t scope = 0; scope < vk_utils::HOST_ALLOCATION_SCOPES_COUNT; ++scope) {
+            write_host_allocation_statistics_json(file, vk_utils::get_host_allocation_scope_name(static_cast<VkSystemAllocationScope>(scope)), host.internal[scope], scope == 0);
+        }
+
+        fprintf(file, "},");
+        write_host_allocation_statistics_json(file, "arenas", host.arenas, true);
+        fprintf(file, "}");
+    }
+
+
+    // single line json, the periodic dump appends one object per line.
+    void write_memory_statistics_json(FILE* file, const vk_utils::context::memory_statistics& stats, double time)
+    {
+        fprintf(file, "{\"time\":%.3f,\"heaps\":[", time);
+
+        for (size_t i = 0; i < stats.heaps.size(); ++i) {
+            const auto& heap = stats.heaps[i];
+
+            fprintf(
+                file,
+                "%s{\"index\":%zu,\"size\":%llu,\"device_local\":%s,\"budget\":%llu,\"usage\":%llu,"
+                "\"block_count\":%u,\"block_bytes\":%llu,\"allocation_count\":%u,\"allocation_bytes\":%llu,\"tags\":",
+                i > 0 ? "," : "",
+                i,
+                static_cast<unsigned long long>(heap.size),
+                (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 ? "true" : "false",
+                static_cast<unsigned long long>(heap.budget),
+                static_cast<unsigned long long>(heap.usage),
+                heap.block_count,
+                static_cast<unsigned long long>(heap.block_bytes),
+                heap.allocation_count,
+                static_cast<unsigned long long>(heap.allocation_bytes));
+
+            write_tag_statistics_json(file, heap.tags);
+            fprintf(file, "}");
+        }
+
+        fprintf(file, "],\"tags\":");
+        write_tag_statistics_json(file, stats.tags);
+        fprintf(file, ",\"host\":");
+        write_host_statistics_json(file, stats.host);
+        fprintf(file, "}\n");
+    }
+
+
+    bool write_memory_statistics_file(const char* path, const char* mode, const vk_utils::context::memory_statistics& stats, double time)
+    {
+        std::unique_ptr<FILE, decltype(&fclose)> file(fopen(path, mode), &fclose);
+
+        if (file == nullptr) {
+            return false;
+        }
+
+        write_memory_statistics_json(file.get(), stats, time);
+
+        return true;
+    }
+
     void merge_extensions_list(const std::vector<VkExtensionProperties>& props, const char** ext_list, uint32_t ext_count, std::vector<const char*>& out_extensions)
     {
         for (uint32_t i = 0; i < ext_count; ++i) {
@@ -131,6 +239,17 @@ namespace
     };
 
 
+    // dedicated transfer families are backed by copy engines which run concurrently with graphics work.
+    uint32_t get_transfer_family_score(VkQueueFlags flags)
+    {
+        if ((flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0) {
+            return 2;
+        }
+
+        return (flags & VK_QUEUE_GRAPHICS_BIT) == 0 ? 1 : 0;
+    }
+
+
     bool check_device_queue_families(VkPhysicalDevice device, VkSurfaceKHR surface, vk_utils::context::queue_family_data* queue_families_indices)
     {
         uint32_t queue_families_count;
@@ -177,7 +296,11 @@ namespace
 
             if (p.queueFlags & VK_QUEUE_TRANSFER_BIT) {
                 if (queue_families_indices[vk_utils::context::QUEUE_TYPE_TRANSFER].index >= 0) {
-                    if (props[i].queueCount > props[queue_families_indices[vk_utils::context::QUEUE_TYPE_TRANSFER].index].queueCount) {
+                    const auto& curr_props = props[queue_families_indices[vk_utils::context::QUEUE_TYPE_TRANSFER].index];
+                    const uint32_t curr_score = get_transfer_family_score(curr_props.queueFlags);
+                    const uint32_t score = get_transfer_family_score(p.queueFlags);
+
+                    if (score > curr_score || (score == curr_score && props[i].queueCount > curr_props.queueCount)) {
                         queue_families_indices[vk_utils::context::QUEUE_TYPE_TRANSFER].index = i;
                         queue_families_indices[vk_utils::context::QUEUE_TYPE_TRANSFER].max_queue_count = props[i].queueCount;
                     }
@@ -205,9 +328,46 @@ namespace
 
     const char* implicit_required_device_extensions[]{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
+    const char* implicit_optional_instance_extensions[] = {
+        VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME};
+
+    const char* implicit_optional_device_extensions[] = {
+        VK_KHR_MAINTENANCE2_EXTENSION_NAME};
+
+    const char* memory_budget_device_extensions[] = {
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME};
+
+    bool has_extension(const std::vector<const char*>& extensions, const char* name)
+    {
+        return std::find_if(extensions.begin(), extensions.end(), [name](const char* e) {
+            return strcmp(e, name) == 0;
+        }) != extensions.end();
+    }
+
     const char* implicit_required_device_layers[] = {
         "VK_LAYER_KHRONOS_validation"};
 
+    bool check_device_timeline_semaphore(VkPhysicalDevice device, const VkPhysicalDeviceProperties& props)
+    {
+        if (props.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+            .pNext = nullptr,
+        };
+
+        VkPhysicalDeviceFeatures2 features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &timeline_features,
+        };
+
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return timeline_features.timelineSemaphore == VK_TRUE;
+    }
+
 } // namespace
 
 
@@ -235,12 +395,121 @@ VkInstance vk_utils::context::instance() const
 }
 
 
+bool vk_utils::context::memory_budget_supported() const
+{
+    return m_memory_budget_supported;
+}
+
+
+bool vk_utils::context::fragment_stores_supported() const
+{
+    return m_fragment_stores_supported;
+}
+
+
+uint32_t vk_utils::context::direct_write_memory_types() const
+{
+    return m_direct_write_memory_types;
+}
+
+
+bool vk_utils::context::device_extension_enabled(const char* name) const
+{
+    return std::find(m_device_extensions.begin(), m_device_extensions.end(), name) != m_device_extensions.end();
+}
+
+
+vk_utils::context::memory_statistics vk_utils::context::get_memory_statistics() const
+{
+    const VkPhysicalDeviceMemoryProperties* memory_props{nullptr};
+    vmaGetMemoryProperties(m_allocator, &memory_props);
+
+    VmaStats vma_stats{};
+    vmaCalculateStats(m_allocator, &vma_stats);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+    vmaGetBudget(m_allocator, budgets);
+
+    memory_statistics stats{};
+    stats.heaps.resize(memory_props->memoryHeapCount);
+
+    for (uint32_t i = 0; i < memory_props->memoryHeapCount; ++i) {
+        auto& heap = stats.heaps[i];
+        const auto& heap_stats = vma_stats.memoryHeap[i];
+
+        heap.size = memory_props->memoryHeaps[i].size;
+        heap.flags = memory_props->memoryHeaps[i].flags;
+        heap.budget = budgets[i].budget;
+        heap.usage = budgets[i].usage;
+        heap.block_count = heap_stats.blockCount;
+        heap.allocation_count = heap_stats.allocationCount;
+        heap.block_bytes = heap_stats.usedBytes + heap_stats.unusedBytes;
+        heap.allocation_bytes = heap_stats.usedBytes;
+
+        for (uint32_t tag = 0; tag < MEMORY_TAG_MAX_ENUM; ++tag) {
+            heap.tags[tag] = get_memory_tag_statistics(static_cast<memory_tag>(tag), i);
+
+            stats.tags[tag].allocation_count += heap.tags[tag].allocation_count;
+            stats.tags[tag].allocation_bytes += heap.tags[tag].allocation_bytes;
+            stats.tags[tag].peak_allocation_bytes += heap.tags[tag].peak_allocation_bytes;
+        }
+    }
+
+    stats.host = get_host_memory_statistics();
+
+    return stats;
+}
+
+
+ERROR_TYPE vk_utils::context::dump_memory_statistics(const char* path) const
+{
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - m_init_time;
+
+    if (!write_memory_statistics_file(path, "w", get_memory_statistics(), time.count())) {
+        RAISE_ERROR_WARN(-1, "cannot open memory statistics file.");
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::context::end_frame()
+{
+    if (ctx->m_memory_statistics_dump_path.empty()) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    if (now - ctx->m_last_memory_statistics_dump < std::chrono::duration<float>(ctx->m_memory_statistics_dump_period)) {
+        return;
+    }
+
+    ctx->m_last_memory_statistics_dump = now;
+
+    const std::chrono::duration<double> time = now - ctx->m_init_time;
+
+    if (!write_memory_statistics_file(ctx->m_memory_statistics_dump_path.c_str(), "a", ctx->get_memory_statistics(), time.count())) {
+        LOG_WARN("cannot open memory statistics file, memory statistics dump is disabled.");
+        ctx->m_memory_statistics_dump_path.clear();
+    }
+}
+
+
 ERROR_TYPE vk_utils::context::init(
     const char* app_name,
     const context_init_info& context_init_info)
 {
     ctx.emplace();
     ctx->m_app_name = app_name;
+    ctx->m_init_time = std::chrono::steady_clock::now();
+
+    set_host_allocation_tracking(context_init_info.track_host_allocations);
+
+    if (context_init_info.memory_statistics_dump_path != nullptr) {
+        ctx->m_memory_statistics_dump_path = context_init_info.memory_statistics_dump_path;
+        ctx->m_memory_statistics_dump_period = context_init_info.memory_statistics_dump_period;
+    }
 
     PASS_ERROR(init_instance(app_name, context_init_info));
     PASS_ERROR(init_debug_messenger(context_init_info));
@@ -272,7 +541,12 @@ ERROR_TYPE vk_utils::context::init_instance(const char* app_name, const vk_utils
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = "no Engine";
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    // timeline semaphores synchronizing every submission are core since 1.2.
+    if (api_version < VK_API_VERSION_1_2) {
+        RAISE_ERROR_FATAL(-1, "vulkan 1.2 instance is required.");
+    }
 
     VkInstanceCreateInfo instance_info{};
     instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -321,6 +595,14 @@ ERROR_TYPE vk_utils::context::init_instance(const char* app_name, const vk_utils
 #endif
         instance_extensions_list);
 
+    merge_extensions_list(
+        instance_extensions_props,
+        implicit_optional_instance_extensions,
+        std::size(implicit_optional_instance_extensions),
+        instance_extensions_list);
+
+    ctx->m_memory_budget_supported = has_extension(instance_extensions_list, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
     uint32_t i_layers_props_size{0};
     vkEnumerateInstanceLayerProperties(&i_layers_props_size, nullptr);
     std::vector<VkLayerProperties> instance_layer_props{i_layers_props_size};
@@ -406,6 +688,7 @@ ERROR_TYPE vk_utils::context::select_physical_device(const vk_utils::context::co
             if (cond(props)) {
                 if (check_device_extensions(device, info.required_device_extensions.names, info.required_device_extensions.count)
                     && check_device_layers(device, info.required_device_layers.names, info.required_device_layers.count)
+                    && check_device_timeline_semaphore(device, props)
                     && check_device_queue_families(device, ctx->m_surface, ctx->m_queue_families_indices)) {
                     ctx->m_physical_device = device;
                     LOG_INFO(std::string(props.deviceName) + " device selected.");
@@ -473,6 +756,23 @@ ERROR_TYPE vk_utils::context::init_device(const context_init_info& context_init_
         std::size(implicit_required_device_extensions),
         device_extensions_list);
 
+    merge_extensions_list(
+        device_extensions_props,
+        implicit_optional_device_extensions,
+        std::size(implicit_optional_device_extensions),
+        device_extensions_list);
+
+    if (ctx->m_memory_budget_supported) {
+        merge_extensions_list(
+            device_extensions_props,
+            memory_budget_device_extensions,
+            std::size(memory_budget_device_extensions),
+            device_extensions_list);
+    }
+
+    ctx->m_memory_budget_supported = has_extension(device_extensions_list, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    ctx->m_device_extensions.assign(device_extensions_list.begin(), device_extensions_list.end());
+
     merge_layers_list(
         device_layers_props,
         context_init_info.required_device_layers.names,
@@ -518,9 +818,27 @@ ERROR_TYPE vk_utils::context::init_device(const context_init_info& context_init_
         }
     }
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = nullptr,
+        .timelineSemaphore = VK_TRUE,
+    };
+
+    VkPhysicalDeviceFeatures supported_features{};
+    vkGetPhysicalDeviceFeatures(context::get().gpu(), &supported_features);
+    ctx->m_fragment_stores_supported = supported_features.fragmentStoresAndAtomics == VK_TRUE;
+
+    VkPhysicalDeviceFeatures2 features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &timeline_features,
+        .features = {
+            .fragmentStoresAndAtomics = supported_features.fragmentStoresAndAtomics,
+        },
+    };
+
     VkDeviceCreateInfo device_info{};
     device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    device_info.pNext = nullptr;
+    device_info.pNext = &features;
     device_info.ppEnabledExtensionNames = device_extensions_list.data();
     device_info.enabledExtensionCount = device_extensions_list.size();
     device_info.ppEnabledLayerNames = device_layers_list.data();
@@ -541,11 +859,38 @@ ERROR_TYPE vk_utils::context::init_memory_allocator()
     allocator_create_info.device = ctx->device();
     allocator_create_info.instance = ctx->instance();
     allocator_create_info.physicalDevice = ctx->gpu();
-    allocator_create_info.vulkanApiVersion = VK_API_VERSION_1_0;
+    allocator_create_info.vulkanApiVersion = VK_API_VERSION_1_2;
+    allocator_create_info.pAllocationCallbacks = get_host_allocation_callbacks(HOST_OBJECT_ALLOCATOR);
+
+    if (ctx->m_memory_budget_supported) {
+        allocator_create_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
 
     if (auto err = ctx->m_allocator.init(&allocator_create_info); err != VK_SUCCESS) {
         RAISE_ERROR_FATAL(err, "cannot initialize allocator.");
     }
+
+    const VkPhysicalDeviceMemoryProperties* memory_properties{nullptr};
+    vmaGetMemoryProperties(ctx->m_allocator, &memory_properties);
+
+    VkDeviceSize largest_device_local_heap{0};
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; ++i) {
+        if (memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            largest_device_local_heap = std::max(largest_device_local_heap, memory_properties->memoryHeaps[i].size);
+        }
+    }
+
+    // small bar windows of discrete gpus are left out, resources would quickly exhaust them.
+    constexpr VkMemoryPropertyFlags direct_write_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    ctx->m_direct_write_memory_types = 0;
+
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; ++i) {
+        const auto& type = memory_properties->memoryTypes[i];
+        if ((type.propertyFlags & direct_write_flags) == direct_write_flags && memory_properties->memoryHeaps[type.heapIndex].size >= largest_device_local_heap / 2) {
+            ctx->m_direct_write_memory_types |= 1u << i;
+        }
+    }
+
     RAISE_ERROR_OK();
 }
 
@@ -560,13 +905,104 @@ ERROR_TYPE vk_utils::context::request_queues()
         }
     }
 
+    // queue types sharing a queue share its submission queue too, values have to increase in submission order.
+    for (const auto queue : ctx->m_queues) {
+        if (queue == nullptr || ctx->find_submission_queue(queue) != nullptr) {
+            continue;
+        }
+
+        auto& submission_queue = ctx->m_submission_queues.emplace_back(std::make_unique<vk_utils::submission_queue>());
+
+        if (auto err = submission_queue->init(ctx->m_device, queue); err != VK_SUCCESS) {
+            RAISE_ERROR_FATAL(err, "cannot create queue timeline semaphore.");
+        }
+    }
+
     RAISE_ERROR_OK();
 }
 
 
+VkResult vk_utils::context::submit(VkQueue queue, const VkSubmitInfo& submit_info, submission_token& out_token) const
+{
+    auto* submission_queue = find_submission_queue(queue);
+
+    if (submission_queue == nullptr) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    return submission_queue->submit(submit_info, out_token);
+}
+
+
+VkResult vk_utils::context::present(VkQueue queue, const VkPresentInfoKHR& present_info) const
+{
+    auto* submission_queue = find_submission_queue(queue);
+
+    if (submission_queue == nullptr) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    return submission_queue->present(present_info);
+}
+
+
+uint64_t vk_utils::context::completed_value(VkQueue queue) const
+{
+    const auto* submission_queue = find_submission_queue(queue);
+    return submission_queue != nullptr ? submission_queue->get_completed_value() : 0;
+}
+
+
+vk_utils::submission_token vk_utils::context::last_submission(VkQueue queue) const
+{
+    const auto* submission_queue = find_submission_queue(queue);
+    return submission_queue != nullptr ? submission_token{queue, submission_queue->get_submitted_value()} : submission_token{};
+}
+
+
+bool vk_utils::context::is_completed(const submission_token& token) const
+{
+    return token.value == 0 || completed_value(token.queue) >= token.value;
+}
+
+
+void vk_utils::context::wait(const submission_token& token) const
+{
+    if (const auto* submission_queue = find_submission_queue(token.queue); submission_queue != nullptr) {
+        submission_queue->wait(token.value);
+    }
+}
+
+
+void vk_utils::context::wait_idle(VkQueue queue) const
+{
+    if (const auto* submission_queue = find_submission_queue(queue); submission_queue != nullptr) {
+        submission_queue->wait(submission_queue->get_submitted_value());
+    }
+}
+
+
+VkSemaphore vk_utils::context::timeline_semaphore(VkQueue queue) const
+{
+    const auto* submission_queue = find_submission_queue(queue);
+    return submission_queue != nullptr ? submission_queue->get_timeline_semaphore() : nullptr;
+}
+
+
+vk_utils::submission_queue* vk_utils::context::find_submission_queue(VkQueue queue) const
+{
+    auto it = std::find_if(m_submission_queues.begin(), m_submission_queues.end(), [queue](const std::unique_ptr<submission_queue>& submission_queue) {
+        return submission_queue->get_queue() == queue;
+    });
+
+    return it != m_submission_queues.end() ? it->get() : nullptr;
+}
+
+
 vk_utils::context::~context()
 {
     m_allocator.destroy();
+    m_submission_queues.clear();
     m_device.destroy();
     m_surface.destroy();
     m_debug_messenger.destroy();
@@ -652,3 +1088,9 @@ VmaAllocator vk_utils::context::allocator() const
 {
     return m_allocator;
 }
+
+
+const VkAllocationCallbacks* vk_utils::context::allocator_allocation_callbacks() const
+{
+    return m_allocator.get_allocation_callbacks();
+}
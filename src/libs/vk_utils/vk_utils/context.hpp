@@ -1,9 +1,14 @@
 #pragma once
 
 #include <vk_utils/handlers.hpp>
+#include <vk_utils/submission_queue.hpp>
 #include <errors/error_handler.hpp>
 
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace vk_utils
 {
@@ -35,6 +40,27 @@ namespace vk_utils
             size_t allocation_alignment{0};
         };
 
+        struct memory_heap_statistics
+        {
+            VkDeviceSize size{0};
+            VkMemoryHeapFlags flags{0};
+            VkDeviceSize budget{0};
+            VkDeviceSize usage{0};
+            uint32_t block_count{0};
+            uint32_t allocation_count{0};
+            VkDeviceSize block_bytes{0};
+            VkDeviceSize allocation_bytes{0};
+            memory_tag_statistics tags[MEMORY_TAG_MAX_ENUM]{};
+        };
+
+        struct memory_statistics
+        {
+            std::vector<memory_heap_statistics> heaps{};
+            // tags totals over all heaps.
+            memory_tag_statistics tags[MEMORY_TAG_MAX_ENUM]{};
+            host_memory_statistics host{};
+        };
+
         enum queue_type {
             QUEUE_TYPE_GRAPHICS,
             QUEUE_TYPE_COMPUTE,
@@ -60,14 +86,24 @@ namespace vk_utils
             layers_info additional_device_layers{};
 
             std::function<VkResult(VkInstance instance, VkSurfaceKHR* surface)> surface_create_callback;
+
+            // driver host allocations of objects created through the handlers are counted and reported with the memory statistics.
+            bool track_host_allocations{false};
+
+            // statistics are appended to the file as one json object per line every period seconds, disabled when the path is null.
+            const char* memory_statistics_dump_path{nullptr};
+            float memory_statistics_dump_period{10.0f};
         };
 
         ~context();
         static ERROR_TYPE init(const char* app_name, const context_init_info& info);
         static const context& get();
+        // writes the periodic memory statistics dump when it is due.
+        static void end_frame();
 
         VkDevice device() const;
         VmaAllocator allocator() const;
+        const VkAllocationCallbacks* allocator_allocation_callbacks() const;
         VkPhysicalDevice gpu() const;
         VkInstance instance() const;
         VkQueue queue(queue_type type) const;
@@ -75,6 +111,28 @@ namespace vk_utils
         const char* app_name() const;
         int32_t queue_family_index(queue_type) const;
         memory_alloc_info get_memory_alloc_info(VkBuffer buffer, VkMemoryPropertyFlags props) const;
+        bool memory_budget_supported() const;
+        // storage writes and atomics of fragment shaders, used by sampler feedback.
+        bool fragment_stores_supported() const;
+        // device local and host visible memory types large enough to hold resources written directly from the host
+        // (integrated gpus, software rasterizers, resizable bar). 0 when uploads have to be staged.
+        uint32_t direct_write_memory_types() const;
+        bool device_extension_enabled(const char* name) const;
+        memory_statistics get_memory_statistics() const;
+        ERROR_TYPE dump_memory_statistics(const char* path) const;
+
+        // every queue owns a timeline semaphore signaled with a monotonically increasing value by each submission.
+        // submissions and presents may be made from any thread, they are handed to the driver in the order they are made.
+        VkResult submit(VkQueue queue, const VkSubmitInfo& submit_info, submission_token& out_token) const;
+        VkResult present(VkQueue queue, const VkPresentInfoKHR& present_info) const;
+        uint64_t completed_value(VkQueue queue) const;
+        // completes once every submission made to the queue so far completed.
+        submission_token last_submission(VkQueue queue) const;
+        bool is_completed(const submission_token& token) const;
+        void wait(const submission_token& token) const;
+        // waits for every submission made to the queue so far.
+        void wait_idle(VkQueue queue) const;
+        VkSemaphore timeline_semaphore(VkQueue queue) const;
 
     private:
         static VkDebugUtilsMessengerCreateInfoEXT get_debug_messenger_create_info();
@@ -84,6 +142,7 @@ namespace vk_utils
         static ERROR_TYPE init_device(const context_init_info& info);
         static ERROR_TYPE request_queues();
         static ERROR_TYPE init_memory_allocator();
+        submission_queue* find_submission_queue(VkQueue queue) const;
 
         instance_handler m_instance{};
         surface_handler m_surface{};
@@ -96,7 +155,17 @@ namespace vk_utils
 
         queue_family_data m_queue_families_indices[QUEUE_TYPE_SIZE]{};
         VkQueue m_queues[QUEUE_TYPE_SIZE]{};
+        std::vector<std::unique_ptr<submission_queue>> m_submission_queues{};
 
         const char* m_app_name;
+        bool m_memory_budget_supported{false};
+        bool m_fragment_stores_supported{false};
+        uint32_t m_direct_write_memory_types{0};
+        std::vector<std::string> m_device_extensions{};
+
+        std::string m_memory_statistics_dump_path{};
+        float m_memory_statistics_dump_period{0.0f};
+        std::chrono::steady_clock::time_point m_init_time{};
+        std::chrono::steady_clock::time_point m_last_memory_statistics_dump{};
     };
 } // namespace vk_utils
@@ -0,0 +1,511 @@
+
+#include "defragmenter.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    constexpr VkBufferUsageFlags required_buffer_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    constexpr VkImageUsageFlags required_image_usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+
+    VkImageSubresourceRange get_image_range(const VkImageCreateInfo& image_info)
+    {
+        return {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = image_info.mipLevels,
+            .baseArrayLayer = 0,
+            .layerCount = image_info.arrayLayers,
+        };
+    }
+
+
+    VkImageMemoryBarrier get_image_barrier(VkImage image, const VkImageCreateInfo& image_info, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access)
+    {
+        return {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = src_access,
+            .dstAccessMask = dst_access,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = get_image_range(image_info),
+        };
+    }
+} // namespace
+
+
+vk_utils::defragmenter::~defragmenter()
+{
+    finish();
+    release_retired(true);
+}
+
+
+ERROR_TYPE vk_utils::defragmenter::init(uint32_t max_moves_per_pass)
+{
+    m_max_moves_per_pass = std::max(1u, max_moves_per_pass);
+    m_moves.resize(m_max_moves_per_pass);
+
+    VkCommandPoolCreateInfo cmd_pool_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = static_cast<uint32_t>(vk_utils::context::get().queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS)),
+    };
+
+    if (m_command_pool.init(vk_utils::context::get().device(), &cmd_pool_info) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot init defragmentation command pool.");
+    }
+
+    VkCommandBufferAllocateInfo cmd_buffer_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = m_command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    if (m_command_buffer.init(vk_utils::context::get().device(), m_command_pool, &cmd_buffer_info, 1) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot init defragmentation command buffer.");
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+vk_utils::defragmenter::resource_id vk_utils::defragmenter::register_buffer(vma_buffer_handler& buffer, moved_callback on_moved)
+{
+    const auto& buffer_info = buffer.get_create_info();
+
+    if (static_cast<VkBuffer>(buffer) == nullptr ||
+        buffer_info.sharingMode != VK_SHARING_MODE_EXCLUSIVE ||
+        (buffer_info.usage & required_buffer_usage) != required_buffer_usage) {
+        return 0;
+    }
+
+    m_entries[m_next_id] = {
+        .buffer = &buffer,
+        .on_moved = std::move(on_moved),
+    };
+
+    return m_next_id++;
+}
+
+
+vk_utils::defragmenter::resource_id vk_utils::defragmenter::register_image(vma_image_handler& image, VkImageLayout layout, moved_callback on_moved)
+{
+    const auto& image_info = image.get_create_info();
+
+    if (static_cast<VkImage>(image) == nullptr ||
+        image_info.sharingMode != VK_SHARING_MODE_EXCLUSIVE ||
+        image_info.tiling != VK_IMAGE_TILING_OPTIMAL ||
+        (image_info.usage & required_image_usage) != required_image_usage) {
+        return 0;
+    }
+
+    m_entries[m_next_id] = {
+        .image = &image,
+        .layout = layout,
+        .on_moved = std::move(on_moved),
+    };
+
+    return m_next_id++;
+}
+
+
+void vk_utils::defragmenter::unregister(resource_id id)
+{
+    auto it = m_entries.find(id);
+
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    if (is_running() && m_allocations.count(get_allocation(it->second)) > 0) {
+        finish();
+    }
+
+    m_entries.erase(it);
+}
+
+
+void vk_utils::defragmenter::set_on_moved(moved_callback on_moved)
+{
+    m_on_moved = std::move(on_moved);
+}
+
+
+ERROR_TYPE vk_utils::defragmenter::begin()
+{
+    if (is_running() || m_entries.empty()) {
+        RAISE_ERROR_OK();
+    }
+
+    std::vector<VmaAllocation> allocations{};
+    allocations.reserve(m_entries.size());
+
+    for (const auto& [id, entry] : m_entries) {
+        allocations.push_back(get_allocation(entry));
+        m_allocations[allocations.back()] = id;
+    }
+
+    VmaDefragmentationInfo2 defragmentation_info{
+        .flags = VMA_DEFRAGMENTATION_FLAG_INCREMENTAL,
+        .allocationCount = static_cast<uint32_t>(allocations.size()),
+        .pAllocations = allocations.data(),
+        .pAllocationsChanged = nullptr,
+        .poolCount = 0,
+        .pPools = nullptr,
+        .maxCpuBytesToMove = VK_WHOLE_SIZE,
+        .maxCpuAllocationsToMove = UINT32_MAX,
+        .maxGpuBytesToMove = VK_WHOLE_SIZE,
+        .maxGpuAllocationsToMove = UINT32_MAX,
+        .commandBuffer = nullptr,
+    };
+
+    const auto res = vmaDefragmentationBegin(vk_utils::context::get().allocator(), &defragmentation_info, nullptr, &m_context);
+
+    if (res != VK_SUCCESS && res != VK_NOT_READY) {
+        m_allocations.clear();
+        m_context = nullptr;
+        RAISE_ERROR_WARN(res, "cannot begin defragmentation.");
+    }
+
+    // nothing to move.
+    if (res == VK_SUCCESS) {
+        vmaDefragmentationEnd(vk_utils::context::get().allocator(), m_context);
+        m_context = nullptr;
+        m_allocations.clear();
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::defragmenter::finish()
+{
+    if (is_running()) {
+        // the allocator reuses the memory the pass moved from once the pass ended, only its copies are waited for.
+        if (m_pass_pending) {
+            vk_utils::context::get().wait(m_pass_submission);
+            end_pass();
+        }
+
+        if (is_running()) {
+            vmaDefragmentationEnd(vk_utils::context::get().allocator(), m_context);
+            m_context = nullptr;
+            m_allocations.clear();
+        }
+    }
+
+    release_retired(false);
+}
+
+
+ERROR_TYPE vk_utils::defragmenter::update()
+{
+    release_retired(false);
+
+    if (m_pass_pending && vk_utils::context::get().is_completed(m_pass_submission)) {
+        end_pass();
+    }
+
+    if (is_running() && !m_pass_pending) {
+        PASS_ERROR(run_pass());
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+bool vk_utils::defragmenter::is_running() const
+{
+    return m_context != nullptr;
+}
+
+
+VmaAllocation vk_utils::defragmenter::get_allocation(const entry& entry)
+{
+    return entry.buffer != nullptr ? static_cast<VmaAllocation>(*entry.buffer) : static_cast<VmaAllocation>(*entry.image);
+}
+
+
+vk_utils::submission_token vk_utils::defragmenter::get_retire_submission()
+{
+    const auto& ctx = vk_utils::context::get();
+    return ctx.last_submission(ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS));
+}
+
+
+ERROR_TYPE vk_utils::defragmenter::run_pass()
+{
+    const auto& ctx = vk_utils::context::get();
+    const auto device = ctx.device();
+    // new resources are destroyed by the allocator later, they are created with its callbacks.
+    const auto* allocation_callbacks = ctx.allocator_allocation_callbacks();
+
+    VmaDefragmentationPassInfo pass_info{
+        .moveCount = m_max_moves_per_pass,
+        .pMoves = m_moves.data(),
+    };
+
+    if (const auto res = vmaBeginDefragmentationPass(ctx.allocator(), m_context, &pass_info); res != VK_SUCCESS && res != VK_NOT_READY) {
+        cancel();
+        RAISE_ERROR_WARN(res, "cannot begin defragmentation pass.");
+    }
+
+    if (pass_info.moveCount == 0) {
+        end_pass();
+        RAISE_ERROR_OK();
+    }
+
+    // moves reported by a pass can't be skipped, a pass which can't be completed stops the defragmentation.
+    const auto destroy_resources = [this, device, allocation_callbacks](const std::vector<VkBuffer>& buffers, const std::vector<VkImage>& images) {
+        for (const auto buffer : buffers) {
+            vkDestroyBuffer(device, buffer, allocation_callbacks);
+        }
+
+        for (const auto image : images) {
+            vkDestroyImage(device, image, allocation_callbacks);
+        }
+
+        cancel();
+    };
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+
+    std::vector<VkBuffer> new_buffers(pass_info.moveCount, nullptr);
+    std::vector<VkImage> new_images(pass_info.moveCount, nullptr);
+
+    vkResetCommandBuffer(m_command_buffer[0], 0);
+    vkBeginCommandBuffer(m_command_buffer[0], &begin_info);
+
+    std::vector<VkImageMemoryBarrier> copy_barriers{};
+    std::vector<VkImageMemoryBarrier> use_barriers{};
+
+    m_pass_resources.clear();
+
+    // resources are created and bound at the new places first, nothing is switched when any of them fails.
+    for (uint32_t i = 0; i < pass_info.moveCount; ++i) {
+        const auto& move = m_moves[i];
+        const auto id = m_allocations.at(move.allocation);
+        const auto& entry = m_entries.at(id);
+
+        VkResult res{VK_SUCCESS};
+
+        if (entry.buffer != nullptr) {
+            res = vkCreateBuffer(device, &entry.buffer->get_create_info(), allocation_callbacks, &new_buffers[i]);
+
+            if (res == VK_SUCCESS) {
+                res = vkBindBufferMemory(device, new_buffers[i], move.memory, move.offset);
+            }
+        } else {
+            const auto& image_info = entry.image->get_create_info();
+            res = vkCreateImage(device, &image_info, allocation_callbacks, &new_images[i]);
+
+            if (res == VK_SUCCESS) {
+                res = vkBindImageMemory(device, new_images[i], move.memory, move.offset);
+            }
+
+            copy_barriers.push_back(get_image_barrier(*entry.image, image_info, entry.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, VK_ACCESS_TRANSFER_READ_BIT));
+            copy_barriers.push_back(get_image_barrier(new_images[i], image_info, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+            use_barriers.push_back(get_image_barrier(new_images[i], image_info, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, entry.layout, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT));
+        }
+
+        if (res != VK_SUCCESS) {
+            vkEndCommandBuffer(m_command_buffer[0]);
+            destroy_resources(new_buffers, new_images);
+            RAISE_ERROR_WARN(res, "cannot create moved resource.");
+        }
+
+        m_pass_resources.push_back(id);
+    }
+
+    // previous frames only read the resources, the copies have to wait for them though before the images layouts change.
+    vkCmdPipelineBarrier(
+        m_command_buffer[0],
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        copy_barriers.size(),
+        copy_barriers.data());
+
+    std::vector<VkImageCopy> image_copies{};
+
+    for (uint32_t i = 0; i < pass_info.moveCount; ++i) {
+        const auto& entry = m_entries.at(m_pass_resources[i]);
+
+        if (entry.buffer != nullptr) {
+            VkBufferCopy buffer_copy{
+                .srcOffset = 0,
+                .dstOffset = 0,
+                .size = entry.buffer->get_create_info().size,
+            };
+
+            vkCmdCopyBuffer(m_command_buffer[0], *entry.buffer, new_buffers[i], 1, &buffer_copy);
+            continue;
+        }
+
+        const auto& image_info = entry.image->get_create_info();
+        image_copies.clear();
+
+        for (uint32_t level = 0; level < image_info.mipLevels; ++level) {
+            image_copies.push_back({
+                .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, image_info.arrayLayers},
+                .srcOffset = {0, 0, 0},
+                .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, image_info.arrayLayers},
+                .dstOffset = {0, 0, 0},
+                .extent = {
+                    std::max(1u, image_info.extent.width >> level),
+                    std::max(1u, image_info.extent.height >> level),
+                    std::max(1u, image_info.extent.depth >> level)},
+            });
+        }
+
+        vkCmdCopyImage(
+            m_command_buffer[0],
+            *entry.image,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            new_images[i],
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            image_copies.size(),
+            image_copies.data());
+    }
+
+    // frames submitted after the pass use the new resources.
+    VkMemoryBarrier buffers_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        m_command_buffer[0],
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1,
+        &buffers_barrier,
+        0,
+        nullptr,
+        use_barriers.size(),
+        use_barriers.data());
+
+    vkEndCommandBuffer(m_command_buffer[0]);
+
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = m_command_buffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    if (const auto res = ctx.submit(ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS), submit_info, m_pass_submission); res != VK_SUCCESS) {
+        destroy_resources(new_buffers, new_images);
+        RAISE_ERROR_WARN(res, "cannot submit defragmentation pass.");
+    }
+
+    m_pass_pending = true;
+
+    for (uint32_t i = 0; i < pass_info.moveCount; ++i) {
+        auto& entry = m_entries.at(m_pass_resources[i]);
+
+        if (entry.buffer != nullptr) {
+            const VkBuffer old_buffer = entry.buffer->replace_resource(new_buffers[i]);
+            m_retired.push_back({[device, old_buffer, allocation_callbacks]() { vkDestroyBuffer(device, old_buffer, allocation_callbacks); }, m_pass_submission});
+        } else {
+            const VkImage old_image = entry.image->replace_resource(new_images[i]);
+            m_retired.push_back({[device, old_image, allocation_callbacks]() { vkDestroyImage(device, old_image, allocation_callbacks); }, m_pass_submission});
+        }
+
+        if (entry.on_moved) {
+            entry.on_moved();
+        }
+    }
+
+    if (m_on_moved) {
+        m_on_moved();
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::defragmenter::end_pass()
+{
+    const auto res = vmaEndDefragmentationPass(vk_utils::context::get().allocator(), m_context);
+
+    for (const auto id : m_pass_resources) {
+        if (auto it = m_entries.find(id); it != m_entries.end()) {
+            if (it->second.buffer != nullptr) {
+                it->second.buffer->update_alloc_info();
+            } else {
+                it->second.image->update_alloc_info();
+            }
+        }
+    }
+
+    m_pass_resources.clear();
+    m_pass_pending = false;
+
+    if (res == VK_SUCCESS && is_running()) {
+        vmaDefragmentationEnd(vk_utils::context::get().allocator(), m_context);
+        m_context = nullptr;
+        m_allocations.clear();
+    }
+}
+
+
+void vk_utils::defragmenter::cancel()
+{
+    // nothing of the begun pass was submitted, resources retired by the previous passes keep their submissions.
+    vmaDefragmentationEnd(vk_utils::context::get().allocator(), m_context);
+
+    m_context = nullptr;
+    m_allocations.clear();
+    m_pass_resources.clear();
+    m_pass_pending = false;
+}
+
+
+void vk_utils::defragmenter::release_retired(bool wait)
+{
+    const auto& ctx = vk_utils::context::get();
+
+    auto released = std::stable_partition(m_retired.begin(), m_retired.end(), [&ctx, wait](const retired_resource& r) {
+        if (wait) {
+            ctx.wait(r.submission);
+        }
+
+        return !ctx.is_completed(r.submission);
+    });
+
+    for (auto it = released; it != m_retired.end(); ++it) {
+        it->destroy();
+    }
+
+    m_retired.erase(released, m_retired.end());
+}
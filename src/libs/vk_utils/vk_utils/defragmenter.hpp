@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/submission_queue.hpp>
+#include <errors/error_handler.hpp>
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vk_utils
+{
+    // Incremental defragmentation of registered vma buffers and images.
+    // every update() runs at most one pass of up to max_moves_per_pass moves: resources are recreated at the new place,
+    // their data is copied on the graphics queue and the handlers are switched to them right away, moved callbacks then patch
+    // views, descriptors and re-record command buffers referencing the previous handles. previous resources are destroyed and
+    // the pass is finished once the pass copies completed, they wait for every frame submitted before, so no frame waits on them.
+    class defragmenter
+    {
+    public:
+        using resource_id = uint64_t;
+        using moved_callback = std::function<void()>;
+
+        defragmenter() = default;
+        defragmenter(const defragmenter&) = delete;
+        defragmenter& operator=(const defragmenter&) = delete;
+        ~defragmenter();
+
+        ERROR_TYPE init(uint32_t max_moves_per_pass = 16);
+
+        // the handler has to keep its address until unregistered.
+        // exclusive resources with transfer src and dst usages only, 0 is returned for the rest.
+        resource_id register_buffer(vma_buffer_handler& buffer, moved_callback on_moved = {});
+        // layout the image is kept in between uses.
+        resource_id register_image(vma_image_handler& image, VkImageLayout layout, moved_callback on_moved = {});
+        // the running defragmentation is finished first, resources taking part in it can't be freed before.
+        void unregister(resource_id id);
+        // called once per pass after the moved callbacks, for owners of pre-recorded command buffers and descriptor sets
+        // which are not registered themselves. previous handles stay valid until the pass copies completed.
+        void set_on_moved(moved_callback on_moved);
+
+        // keeps an object replaced in a moved callback alive until the graphics submissions made so far completed.
+        template<typename T>
+        void retire(T resource)
+        {
+            m_retired.push_back({[r = std::make_shared<T>(std::move(resource))]() mutable { r.reset(); }, get_retire_submission()});
+        }
+
+        // starts defragmenting all registered resources.
+        ERROR_TYPE begin();
+        // finishes the running defragmentation, a pending pass is completed first.
+        void finish();
+        // called once per frame after the frame submission.
+        ERROR_TYPE update();
+
+        bool is_running() const;
+
+    private:
+        struct entry
+        {
+            vma_buffer_handler* buffer{nullptr};
+            vma_image_handler* image{nullptr};
+            VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+            moved_callback on_moved{};
+        };
+
+        struct retired_resource
+        {
+            std::function<void()> destroy{};
+            submission_token submission{};
+        };
+
+        static VmaAllocation get_allocation(const entry& entry);
+        static submission_token get_retire_submission();
+
+        ERROR_TYPE run_pass();
+        void end_pass();
+        // stops the defragmentation when the begun pass can't be submitted.
+        void cancel();
+        // releases retired resources whose submissions completed, or all of them after waiting for them.
+        void release_retired(bool wait);
+
+        uint32_t m_max_moves_per_pass{16};
+
+        std::unordered_map<resource_id, entry> m_entries{};
+        resource_id m_next_id{1};
+        moved_callback m_on_moved{};
+
+        VmaDefragmentationContext m_context{nullptr};
+        std::unordered_map<VmaAllocation, resource_id> m_allocations{};
+
+        std::vector<VmaDefragmentationPassMoveInfo> m_moves{};
+        std::vector<resource_id> m_pass_resources{};
+        bool m_pass_pending{false};
+
+        cmd_pool_handler m_command_pool{};
+        cmd_buffers_handler m_command_buffer{};
+        // graphics submission of the pass copies.
+        submission_token m_pass_submission{};
+
+        std::vector<retired_resource> m_retired{};
+    };
+} // namespace vk_utils
@@ -0,0 +1,81 @@
+
+#include "deletion_queue.hpp"
+
+#include <vk_utils/context.hpp>
+
+#include <algorithm>
+
+
+void vk_utils::deletion_queue::defer(const submission_token& submission, std::function<void()> release)
+{
+    std::lock_guard lock{m_mutex};
+    m_fenced.push_back({submission, {std::move(release)}});
+}
+
+
+void vk_utils::deletion_queue::end_frame(const submission_token& frame_submission)
+{
+    std::lock_guard lock{m_mutex};
+
+    collect_completed();
+
+    if (m_pending.empty()) {
+        return;
+    }
+
+    m_frames.push_back({frame_submission, std::move(m_pending)});
+    m_pending.clear();
+}
+
+
+void vk_utils::deletion_queue::flush()
+{
+    std::lock_guard lock{m_mutex};
+
+    for (auto& frame : m_frames) {
+        for (auto& destroy : frame.retired) {
+            destroy();
+        }
+    }
+
+    for (auto& fenced : m_fenced) {
+        for (auto& destroy : fenced.retired) {
+            destroy();
+        }
+    }
+
+    for (auto& destroy : m_pending) {
+        destroy();
+    }
+
+    m_frames.clear();
+    m_fenced.clear();
+    m_pending.clear();
+}
+
+
+void vk_utils::deletion_queue::collect_completed()
+{
+    const auto& ctx = vk_utils::context::get();
+
+    while (!m_frames.empty() && ctx.is_completed(m_frames.front().submission)) {
+        for (auto& destroy : m_frames.front().retired) {
+            destroy();
+        }
+
+        m_frames.pop_front();
+    }
+
+    // fenced releases may wait on different queues, so they complete out of order.
+    auto completed = std::partition(m_fenced.begin(), m_fenced.end(), [&ctx](const frame& fenced) {
+        return !ctx.is_completed(fenced.submission);
+    });
+
+    for (auto it = completed; it != m_fenced.end(); ++it) {
+        for (auto& destroy : it->retired) {
+            destroy();
+        }
+    }
+
+    m_fenced.erase(completed, m_fenced.end());
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/submission_queue.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vk_utils
+{
+    // Handlers released while submitted frames may still use them.
+    // objects retired during a frame are destroyed once the next frame submission completed,
+    // so resources are replaced at runtime without waiting for the device to become idle.
+    class deletion_queue
+    {
+    public:
+        deletion_queue() = default;
+        deletion_queue(const deletion_queue&) = delete;
+        deletion_queue& operator=(const deletion_queue&) = delete;
+        ~deletion_queue() = default;
+
+        template<typename T>
+        void retire(T resource)
+        {
+            std::lock_guard lock{m_mutex};
+            m_pending.emplace_back([r = std::make_shared<T>(std::move(resource))]() mutable { r.reset(); });
+        }
+
+        // for resources owned by shared allocators, the release gives them back once the frames using them completed.
+        void defer(std::function<void()> release)
+        {
+            std::lock_guard lock{m_mutex};
+            m_pending.emplace_back(std::move(release));
+        }
+
+        // for releases fenced by a submission of their own, e.g. uploads submitted outside of the frames.
+        void defer(const submission_token& submission, std::function<void()> release);
+
+        // called right after the frame submission.
+        void end_frame(const submission_token& frame_submission);
+        // destroys everything retired so far, the device has to be idle.
+        void flush();
+
+    private:
+        struct frame
+        {
+            submission_token submission{};
+            std::vector<std::function<void()>> retired{};
+        };
+
+        void collect_completed();
+
+        std::mutex m_mutex{};
+        std::vector<std::function<void()>> m_pending{};
+        std::deque<frame> m_frames{};
+        std::vector<frame> m_fenced{};
+    };
+} // namespace vk_utils
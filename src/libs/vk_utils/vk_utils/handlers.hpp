@@ -6,6 +6,8 @@
 
 
 #include <vk_utils/defs.hpp>
+#include <vk_utils/host_allocator.hpp>
+#include <vk_utils/memory_statistics.hpp>
 #include <VulkanMemoryAllocator/src/vk_mem_alloc.h>
 
 #include <utility>
@@ -54,32 +56,40 @@ namespace vk_utils
             }
             std::swap(m_handler, src.m_handler);
             std::swap(m_initializer, src.m_initializer);
+            std::swap(m_allocation_callbacks, src.m_allocation_callbacks);
             return *this;
         }
 
-        virtual VkResult init(InitializerType initializer, InitStructType* info)
+        virtual VkResult init(
+            InitializerType initializer,
+            InitStructType* info,
+            const VkAllocationCallbacks* allocation_callbacks = get_host_allocation_callbacks(host_object_of<StructType>))
         {
             m_initializer = initializer;
-            return init_func(m_initializer, info, nullptr, &m_handler);
+            m_allocation_callbacks = allocation_callbacks;
+            return init_func(m_initializer, info, m_allocation_callbacks, &m_handler);
         }
 
         virtual VkResult reset(InitializerType initializer, InitStructType* info)
         {
             InitializerType old_initializer = m_initializer;
             StructType old_handler = m_handler;
+            const VkAllocationCallbacks* old_allocation_callbacks = m_allocation_callbacks;
 
             auto init_res = init(initializer, info);
 
             if (init_res == VK_SUCCESS) {
-                destroy_impl(old_initializer, old_handler);
+                destroy_impl(old_initializer, old_handler, old_allocation_callbacks);
             } else {
                 m_initializer = old_initializer;
                 m_handler = old_handler;
+                m_allocation_callbacks = old_allocation_callbacks;
             }
 
             return init_res;
         }
 
+        // the handler was created outside with default allocation callbacks.
         virtual void reset(InitializerType initializer, StructType handler)
         {
             destroy();
@@ -89,9 +99,10 @@ namespace vk_utils
 
         virtual void destroy()
         {
-            destroy_impl(m_initializer, m_handler);
+            destroy_impl(m_initializer, m_handler, m_allocation_callbacks);
             m_handler = nullptr;
             m_initializer = nullptr;
+            m_allocation_callbacks = nullptr;
         }
 
         operator StructType() const
@@ -105,16 +116,17 @@ namespace vk_utils
         }
 
     private:
-        void destroy_impl(InitializerType initializer, StructType handler)
+        void destroy_impl(InitializerType initializer, StructType handler, const VkAllocationCallbacks* allocation_callbacks)
         {
             if (initializer != nullptr && handler != nullptr) {
-                destroy_func(initializer, handler, nullptr);
+                destroy_func(initializer, handler, allocation_callbacks);
             }
         }
 
     protected:
         InitializerType m_initializer{nullptr};
         StructType m_handler{nullptr};
+        const VkAllocationCallbacks* m_allocation_callbacks{nullptr};
     };
 
 
@@ -150,18 +162,21 @@ namespace vk_utils
                 return *this;
             }
             std::swap(m_handle, src.m_handle);
+            std::swap(m_allocation_callbacks, src.m_allocation_callbacks);
             return *this;
         }
         VkResult init(VkInstanceCreateInfo* info)
         {
-            return vkCreateInstance(info, nullptr, &m_handle);
+            m_allocation_callbacks = get_host_allocation_callbacks(HOST_OBJECT_INSTANCE);
+            return vkCreateInstance(info, m_allocation_callbacks, &m_handle);
         }
 
         void destroy()
         {
             if (m_handle != nullptr) {
-                vkDestroyInstance(m_handle, nullptr);
+                vkDestroyInstance(m_handle, m_allocation_callbacks);
                 m_handle = nullptr;
+                m_allocation_callbacks = nullptr;
             }
         }
 
@@ -172,6 +187,7 @@ namespace vk_utils
 
     private:
         VkInstance m_handle{nullptr};
+        const VkAllocationCallbacks* m_allocation_callbacks{nullptr};
     };
 
 
@@ -197,20 +213,23 @@ namespace vk_utils
                 return *this;
             }
             std::swap(m_handle, src.m_handle);
+            std::swap(m_allocation_callbacks, src.m_allocation_callbacks);
             return *this;
         }
 
 
         VkResult init(VkPhysicalDevice physical_device, VkDeviceCreateInfo* info)
         {
-            return vkCreateDevice(physical_device, info, nullptr, &m_handle);
+            m_allocation_callbacks = get_host_allocation_callbacks(HOST_OBJECT_DEVICE);
+            return vkCreateDevice(physical_device, info, m_allocation_callbacks, &m_handle);
         }
 
         void destroy()
         {
             if (m_handle != nullptr) {
-                vkDestroyDevice(m_handle, nullptr);
+                vkDestroyDevice(m_handle, m_allocation_callbacks);
                 m_handle = nullptr;
+                m_allocation_callbacks = nullptr;
             }
         }
 
@@ -221,6 +240,7 @@ namespace vk_utils
 
     private:
         VkDevice m_handle{nullptr};
+        const VkAllocationCallbacks* m_allocation_callbacks{nullptr};
     };
 
 
@@ -317,6 +337,7 @@ namespace vk_utils
 
             std::swap(m_handler, src.m_handler);
             std::swap(m_device, src.m_device);
+            std::swap(m_allocation_callbacks, src.m_allocation_callbacks);
 
             return *this;
         }
@@ -324,18 +345,20 @@ namespace vk_utils
         VkResult init(VkDevice device, VkGraphicsPipelineCreateInfo* info, VkPipelineCache cache = nullptr)
         {
             m_device = device;
-            return vkCreateGraphicsPipelines(m_device, cache, 1, info, nullptr, &m_handler);
+            m_allocation_callbacks = get_host_allocation_callbacks(HOST_OBJECT_PIPELINE);
+            return vkCreateGraphicsPipelines(m_device, cache, 1, info, m_allocation_callbacks, &m_handler);
         }
 
         VkResult reset(VkDevice i, VkGraphicsPipelineCreateInfo* info)
         {
             VkDevice old_device = m_device;
             VkPipeline old_handler = m_handler;
+            const VkAllocationCallbacks* old_allocation_callbacks = m_allocation_callbacks;
 
             auto res = init(i, info);
 
             if (res == VK_SUCCESS) {
-                destroy_impl(old_device, old_handler);
+                destroy_impl(old_device, old_handler, old_allocation_callbacks);
             }
 
             return res;
@@ -350,9 +373,10 @@ namespace vk_utils
 
         void destroy()
         {
-            destroy_impl(m_device, m_handler);
+            destroy_impl(m_device, m_handler, m_allocation_callbacks);
             m_device = nullptr;
             m_handler = nullptr;
+            m_allocation_callbacks = nullptr;
         }
 
         operator VkPipeline() const
@@ -361,15 +385,99 @@ namespace vk_utils
         }
 
     private:
-        void destroy_impl(VkDevice device, VkPipeline pipeline)
+        void destroy_impl(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* allocation_callbacks)
         {
             if (device != nullptr && pipeline != nullptr) {
-                vkDestroyPipeline(device, pipeline, nullptr);
+                vkDestroyPipeline(device, pipeline, allocation_callbacks);
             }
         }
 
         VkDevice m_device{nullptr};
         VkPipeline m_handler{nullptr};
+        const VkAllocationCallbacks* m_allocation_callbacks{nullptr};
+    };
+
+
+    class compute_pipeline_handler
+    {
+    public:
+        compute_pipeline_handler() = default;
+        ~compute_pipeline_handler()
+        {
+            destroy();
+        }
+        compute_pipeline_handler(const compute_pipeline_handler&) = delete;
+        compute_pipeline_handler& operator=(const compute_pipeline_handler&) = delete;
+        compute_pipeline_handler(compute_pipeline_handler&& src) noexcept
+        {
+            *this = std::move(src);
+        }
+        compute_pipeline_handler& operator=(compute_pipeline_handler&& src) noexcept
+        {
+            if (this == &src) {
+                return *this;
+            }
+
+            std::swap(m_handler, src.m_handler);
+            std::swap(m_device, src.m_device);
+            std::swap(m_allocation_callbacks, src.m_allocation_callbacks);
+
+            return *this;
+        }
+
+        VkResult init(VkDevice device, VkComputePipelineCreateInfo* info, VkPipelineCache cache = nullptr)
+        {
+            m_device = device;
+            m_allocation_callbacks = get_host_allocation_callbacks(HOST_OBJECT_PIPELINE);
+            return vkCreateComputePipelines(m_device, cache, 1, info, m_allocation_callbacks, &m_handler);
+        }
+
+        VkResult reset(VkDevice i, VkComputePipelineCreateInfo* info)
+        {
+            VkDevice old_device = m_device;
+            VkPipeline old_handler = m_handler;
+            const VkAllocationCallbacks* old_allocation_callbacks = m_allocation_callbacks;
+
+            auto res = init(i, info);
+
+            if (res == VK_SUCCESS) {
+                destroy_impl(old_device, old_handler, old_allocation_callbacks);
+            }
+
+            return res;
+        }
+
+        void reset(VkDevice d, VkPipeline p)
+        {
+            destroy();
+            m_device = d;
+            m_handler = p;
+        }
+
+        void destroy()
+        {
+            destroy_impl(m_device, m_handler, m_allocation_callbacks);
+            m_device = nullptr;
+            m_handler = nullptr;
+            m_allocation_callbacks = nullptr;
+        }
+
+        operator VkPipeline() const
+        {
+            return m_handler;
+        }
+
+    private:
+        void destroy_impl(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* allocation_callbacks)
+        {
+            if (device != nullptr && pipeline != nullptr) {
+                vkDestroyPipeline(device, pipeline, allocation_callbacks);
+            }
+        }
+
+        VkDevice m_device{nullptr};
+        VkPipeline m_handler{nullptr};
+        const VkAllocationCallbacks* m_allocation_callbacks{nullptr};
     };
 
 
@@ -395,12 +503,14 @@ namespace vk_utils
                 return *this;
             }
             std::swap(m_handle, src.m_handle);
+            std::swap(m_allocation_callbacks, src.m_allocation_callbacks);
             return *this;
         }
 
 
         VkResult init(VmaAllocatorCreateInfo* info)
         {
+            m_allocation_callbacks = info->pAllocationCallbacks;
             return vmaCreateAllocator(info, &m_handle);
         }
 
@@ -409,9 +519,16 @@ namespace vk_utils
             if (m_handle != nullptr) {
                 vmaDestroyAllocator(m_handle);
                 m_handle = nullptr;
+                m_allocation_callbacks = nullptr;
             }
         }
 
+        // the allocator creates and destroys its buffers, images and memory with these callbacks.
+        const VkAllocationCallbacks* get_allocation_callbacks() const
+        {
+            return m_allocation_callbacks;
+        }
+
         operator VmaAllocator() const
         {
             return m_handle;
@@ -419,6 +536,7 @@ namespace vk_utils
 
     private:
         VmaAllocator m_handle{nullptr};
+        const VkAllocationCallbacks* m_allocation_callbacks{nullptr};
     };
 
     template<
@@ -449,19 +567,40 @@ namespace vk_utils
             std::swap(m_resource, src.m_resource);
             std::swap(m_allocation, src.m_allocation);
             std::swap(m_allocator, src.m_allocator);
+            std::swap(m_alloc_info, src.m_alloc_info);
+            std::swap(m_create_info, src.m_create_info);
+            std::swap(m_tag, src.m_tag);
+            std::swap(m_heap_index, src.m_heap_index);
             return *this;
         }
 
-        VkResult init(VmaAllocator allocator, InitStructType* init_info, VmaAllocationCreateInfo* alloc_info)
+        VkResult init(VmaAllocator allocator, InitStructType* init_info, VmaAllocationCreateInfo* alloc_info, memory_tag tag = MEMORY_TAG_UNTAGGED)
         {
             destroy();
             m_allocator = allocator;
-            return init_func(m_allocator, init_info, alloc_info, &m_resource, &m_allocation, &m_alloc_info);
+            m_create_info = *init_info;
+            m_create_info.pNext = nullptr;
+            m_create_info.pQueueFamilyIndices = nullptr;
+            m_create_info.queueFamilyIndexCount = 0;
+
+            const auto res = init_func(m_allocator, init_info, alloc_info, &m_resource, &m_allocation, &m_alloc_info);
+
+            if (res == VK_SUCCESS) {
+                const VkPhysicalDeviceMemoryProperties* memory_props{nullptr};
+                vmaGetMemoryProperties(m_allocator, &memory_props);
+
+                m_tag = tag;
+                m_heap_index = memory_props->memoryTypes[m_alloc_info.memoryType].heapIndex;
+                detail::track_allocation(m_tag, m_heap_index, m_alloc_info.size);
+            }
+
+            return res;
         }
 
         void destroy()
         {
             if (m_allocator != nullptr && m_resource != nullptr && m_allocation != nullptr) {
+                detail::untrack_allocation(m_tag, m_heap_index, m_alloc_info.size);
                 destroy_func(m_allocator, m_resource, m_allocation);
 
                 m_allocator = nullptr;
@@ -475,6 +614,39 @@ namespace vk_utils
             return m_alloc_info;
         }
 
+        const InitStructType& get_create_info() const
+        {
+            return m_create_info;
+        }
+
+        memory_tag get_tag() const
+        {
+            return m_tag;
+        }
+
+        // switches to a resource bound to the same allocation after the allocation was moved,
+        // the previous resource is returned to the caller which destroys it once it is not used anymore.
+        StructType replace_resource(StructType resource)
+        {
+            std::swap(m_resource, resource);
+            return resource;
+        }
+
+        // a moved allocation may end up in another memory type, its statistics follow it.
+        void update_alloc_info()
+        {
+            if (m_allocator != nullptr && m_allocation != nullptr) {
+                detail::untrack_allocation(m_tag, m_heap_index, m_alloc_info.size);
+                vmaGetAllocationInfo(m_allocator, m_allocation, &m_alloc_info);
+
+                const VkPhysicalDeviceMemoryProperties* memory_props{nullptr};
+                vmaGetMemoryProperties(m_allocator, &memory_props);
+
+                m_heap_index = memory_props->memoryTypes[m_alloc_info.memoryType].heapIndex;
+                detail::track_allocation(m_tag, m_heap_index, m_alloc_info.size);
+            }
+        }
+
         operator StructType() const
         {
             return m_resource;
@@ -500,6 +672,9 @@ namespace vk_utils
         StructType m_resource{nullptr};
         VmaAllocation m_allocation{nullptr};
         VmaAllocationInfo m_alloc_info{};
+        InitStructType m_create_info{};
+        memory_tag m_tag{MEMORY_TAG_UNTAGGED};
+        uint32_t m_heap_index{0};
     };
 
     using img_view_handler =
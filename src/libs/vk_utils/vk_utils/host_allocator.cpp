@@ -0,0 +1,381 @@
+
+#include "host_allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    struct allocation_header
+    {
+        size_t size{0};
+        size_t offset{0};
+        uint32_t object{0};
+        uint32_t scope{0};
+    };
+
+    std::atomic_bool tracking_enabled{false};
+
+    std::mutex host_statistics_mutex{};
+    vk_utils::host_memory_statistics host_statistics{};
+
+
+    void add_allocation(vk_utils::host_allocation_statistics& stats, size_t size)
+    {
+        stats.allocation_count++;
+        stats.allocation_bytes += size;
+        stats.peak_allocation_bytes = std::max(stats.peak_allocation_bytes, stats.allocation_bytes);
+    }
+
+
+    void remove_allocation(vk_utils::host_allocation_statistics& stats, size_t size)
+    {
+        stats.allocation_count -= std::min(stats.allocation_count, 1u);
+        stats.allocation_bytes -= std::min(stats.allocation_bytes, size);
+    }
+
+
+    uint32_t scope_index(VkSystemAllocationScope scope)
+    {
+        return std::min<uint32_t>(scope, vk_utils::HOST_ALLOCATION_SCOPES_COUNT - 1);
+    }
+
+
+    uint8_t* align_up(uint8_t* ptr, size_t alignment)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return ptr + ((alignment - address % alignment) % alignment);
+    }
+
+
+    allocation_header* get_header(void* memory)
+    {
+        return reinterpret_cast<allocation_header*>(static_cast<uint8_t*>(memory) - sizeof(allocation_header));
+    }
+
+
+    void* VKAPI_PTR tracked_allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        if (size == 0) {
+            return nullptr;
+        }
+
+        alignment = std::max(alignment, alignof(allocation_header));
+
+        auto* raw = static_cast<uint8_t*>(malloc(size + sizeof(allocation_header) + alignment));
+
+        if (raw == nullptr) {
+            return nullptr;
+        }
+
+        auto* memory = align_up(raw + sizeof(allocation_header), alignment);
+        auto* header = get_header(memory);
+
+        header->size = size;
+        header->offset = memory - raw;
+        header->object = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(user_data));
+        header->scope = scope_index(scope);
+
+        std::lock_guard lock{host_statistics_mutex};
+        add_allocation(host_statistics.objects[header->object], size);
+        add_allocation(host_statistics.scopes[header->scope], size);
+
+        return memory;
+    }
+
+
+    void VKAPI_PTR tracked_free(void*, void* memory)
+    {
+        if (memory == nullptr) {
+            return;
+        }
+
+        const auto* header = get_header(memory);
+
+        {
+            std::lock_guard lock{host_statistics_mutex};
+            remove_allocation(host_statistics.objects[header->object], header->size);
+            remove_allocation(host_statistics.scopes[header->scope], header->size);
+        }
+
+        free(static_cast<uint8_t*>(memory) - header->offset);
+    }
+
+
+    void* VKAPI_PTR tracked_reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        if (original == nullptr) {
+            return tracked_allocate(user_data, size, alignment, scope);
+        }
+
+        if (size == 0) {
+            tracked_free(user_data, original);
+            return nullptr;
+        }
+
+        void* memory = tracked_allocate(user_data, size, alignment, scope);
+
+        if (memory != nullptr) {
+            memcpy(memory, original, std::min(size, get_header(original)->size));
+            tracked_free(user_data, original);
+        }
+
+        return memory;
+    }
+
+
+    void VKAPI_PTR internal_allocation_notification(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+    {
+        std::lock_guard lock{host_statistics_mutex};
+        add_allocation(host_statistics.internal[scope_index(scope)], size);
+    }
+
+
+    void VKAPI_PTR internal_free_notification(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+    {
+        std::lock_guard lock{host_statistics_mutex};
+        remove_allocation(host_statistics.internal[scope_index(scope)], size);
+    }
+
+
+    struct tracked_callbacks
+    {
+        tracked_callbacks()
+        {
+            for (uint32_t i = 0; i < vk_utils::HOST_OBJECT_MAX_ENUM; ++i) {
+                callbacks[i] = VkAllocationCallbacks{
+                    .pUserData = reinterpret_cast<void*>(static_cast<uintptr_t>(i)),
+                    .pfnAllocation = tracked_allocate,
+                    .pfnReallocation = tracked_reallocate,
+                    .pfnFree = tracked_free,
+                    .pfnInternalAllocation = internal_allocation_notification,
+                    .pfnInternalFree = internal_free_notification,
+                };
+            }
+        }
+
+        VkAllocationCallbacks callbacks[vk_utils::HOST_OBJECT_MAX_ENUM]{};
+    };
+
+    const tracked_callbacks all_tracked_callbacks{};
+} // namespace
+
+
+const char* vk_utils::get_host_object_name(host_object object)
+{
+    switch (object) {
+        case HOST_OBJECT_OTHER:
+            return "other";
+        case HOST_OBJECT_INSTANCE:
+            return "instance";
+        case HOST_OBJECT_DEVICE:
+            return "device";
+        case HOST_OBJECT_ALLOCATOR:
+            return "allocator";
+        case HOST_OBJECT_SURFACE:
+            return "surface";
+        case HOST_OBJECT_SWAPCHAIN:
+            return "swapchain";
+        case HOST_OBJECT_DEBUG_MESSENGER:
+            return "debug_messenger";
+        case HOST_OBJECT_BUFFER:
+            return "buffer";
+        case HOST_OBJECT_IMAGE:
+            return "image";
+        case HOST_OBJECT_IMAGE_VIEW:
+            return "image_view";
+        case HOST_OBJECT_SAMPLER:
+            return "sampler";
+        case HOST_OBJECT_SHADER_MODULE:
+            return "shader_module";
+        case HOST_OBJECT_PIPELINE:
+            return "pipeline";
+        case HOST_OBJECT_PIPELINE_LAYOUT:
+            return "pipeline_layout";
+        case HOST_OBJECT_RENDER_PASS:
+            return "render_pass";
+        case HOST_OBJECT_FRAMEBUFFER:
+            return "framebuffer";
+        case HOST_OBJECT_DESCRIPTOR_SET_LAYOUT:
+            return "descriptor_set_layout";
+        case HOST_OBJECT_DESCRIPTOR_POOL:
+            return "descriptor_pool";
+        case HOST_OBJECT_COMMAND_POOL:
+            return "command_pool";
+        case HOST_OBJECT_SEMAPHORE:
+            return "semaphore";
+        case HOST_OBJECT_FENCE:
+            return "fence";
+        case HOST_OBJECT_DEVICE_MEMORY:
+            return "device_memory";
+        default:
+            return "unknown";
+    }
+}
+
+
+const char* vk_utils::get_host_allocation_scope_name(VkSystemAllocationScope scope)
+{
+    switch (scope) {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+            return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+            return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+            return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+            return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+            return "instance";
+        default:
+            return "unknown";
+    }
+}
+
+
+void vk_utils::set_host_allocation_tracking(bool enabled)
+{
+    tracking_enabled = enabled;
+}
+
+
+bool vk_utils::host_allocation_tracking_enabled()
+{
+    return tracking_enabled;
+}
+
+
+const VkAllocationCallbacks* vk_utils::get_host_allocation_callbacks(host_object object)
+{
+    if (!tracking_enabled || object >= HOST_OBJECT_MAX_ENUM) {
+        return nullptr;
+    }
+
+    return &all_tracked_callbacks.callbacks[object];
+}
+
+
+vk_utils::host_memory_statistics vk_utils::get_host_memory_statistics()
+{
+    std::lock_guard lock{host_statistics_mutex};
+    return host_statistics;
+}
+
+
+vk_utils::host_arena::host_arena(size_t block_size)
+    : m_block_size(block_size)
+{
+    m_callbacks = VkAllocationCallbacks{
+        .pUserData = this,
+        .pfnAllocation = allocate,
+        .pfnReallocation = reallocate,
+        .pfnFree = free,
+        .pfnInternalAllocation = internal_allocation_notification,
+        .pfnInternalFree = internal_free_notification,
+    };
+}
+
+
+vk_utils::host_arena::~host_arena()
+{
+    std::lock_guard lock{host_statistics_mutex};
+
+    for (const auto& b : m_blocks) {
+        remove_allocation(host_statistics.arenas, b.size);
+    }
+}
+
+
+const VkAllocationCallbacks* vk_utils::host_arena::get_callbacks() const
+{
+    return &m_callbacks;
+}
+
+
+void vk_utils::host_arena::reset()
+{
+    std::lock_guard lock{m_mutex};
+
+    m_block_index = 0;
+    m_block_offset = 0;
+}
+
+
+void* VKAPI_PTR vk_utils::host_arena::allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope)
+{
+    return static_cast<host_arena*>(user_data)->allocate(size, alignment);
+}
+
+
+void* VKAPI_PTR vk_utils::host_arena::reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope)
+{
+    auto* arena = static_cast<host_arena*>(user_data);
+
+    if (original == nullptr) {
+        return arena->allocate(size, alignment);
+    }
+
+    if (size == 0) {
+        return nullptr;
+    }
+
+    void* memory = arena->allocate(size, alignment);
+
+    if (memory != nullptr) {
+        const auto original_size = *reinterpret_cast<size_t*>(static_cast<uint8_t*>(original) - sizeof(size_t));
+        memcpy(memory, original, std::min(size, original_size));
+    }
+
+    return memory;
+}
+
+
+void VKAPI_PTR vk_utils::host_arena::free(void*, void*)
+{
+}
+
+
+void* vk_utils::host_arena::allocate(size_t size, size_t alignment)
+{
+    if (size == 0) {
+        return nullptr;
+    }
+
+    alignment = std::max(alignment, alignof(size_t));
+
+    std::lock_guard lock{m_mutex};
+
+    // the size is kept in front of every allocation for reallocations.
+    for (; m_block_index < m_blocks.size(); ++m_block_index, m_block_offset = 0) {
+        auto& b = m_blocks[m_block_index];
+        auto* memory = align_up(b.data.get() + m_block_offset + sizeof(size_t), alignment);
+
+        if (memory + size <= b.data.get() + b.size) {
+            *reinterpret_cast<size_t*>(memory - sizeof(size_t)) = size;
+            m_block_offset = memory + size - b.data.get();
+            return memory;
+        }
+    }
+
+    reserve_block(std::max(m_block_size, size + sizeof(size_t) + alignment));
+
+    auto& b = m_blocks.back();
+    auto* memory = align_up(b.data.get() + sizeof(size_t), alignment);
+
+    *reinterpret_cast<size_t*>(memory - sizeof(size_t)) = size;
+    m_block_index = m_blocks.size() - 1;
+    m_block_offset = memory + size - b.data.get();
+
+    return memory;
+}
+
+
+void vk_utils::host_arena::reserve_block(size_t size)
+{
+    m_blocks.push_back({std::make_unique<uint8_t[]>(size), size});
+
+    std::lock_guard lock{host_statistics_mutex};
+    add_allocation(host_statistics.arenas, size);
+}
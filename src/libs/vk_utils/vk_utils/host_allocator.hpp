@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vk_utils/defs.hpp>
+#include <VulkanMemoryAllocator/src/vk_mem_alloc.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vk_utils
+{
+    // Object category driver host allocations are accounted to.
+    enum host_object
+    {
+        HOST_OBJECT_OTHER,
+        HOST_OBJECT_INSTANCE,
+        HOST_OBJECT_DEVICE,
+        HOST_OBJECT_ALLOCATOR,
+        HOST_OBJECT_SURFACE,
+        HOST_OBJECT_SWAPCHAIN,
+        HOST_OBJECT_DEBUG_MESSENGER,
+        HOST_OBJECT_BUFFER,
+        HOST_OBJECT_IMAGE,
+        HOST_OBJECT_IMAGE_VIEW,
+        HOST_OBJECT_SAMPLER,
+        HOST_OBJECT_SHADER_MODULE,
+        HOST_OBJECT_PIPELINE,
+        HOST_OBJECT_PIPELINE_LAYOUT,
+        HOST_OBJECT_RENDER_PASS,
+        HOST_OBJECT_FRAMEBUFFER,
+        HOST_OBJECT_DESCRIPTOR_SET_LAYOUT,
+        HOST_OBJECT_DESCRIPTOR_POOL,
+        HOST_OBJECT_COMMAND_POOL,
+        HOST_OBJECT_SEMAPHORE,
+        HOST_OBJECT_FENCE,
+        HOST_OBJECT_DEVICE_MEMORY,
+        HOST_OBJECT_MAX_ENUM
+    };
+
+    constexpr uint32_t HOST_ALLOCATION_SCOPES_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    struct host_allocation_statistics
+    {
+        uint32_t allocation_count{0};
+        size_t allocation_bytes{0};
+        size_t peak_allocation_bytes{0};
+    };
+
+    struct host_memory_statistics
+    {
+        host_allocation_statistics objects[HOST_OBJECT_MAX_ENUM]{};
+        host_allocation_statistics scopes[HOST_ALLOCATION_SCOPES_COUNT]{};
+        // allocations the driver made itself and only reported.
+        host_allocation_statistics internal[HOST_ALLOCATION_SCOPES_COUNT]{};
+        // blocks reserved by live arenas.
+        host_allocation_statistics arenas{};
+    };
+
+    template<typename T>
+    constexpr host_object host_object_of = HOST_OBJECT_OTHER;
+
+    template<> constexpr host_object host_object_of<VkInstance> = HOST_OBJECT_INSTANCE;
+    template<> constexpr host_object host_object_of<VkDevice> = HOST_OBJECT_DEVICE;
+    template<> constexpr host_object host_object_of<VmaAllocator> = HOST_OBJECT_ALLOCATOR;
+    template<> constexpr host_object host_object_of<VkSurfaceKHR> = HOST_OBJECT_SURFACE;
+    template<> constexpr host_object host_object_of<VkSwapchainKHR> = HOST_OBJECT_SWAPCHAIN;
+    template<> constexpr host_object host_object_of<VkDebugUtilsMessengerEXT> = HOST_OBJECT_DEBUG_MESSENGER;
+    template<> constexpr host_object host_object_of<VkBuffer> = HOST_OBJECT_BUFFER;
+    template<> constexpr host_object host_object_of<VkImage> = HOST_OBJECT_IMAGE;
+    template<> constexpr host_object host_object_of<VkImageView> = HOST_OBJECT_IMAGE_VIEW;
+    template<> constexpr host_object host_object_of<VkSampler> = HOST_OBJECT_SAMPLER;
+    template<> constexpr host_object host_object_of<VkShaderModule> = HOST_OBJECT_SHADER_MODULE;
+    template<> constexpr host_object host_object_of<VkPipeline> = HOST_OBJECT_PIPELINE;
+    template<> constexpr host_object host_object_of<VkPipelineLayout> = HOST_OBJECT_PIPELINE_LAYOUT;
+    template<> constexpr host_object host_object_of<VkRenderPass> = HOST_OBJECT_RENDER_PASS;
+    template<> constexpr host_object host_object_of<VkFramebuffer> = HOST_OBJECT_FRAMEBUFFER;
+    template<> constexpr host_object host_object_of<VkDescriptorSetLayout> = HOST_OBJECT_DESCRIPTOR_SET_LAYOUT;
+    template<> constexpr host_object host_object_of<VkDescriptorPool> = HOST_OBJECT_DESCRIPTOR_POOL;
+    template<> constexpr host_object host_object_of<VkCommandPool> = HOST_OBJECT_COMMAND_POOL;
+    template<> constexpr host_object host_object_of<VkSemaphore> = HOST_OBJECT_SEMAPHORE;
+    template<> constexpr host_object host_object_of<VkFence> = HOST_OBJECT_FENCE;
+    template<> constexpr host_object host_object_of<VkDeviceMemory> = HOST_OBJECT_DEVICE_MEMORY;
+
+    const char* get_host_object_name(host_object object);
+    const char* get_host_allocation_scope_name(VkSystemAllocationScope scope);
+
+    // handlers created while tracking is enabled pass callbacks counting their host allocations,
+    // they keep the callbacks they were created with, so tracking may be toggled at any time.
+    void set_host_allocation_tracking(bool enabled);
+    bool host_allocation_tracking_enabled();
+
+    // nullptr when tracking is disabled.
+    const VkAllocationCallbacks* get_host_allocation_callbacks(host_object object);
+
+    host_memory_statistics get_host_memory_statistics();
+
+
+    // Linear host memory for short-lived objects, e.g. shader modules only used to create a pipeline.
+    // frees are ignored, memory is reused by reset() or given back when the arena is destroyed,
+    // every object created with the arena callbacks has to be destroyed before.
+    class host_arena
+    {
+    public:
+        explicit host_arena(size_t block_size = 64 * 1024);
+        host_arena(const host_arena&) = delete;
+        host_arena& operator=(const host_arena&) = delete;
+        ~host_arena();
+
+        const VkAllocationCallbacks* get_callbacks() const;
+        void reset();
+
+    private:
+        struct block
+        {
+            std::unique_ptr<uint8_t[]> data{};
+            size_t size{0};
+        };
+
+        static void* VKAPI_PTR allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static void* VKAPI_PTR reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static void VKAPI_PTR free(void* user_data, void* memory);
+
+        void* allocate(size_t size, size_t alignment);
+        void reserve_block(size_t size);
+
+        std::mutex m_mutex{};
+        VkAllocationCallbacks m_callbacks{};
+        size_t m_block_size{0};
+        std::vector<block> m_blocks{};
+        size_t m_block_index{0};
+        size_t m_block_offset{0};
+    };
+} // namespace vk_utils
@@ -0,0 +1,252 @@
+
+#include "image_decoder.hpp"
+
+#include <stb/stb_image.h>
+
+#ifdef VK_UTILS_USE_TURBOJPEG
+    #include <turbojpeg.h>
+#endif
+
+#ifdef VK_UTILS_USE_SPNG
+    #include <spng.h>
+#endif
+
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+    class stb_image_decoder : public vk_utils::image_decoder
+    {
+    public:
+        const char* get_name() const override
+        {
+            return "stb";
+        }
+
+        bool read_info(const uint8_t* data, size_t size, vk_utils::decoded_image_info& info) const override
+        {
+            int w, h, c;
+
+            if (stbi_info_from_memory(data, size, &w, &h, &c) == 0) {
+                return false;
+            }
+
+            info = {
+                .width = static_cast<uint32_t>(w),
+                .height = static_cast<uint32_t>(h),
+                .channels_count = static_cast<uint32_t>(c),
+            };
+
+            return true;
+        }
+
+        bool decode(const uint8_t* data, size_t size, uint32_t channels_count, uint8_t* dst) const override
+        {
+            int w, h, c;
+            std::unique_ptr<stbi_uc, std::function<void(stbi_uc*)>> image_handler{
+                stbi_load_from_memory(data, size, &w, &h, &c, channels_count),
+                [](stbi_uc* ptr) {if (ptr != nullptr) stbi_image_free(ptr); }};
+
+            if (image_handler == nullptr) {
+                return false;
+            }
+
+            std::memcpy(dst, image_handler.get(), size_t(w) * h * channels_count);
+
+            return true;
+        }
+    };
+
+#ifdef VK_UTILS_USE_TURBOJPEG
+    class turbojpeg_image_decoder : public vk_utils::image_decoder
+    {
+    public:
+        const char* get_name() const override
+        {
+            return "turbojpeg";
+        }
+
+        bool read_info(const uint8_t* data, size_t size, vk_utils::decoded_image_info& info) const override
+        {
+            if (size < 2 || data[0] != 0xFF || data[1] != 0xD8) {
+                return false;
+            }
+
+            std::unique_ptr<void, std::function<void(void*)>> handle{tjInitDecompress(), [](void* h) {if (h != nullptr) tjDestroy(h); }};
+
+            int w, h, subsampling, colorspace;
+
+            if (handle == nullptr || tjDecompressHeader3(handle.get(), data, size, &w, &h, &subsampling, &colorspace) != 0) {
+                return false;
+            }
+
+            info = {
+                .width = static_cast<uint32_t>(w),
+                .height = static_cast<uint32_t>(h),
+                .channels_count = colorspace == TJCS_GRAY ? 1u : 3u,
+            };
+
+            return true;
+        }
+
+        bool decode(const uint8_t* data, size_t size, uint32_t channels_count, uint8_t* dst) const override
+        {
+            std::unique_ptr<void, std::function<void(void*)>> handle{tjInitDecompress(), [](void* h) {if (h != nullptr) tjDestroy(h); }};
+
+            int w, h, subsampling, colorspace;
+
+            if (handle == nullptr || tjDecompressHeader3(handle.get(), data, size, &w, &h, &subsampling, &colorspace) != 0) {
+                return false;
+            }
+
+            int pixel_format;
+
+            switch (channels_count) {
+                case 1:
+                    pixel_format = TJPF_GRAY;
+                    break;
+                case 3:
+                    pixel_format = TJPF_RGB;
+                    break;
+                case 4:
+                    pixel_format = TJPF_RGBA;
+                    break;
+                default:
+                    return false;
+            }
+
+            return tjDecompress2(handle.get(), data, size, dst, w, w * channels_count, h, pixel_format, 0) == 0;
+        }
+    };
+#endif
+
+#ifdef VK_UTILS_USE_SPNG
+    class spng_image_decoder : public vk_utils::image_decoder
+    {
+    public:
+        const char* get_name() const override
+        {
+            return "spng";
+        }
+
+        bool read_info(const uint8_t* data, size_t size, vk_utils::decoded_image_info& info) const override
+        {
+            constexpr uint8_t png_signature[]{0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+
+            if (size < sizeof(png_signature) || std::memcmp(data, png_signature, sizeof(png_signature)) != 0) {
+                return false;
+            }
+
+            std::unique_ptr<spng_ctx, std::function<void(spng_ctx*)>> ctx{spng_ctx_new(0), [](spng_ctx* c) {if (c != nullptr) spng_ctx_free(c); }};
+            spng_ihdr ihdr{};
+
+            if (ctx == nullptr || spng_set_png_buffer(ctx.get(), data, size) != 0 || spng_get_ihdr(ctx.get(), &ihdr) != 0) {
+                return false;
+            }
+
+            info = {
+                .width = ihdr.width,
+                .height = ihdr.height,
+                .channels_count = get_channels_count(ctx.get(), ihdr),
+            };
+
+            return true;
+        }
+
+        bool decode(const uint8_t* data, size_t size, uint32_t channels_count, uint8_t* dst) const override
+        {
+            std::unique_ptr<spng_ctx, std::function<void(spng_ctx*)>> ctx{spng_ctx_new(0), [](spng_ctx* c) {if (c != nullptr) spng_ctx_free(c); }};
+            spng_ihdr ihdr{};
+
+            if (ctx == nullptr || spng_set_png_buffer(ctx.get(), data, size) != 0 || spng_get_ihdr(ctx.get(), &ihdr) != 0) {
+                return false;
+            }
+
+            int format;
+
+            switch (channels_count) {
+                case 1:
+                    format = SPNG_FMT_G8;
+                    break;
+                case 2:
+                    format = SPNG_FMT_GA8;
+                    break;
+                case 3:
+                    format = SPNG_FMT_RGB8;
+                    break;
+                case 4:
+                    format = SPNG_FMT_RGBA8;
+                    break;
+                default:
+                    return false;
+            }
+
+            size_t decoded_size{0};
+
+            if (spng_decoded_image_size(ctx.get(), format, &decoded_size) != 0 || decoded_size != size_t(ihdr.width) * ihdr.height * channels_count) {
+                return false;
+            }
+
+            return spng_decode_image(ctx.get(), dst, decoded_size, format, SPNG_DECODE_TRNS) == 0;
+        }
+
+    private:
+        static uint32_t get_channels_count(spng_ctx* ctx, const spng_ihdr& ihdr)
+        {
+            spng_trns trns{};
+            const bool has_trns = spng_get_trns(ctx, &trns) == 0;
+
+            switch (ihdr.color_type) {
+                case SPNG_COLOR_TYPE_GRAYSCALE:
+                    return has_trns ? 4 : (ihdr.bit_depth <= 8 ? 1 : 3);
+                case SPNG_COLOR_TYPE_GRAYSCALE_ALPHA:
+                    return ihdr.bit_depth == 8 ? 2 : 4;
+                case SPNG_COLOR_TYPE_TRUECOLOR:
+                    [[fallthrough]];
+                case SPNG_COLOR_TYPE_INDEXED:
+                    return has_trns ? 4 : 3;
+                default:
+                    return 4;
+            }
+        }
+    };
+#endif
+
+    std::vector<std::unique_ptr<vk_utils::image_decoder>>& get_decoders()
+    {
+        static std::vector<std::unique_ptr<vk_utils::image_decoder>> decoders = []() {
+            std::vector<std::unique_ptr<vk_utils::image_decoder>> res{};
+#ifdef VK_UTILS_USE_TURBOJPEG
+            res.emplace_back(std::make_unique<turbojpeg_image_decoder>());
+#endif
+#ifdef VK_UTILS_USE_SPNG
+            res.emplace_back(std::make_unique<spng_image_decoder>());
+#endif
+            res.emplace_back(std::make_unique<stb_image_decoder>());
+            return res;
+        }();
+
+        return decoders;
+    }
+} // namespace
+
+
+void vk_utils::register_image_decoder(std::unique_ptr<image_decoder> decoder)
+{
+    auto& decoders = get_decoders();
+    decoders.insert(decoders.begin(), std::move(decoder));
+}
+
+
+const vk_utils::image_decoder* vk_utils::find_image_decoder(const uint8_t* data, size_t size, decoded_image_info& info)
+{
+    for (const auto& decoder : get_decoders()) {
+        if (decoder->read_info(data, size, info)) {
+            return decoder.get();
+        }
+    }
+
+    return nullptr;
+}
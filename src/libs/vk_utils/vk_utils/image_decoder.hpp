@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace vk_utils
+{
+    struct decoded_image_info
+    {
+        uint32_t width{0};
+        uint32_t height{0};
+        uint32_t channels_count{0};
+    };
+
+    // decodes 8 bit per channel images straight into caller memory, e.g. a mapped staging buffer.
+    class image_decoder
+    {
+    public:
+        virtual ~image_decoder() = default;
+
+        virtual const char* get_name() const = 0;
+
+        // fails fast on images of unsupported containers.
+        virtual bool read_info(const uint8_t* data, size_t size, decoded_image_info& info) const = 0;
+
+        // writes width * height * channels_count tightly packed bytes to dst,
+        // channels_count is the image one from read_info or 4.
+        virtual bool decode(const uint8_t* data, size_t size, uint32_t channels_count, uint8_t* dst) const = 0;
+    };
+
+    // decoders are tried from the last registered one, built in SIMD decoders go next and stb is the last fallback.
+    // must not be called while images are being loaded.
+    void register_image_decoder(std::unique_ptr<image_decoder> decoder);
+
+    const image_decoder* find_image_decoder(const uint8_t* data, size_t size, decoded_image_info& info);
+} // namespace vk_utils
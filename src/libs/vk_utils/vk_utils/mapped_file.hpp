@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vk_utils
+{
+    // Read only memory mapping of a whole file.
+    class mapped_file
+    {
+    public:
+        mapped_file() = default;
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        ~mapped_file();
+
+        bool open(const char* path);
+        void close();
+
+        const uint8_t* data() const;
+        size_t size() const;
+
+    private:
+        const uint8_t* m_data{nullptr};
+        size_t m_size{0};
+#if defined(_WIN32)
+        void* m_file{nullptr};
+        void* m_mapping{nullptr};
+#endif
+    };
+} // namespace vk_utils
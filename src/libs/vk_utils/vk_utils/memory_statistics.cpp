@@ -0,0 +1,72 @@
+
+#include "memory_statistics.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+namespace
+{
+    std::mutex tag_statistics_mutex{};
+    vk_utils::memory_tag_statistics tag_statistics[vk_utils::MEMORY_TAG_MAX_ENUM][VK_MAX_MEMORY_HEAPS]{};
+} // namespace
+
+
+const char* vk_utils::get_memory_tag_name(memory_tag tag)
+{
+    switch (tag) {
+        case MEMORY_TAG_UNTAGGED:
+            return "untagged";
+        case MEMORY_TAG_GEOMETRY:
+            return "geometry";
+        case MEMORY_TAG_TEXTURES:
+            return "textures";
+        case MEMORY_TAG_STAGING:
+            return "staging";
+        case MEMORY_TAG_UNIFORMS:
+            return "uniforms";
+        case MEMORY_TAG_ATTACHMENTS:
+            return "attachments";
+        default:
+            return "unknown";
+    }
+}
+
+
+vk_utils::memory_tag_statistics vk_utils::get_memory_tag_statistics(memory_tag tag, uint32_t heap_index)
+{
+    if (tag >= MEMORY_TAG_MAX_ENUM || heap_index >= VK_MAX_MEMORY_HEAPS) {
+        return {};
+    }
+
+    std::lock_guard lock{tag_statistics_mutex};
+    return tag_statistics[tag][heap_index];
+}
+
+
+void vk_utils::detail::track_allocation(memory_tag tag, uint32_t heap_index, VkDeviceSize size)
+{
+    if (tag >= MEMORY_TAG_MAX_ENUM || heap_index >= VK_MAX_MEMORY_HEAPS) {
+        return;
+    }
+
+    std::lock_guard lock{tag_statistics_mutex};
+    auto& stats = tag_statistics[tag][heap_index];
+
+    stats.allocation_count++;
+    stats.allocation_bytes += size;
+    stats.peak_allocation_bytes = std::max(stats.peak_allocation_bytes, stats.allocation_bytes);
+}
+
+
+void vk_utils::detail::untrack_allocation(memory_tag tag, uint32_t heap_index, VkDeviceSize size)
+{
+    if (tag >= MEMORY_TAG_MAX_ENUM || heap_index >= VK_MAX_MEMORY_HEAPS) {
+        return;
+    }
+
+    std::lock_guard lock{tag_statistics_mutex};
+    auto& stats = tag_statistics[tag][heap_index];
+
+    stats.allocation_count -= std::min(stats.allocation_count, 1u);
+    stats.allocation_bytes -= std::min(stats.allocation_bytes, size);
+}
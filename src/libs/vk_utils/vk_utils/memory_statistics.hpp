@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vk_utils/defs.hpp>
+#include <VulkanMemoryAllocator/src/vk_mem_alloc.h>
+
+#include <cstdint>
+
+namespace vk_utils
+{
+    // Resource category vma allocations are accounted to.
+    enum memory_tag
+    {
+        MEMORY_TAG_UNTAGGED,
+        MEMORY_TAG_GEOMETRY,
+        MEMORY_TAG_TEXTURES,
+        MEMORY_TAG_STAGING,
+        MEMORY_TAG_UNIFORMS,
+        MEMORY_TAG_ATTACHMENTS,
+        MEMORY_TAG_MAX_ENUM
+    };
+
+    struct memory_tag_statistics
+    {
+        uint32_t allocation_count{0};
+        VkDeviceSize allocation_bytes{0};
+        VkDeviceSize peak_allocation_bytes{0};
+    };
+
+    const char* get_memory_tag_name(memory_tag tag);
+
+    // live allocations made through the vma resource handlers on the given heap.
+    memory_tag_statistics get_memory_tag_statistics(memory_tag tag, uint32_t heap_index);
+
+    namespace detail
+    {
+        void track_allocation(memory_tag tag, uint32_t heap_index, VkDeviceSize size);
+        void untrack_allocation(memory_tag tag, uint32_t heap_index, VkDeviceSize size);
+    } // namespace detail
+} // namespace vk_utils
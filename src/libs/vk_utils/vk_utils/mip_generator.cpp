@@ -0,0 +1,716 @@
+
+#include "mip_generator.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
+
+#include <shaderc/shaderc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+namespace
+{
+    constexpr uint32_t max_mips_per_dispatch = 12;
+    constexpr uint32_t tile_mips_count = 6;
+    constexpr uint32_t tile_size = 1u << tile_mips_count;
+    // the last workgroup reduces a single tile of the 6th level.
+    constexpr uint32_t max_single_pass_dimension = tile_size * tile_size;
+
+    struct push_constants
+    {
+        int32_t src_size[2];
+        int32_t mips_count;
+        int32_t srgb;
+        uint32_t workgroups_count;
+        uint32_t counter_offset;
+    };
+
+    constexpr const char* downsample_shader_source = R"(
+#version 450
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+layout(push_constant) uniform push_constants
+{
+    ivec2 src_size;
+    int mips_count;
+    int srgb;
+    uint workgroups_count;
+    uint counter_offset;
+} pc;
+
+layout(set = 0, binding = 0) uniform sampler2DArray src_image;
+layout(set = 0, binding = 1, STORAGE_FORMAT) uniform coherent image2DArray dst_mips[12];
+layout(set = 0, binding = 2, std430) coherent buffer counters_buffer
+{
+    uint counters[];
+};
+
+shared vec4 tile[16][16];
+shared uint is_last_workgroup;
+
+vec3 srgb_to_linear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), greaterThan(c, vec3(0.04045)));
+}
+
+vec3 linear_to_srgb(vec3 c)
+{
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, greaterThan(c, vec3(0.0031308)));
+}
+
+ivec2 get_mip_size(int mip)
+{
+    return max(pc.src_size >> mip, ivec2(1));
+}
+
+#define STORE_MIP(i)                                     \
+    case i + 1:                                          \
+        imageStore(dst_mips[i], ivec3(p, layer), c);     \
+        break;
+
+void store_mip(int mip, ivec2 p, int layer, vec4 c)
+{
+    if (mip > pc.mips_count || any(greaterThanEqual(p, get_mip_size(mip)))) {
+        return;
+    }
+
+    if (pc.srgb != 0) {
+        c.rgb = linear_to_srgb(clamp(c.rgb, 0.0, 1.0));
+    }
+
+    switch (mip) {
+        STORE_MIP(0)
+        STORE_MIP(1)
+        STORE_MIP(2)
+        STORE_MIP(3)
+        STORE_MIP(4)
+        STORE_MIP(5)
+        STORE_MIP(6)
+        STORE_MIP(7)
+        STORE_MIP(8)
+        STORE_MIP(9)
+        STORE_MIP(10)
+        STORE_MIP(11)
+    }
+}
+
+vec4 load_mip6(ivec2 p, int layer)
+{
+    vec4 c = imageLoad(dst_mips[5], ivec3(min(p, get_mip_size(6) - 1), layer));
+
+    if (pc.srgb != 0) {
+        c.rgb = srgb_to_linear(c.rgb);
+    }
+
+    return c;
+}
+
+void reduce_tile(int first_mip, ivec2 tile_id, int layer)
+{
+    const int i = int(gl_LocalInvocationIndex);
+    int mip = first_mip;
+
+    for (int size = 8; size >= 1; size /= 2, ++mip) {
+        barrier();
+
+        const ivec2 t = ivec2(i % size, i / size);
+        const bool active = i < size * size;
+        vec4 c = vec4(0.0);
+
+        if (active) {
+            c = (tile[2 * t.y][2 * t.x] + tile[2 * t.y][2 * t.x + 1] + tile[2 * t.y + 1][2 * t.x] + tile[2 * t.y + 1][2 * t.x + 1]) * 0.25;
+        }
+
+        barrier();
+
+        if (active) {
+            tile[t.y][t.x] = c;
+            store_mip(mip, tile_id * size + t, layer, c);
+        }
+    }
+}
+
+void main()
+{
+    const int layer = int(gl_WorkGroupID.z);
+    const ivec2 t = ivec2(int(gl_LocalInvocationIndex) % 16, int(gl_LocalInvocationIndex) / 16);
+    const ivec2 tile_id = ivec2(gl_WorkGroupID.xy);
+    const ivec2 p2 = tile_id * 16 + t;
+    const vec2 mip1_texel_size = 1.0 / vec2(get_mip_size(1));
+
+    vec4 sum = vec4(0.0);
+
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            const ivec2 p1 = p2 * 2 + ivec2(x, y);
+            const vec4 c = textureLod(src_image, vec3((vec2(p1) + 0.5) * mip1_texel_size, layer), 0.0);
+            store_mip(1, p1, layer, c);
+            sum += c;
+        }
+    }
+
+    sum *= 0.25;
+    store_mip(2, p2, layer, sum);
+    tile[t.y][t.x] = sum;
+
+    reduce_tile(3, tile_id, layer);
+
+    if (pc.mips_count <= 6) {
+        return;
+    }
+
+    memoryBarrierImage();
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0) {
+        is_last_workgroup = atomicAdd(counters[pc.counter_offset + layer], 1u) == pc.workgroups_count - 1u ? 1u : 0u;
+    }
+
+    barrier();
+
+    if (is_last_workgroup == 0u) {
+        return;
+    }
+
+    memoryBarrierImage();
+
+    sum = vec4(0.0);
+
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            const ivec2 p7 = t * 2 + ivec2(x, y);
+            const vec4 c = (load_mip6(p7 * 2, layer) + load_mip6(p7 * 2 + ivec2(1, 0), layer) + load_mip6(p7 * 2 + ivec2(0, 1), layer) + load_mip6(p7 * 2 + ivec2(1, 1), layer)) * 0.25;
+            store_mip(7, p7, layer, c);
+            sum += c;
+        }
+    }
+
+    sum *= 0.25;
+    store_mip(8, t, layer, sum);
+    tile[t.y][t.x] = sum;
+
+    reduce_tile(9, ivec2(0), layer);
+}
+)";
+
+    struct dispatch_info
+    {
+        uint32_t src_level;
+        uint32_t mips_count;
+        uint32_t width;
+        uint32_t height;
+    };
+} // namespace
+
+
+ERROR_TYPE vk_utils::mip_generator::init()
+{
+    VkSamplerCreateInfo sampler_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 0,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_NEVER,
+        .minLod = 0,
+        .maxLod = 0,
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE};
+
+    if (const auto e = m_sampler.init(vk_utils::context::get().device(), &sampler_info); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot init mip generator sampler.");
+    }
+
+    VkDescriptorSetLayoutBinding bindings[]{
+        {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = m_sampler,
+        },
+        {
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = max_mips_per_dispatch,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+        {
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+        }};
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .bindingCount = std::size(bindings),
+        .pBindings = bindings,
+    };
+
+    if (const auto e = m_descriptor_set_layout.init(vk_utils::context::get().device(), &set_layout_info); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot init mip generator descriptor set layout.");
+    }
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(push_constants),
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .setLayoutCount = 1,
+        .pSetLayouts = m_descriptor_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+
+    if (const auto e = m_pipeline_layout.init(vk_utils::context::get().device(), &pipeline_layout_info); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot init mip generator pipeline layout.");
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+bool vk_utils::mip_generator::is_supported(VkFormat format, uint32_t queue_family_index) const
+{
+    const auto* info = find_format_info(format);
+
+    if (info == nullptr || static_cast<VkPipelineLayout>(m_pipeline_layout) == nullptr) {
+        return false;
+    }
+
+    if (info->storage_format != format && !vk_utils::context::get().device_extension_enabled(VK_KHR_MAINTENANCE2_EXTENSION_NAME)) {
+        return false;
+    }
+
+    uint32_t families_count{0};
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_utils::context::get().gpu(), &families_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(families_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_utils::context::get().gpu(), &families_count, families.data());
+
+    if (queue_family_index >= families.size() || (families[queue_family_index].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0) {
+        return false;
+    }
+
+    VkFormatProperties format_props{};
+    vkGetPhysicalDeviceFormatProperties(vk_utils::context::get().gpu(), format, &format_props);
+
+    if ((format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) == 0) {
+        return false;
+    }
+
+    vkGetPhysicalDeviceFormatProperties(vk_utils::context::get().gpu(), info->storage_format, &format_props);
+
+    return (format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+
+VkImageUsageFlags vk_utils::mip_generator::get_image_usage(VkFormat format) const
+{
+    return VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+}
+
+
+VkImageCreateFlags vk_utils::mip_generator::get_image_create_flags(VkFormat format) const
+{
+    const auto* info = find_format_info(format);
+
+    if (info == nullptr || info->storage_format == format) {
+        return 0;
+    }
+
+    return VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT_KHR;
+}
+
+
+ERROR_TYPE vk_utils::mip_generator::record(
+    VkCommandBuffer cmd,
+    VkImage image,
+    VkFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t base_level,
+    uint32_t end_level,
+    uint32_t layer_count,
+    recorded_resources& out_resources)
+{
+    VkImageMemoryBarrier image_barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseArrayLayer = 0,
+            .layerCount = layer_count,
+        }};
+
+    if (end_level <= base_level + 1) {
+        image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_barrier.subresourceRange.baseMipLevel = base_level;
+        image_barrier.subresourceRange.levelCount = 1;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+        RAISE_ERROR_OK();
+    }
+
+    const auto* info = find_format_info(format);
+
+    if (info == nullptr) {
+        RAISE_ERROR_WARN(-1, "unsupported mip generator format.");
+    }
+
+    VkPipeline pipeline{nullptr};
+    PASS_ERROR(get_pipeline(*info, pipeline));
+
+    std::vector<dispatch_info> dispatches{};
+
+    for (uint32_t level = base_level, w = width, h = height; level + 1 < end_level;) {
+        uint32_t mips_count = std::min(end_level - level - 1, max_mips_per_dispatch);
+
+        if (std::max(w, h) > max_single_pass_dimension) {
+            mips_count = std::min(mips_count, tile_mips_count);
+        }
+
+        dispatches.push_back({.src_level = level, .mips_count = mips_count, .width = w, .height = h});
+
+        level += mips_count;
+        w = std::max(1u, w >> mips_count);
+        h = std::max(1u, h >> mips_count);
+    }
+
+    recorded_resources resources{};
+
+    PASS_ERROR(create_buffer(
+        resources.counters_buffer,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        dispatches.size() * layer_count * sizeof(uint32_t),
+        nullptr,
+        -1,
+        MEMORY_TAG_TEXTURES));
+
+    VkDescriptorPoolSize pool_sizes[]{
+        {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = static_cast<uint32_t>(dispatches.size())},
+        {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = static_cast<uint32_t>(dispatches.size() * max_mips_per_dispatch)},
+        {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = static_cast<uint32_t>(dispatches.size())},
+    };
+
+    VkDescriptorPoolCreateInfo pool_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .maxSets = static_cast<uint32_t>(dispatches.size()),
+        .poolSizeCount = std::size(pool_sizes),
+        .pPoolSizes = pool_sizes,
+    };
+
+    if (const auto e = resources.descriptor_pool.init(vk_utils::context::get().device(), &pool_info); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot init mip generator descriptor pool.");
+    }
+
+    vkCmdFillBuffer(cmd, resources.counters_buffer, 0, VK_WHOLE_SIZE, 0);
+
+    VkBufferMemoryBarrier counters_barrier{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = resources.counters_buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+
+    VkImageMemoryBarrier initial_barriers[2]{image_barrier, image_barrier};
+
+    initial_barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    initial_barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    initial_barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    initial_barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    initial_barriers[0].subresourceRange.baseMipLevel = base_level;
+    initial_barriers[0].subresourceRange.levelCount = 1;
+
+    initial_barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    initial_barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    initial_barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    initial_barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    initial_barriers[1].subresourceRange.baseMipLevel = base_level + 1;
+    initial_barriers[1].subresourceRange.levelCount = end_level - base_level - 1;
+
+    vkCmdPipelineBarrier(
+        cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &counters_barrier, std::size(initial_barriers), initial_barriers);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+    std::vector<VkImageMemoryBarrier> final_barriers{};
+
+    for (size_t d = 0; d < dispatches.size(); ++d) {
+        const auto& dispatch = dispatches[d];
+
+        if (d > 0) {
+            VkImageMemoryBarrier src_level_barrier = image_barrier;
+            src_level_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            src_level_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            src_level_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            src_level_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            src_level_barrier.subresourceRange.baseMipLevel = dispatch.src_level;
+            src_level_barrier.subresourceRange.levelCount = 1;
+
+            vkCmdPipelineBarrier(
+                cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &src_level_barrier);
+        }
+
+        VkImageViewCreateInfo view_info{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .image = image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+            .format = format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+            },
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = dispatch.src_level,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count,
+            }};
+
+        auto& src_view = resources.image_views.emplace_back();
+
+        if (const auto e = src_view.init(vk_utils::context::get().device(), &view_info); e != VK_SUCCESS) {
+            RAISE_ERROR_WARN(e, "cannot init mip generator source view.");
+        }
+
+        VkDescriptorImageInfo src_image_info{
+            .sampler = m_sampler,
+            .imageView = src_view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+
+        std::array<VkDescriptorImageInfo, max_mips_per_dispatch> dst_images_infos{};
+
+        view_info.format = info->storage_format;
+
+        for (uint32_t i = 0; i < dispatch.mips_count; ++i) {
+            view_info.subresourceRange.baseMipLevel = dispatch.src_level + 1 + i;
+
+            auto& dst_view = resources.image_views.emplace_back();
+
+            if (const auto e = dst_view.init(vk_utils::context::get().device(), &view_info); e != VK_SUCCESS) {
+                RAISE_ERROR_WARN(e, "cannot init mip generator storage view.");
+            }
+
+            dst_images_infos[i] = {
+                .sampler = nullptr,
+                .imageView = dst_view,
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            };
+        }
+
+        std::fill(dst_images_infos.begin() + dispatch.mips_count, dst_images_infos.end(), dst_images_infos[dispatch.mips_count - 1]);
+
+        VkDescriptorBufferInfo counters_info{
+            .buffer = resources.counters_buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        VkDescriptorSetAllocateInfo set_alloc_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = resources.descriptor_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = m_descriptor_set_layout,
+        };
+
+        auto& descriptor_set = resources.descriptor_sets.emplace_back();
+
+        if (const auto e = descriptor_set.init(vk_utils::context::get().device(), resources.descriptor_pool, &set_alloc_info, 1); e != VK_SUCCESS) {
+            RAISE_ERROR_WARN(e, "cannot allocate mip generator descriptor set.");
+        }
+
+        VkWriteDescriptorSet writes[]{
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = descriptor_set[0],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &src_image_info,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = descriptor_set[0],
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = max_mips_per_dispatch,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = dst_images_infos.data(),
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = descriptor_set[0],
+                .dstBinding = 2,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &counters_info,
+            }};
+
+        vkUpdateDescriptorSets(vk_utils::context::get().device(), std::size(writes), writes, 0, nullptr);
+
+        const VkDescriptorSet set = descriptor_set[0];
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &set, 0, nullptr);
+
+        const uint32_t groups_x = (dispatch.width + tile_size - 1) / tile_size;
+        const uint32_t groups_y = (dispatch.height + tile_size - 1) / tile_size;
+
+        const push_constants constants{
+            .src_size = {static_cast<int32_t>(dispatch.width), static_cast<int32_t>(dispatch.height)},
+            .mips_count = static_cast<int32_t>(dispatch.mips_count),
+            .srgb = info->srgb ? 1 : 0,
+            .workgroups_count = groups_x * groups_y,
+            .counter_offset = static_cast<uint32_t>(d * layer_count),
+        };
+
+        vkCmdPushConstants(cmd, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(cmd, groups_x, groups_y, layer_count);
+
+        const bool is_last = d + 1 == dispatches.size();
+        const uint32_t written_levels = is_last ? dispatch.mips_count : dispatch.mips_count - 1;
+
+        if (written_levels > 0) {
+            VkImageMemoryBarrier& barrier = final_barriers.emplace_back(image_barrier);
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.subresourceRange.baseMipLevel = dispatch.src_level + 1;
+            barrier.subresourceRange.levelCount = written_levels;
+        }
+    }
+
+    vkCmdPipelineBarrier(
+        cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, final_barriers.size(), final_barriers.data());
+
+    out_resources = std::move(resources);
+
+    RAISE_ERROR_OK();
+}
+
+
+const vk_utils::mip_generator::format_info* vk_utils::mip_generator::find_format_info(VkFormat format)
+{
+    static const format_info formats[]{
+        {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, "rgba8", false},
+        {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM, "rgba8", true},
+        {VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_UNORM, "rg8", false},
+        {VK_FORMAT_R8G8_SRGB, VK_FORMAT_R8G8_UNORM, "rg8", true},
+        {VK_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM, "r8", false},
+        {VK_FORMAT_R8_SRGB, VK_FORMAT_R8_UNORM, "r8", true},
+        {VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, "rgba16f", false},
+        {VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, "rg16f", false},
+        {VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16_SFLOAT, "r16f", false},
+        {VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, "rgba32f", false},
+    };
+
+    const auto format_it = std::find_if(std::begin(formats), std::end(formats), [format](const format_info& f) {
+        return f.format == format;
+    });
+
+    return format_it == std::end(formats) ? nullptr : format_it;
+}
+
+
+ERROR_TYPE vk_utils::mip_generator::get_pipeline(const format_info& format, VkPipeline& out_pipeline)
+{
+    if (auto pipeline_it = m_pipelines.find(format.storage_format); pipeline_it != m_pipelines.end()) {
+        out_pipeline = pipeline_it->second;
+        RAISE_ERROR_OK();
+    }
+
+    static shaderc::Compiler compiler{};
+
+    shaderc::CompileOptions options;
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    options.AddMacroDefinition("STORAGE_FORMAT", format.glsl_format);
+
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(downsample_shader_source, shaderc_glsl_compute_shader, "mip_generator.comp", options);
+
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+        LOG_ERROR(result.GetErrorMessage());
+        RAISE_ERROR_WARN(-1, "cannot compile mip generator shader.");
+    }
+
+    std::vector<uint32_t> code(result.begin(), result.end());
+    // the module is destroyed right after the pipeline creation.
+    vk_utils::host_arena arena{};
+    vk_utils::shader_module_handler shader_module{};
+    PASS_ERROR(create_shader_module(code.data(), code.size() * sizeof(uint32_t), shader_module, &arena));
+
+    VkComputePipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader_module,
+            .pName = "main",
+            .pSpecializationInfo = nullptr,
+        },
+        .layout = m_pipeline_layout,
+        .basePipelineHandle = nullptr,
+        .basePipelineIndex = -1,
+    };
+
+    vk_utils::compute_pipeline_handler pipeline{};
+
+    if (const auto e = pipeline.init(vk_utils::context::get().device(), &pipeline_info); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot init mip generator pipeline.");
+    }
+
+    out_pipeline = pipeline;
+    m_pipelines.emplace(format.storage_format, std::move(pipeline));
+
+    RAISE_ERROR_OK();
+}
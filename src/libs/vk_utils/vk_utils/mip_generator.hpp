@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <errors/error_handler.hpp>
+
+#include <map>
+#include <vector>
+
+namespace vk_utils
+{
+    // Generates mip chains with a compute shader, up to 12 levels are written by one dispatch:
+    // every workgroup reduces a 64x64 tile to 6 levels and the last finished workgroup reduces the rest.
+    // sRGB images are filtered in linear space through unorm storage views.
+    class mip_generator
+    {
+    public:
+        // resources referenced by the recorded commands, must be kept alive until their execution completes.
+        struct recorded_resources
+        {
+            vk_utils::descriptor_pool_handler descriptor_pool{};
+            std::vector<vk_utils::descriptor_set_handler> descriptor_sets{};
+            std::vector<vk_utils::image_view_handler> image_views{};
+            vk_utils::vma_buffer_handler counters_buffer{};
+        };
+
+        mip_generator() = default;
+        mip_generator(const mip_generator&) = delete;
+        mip_generator& operator=(const mip_generator&) = delete;
+        ~mip_generator() = default;
+
+        ERROR_TYPE init();
+
+        bool is_supported(VkFormat format, uint32_t queue_family_index) const;
+
+        // image usage and create flags the image must be created with to generate its mips.
+        VkImageUsageFlags get_image_usage(VkFormat format) const;
+        VkImageCreateFlags get_image_create_flags(VkFormat format) const;
+
+        // expects base_level and the generated levels in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        // leaves levels [base_level, end_level) in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+        ERROR_TYPE record(
+            VkCommandBuffer cmd,
+            VkImage image,
+            VkFormat format,
+            uint32_t width,
+            uint32_t height,
+            uint32_t base_level,
+            uint32_t end_level,
+            uint32_t layer_count,
+            recorded_resources& out_resources);
+
+    private:
+        struct format_info
+        {
+            VkFormat format;
+            VkFormat storage_format;
+            const char* glsl_format;
+            bool srgb;
+        };
+
+        static const format_info* find_format_info(VkFormat format);
+
+        ERROR_TYPE get_pipeline(const format_info& format, VkPipeline& out_pipeline);
+
+        vk_utils::sampler_handler m_sampler{};
+        vk_utils::descriptor_set_layout_handler m_descriptor_set_layout{};
+        vk_utils::pipeline_layout_handler m_pipeline_layout{};
+        std::map<VkFormat, vk_utils::compute_pipeline_handler> m_pipelines{};
+    };
+} // namespace vk_utils
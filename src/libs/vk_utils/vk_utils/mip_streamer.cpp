@@ -0,0 +1,266 @@
+
+#include "mip_streamer.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
+
+#include <algorithm>
+
+vk_utils::mip_streamer::~mip_streamer()
+{
+    if (m_batch_in_flight) {
+        vk_utils::context::get().wait(m_batch_submission);
+    }
+}
+
+
+ERROR_TYPE vk_utils::mip_streamer::init(VkQueue queue, uint32_t queue_family_index)
+{
+    VkCommandPoolCreateInfo cmd_pool_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queue_family_index,
+    };
+
+    vk_utils::cmd_pool_handler cmd_pool{};
+
+    if (cmd_pool.init(vk_utils::context::get().device(), &cmd_pool_info) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot init mip streamer command pool.");
+    }
+
+    VkCommandBufferAllocateInfo cmd_buffer_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = cmd_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    vk_utils::cmd_buffers_handler cmd_buffer{};
+
+    if (cmd_buffer.init(vk_utils::context::get().device(), cmd_pool, &cmd_buffer_info, 1) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot init mip streamer command buffer.");
+    }
+
+    m_queue = queue;
+    m_command_pool = std::move(cmd_pool);
+    m_command_buffer = std::move(cmd_buffer);
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::mip_streamer::set_tail_dimension(uint32_t dimension)
+{
+    m_tail_dimension = std::max(1u, dimension);
+}
+
+
+void vk_utils::mip_streamer::set_max_steps_per_update(uint32_t steps_count)
+{
+    m_max_steps_per_update = std::max(1u, steps_count);
+}
+
+
+void vk_utils::mip_streamer::set_on_level_resident(on_level_resident_callback callback)
+{
+    m_on_level_resident = std::move(callback);
+}
+
+
+uint32_t vk_utils::mip_streamer::get_first_resident_level(uint32_t width, uint32_t height, uint32_t level_count) const
+{
+    if (level_count == 0) {
+        return 0;
+    }
+
+    uint32_t level = 0;
+
+    while (level < level_count - 1 && std::max(width, height) > m_tail_dimension) {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        level++;
+    }
+
+    return level;
+}
+
+
+void vk_utils::mip_streamer::enqueue(
+    VkImage image,
+    const VkSamplerCreateInfo& sampler_info,
+    vk_utils::vma_buffer_handler staging_buffer,
+    std::vector<stream_step> steps)
+{
+    if (steps.empty()) {
+        return;
+    }
+
+    auto& entry = m_entries.emplace_back();
+    entry.image = image;
+    entry.sampler_info = sampler_info;
+    entry.sampler_info.pNext = nullptr;
+    entry.staging_buffer = std::move(staging_buffer);
+    entry.steps = std::move(steps);
+}
+
+
+void vk_utils::mip_streamer::cancel(VkImage image)
+{
+    auto entry_it = std::find_if(m_entries.begin(), m_entries.end(), [image](const stream_entry& e) {
+        return e.image == image;
+    });
+
+    if (entry_it == m_entries.end()) {
+        return;
+    }
+
+    if (m_batch_in_flight) {
+        vk_utils::context::get().wait(m_batch_submission);
+    }
+
+    m_entries.erase(entry_it);
+
+    if (m_batch_in_flight) {
+        HANDLE_ERROR(complete_in_flight_batch());
+    }
+}
+
+
+ERROR_TYPE vk_utils::mip_streamer::update()
+{
+    if (m_batch_in_flight) {
+        if (!vk_utils::context::get().is_completed(m_batch_submission)) {
+            RAISE_ERROR_OK();
+        }
+
+        PASS_ERROR(complete_in_flight_batch());
+    }
+
+    PASS_ERROR(submit_batch());
+
+    RAISE_ERROR_OK();
+}
+
+
+bool vk_utils::mip_streamer::empty() const
+{
+    return m_entries.empty() && !m_batch_in_flight;
+}
+
+
+bool vk_utils::mip_streamer::contains(VkImage image) const
+{
+    return std::find_if(m_entries.begin(), m_entries.end(), [image](const stream_entry& e) {
+        return e.image == image;
+    }) != m_entries.end();
+}
+
+
+ERROR_TYPE vk_utils::mip_streamer::complete_in_flight_batch()
+{
+    m_batch_in_flight = false;
+
+    for (auto& entry : m_entries) {
+        if (entry.recorded_steps == 0) {
+            continue;
+        }
+
+        const auto& last_step = entry.steps[entry.recorded_steps - 1];
+
+        if (m_on_level_resident) {
+            VkSamplerCreateInfo sampler_info = entry.sampler_info;
+            sampler_info.minLod = static_cast<float>(last_step.level);
+
+            vk_utils::sampler_handler sampler{};
+
+            if (sampler.init(vk_utils::context::get().device(), &sampler_info) != VK_SUCCESS) {
+                RAISE_ERROR_WARN(-1, "cannot init streamed texture sampler.");
+            }
+
+            m_on_level_resident(entry.image, last_step.level, std::move(sampler));
+        }
+
+        entry.steps.erase(entry.steps.begin(), entry.steps.begin() + entry.recorded_steps);
+        entry.recorded_steps = 0;
+    }
+
+    m_entries.erase(
+        std::remove_if(m_entries.begin(), m_entries.end(), [](const stream_entry& e) {
+            return e.steps.empty();
+        }),
+        m_entries.end());
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::mip_streamer::submit_batch()
+{
+    if (m_entries.empty()) {
+        RAISE_ERROR_OK();
+    }
+
+    if (m_queue == nullptr) {
+        RAISE_ERROR_WARN(-1, "mip streamer wasn't initialized.");
+    }
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+
+    vkResetCommandBuffer(m_command_buffer[0], 0);
+    vkBeginCommandBuffer(m_command_buffer[0], &begin_info);
+
+    uint32_t recorded_steps = 0;
+
+    while (recorded_steps < m_max_steps_per_update) {
+        stream_entry* next_entry = nullptr;
+
+        for (auto& entry : m_entries) {
+            if (entry.recorded_steps >= entry.steps.size()) {
+                continue;
+            }
+
+            if (next_entry == nullptr || entry.steps[entry.recorded_steps].level > next_entry->steps[next_entry->recorded_steps].level) {
+                next_entry = &entry;
+            }
+        }
+
+        if (next_entry == nullptr) {
+            break;
+        }
+
+        next_entry->steps[next_entry->recorded_steps].record(m_command_buffer[0]);
+        next_entry->recorded_steps++;
+        recorded_steps++;
+    }
+
+    if (vkEndCommandBuffer(m_command_buffer[0]) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot record mip streaming commands.");
+    }
+
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = m_command_buffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    if (const auto e = vk_utils::context::get().submit(m_queue, submit_info, m_batch_submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit mip streaming commands.");
+    }
+
+    m_batch_in_flight = true;
+
+    RAISE_ERROR_OK();
+}
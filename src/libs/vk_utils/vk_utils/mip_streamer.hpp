@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/submission_queue.hpp>
+#include <errors/error_handler.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace vk_utils
+{
+    // Streams high resolution mip levels of already sampleable images.
+    // Texture creation functions upload only the small mips tail and clamp sampler minLod to it,
+    // the remaining levels are uploaded by update() calls over the subsequent frames.
+    class mip_streamer
+    {
+    public:
+        struct stream_step
+        {
+            uint32_t level{0};
+            std::function<void(VkCommandBuffer)> record;
+        };
+
+        // the owner of the image takes the sampler clamped to the new base level over and retires the one it replaces,
+        // frames in flight may still sample with it. without a callback samplers of streamed images are not replaced.
+        using on_level_resident_callback = std::function<void(VkImage image, uint32_t base_level, vk_utils::sampler_handler sampler)>;
+
+        mip_streamer() = default;
+        mip_streamer(const mip_streamer&) = delete;
+        mip_streamer& operator=(const mip_streamer&) = delete;
+        ~mip_streamer();
+
+        ERROR_TYPE init(VkQueue queue, uint32_t queue_family_index);
+
+        void set_tail_dimension(uint32_t dimension);
+        void set_max_steps_per_update(uint32_t steps_count);
+        void set_on_level_resident(on_level_resident_callback callback);
+
+        uint32_t get_first_resident_level(uint32_t width, uint32_t height, uint32_t level_count) const;
+
+        void enqueue(
+            VkImage image,
+            const VkSamplerCreateInfo& sampler_info,
+            vk_utils::vma_buffer_handler staging_buffer,
+            std::vector<stream_step> steps);
+
+        void cancel(VkImage image);
+
+        ERROR_TYPE update();
+
+        bool empty() const;
+        bool contains(VkImage image) const;
+
+    private:
+        struct stream_entry
+        {
+            VkImage image{nullptr};
+            VkSamplerCreateInfo sampler_info{};
+            vk_utils::vma_buffer_handler staging_buffer{};
+            std::vector<stream_step> steps{};
+            uint32_t recorded_steps{0};
+        };
+
+        ERROR_TYPE complete_in_flight_batch();
+        ERROR_TYPE submit_batch();
+
+        VkQueue m_queue{nullptr};
+        vk_utils::cmd_pool_handler m_command_pool{};
+        vk_utils::cmd_buffers_handler m_command_buffer{};
+        submission_token m_batch_submission{};
+        bool m_batch_in_flight{false};
+
+        uint32_t m_tail_dimension{256};
+        uint32_t m_max_steps_per_update{1};
+
+        on_level_resident_callback m_on_level_resident{};
+
+        std::vector<stream_entry> m_entries{};
+    };
+} // namespace vk_utils
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+
+namespace vk_utils
+{
+    // Intrusive lock-free multiple producers single consumer queue (D. Vyukov).
+    // nodes are linked through their std::atomic<T*> next member and aren't owned by the queue,
+    // a pushed node must stay alive until it is popped.
+    template<typename T>
+    class mpsc_queue
+    {
+    public:
+        mpsc_queue()
+            : m_head(&m_stub)
+            , m_tail(&m_stub)
+        {
+        }
+
+        mpsc_queue(const mpsc_queue&) = delete;
+        mpsc_queue& operator=(const mpsc_queue&) = delete;
+        ~mpsc_queue() = default;
+
+        // wait free, may be called by any thread.
+        void push(T* node)
+        {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            T* prev = m_head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // consumer only. returns nullptr when the queue is empty or a producer is between its exchange and link,
+        // that producer observes the queue afterwards, so consumers retry once it finished its push.
+        T* pop()
+        {
+            T* tail = m_tail;
+            T* next = tail->next.load(std::memory_order_acquire);
+
+            if (tail == &m_stub) {
+                if (next == nullptr) {
+                    return nullptr;
+                }
+
+                m_tail = next;
+                tail = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr) {
+                m_tail = next;
+                return tail;
+            }
+
+            if (tail != m_head.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            push(&m_stub);
+            next = tail->next.load(std::memory_order_acquire);
+
+            if (next != nullptr) {
+                m_tail = next;
+                return tail;
+            }
+
+            return nullptr;
+        }
+
+    private:
+        T m_stub{};
+        std::atomic<T*> m_head;
+        T* m_tail;
+    };
+} // namespace vk_utils
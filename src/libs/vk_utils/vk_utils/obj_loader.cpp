@@ -3,6 +3,12 @@
 
 #include <vk_utils/tools.hpp>
 #include <vk_utils/context.hpp>
+#include <vk_utils/deletion_queue.hpp>
+#include <vk_utils/mip_streamer.hpp>
+#include <vk_utils/texture_packer.hpp>
+#include <vk_utils/texture_residency.hpp>
+#include <vk_utils/transfer_upload.hpp>
+#include <vk_utils/upload_context.hpp>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -15,6 +21,21 @@
 #include <filesystem>
 #include <optional>
 
+namespace
+{
+    // frames in flight may still sample with the replaced sampler.
+    void retire_sampler(vk_utils::sampler_handler sampler)
+    {
+        if (auto* deletion_queue = vk_utils::get_deletion_queue(); deletion_queue != nullptr) {
+            deletion_queue->retire(std::move(sampler));
+            return;
+        }
+
+        const auto& ctx = vk_utils::context::get();
+        ctx.wait_idle(ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS));
+    }
+} // namespace
+
 ERROR_TYPE vk_utils::obj_loader::load_model(
     const vk_utils::obj_loader::obj_model_info& model_info,
     VkQueue transfer_queue,
@@ -42,6 +63,29 @@ ERROR_TYPE vk_utils::obj_loader::load_model(
 
     PASS_ERROR(init_obj_geometry(attrib, shapes, transfer_queue, transfer_queue_index, command_pool, model));
     PASS_ERROR(init_obj_materials(shapes, materials, model_info, transfer_queue, transfer_queue_index, command_pool, model));
+
+    // textures took their final place in the model, samplers of streamed ones are replaced there.
+    if (model_info.streamer != nullptr) {
+        model_info.streamer->set_on_level_resident([&model, on_texture_changed = model_info.on_texture_changed](VkImage image, uint32_t base_level, vk_utils::sampler_handler sampler) {
+            for (uint32_t i = 0; i < model.textures.size(); ++i) {
+                auto& model_texture = model.textures[i];
+
+                if (static_cast<VkImage>(model_texture.image) != image) {
+                    continue;
+                }
+
+                retire_sampler(std::move(model_texture.sampler));
+                model_texture.sampler = std::move(sampler);
+
+                if (on_texture_changed) {
+                    on_texture_changed(i, model_texture);
+                }
+
+                return;
+            }
+        });
+    }
+
     RAISE_ERROR_OK();
 }
 
@@ -204,92 +248,26 @@ ERROR_TYPE vk_utils::obj_loader::init_obj_geometry(
         indices_offset += geometry.indices.size();
     }
 
-    vk_utils::vma_buffer_handler vertex_staging_buffer;
-    vk_utils::vma_buffer_handler index_staging_buffer;
+    const VkDeviceSize vertex_data_size = vert_buffer_data.size() * sizeof(float);
+    const VkDeviceSize index_data_size = index_buffer_data.size() * sizeof(uint32_t);
 
+    // host visible device local memory is written right away, without staging copies and a submission.
     vk_utils::vma_buffer_handler vertex_buffer;
     vk_utils::vma_buffer_handler index_buffer;
 
-    vk_utils::create_buffer(vertex_staging_buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, vert_buffer_data.size() * sizeof(float), vert_buffer_data.data());
-    vk_utils::create_buffer(index_staging_buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, index_buffer_data.size() * sizeof(uint32_t), index_buffer_data.data());
-
-    vk_utils::create_buffer(vertex_buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, vert_buffer_data.size() * sizeof(float));
-    vk_utils::create_buffer(index_buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, index_buffer_data.size() * sizeof(uint32_t));
-
-    VkCommandBufferAllocateInfo cmd_buffer_alloc_info{};
-    cmd_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmd_buffer_alloc_info.pNext = nullptr;
-    cmd_buffer_alloc_info.commandPool = command_pool;
-    cmd_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmd_buffer_alloc_info.commandBufferCount = 1;
-    vk_utils::cmd_buffers_handler cmd_buffer;
-    cmd_buffer.init(vk_utils::context::get().device(), command_pool, &cmd_buffer_alloc_info, 1);
-
-    VkCommandBufferBeginInfo cmd_buffer_begin_info{};
-    cmd_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    cmd_buffer_begin_info.pNext = nullptr;
-    cmd_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    cmd_buffer_begin_info.pInheritanceInfo = nullptr;
-
-    vkBeginCommandBuffer(cmd_buffer[0], &cmd_buffer_begin_info);
-
-    VkBufferCopy vert_region{};
-    vert_region.srcOffset = 0;
-    vert_region.dstOffset = 0;
-    vert_region.size = vert_buffer_data.size() * sizeof(float);
-    vkCmdCopyBuffer(cmd_buffer[0], vertex_staging_buffer, vertex_buffer, 1, &vert_region);
-
-    VkBufferCopy index_region{};
-    index_region.srcOffset = 0;
-    index_region.dstOffset = 0;
-    index_region.size = index_buffer_data.size() * sizeof(uint32_t);
-    vkCmdCopyBuffer(cmd_buffer[0], index_staging_buffer, index_buffer, 1, &index_region);
-
-    VkBufferMemoryBarrier buffer_barriers[]{
-        {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-         .pNext = nullptr,
-         .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-         .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-         .buffer = vertex_buffer,
-         .offset = 0,
-         .size = vert_region.size},
-        {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-         .pNext = nullptr,
-         .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-         .dstAccessMask = VK_ACCESS_INDEX_READ_BIT,
-         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-         .buffer = index_buffer,
-         .offset = 0,
-         .size = index_region.size}};
-
-    vkCmdPipelineBarrier(
-        cmd_buffer[0],
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-        0,
-        0,
-        nullptr,
-        std::size(buffer_barriers),
-        buffer_barriers,
-        0,
-        nullptr);
-
-    vkEndCommandBuffer(cmd_buffer[0]);
-    VkSubmitInfo submit_info{};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.pNext = nullptr;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = cmd_buffer;
-
-    auto fence = create_fence();
-    vkQueueSubmit(transfer_queue, 1, &submit_info, fence);
-    vkWaitForFences(vk_utils::context::get().device(), 1, fence, VK_TRUE, UINT64_MAX);
-
-    model.vertex_buffer = std::move(vertex_buffer);
-    model.index_buffer = std::move(index_buffer);
+    if (vk_utils::create_direct_write_buffer(vertex_buffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_data_size, -1, vk_utils::MEMORY_TAG_GEOMETRY)
+        && vk_utils::create_direct_write_buffer(index_buffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_data_size, -1, vk_utils::MEMORY_TAG_GEOMETRY)) {
+        const auto allocator = vk_utils::context::get().allocator();
+        std::memcpy(vertex_buffer.get_alloc_info().pMappedData, vert_buffer_data.data(), vertex_data_size);
+        std::memcpy(index_buffer.get_alloc_info().pMappedData, index_buffer_data.data(), index_data_size);
+        vmaFlushAllocation(allocator, vertex_buffer, 0, VK_WHOLE_SIZE);
+        vmaFlushAllocation(allocator, index_buffer, 0, VK_WHOLE_SIZE);
+
+        model.vertex_buffer = std::move(vertex_buffer);
+        model.index_buffer = std::move(index_buffer);
+    } else {
+        PASS_ERROR(upload_obj_geometry(vert_buffer_data, index_buffer_data, transfer_queue, command_pool, model));
+    }
 
     glm::vec3 offset =  (max_pos - min_pos) / 2.0f;
 
@@ -310,6 +288,155 @@ ERROR_TYPE vk_utils::obj_loader::init_obj_geometry(
 }
 
 
+ERROR_TYPE vk_utils::obj_loader::upload_obj_geometry(
+    const std::vector<float>& vert_buffer_data,
+    const std::vector<uint32_t>& index_buffer_data,
+    VkQueue transfer_queue,
+    VkCommandPool command_pool,
+    obj_model& model)
+{
+    vk_utils::staging_buffer vertex_staging_buffer;
+    vk_utils::staging_buffer index_staging_buffer;
+
+    vk_utils::vma_buffer_handler vertex_buffer;
+    vk_utils::vma_buffer_handler index_buffer;
+
+    VkBuffer vertex_staging{nullptr};
+    VkDeviceSize vertex_staging_offset{0};
+    VkBuffer index_staging{nullptr};
+    VkDeviceSize index_staging_offset{0};
+
+    // with an upload context the copies are batched into its next flush, which also releases the staging memory.
+    auto* upload_context = vk_utils::get_upload_context();
+
+    if (upload_context != nullptr) {
+        PASS_ERROR(upload_context->allocate_staging(
+            vert_buffer_data.size() * sizeof(float), sizeof(float), vert_buffer_data.data(), vertex_staging, vertex_staging_offset));
+        PASS_ERROR(upload_context->allocate_staging(
+            index_buffer_data.size() * sizeof(uint32_t), sizeof(uint32_t), index_buffer_data.data(), index_staging, index_staging_offset));
+    } else {
+        vertex_staging_buffer.init(vert_buffer_data.size() * sizeof(float), sizeof(float), vk_utils::get_staging_ring(), vert_buffer_data.data());
+        index_staging_buffer.init(index_buffer_data.size() * sizeof(uint32_t), sizeof(uint32_t), vk_utils::get_staging_ring(), index_buffer_data.data());
+
+        vertex_staging = vertex_staging_buffer.get_buffer();
+        vertex_staging_offset = vertex_staging_buffer.get_offset();
+        index_staging = index_staging_buffer.get_buffer();
+        index_staging_offset = index_staging_buffer.get_offset();
+    }
+
+    // otherwise the geometry copies run on the dedicated transfer queue when there is one, the buffers are handed over to the graphics queue afterwards.
+    const bool use_transfer_upload = upload_context == nullptr && vk_utils::transfer_upload::is_available();
+    vk_utils::transfer_upload upload{};
+    vk_utils::cmd_buffers_handler cmd_buffer;
+    VkCommandBuffer upload_cmd_buffer{nullptr};
+    uint32_t buffers_queue_family = -1;
+
+    if (upload_context != nullptr) {
+        PASS_ERROR(upload_context->get_command_buffer(upload_cmd_buffer));
+        buffers_queue_family = upload_context->get_queue_family_index();
+    } else if (use_transfer_upload) {
+        PASS_ERROR(upload.begin());
+        upload_cmd_buffer = upload.get_command_buffer();
+        buffers_queue_family = upload.get_queue_family_index();
+    } else {
+        VkCommandBufferAllocateInfo cmd_buffer_alloc_info{};
+        cmd_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd_buffer_alloc_info.pNext = nullptr;
+        cmd_buffer_alloc_info.commandPool = command_pool;
+        cmd_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd_buffer_alloc_info.commandBufferCount = 1;
+        cmd_buffer.init(vk_utils::context::get().device(), command_pool, &cmd_buffer_alloc_info, 1);
+
+        VkCommandBufferBeginInfo cmd_buffer_begin_info{};
+        cmd_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        cmd_buffer_begin_info.pNext = nullptr;
+        cmd_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        cmd_buffer_begin_info.pInheritanceInfo = nullptr;
+
+        vkBeginCommandBuffer(cmd_buffer[0], &cmd_buffer_begin_info);
+        upload_cmd_buffer = cmd_buffer[0];
+    }
+
+    vk_utils::create_buffer(vertex_buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, vert_buffer_data.size() * sizeof(float), nullptr, buffers_queue_family, vk_utils::MEMORY_TAG_GEOMETRY);
+    vk_utils::create_buffer(index_buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, index_buffer_data.size() * sizeof(uint32_t), nullptr, buffers_queue_family, vk_utils::MEMORY_TAG_GEOMETRY);
+
+    VkBufferCopy vert_region{};
+    vert_region.srcOffset = vertex_staging_offset;
+    vert_region.dstOffset = 0;
+    vert_region.size = vert_buffer_data.size() * sizeof(float);
+    vkCmdCopyBuffer(upload_cmd_buffer, vertex_staging, vertex_buffer, 1, &vert_region);
+
+    VkBufferCopy index_region{};
+    index_region.srcOffset = index_staging_offset;
+    index_region.dstOffset = 0;
+    index_region.size = index_buffer_data.size() * sizeof(uint32_t);
+    vkCmdCopyBuffer(upload_cmd_buffer, index_staging, index_buffer, 1, &index_region);
+
+    if (use_transfer_upload) {
+        auto& ownership_transfer = upload.get_ownership_transfer();
+        ownership_transfer.add_buffer(vertex_buffer, 0, vert_region.size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        ownership_transfer.add_buffer(index_buffer, 0, index_region.size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_INDEX_READ_BIT);
+
+        upload.retain(std::move(vertex_staging_buffer));
+        upload.retain(std::move(index_staging_buffer));
+        PASS_ERROR(upload.submit(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+    } else {
+        VkBufferMemoryBarrier buffer_barriers[]{
+            {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+             .pNext = nullptr,
+             .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+             .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+             .buffer = vertex_buffer,
+             .offset = 0,
+             .size = vert_region.size},
+            {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+             .pNext = nullptr,
+             .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+             .dstAccessMask = VK_ACCESS_INDEX_READ_BIT,
+             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+             .buffer = index_buffer,
+             .offset = 0,
+             .size = index_region.size}};
+
+        vkCmdPipelineBarrier(
+            upload_cmd_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            0,
+            nullptr,
+            std::size(buffer_barriers),
+            buffer_barriers,
+            0,
+            nullptr);
+    }
+
+    if (upload_context == nullptr && !use_transfer_upload) {
+        vkEndCommandBuffer(cmd_buffer[0]);
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = nullptr;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = cmd_buffer;
+
+        vk_utils::submission_token submission{};
+        if (const auto e = vk_utils::context::get().submit(transfer_queue, submit_info, submission); e != VK_SUCCESS) {
+            RAISE_ERROR_WARN(e, "cannot submit geometry upload.");
+        }
+
+        vk_utils::context::get().wait(submission);
+    }
+
+    model.vertex_buffer = std::move(vertex_buffer);
+    model.index_buffer = std::move(index_buffer);
+
+    RAISE_ERROR_OK();
+}
+
+
 ERROR_TYPE vk_utils::obj_loader::init_obj_materials(
     const std::vector<tinyobj::shape_t>& shapes,
     const std::vector<tinyobj::material_t>& materials,
@@ -321,6 +448,9 @@ ERROR_TYPE vk_utils::obj_loader::init_obj_materials(
 {
     std::vector<const char*> loaded_textures_names;
     std::vector<texture> loaded_textures;
+    std::vector<int32_t> packed_images;
+
+    vk_utils::texture_packer packer{};
 
     auto get_tex_index = [&loaded_textures_names](const char* path) {
         auto tex_it = std::find_if(loaded_textures_names.begin(), loaded_textures_names.end(), [path](const char* curr_tex_path) {
@@ -329,26 +459,52 @@ ERROR_TYPE vk_utils::obj_loader::init_obj_materials(
         return tex_it == loaded_textures_names.end() ? -1 : std::distance(loaded_textures_names.begin(), tex_it);
     };
 
+    auto load_single_texture = [&model_info, transfer_queue, transfer_queue_index, command_pool](const char* path, texture& new_texture) -> ERROR_TYPE {
+        if (model_info.residency != nullptr) {
+            texture_residency::texture_id id{0};
+            PASS_ERROR(model_info.residency->add_texture(path, {}, id));
+            new_texture.residency_id = static_cast<int32_t>(id);
+        } else {
+            PASS_ERROR(load_texture(path, transfer_queue, transfer_queue_index, command_pool, {}, new_texture.image, new_texture.image_view, new_texture.sampler, model_info.streamer));
+        }
+
+        RAISE_ERROR_OK();
+    };
+
+    auto load_material_texture = [&loaded_textures, &packed_images, &packer, &model_info, &load_single_texture](const char* path) -> ERROR_TYPE {
+        auto& new_texture = loaded_textures.emplace_back();
+        auto& packed_image = packed_images.emplace_back(-1);
+
+        if (model_info.pack_textures && vk_utils::texture_packer::is_packable(path)) {
+            uint32_t image_index{0};
+            PASS_ERROR(packer.add_image(path, image_index));
+            packed_image = image_index;
+        } else {
+            PASS_ERROR(load_single_texture(path, new_texture));
+        }
+
+        RAISE_ERROR_OK();
+    };
+
     for (const auto& [tex_name, tex_val] : model_info.phong_textures) {
         for (auto tex_path : tex_val) {
             if (!tex_path.empty() && get_tex_index(tex_path.c_str()) < 0) {
-                texture new_texture{};
-                PASS_ERROR(load_texture(tex_path.c_str(), transfer_queue, transfer_queue_index, command_pool, {}, new_texture.image, new_texture.image_view, new_texture.sampler));
+                PASS_ERROR(load_material_texture(tex_path.c_str()));
                 loaded_textures_names.emplace_back(tex_path.c_str());
-                loaded_textures.emplace_back(std::move(new_texture));
             }
         }
     }
 
     for (const auto& tex_path : model_info.other_textures) {
         texture new_texture{};
-        PASS_ERROR(load_texture(tex_path.c_str(), transfer_queue, transfer_queue_index, command_pool, {}, new_texture.image, new_texture.image_view, new_texture.sampler));
+        PASS_ERROR(load_single_texture(tex_path.c_str(), new_texture));
         loaded_textures_names.emplace_back(tex_path.c_str());
         model.other_texturs_key_index_map[tex_path] = loaded_textures.size();
         loaded_textures.emplace_back(std::move(new_texture));
+        packed_images.emplace_back(-1);
     }
 
-    auto add_material_texture = [&get_tex_index, &loaded_textures_names, &loaded_textures, transfer_queue, transfer_queue_index, command_pool, &model_info](const std::string& image_path) -> int32_t {
+    auto add_material_texture = [&get_tex_index, &load_material_texture, &loaded_textures_names, &loaded_textures, &model_info](const std::string& image_path) -> int32_t {
         if (image_path.empty()) {
             return -1;
         }
@@ -361,15 +517,12 @@ ERROR_TYPE vk_utils::obj_loader::init_obj_materials(
 
         loaded_textures_names.emplace_back(image_path.c_str());
 
-        texture new_texture{};
         if (std::filesystem::path(image_path).is_absolute()) {
-            HANDLE_ERROR(load_texture(image_path.c_str(), transfer_queue, transfer_queue_index, command_pool, {}, new_texture.image, new_texture.image_view, new_texture.sampler));
+            HANDLE_ERROR(load_material_texture(image_path.c_str()));
         } else {
             auto image_abs_path = (std::filesystem::path(model_info.model_path).parent_path() / image_path).string();
-            HANDLE_ERROR(load_texture(image_abs_path.c_str(), transfer_queue, transfer_queue_index, command_pool, {}, new_texture.image, new_texture.image_view, new_texture.sampler));
+            HANDLE_ERROR(load_material_texture(image_abs_path.c_str()));
         }
-        
-        loaded_textures.emplace_back(std::move(new_texture));
 
         return static_cast<decltype(i)>(loaded_textures.size() - 1);
     };
@@ -404,10 +557,64 @@ ERROR_TYPE vk_utils::obj_loader::init_obj_materials(
             curr_material.material_textures[PHONG_DISPLACEMENT] = add_material_texture(obj_mat.displacement_texname);
             curr_material.material_textures[PHONG_ALPHA] = add_material_texture(obj_mat.alpha_texname);
             curr_material.material_textures[PHONG_REFLECTION] = add_material_texture(obj_mat.reflection_texname);
+            model.sub_geometries[i].material = std::move(curr_material);
+        }
+    }
+
+    if (!model_info.pack_textures) {
+        model.textures = std::move(loaded_textures);
+        RAISE_ERROR_OK();
+    }
+
+    std::vector<vk_utils::texture_packer::page> pages;
+    std::vector<vk_utils::texture_packer::packed_region> regions;
+
+    PASS_ERROR(packer.pack(transfer_queue, transfer_queue_index, command_pool, {}, pages, regions));
+
+    std::vector<texture> textures;
+    std::vector<int32_t> textures_remap(loaded_textures.size(), -1);
+
+    for (size_t i = 0; i < loaded_textures.size(); ++i) {
+        if (packed_images[i] < 0) {
+            textures_remap[i] = textures.size();
+            textures.emplace_back(std::move(loaded_textures[i]));
+        }
+    }
+
+    const int32_t pages_offset = textures.size();
+
+    for (auto& page : pages) {
+        auto& page_texture = textures.emplace_back();
+        page_texture.image = std::move(page.image);
+        page_texture.image_view = std::move(page.image_view);
+        page_texture.sampler = std::move(page.sampler);
+    }
+
+    for (auto& [key, index] : model.other_texturs_key_index_map) {
+        index = textures_remap[index];
+    }
+
+    for (auto& sub_geometry : model.sub_geometries) {
+        auto& material = std::get<obj_phong_material>(sub_geometry.material);
+
+        for (size_t slot = 0; slot < PHONG_SIZE; ++slot) {
+            const int32_t texture_index = material.material_textures[slot];
+
+            if (texture_index < 0) {
+                continue;
+            }
+
+            if (const int32_t packed_image = packed_images[texture_index]; packed_image >= 0) {
+                const auto& region = regions[packed_image];
+                material.material_textures[slot] = pages_offset + region.page;
+                material.material_layers[slot] = {.layer = region.layer, .uv_transform = region.uv_transform};
+            } else {
+                material.material_textures[slot] = textures_remap[texture_index];
+            }
         }
     }
 
-    model.textures = std::move(loaded_textures);
+    model.textures = std::move(textures);
 
     RAISE_ERROR_OK();
-}
\ No newline at end of file
+}
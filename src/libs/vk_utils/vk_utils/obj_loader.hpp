@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <array>
+#include <functional>
 #include <variant>
 #include <unordered_map>
 #include <string>
@@ -20,6 +21,9 @@ namespace tinyobj
 
 namespace vk_utils
 {
+    class texture_residency;
+    class mip_streamer;
+
     class obj_loader
     {
     public:
@@ -48,9 +52,17 @@ namespace vk_utils
             PBR_SIZE,
         };
 
+        struct texture_layer
+        {
+            uint32_t layer{0};
+            // uv scale xy, uv offset zw
+            std::array<float, 4> uv_transform{1, 1, 0, 0};
+        };
+
         struct obj_phong_material
         {
             std::array<int32_t, PHONG_SIZE> material_textures{-1, -1, -1, -1, -1, -1, -1, -1};
+            std::array<texture_layer, PHONG_SIZE> material_layers{};
             std::array<std::array<float, 3>, PHONG_SIZE> material_coefficients{};
         };
 
@@ -75,6 +87,9 @@ namespace vk_utils
             vk_utils::vma_image_handler image{};
             vk_utils::image_view_handler image_view{};
             vk_utils::sampler_handler sampler{};
+            // textures loaded through obj_model_info::residency are owned by it and have null handlers here,
+            // the id is also the texture sampler feedback id.
+            int32_t residency_id{-1};
         };
 
         struct obj_model
@@ -95,6 +110,15 @@ namespace vk_utils
             std::unordered_map<std::string, std::array<std::string, PHONG_SIZE>> phong_textures;
             std::unordered_map<std::string, std::array<std::string, PBR_SIZE>> pbr_textures;
             std::vector<std::string> other_textures;
+            // material png/jpg textures are packed into 2D array textures, see texture_packer
+            bool pack_textures{false};
+            // not packed textures are added to the residency, their mips are streamed by sampler feedback
+            vk_utils::texture_residency* residency{nullptr};
+            // top mips of textures neither packed nor added to the residency are streamed when set,
+            // the streamer is used for the model only and the model has to keep its address until they are resident.
+            vk_utils::mip_streamer* streamer{nullptr};
+            // called when a streamed texture sampler was replaced, descriptors which reference the old one have to be updated.
+            std::function<void(uint32_t texture_index, const texture& texture)> on_texture_changed{};
         };
 
         ERROR_TYPE load_model(
@@ -113,6 +137,13 @@ namespace vk_utils
             VkCommandPool command_pool,
             obj_model& model);
 
+        ERROR_TYPE upload_obj_geometry(
+            const std::vector<float>& vert_buffer_data,
+            const std::vector<uint32_t>& index_buffer_data,
+            VkQueue transfer_queue,
+            VkCommandPool command_pool,
+            obj_model& model);
+
         ERROR_TYPE init_obj_materials(
             const std::vector<tinyobj::shape_t>& shapes,
             const std::vector<tinyobj::material_t>& materials,
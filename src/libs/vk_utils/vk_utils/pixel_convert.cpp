@@ -0,0 +1,404 @@
+
+#include "pixel_convert.hpp"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    // the kernels are compiled for ssse3 only and run when the cpu reports it.
+    #define VK_UTILS_PIXEL_CONVERT_SSSE3
+    #define VK_UTILS_PIXEL_CONVERT_TARGET __attribute__((target("ssse3")))
+    #include <tmmintrin.h>
+#elif defined(__SSSE3__) || defined(__AVX__)
+    #define VK_UTILS_PIXEL_CONVERT_SSSE3
+    #define VK_UTILS_PIXEL_CONVERT_TARGET
+    #include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define VK_UTILS_PIXEL_CONVERT_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+    uint8_t premultiply(uint8_t c, uint8_t a)
+    {
+        const uint32_t t = c * a + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+
+    void convert_rgb_to_rgba_scalar(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        for (size_t i = 0; i < pixels_count; ++i, src += 3, dst += 4) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 255;
+        }
+    }
+
+
+    void convert_grey_to_rgba_scalar(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        for (size_t i = 0; i < pixels_count; ++i, src += 1, dst += 4) {
+            dst[0] = src[0];
+            dst[1] = src[0];
+            dst[2] = src[0];
+            dst[3] = 255;
+        }
+    }
+
+
+    void convert_grey_alpha_to_rgba_scalar(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        for (size_t i = 0; i < pixels_count; ++i, src += 2, dst += 4) {
+            dst[0] = src[0];
+            dst[1] = src[0];
+            dst[2] = src[0];
+            dst[3] = src[1];
+        }
+    }
+
+
+    void swizzle_rgba_scalar(const uint8_t* src, uint8_t* dst, size_t pixels_count, const std::array<uint8_t, 4>& order)
+    {
+        for (size_t i = 0; i < pixels_count; ++i, src += 4, dst += 4) {
+            const uint8_t pixel[4]{src[0], src[1], src[2], src[3]};
+            dst[0] = pixel[order[0]];
+            dst[1] = pixel[order[1]];
+            dst[2] = pixel[order[2]];
+            dst[3] = pixel[order[3]];
+        }
+    }
+
+
+    void premultiply_rgba_scalar(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        for (size_t i = 0; i < pixels_count; ++i, src += 4, dst += 4) {
+            const uint8_t a = src[3];
+            dst[0] = premultiply(src[0], a);
+            dst[1] = premultiply(src[1], a);
+            dst[2] = premultiply(src[2], a);
+            dst[3] = a;
+        }
+    }
+
+#if defined(VK_UTILS_PIXEL_CONVERT_SSSE3)
+    constexpr size_t batch_size = 16;
+
+    bool simd_supported()
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+#else
+        return true;
+#endif
+    }
+
+
+    VK_UTILS_PIXEL_CONVERT_TARGET size_t convert_rgb_to_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 3, dst += batch_size * 4) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48), _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+        }
+
+        return i;
+    }
+
+
+    VK_UTILS_PIXEL_CONVERT_TARGET size_t convert_grey_to_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        const __m128i alpha = _mm_set1_epi32(0xff000000);
+        const __m128i shuffles[4]{
+            _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+            _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+            _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+            _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1),
+        };
+
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size, dst += batch_size * 4) {
+            const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+
+            for (int32_t q = 0; q < 4; ++q) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + q * 16), _mm_or_si128(_mm_shuffle_epi8(g, shuffles[q]), alpha));
+            }
+        }
+
+        return i;
+    }
+
+
+    VK_UTILS_PIXEL_CONVERT_TARGET size_t convert_grey_alpha_to_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        const __m128i shuffle_lo = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+        const __m128i shuffle_hi = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 2, dst += batch_size * 4) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(a, shuffle_lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_shuffle_epi8(a, shuffle_hi));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_shuffle_epi8(b, shuffle_lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48), _mm_shuffle_epi8(b, shuffle_hi));
+        }
+
+        return i;
+    }
+
+
+    VK_UTILS_PIXEL_CONVERT_TARGET size_t swizzle_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count, const std::array<uint8_t, 4>& order)
+    {
+        alignas(16) int8_t shuffle_bytes[16];
+
+        for (int32_t p = 0; p < 4; ++p) {
+            for (int32_t c = 0; c < 4; ++c) {
+                shuffle_bytes[p * 4 + c] = static_cast<int8_t>(p * 4 + order[c]);
+            }
+        }
+
+        const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle_bytes));
+
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 4, dst += batch_size * 4) {
+            for (int32_t q = 0; q < 4; ++q) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + q * 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + q * 16), _mm_shuffle_epi8(v, shuffle));
+            }
+        }
+
+        return i;
+    }
+
+
+    VK_UTILS_PIXEL_CONVERT_TARGET __m128i premultiply_epi16(__m128i v)
+    {
+        const __m128i alpha_lanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+        const __m128i alpha_one = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+        const __m128i bias = _mm_set1_epi16(128);
+
+        __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        a = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), alpha_one);
+
+        const __m128i t = _mm_add_epi16(_mm_mullo_epi16(v, a), bias);
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+
+    VK_UTILS_PIXEL_CONVERT_TARGET size_t premultiply_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 4, dst += batch_size * 4) {
+            for (int32_t q = 0; q < 4; ++q) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + q * 16));
+                const __m128i lo = premultiply_epi16(_mm_unpacklo_epi8(v, zero));
+                const __m128i hi = premultiply_epi16(_mm_unpackhi_epi8(v, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + q * 16), _mm_packus_epi16(lo, hi));
+            }
+        }
+
+        return i;
+    }
+#elif defined(VK_UTILS_PIXEL_CONVERT_NEON)
+    constexpr size_t batch_size = 16;
+
+    bool simd_supported()
+    {
+        return true;
+    }
+
+
+    size_t convert_rgb_to_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 3, dst += batch_size * 4) {
+            const uint8x16x3_t rgb = vld3q_u8(src);
+            const uint8x16x4_t rgba{rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(255)};
+            vst4q_u8(dst, rgba);
+        }
+
+        return i;
+    }
+
+
+    size_t convert_grey_to_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size, dst += batch_size * 4) {
+            const uint8x16_t g = vld1q_u8(src);
+            const uint8x16x4_t rgba{g, g, g, vdupq_n_u8(255)};
+            vst4q_u8(dst, rgba);
+        }
+
+        return i;
+    }
+
+
+    size_t convert_grey_alpha_to_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 2, dst += batch_size * 4) {
+            const uint8x16x2_t ga = vld2q_u8(src);
+            const uint8x16x4_t rgba{ga.val[0], ga.val[0], ga.val[0], ga.val[1]};
+            vst4q_u8(dst, rgba);
+        }
+
+        return i;
+    }
+
+
+    size_t swizzle_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count, const std::array<uint8_t, 4>& order)
+    {
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 4, dst += batch_size * 4) {
+            const uint8x16x4_t v = vld4q_u8(src);
+            const uint8x16x4_t swizzled{v.val[order[0]], v.val[order[1]], v.val[order[2]], v.val[order[3]]};
+            vst4q_u8(dst, swizzled);
+        }
+
+        return i;
+    }
+
+
+    uint8x16_t premultiply_u8(uint8x16_t c, uint8x16_t a)
+    {
+        const uint16x8_t bias = vdupq_n_u16(128);
+        const uint16x8_t lo = vaddq_u16(vmull_u8(vget_low_u8(c), vget_low_u8(a)), bias);
+        const uint16x8_t hi = vaddq_u16(vmull_u8(vget_high_u8(c), vget_high_u8(a)), bias);
+        return vcombine_u8(vaddhn_u16(lo, vshrq_n_u16(lo, 8)), vaddhn_u16(hi, vshrq_n_u16(hi, 8)));
+    }
+
+
+    size_t premultiply_rgba_simd(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+    {
+        size_t i = 0;
+
+        for (; i + batch_size <= pixels_count; i += batch_size, src += batch_size * 4, dst += batch_size * 4) {
+            uint8x16x4_t v = vld4q_u8(src);
+            v.val[0] = premultiply_u8(v.val[0], v.val[3]);
+            v.val[1] = premultiply_u8(v.val[1], v.val[3]);
+            v.val[2] = premultiply_u8(v.val[2], v.val[3]);
+            vst4q_u8(dst, v);
+        }
+
+        return i;
+    }
+#else
+    bool simd_supported()
+    {
+        return false;
+    }
+
+
+    size_t convert_rgb_to_rgba_simd(const uint8_t*, uint8_t*, size_t)
+    {
+        return 0;
+    }
+
+
+    size_t convert_grey_to_rgba_simd(const uint8_t*, uint8_t*, size_t)
+    {
+        return 0;
+    }
+
+
+    size_t convert_grey_alpha_to_rgba_simd(const uint8_t*, uint8_t*, size_t)
+    {
+        return 0;
+    }
+
+
+    size_t swizzle_rgba_simd(const uint8_t*, uint8_t*, size_t, const std::array<uint8_t, 4>&)
+    {
+        return 0;
+    }
+
+
+    size_t premultiply_rgba_simd(const uint8_t*, uint8_t*, size_t)
+    {
+        return 0;
+    }
+#endif
+} // namespace
+
+
+void vk_utils::convert_rgb_to_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+{
+    const size_t converted = simd_supported() ? convert_rgb_to_rgba_simd(src, dst, pixels_count) : 0;
+    convert_rgb_to_rgba_scalar(src + converted * 3, dst + converted * 4, pixels_count - converted);
+}
+
+
+void vk_utils::convert_grey_to_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+{
+    const size_t converted = simd_supported() ? convert_grey_to_rgba_simd(src, dst, pixels_count) : 0;
+    convert_grey_to_rgba_scalar(src + converted, dst + converted * 4, pixels_count - converted);
+}
+
+
+void vk_utils::convert_grey_alpha_to_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+{
+    const size_t converted = simd_supported() ? convert_grey_alpha_to_rgba_simd(src, dst, pixels_count) : 0;
+    convert_grey_alpha_to_rgba_scalar(src + converted * 2, dst + converted * 4, pixels_count - converted);
+}
+
+
+void vk_utils::convert_to_rgba(const uint8_t* src, uint32_t channels_count, uint8_t* dst, size_t pixels_count)
+{
+    switch (channels_count) {
+        case 1:
+            convert_grey_to_rgba(src, dst, pixels_count);
+            break;
+        case 2:
+            convert_grey_alpha_to_rgba(src, dst, pixels_count);
+            break;
+        case 3:
+            convert_rgb_to_rgba(src, dst, pixels_count);
+            break;
+        case 4:
+            if (src != dst) {
+                std::memcpy(dst, src, pixels_count * 4);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+void vk_utils::swizzle_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count, const std::array<uint8_t, 4>& order)
+{
+    const size_t converted = simd_supported() ? swizzle_rgba_simd(src, dst, pixels_count, order) : 0;
+    swizzle_rgba_scalar(src + converted * 4, dst + converted * 4, pixels_count - converted, order);
+}
+
+
+void vk_utils::premultiply_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count)
+{
+    const size_t converted = simd_supported() ? premultiply_rgba_simd(src, dst, pixels_count) : 0;
+    premultiply_rgba_scalar(src + converted * 4, dst + converted * 4, pixels_count - converted);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace vk_utils
+{
+    // 8 bit per channel pixels conversion kernels, vectorized with SSSE3 when the cpu supports it or with NEON.
+    // dst may point to write combined mapped memory, it is written sequentially and never read.
+    void convert_rgb_to_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count);
+    void convert_grey_to_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count);
+    void convert_grey_alpha_to_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count);
+
+    // channels_count of 1, 2, 3 or 4.
+    void convert_to_rgba(const uint8_t* src, uint32_t channels_count, uint8_t* dst, size_t pixels_count);
+
+    // dst channel i is taken from src channel order[i], src and dst may be the same.
+    void swizzle_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count, const std::array<uint8_t, 4>& order);
+
+    // rgb multiplied by alpha with rounding, src and dst may be the same.
+    void premultiply_rgba(const uint8_t* src, uint8_t* dst, size_t pixels_count);
+} // namespace vk_utils
@@ -0,0 +1,55 @@
+
+#include "range_allocator.hpp"
+
+
+vk_utils::range_allocator::range_allocator(VkDeviceSize size)
+    : m_free_ranges{{0, size}}
+{
+}
+
+
+bool vk_utils::range_allocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& out_offset)
+{
+    for (auto it = m_free_ranges.begin(); it != m_free_ranges.end(); ++it) {
+        const VkDeviceSize range_begin = it->first;
+        const VkDeviceSize range_end = it->first + it->second;
+        const VkDeviceSize offset = alignment > 1 ? (range_begin + alignment - 1) / alignment * alignment : range_begin;
+
+        if (offset + size > range_end) {
+            continue;
+        }
+
+        m_free_ranges.erase(it);
+
+        if (offset > range_begin) {
+            m_free_ranges.emplace(range_begin, offset - range_begin);
+        }
+
+        if (offset + size < range_end) {
+            m_free_ranges.emplace(offset + size, range_end - offset - size);
+        }
+
+        out_offset = offset;
+        return true;
+    }
+
+    return false;
+}
+
+
+void vk_utils::range_allocator::free(VkDeviceSize offset, VkDeviceSize size)
+{
+    auto [it, inserted] = m_free_ranges.emplace(offset, size);
+
+    if (auto next = std::next(it); next != m_free_ranges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        m_free_ranges.erase(next);
+    }
+
+    if (it != m_free_ranges.begin()) {
+        if (auto prev = std::prev(it); prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            m_free_ranges.erase(it);
+        }
+    }
+}
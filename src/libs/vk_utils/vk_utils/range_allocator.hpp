@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+
+#include <map>
+
+namespace vk_utils
+{
+    // First fit sub-allocation of one block from a free list coalesced on free.
+    // alignments don't have to be powers of two, e.g. vertex strides.
+    class range_allocator
+    {
+    public:
+        range_allocator() = default;
+        explicit range_allocator(VkDeviceSize size);
+
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& out_offset);
+        void free(VkDeviceSize offset, VkDeviceSize size);
+
+    private:
+        // free ranges begin to size.
+        std::map<VkDeviceSize, VkDeviceSize> m_free_ranges{};
+    };
+} // namespace vk_utils
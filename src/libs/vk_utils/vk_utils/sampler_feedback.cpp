@@ -0,0 +1,105 @@
+
+#include "sampler_feedback.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
+
+#include <sampler_feedback_glsl.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint32_t not_sampled_level = ~0u;
+    constexpr int32_t level_offset = 16;
+} // namespace
+
+
+vk_utils::sampler_feedback::~sampler_feedback()
+{
+    for (auto& frame : m_frames) {
+        if (frame.mapped_data != nullptr) {
+            vmaUnmapMemory(vk_utils::context::get().allocator(), frame.buffer);
+        }
+    }
+}
+
+
+ERROR_TYPE vk_utils::sampler_feedback::init(uint32_t textures_count, uint32_t frames_count)
+{
+    if (textures_count == 0 || frames_count == 0) {
+        RAISE_ERROR_WARN(-1, "invalid sampler feedback textures or frames count.");
+    }
+
+    const auto allocator = vk_utils::context::get().allocator();
+
+    m_textures_count = textures_count;
+    m_frames.resize(frames_count);
+
+    for (auto& frame : m_frames) {
+        PASS_ERROR(create_buffer(
+            frame.buffer,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_TO_CPU,
+            textures_count * sizeof(uint32_t)));
+
+        void* mapped_data{nullptr};
+
+        if (const auto err = vmaMapMemory(allocator, frame.buffer, &mapped_data); err != VK_SUCCESS) {
+            RAISE_ERROR_WARN(err, "cannot map sampler feedback buffer.");
+        }
+
+        frame.mapped_data = static_cast<uint32_t*>(mapped_data);
+        std::fill_n(frame.mapped_data, m_textures_count, not_sampled_level);
+        vmaFlushAllocation(allocator, frame.buffer, 0, VK_WHOLE_SIZE);
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+VkDescriptorBufferInfo vk_utils::sampler_feedback::get_buffer_info(uint32_t frame) const
+{
+    return {
+        .buffer = m_frames[frame % m_frames.size()].buffer,
+        .offset = 0,
+        .range = m_textures_count * sizeof(uint32_t),
+    };
+}
+
+
+void vk_utils::sampler_feedback::read(uint32_t frame, const on_level_sampled_callback& callback)
+{
+    const auto allocator = vk_utils::context::get().allocator();
+    auto& frame_buffer = m_frames[frame % m_frames.size()];
+
+    vmaInvalidateAllocation(allocator, frame_buffer.buffer, 0, VK_WHOLE_SIZE);
+
+    for (uint32_t texture_id = 0; texture_id < m_textures_count; ++texture_id) {
+        if (frame_buffer.mapped_data[texture_id] != not_sampled_level) {
+            callback(texture_id, static_cast<int32_t>(frame_buffer.mapped_data[texture_id]) - level_offset);
+        }
+    }
+
+    std::fill_n(frame_buffer.mapped_data, m_textures_count, not_sampled_level);
+    vmaFlushAllocation(allocator, frame_buffer.buffer, 0, VK_WHOLE_SIZE);
+}
+
+
+const char* vk_utils::sampler_feedback::get_glsl_source()
+{
+    return vk_utils::detail::sampler_feedback_glsl;
+}
+
+
+void vk_utils::sampler_feedback::record_readback_barrier(VkCommandBuffer cmd)
+{
+    VkMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <errors/error_handler.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace vk_utils
+{
+    // Collects mip levels which shaders really sample.
+    // Fragment shaders atomicMin the level returned by textureQueryLod into a per texture slot of a storage buffer,
+    // every frame in flight writes its own host visible buffer which is read back once the frame submission completed.
+    class sampler_feedback
+    {
+    public:
+        // level is relative to the texture image level 0, negative levels mean the image is too small for its on screen size.
+        using on_level_sampled_callback = std::function<void(uint32_t texture_id, int32_t level)>;
+
+        sampler_feedback() = default;
+        sampler_feedback(const sampler_feedback&) = delete;
+        sampler_feedback& operator=(const sampler_feedback&) = delete;
+        ~sampler_feedback();
+
+        ERROR_TYPE init(uint32_t textures_count, uint32_t frames_count);
+
+        // storage buffer the frame shaders write to, bound with VK_DESCRIPTOR_TYPE_STORAGE_BUFFER.
+        VkDescriptorBufferInfo get_buffer_info(uint32_t frame) const;
+
+        // makes the frame shader writes available to read(), recorded into the frame command buffer after its last draw.
+        static void record_readback_barrier(VkCommandBuffer cmd);
+
+        // reports textures sampled by the frame and resets its buffer,
+        // must be called after the frame submission was waited and before the frame is recorded again.
+        void read(uint32_t frame, const on_level_sampled_callback& callback);
+
+        // GLSL declarations to prepend to fragment shaders after the #version directive, precompiled shaders include
+        // "vk_utils/sampler_feedback.glsl.inc" instead, the source is generated from that file.
+        // SAMPLER_FEEDBACK_SET and SAMPLER_FEEDBACK_BINDING may be defined before to relocate the buffer.
+        // usage: write_sampler_feedback(texture_id, diffuse_texture, uv);
+        static const char* get_glsl_source();
+
+    private:
+        struct frame_buffer
+        {
+            vk_utils::vma_buffer_handler buffer{};
+            uint32_t* mapped_data{nullptr};
+        };
+
+        uint32_t m_textures_count{0};
+        std::vector<frame_buffer> m_frames{};
+    };
+} // namespace vk_utils
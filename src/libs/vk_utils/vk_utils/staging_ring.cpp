@@ -0,0 +1,311 @@
+
+#include "staging_ring.hpp"
+
+#include <vk_utils/context.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+
+    VkResult create_mapped_buffer(VkDeviceSize size, vk_utils::vma_buffer_handler& out_buffer)
+    {
+        const auto& ctx = vk_utils::context::get();
+
+        // staging memory is read by uploads on the graphics and on the dedicated transfer queue.
+        const uint32_t queue_families[]{
+            static_cast<uint32_t>(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS)),
+            static_cast<uint32_t>(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_TRANSFER))};
+
+        const bool concurrent = ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_TRANSFER) >= 0 && queue_families[0] != queue_families[1];
+
+        VkBufferCreateInfo buffer_info{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = concurrent ? 2u : 0u,
+            .pQueueFamilyIndices = concurrent ? queue_families : nullptr,
+        };
+
+        VmaAllocationCreateInfo alloc_info{
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+        };
+
+        return out_buffer.init(ctx.allocator(), &buffer_info, &alloc_info, vk_utils::MEMORY_TAG_STAGING);
+    }
+} // namespace
+
+
+ERROR_TYPE vk_utils::staging_ring::init(VkDeviceSize size, uint32_t frames_count)
+{
+    if (size == 0) {
+        RAISE_ERROR_WARN(-1, "invalid staging ring size.");
+    }
+
+    if (const auto err = create_mapped_buffer(size, m_buffer); err != VK_SUCCESS) {
+        RAISE_ERROR_WARN(err, "cannot init staging ring buffer.");
+    }
+
+    m_mapped_data = static_cast<uint8_t*>(m_buffer.get_alloc_info().pMappedData);
+    m_size = size;
+    m_frames_count = std::max(1u, frames_count);
+    m_frame_index = 0;
+    m_regions.clear();
+
+    RAISE_ERROR_OK();
+}
+
+
+bool vk_utils::staging_ring::allocate(VkDeviceSize size, VkDeviceSize alignment, allocation& out_allocation)
+{
+    if (m_mapped_data == nullptr || size == 0 || size > m_size) {
+        return false;
+    }
+
+    reclaim();
+
+    VkDeviceSize offset = 0;
+
+    if (!m_regions.empty()) {
+        const VkDeviceSize tail = m_regions.front().begin;
+        const VkDeviceSize head = align_up(m_regions.back().end, alignment);
+        const bool wrapped = m_regions.back().begin < tail;
+
+        if (!wrapped && head + size <= m_size) {
+            offset = head;
+        } else if (!wrapped && size <= tail) {
+            offset = 0;
+        } else if (wrapped && head + size <= tail) {
+            offset = head;
+        } else {
+            return false;
+        }
+    }
+
+    auto& new_region = m_regions.emplace_back();
+    new_region.begin = offset;
+    new_region.end = offset + size;
+
+    out_allocation = {
+        .buffer = m_buffer,
+        .offset = offset,
+        .size = size,
+        .mapped_data = m_mapped_data + offset,
+    };
+
+    return true;
+}
+
+
+void vk_utils::staging_ring::flush(const allocation& allocation) const
+{
+    vmaFlushAllocation(vk_utils::context::get().allocator(), m_buffer, allocation.offset, allocation.size);
+}
+
+
+void vk_utils::staging_ring::release(const allocation& allocation)
+{
+    if (auto* r = find_region(allocation); r != nullptr) {
+        r->state = REGION_STATE_RELEASED;
+    }
+}
+
+
+void vk_utils::staging_ring::release(const allocation& allocation, const submission_token& submission)
+{
+    if (auto* r = find_region(allocation); r != nullptr) {
+        r->state = REGION_STATE_TIMELINE;
+        r->submission = submission;
+    }
+}
+
+
+void vk_utils::staging_ring::release_after_frame(const allocation& allocation)
+{
+    if (auto* r = find_region(allocation); r != nullptr) {
+        r->state = REGION_STATE_FRAME;
+        r->frame = m_frame_index;
+    }
+}
+
+
+void vk_utils::staging_ring::end_frame()
+{
+    m_frame_index++;
+}
+
+
+VkDeviceSize vk_utils::staging_ring::get_size() const
+{
+    return m_size;
+}
+
+
+vk_utils::staging_ring::region* vk_utils::staging_ring::find_region(const allocation& allocation)
+{
+    auto it = std::find_if(m_regions.begin(), m_regions.end(), [&allocation](const region& r) {
+        return r.begin == allocation.offset && r.state == REGION_STATE_ALLOCATED;
+    });
+
+    return it != m_regions.end() ? &*it : nullptr;
+}
+
+
+void vk_utils::staging_ring::reclaim()
+{
+    const auto& ctx = vk_utils::context::get();
+
+    for (auto& r : m_regions) {
+        if (r.state == REGION_STATE_TIMELINE && ctx.is_completed(r.submission)) {
+            r.state = REGION_STATE_RELEASED;
+        } else if (r.state == REGION_STATE_FRAME && r.frame + m_frames_count <= m_frame_index) {
+            r.state = REGION_STATE_RELEASED;
+        }
+    }
+
+    while (!m_regions.empty() && m_regions.front().state == REGION_STATE_RELEASED) {
+        m_regions.pop_front();
+    }
+}
+
+
+vk_utils::staging_buffer::staging_buffer(vk_utils::vma_buffer_handler dedicated_buffer)
+    : m_dedicated_buffer(std::move(dedicated_buffer))
+{
+    m_allocation = {
+        .buffer = m_dedicated_buffer,
+        .offset = 0,
+        .size = m_dedicated_buffer.get_create_info().size,
+        .mapped_data = static_cast<uint8_t*>(m_dedicated_buffer.get_alloc_info().pMappedData),
+    };
+}
+
+
+vk_utils::staging_buffer::staging_buffer(staging_buffer&& src) noexcept
+{
+    *this = std::move(src);
+}
+
+
+vk_utils::staging_buffer& vk_utils::staging_buffer::operator=(staging_buffer&& src) noexcept
+{
+    if (this == &src) {
+        return *this;
+    }
+
+    std::swap(m_ring, src.m_ring);
+    std::swap(m_allocation, src.m_allocation);
+    std::swap(m_dedicated_buffer, src.m_dedicated_buffer);
+
+    return *this;
+}
+
+
+vk_utils::staging_buffer::~staging_buffer()
+{
+    release();
+}
+
+
+ERROR_TYPE vk_utils::staging_buffer::init(VkDeviceSize size, VkDeviceSize alignment, vk_utils::staging_ring* ring, const void* data)
+{
+    release();
+    m_dedicated_buffer.destroy();
+    m_allocation = {};
+
+    if (ring != nullptr && ring->allocate(size, alignment, m_allocation)) {
+        m_ring = ring;
+    } else {
+        if (const auto err = create_mapped_buffer(size, m_dedicated_buffer); err != VK_SUCCESS) {
+            RAISE_ERROR_WARN(err, "cannot init staging buffer.");
+        }
+
+        m_allocation = {
+            .buffer = m_dedicated_buffer,
+            .offset = 0,
+            .size = size,
+            .mapped_data = static_cast<uint8_t*>(m_dedicated_buffer.get_alloc_info().pMappedData),
+        };
+    }
+
+    if (data != nullptr) {
+        std::memcpy(m_allocation.mapped_data, data, size);
+        flush();
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+VkBuffer vk_utils::staging_buffer::get_buffer() const
+{
+    return m_allocation.buffer;
+}
+
+
+VkDeviceSize vk_utils::staging_buffer::get_offset() const
+{
+    return m_allocation.offset;
+}
+
+
+VkDeviceSize vk_utils::staging_buffer::get_size() const
+{
+    return m_allocation.size;
+}
+
+
+uint8_t* vk_utils::staging_buffer::get_mapped_data() const
+{
+    return m_allocation.mapped_data;
+}
+
+
+void vk_utils::staging_buffer::flush() const
+{
+    if (m_ring != nullptr) {
+        m_ring->flush(m_allocation);
+    } else if (is_dedicated()) {
+        vmaFlushAllocation(vk_utils::context::get().allocator(), m_dedicated_buffer, 0, VK_WHOLE_SIZE);
+    }
+}
+
+
+void vk_utils::staging_buffer::release_after_frame()
+{
+    if (m_ring != nullptr) {
+        m_ring->release_after_frame(m_allocation);
+        m_ring = nullptr;
+    }
+}
+
+
+bool vk_utils::staging_buffer::is_dedicated() const
+{
+    return static_cast<VkBuffer>(m_dedicated_buffer) != nullptr;
+}
+
+
+vk_utils::vma_buffer_handler& vk_utils::staging_buffer::get_dedicated_buffer()
+{
+    return m_dedicated_buffer;
+}
+
+
+void vk_utils::staging_buffer::release()
+{
+    if (m_ring != nullptr) {
+        m_ring->release(m_allocation);
+        m_ring = nullptr;
+    }
+}
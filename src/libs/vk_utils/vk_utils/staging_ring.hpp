@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/submission_queue.hpp>
+#include <errors/error_handler.hpp>
+
+#include <deque>
+
+namespace vk_utils
+{
+    // One persistently mapped staging buffer sub-allocated linearly.
+    // Allocations are reclaimed in allocation order after they are released: immediately, once a submission completed
+    // or after end_frame() was called frames count times.
+    class staging_ring
+    {
+    public:
+        struct allocation
+        {
+            VkBuffer buffer{nullptr};
+            VkDeviceSize offset{0};
+            VkDeviceSize size{0};
+            uint8_t* mapped_data{nullptr};
+        };
+
+        staging_ring() = default;
+        staging_ring(const staging_ring&) = delete;
+        staging_ring& operator=(const staging_ring&) = delete;
+        ~staging_ring() = default;
+
+        ERROR_TYPE init(VkDeviceSize size, uint32_t frames_count = 3);
+
+        // returns false when the ring has no free space left, callers fall back to dedicated staging buffers.
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, allocation& out_allocation);
+        void flush(const allocation& allocation) const;
+
+        // commands reading the allocation have already completed.
+        void release(const allocation& allocation);
+        void release(const allocation& allocation, const submission_token& submission);
+        // for commands submitted by the caller within the current frame.
+        void release_after_frame(const allocation& allocation);
+
+        void end_frame();
+
+        VkDeviceSize get_size() const;
+
+    private:
+        enum region_state
+        {
+            REGION_STATE_ALLOCATED,
+            REGION_STATE_TIMELINE,
+            REGION_STATE_FRAME,
+            REGION_STATE_RELEASED
+        };
+
+        struct region
+        {
+            VkDeviceSize begin{0};
+            VkDeviceSize end{0};
+            region_state state{REGION_STATE_ALLOCATED};
+            submission_token submission{};
+            uint64_t frame{0};
+        };
+
+        region* find_region(const allocation& allocation);
+        void reclaim();
+
+        vk_utils::vma_buffer_handler m_buffer{};
+        uint8_t* m_mapped_data{nullptr};
+        VkDeviceSize m_size{0};
+        uint32_t m_frames_count{3};
+        uint64_t m_frame_index{0};
+
+        std::deque<region> m_regions{};
+    };
+
+
+    // Staging memory of one upload: a ring allocation when a ring is passed and has room, a dedicated mapped buffer otherwise.
+    // ring allocations are released on destruction, so the object has to outlive the commands reading it.
+    class staging_buffer
+    {
+    public:
+        staging_buffer() = default;
+        explicit staging_buffer(vk_utils::vma_buffer_handler dedicated_buffer);
+        staging_buffer(const staging_buffer&) = delete;
+        staging_buffer& operator=(const staging_buffer&) = delete;
+        staging_buffer(staging_buffer&& src) noexcept;
+        staging_buffer& operator=(staging_buffer&& src) noexcept;
+        ~staging_buffer();
+
+        ERROR_TYPE init(VkDeviceSize size, VkDeviceSize alignment, vk_utils::staging_ring* ring, const void* data = nullptr);
+
+        VkBuffer get_buffer() const;
+        VkDeviceSize get_offset() const;
+        VkDeviceSize get_size() const;
+        uint8_t* get_mapped_data() const;
+
+        void flush() const;
+
+        // hands the ring allocation over to frame based reclamation, the offset and buffer stay valid for recording.
+        void release_after_frame();
+
+        bool is_dedicated() const;
+        // null for ring allocations.
+        vk_utils::vma_buffer_handler& get_dedicated_buffer();
+
+    private:
+        void release();
+
+        vk_utils::staging_ring* m_ring{nullptr};
+        vk_utils::staging_ring::allocation m_allocation{};
+        vk_utils::vma_buffer_handler m_dedicated_buffer{};
+    };
+} // namespace vk_utils
@@ -0,0 +1,269 @@
+
+#include "submission_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // size of the submit info extension structures which may be copied out of a caller chain.
+    size_t get_submit_structure_size(VkStructureType type)
+    {
+        switch (type) {
+            case VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO:
+                return sizeof(VkDeviceGroupSubmitInfo);
+            case VK_STRUCTURE_TYPE_PROTECTED_SUBMIT_INFO:
+                return sizeof(VkProtectedSubmitInfo);
+            case VK_STRUCTURE_TYPE_PERFORMANCE_QUERY_SUBMIT_INFO_KHR:
+                return sizeof(VkPerformanceQuerySubmitInfoKHR);
+            default:
+                return 0;
+        }
+    }
+} // namespace
+
+VkResult vk_utils::submission_queue::init(VkDevice device, VkQueue queue)
+{
+    VkSemaphoreTypeCreateInfo type_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+
+    VkSemaphoreCreateInfo semaphore_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+        .flags = 0,
+    };
+
+    m_device = device;
+    m_queue = queue;
+    m_submitted_value = 0;
+
+    return m_timeline.init(device, &semaphore_info);
+}
+
+
+VkResult vk_utils::submission_queue::submit(const VkSubmitInfo& submit_info, submission_token& out_token)
+{
+    request r{};
+
+    if (const auto e = prepare_submit(submit_info, r); e != VK_SUCCESS) {
+        return e;
+    }
+
+    process(r);
+
+    if (r.result == VK_SUCCESS) {
+        out_token = {m_queue, r.value};
+    }
+
+    return r.result;
+}
+
+
+VkResult vk_utils::submission_queue::present(const VkPresentInfoKHR& present_info)
+{
+    request r{};
+    r.present_info = &present_info;
+
+    process(r);
+
+    return r.result;
+}
+
+
+VkQueue vk_utils::submission_queue::get_queue() const
+{
+    return m_queue;
+}
+
+
+VkSemaphore vk_utils::submission_queue::get_timeline_semaphore() const
+{
+    return m_timeline;
+}
+
+
+uint64_t vk_utils::submission_queue::get_submitted_value() const
+{
+    return m_submitted_value.load(std::memory_order_acquire);
+}
+
+
+uint64_t vk_utils::submission_queue::get_completed_value() const
+{
+    uint64_t value{0};
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &value);
+
+    return value;
+}
+
+
+void vk_utils::submission_queue::wait(uint64_t value) const
+{
+    if (value == 0) {
+        return;
+    }
+
+    const VkSemaphore semaphore = m_timeline;
+
+    VkSemaphoreWaitInfo wait_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &semaphore,
+        .pValues = &value,
+    };
+
+    vkWaitSemaphores(m_device, &wait_info, UINT64_MAX);
+}
+
+
+VkResult vk_utils::submission_queue::prepare_submit(const VkSubmitInfo& submit_info, request& r) const
+{
+    const VkTimelineSemaphoreSubmitInfo* chained_timeline_info{nullptr};
+    for (auto* next = static_cast<const VkBaseInStructure*>(submit_info.pNext); next != nullptr; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO) {
+            chained_timeline_info = reinterpret_cast<const VkTimelineSemaphoreSubmitInfo*>(next);
+            break;
+        }
+    }
+
+    r.signal_semaphores.assign(submit_info.pSignalSemaphores, submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+    r.signal_semaphores.push_back(m_timeline);
+    // binary semaphores ignore their values, the queue timeline value is set once the request is submitted.
+    r.signal_values.assign(r.signal_semaphores.size(), 0);
+    r.wait_values.assign(submit_info.waitSemaphoreCount, 0);
+
+    const void* chain = submit_info.pNext;
+
+    if (chained_timeline_info != nullptr) {
+        if (chained_timeline_info->pWaitSemaphoreValues != nullptr) {
+            std::copy_n(chained_timeline_info->pWaitSemaphoreValues, std::min(chained_timeline_info->waitSemaphoreValueCount, submit_info.waitSemaphoreCount), r.wait_values.data());
+        }
+
+        if (chained_timeline_info->pSignalSemaphoreValues != nullptr) {
+            std::copy_n(chained_timeline_info->pSignalSemaphoreValues, std::min(chained_timeline_info->signalSemaphoreValueCount, submit_info.signalSemaphoreCount), r.signal_values.data());
+        }
+
+        // the caller timeline info is left out of the chain, structures in front of it are copied and relinked.
+        chain = chained_timeline_info->pNext;
+        VkBaseOutStructure* last_copy{nullptr};
+
+        for (auto* next = static_cast<const VkBaseInStructure*>(submit_info.pNext); next != reinterpret_cast<const VkBaseInStructure*>(chained_timeline_info); next = next->pNext) {
+            const size_t size = get_submit_structure_size(next->sType);
+
+            if (size == 0) {
+                return VK_ERROR_FEATURE_NOT_PRESENT;
+            }
+
+            auto* copy = reinterpret_cast<VkBaseOutStructure*>(r.chain_copies.emplace_back(std::make_unique<uint8_t[]>(size)).get());
+            std::memcpy(copy, next, size);
+
+            if (last_copy == nullptr) {
+                chain = copy;
+            } else {
+                last_copy->pNext = copy;
+            }
+
+            last_copy = copy;
+        }
+
+        if (last_copy != nullptr) {
+            last_copy->pNext = static_cast<VkBaseOutStructure*>(const_cast<void*>(chained_timeline_info->pNext));
+        }
+    }
+
+    r.timeline_info = VkTimelineSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = chain,
+        .waitSemaphoreValueCount = static_cast<uint32_t>(r.wait_values.size()),
+        .pWaitSemaphoreValues = r.wait_values.data(),
+        .signalSemaphoreValueCount = static_cast<uint32_t>(r.signal_values.size()),
+        .pSignalSemaphoreValues = r.signal_values.data(),
+    };
+
+    r.submit_info = submit_info;
+    r.submit_info.pNext = &r.timeline_info;
+    r.submit_info.signalSemaphoreCount = static_cast<uint32_t>(r.signal_semaphores.size());
+    r.submit_info.pSignalSemaphores = r.signal_semaphores.data();
+
+    return VK_SUCCESS;
+}
+
+
+void vk_utils::submission_queue::process(request& r)
+{
+    m_requests.push(&r);
+
+    // a submitter which already passed the request retries it after releasing the queue,
+    // the request is handed over either by it or by this thread.
+    while (!r.done.load(std::memory_order_acquire)) {
+        if (!m_submitting.test_and_set(std::memory_order_acquire)) {
+            drain();
+            m_submitting.clear(std::memory_order_release);
+            m_submitting.notify_all();
+        } else {
+            m_submitting.wait(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+void vk_utils::submission_queue::drain()
+{
+    m_batch.clear();
+
+    while (auto* r = m_requests.pop()) {
+        m_batch.push_back(r);
+    }
+
+    auto* begin = m_batch.data();
+    auto* end = m_batch.data() + m_batch.size();
+
+    while (begin != end) {
+        if ((*begin)->present_info != nullptr) {
+            (*begin)->result = vkQueuePresentKHR(m_queue, (*begin)->present_info);
+            // the requesting thread may return and destroy the request as soon as it is done.
+            (*begin)->done.store(true, std::memory_order_release);
+            ++begin;
+            continue;
+        }
+
+        auto* submits_end = std::find_if(begin, end, [](const request* r) {
+            return r->present_info != nullptr;
+        });
+
+        submit_requests(begin, submits_end);
+        begin = submits_end;
+    }
+}
+
+
+void vk_utils::submission_queue::submit_requests(request** begin, request** end)
+{
+    const auto count = static_cast<size_t>(end - begin);
+    const uint64_t first_value = m_submitted_value.load(std::memory_order_relaxed) + 1;
+
+    m_submit_infos.clear();
+
+    for (size_t i = 0; i < count; ++i) {
+        begin[i]->signal_values.back() = first_value + i;
+        m_submit_infos.push_back(begin[i]->submit_info);
+    }
+
+    const auto result = vkQueueSubmit(m_queue, static_cast<uint32_t>(count), m_submit_infos.data(), nullptr);
+
+    if (result == VK_SUCCESS) {
+        m_submitted_value.store(first_value + count - 1, std::memory_order_release);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        begin[i]->result = result;
+        begin[i]->value = result == VK_SUCCESS ? first_value + i : 0;
+        begin[i]->done.store(true, std::memory_order_release);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/mpsc_queue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace vk_utils
+{
+    // Completion of a submission, the value its queue timeline semaphore is signaled with.
+    // a default token belongs to no queue and counts as completed.
+    struct submission_token
+    {
+        VkQueue queue{nullptr};
+        uint64_t value{0};
+    };
+
+
+    // Submissions and presents of one queue made by any thread.
+    // producers push requests into a lock-free queue, the first producer finding no other one submitting becomes
+    // the submitter and hands every queued request to the driver, consecutive submissions in one vkQueueSubmit.
+    // the queue is only accessed by the current submitter, callers return once their request was handed over.
+    class submission_queue
+    {
+    public:
+        submission_queue() = default;
+        submission_queue(const submission_queue&) = delete;
+        submission_queue& operator=(const submission_queue&) = delete;
+        ~submission_queue() = default;
+
+        VkResult init(VkDevice device, VkQueue queue);
+
+        // the timeline signal is appended to the submit info, values of other timelines are chained by the caller.
+        // a chained timeline info is replaced, structures chained in front of it must be known to be copied.
+        VkResult submit(const VkSubmitInfo& submit_info, submission_token& out_token);
+        VkResult present(const VkPresentInfoKHR& present_info);
+
+        VkQueue get_queue() const;
+        VkSemaphore get_timeline_semaphore() const;
+        uint64_t get_submitted_value() const;
+        uint64_t get_completed_value() const;
+        void wait(uint64_t value) const;
+
+    private:
+        struct request
+        {
+            std::atomic<request*> next{nullptr};
+            // prepared by the requesting thread, points into the request.
+            VkSubmitInfo submit_info{};
+            VkTimelineSemaphoreSubmitInfo timeline_info{};
+            std::vector<VkSemaphore> signal_semaphores{};
+            std::vector<uint64_t> signal_values{};
+            std::vector<uint64_t> wait_values{};
+            std::vector<std::unique_ptr<uint8_t[]>> chain_copies{};
+            const VkPresentInfoKHR* present_info{nullptr};
+            VkResult result{VK_SUCCESS};
+            uint64_t value{0};
+            std::atomic_bool done{false};
+        };
+
+        VkResult prepare_submit(const VkSubmitInfo& submit_info, request& r) const;
+        void process(request& r);
+        void drain();
+        void submit_requests(request** begin, request** end);
+
+        VkDevice m_device{nullptr};
+        VkQueue m_queue{nullptr};
+        semaphore_handler m_timeline{};
+
+        mpsc_queue<request> m_requests{};
+        std::atomic_flag m_submitting{};
+        std::atomic<uint64_t> m_submitted_value{0};
+
+        // used by the current submitter only.
+        std::vector<request*> m_batch{};
+        std::vector<VkSubmitInfo> m_submit_infos{};
+    };
+} // namespace vk_utils
@@ -0,0 +1,243 @@
+
+#include "texture_packer.hpp"
+
+#include <vk_utils/pixel_convert.hpp>
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace
+{
+    constexpr uint32_t pixel_size = 4;
+}
+
+
+vk_utils::texture_packer::texture_packer(uint32_t atlas_size, uint32_t atlas_tile_max_size, uint32_t atlas_padding)
+    : m_atlas_size(atlas_size)
+    , m_atlas_tile_max_size(std::min(atlas_tile_max_size, atlas_size - 2 * atlas_padding))
+    , m_atlas_padding(atlas_padding)
+{
+}
+
+
+bool vk_utils::texture_packer::is_packable(const char* path)
+{
+    constexpr const char* stb_formats[]{".png", ".jpg", ".jpeg"};
+
+    return std::find_if(std::begin(stb_formats), std::end(stb_formats), [path](const char* ext) {
+        return strstr(path, ext) != nullptr;
+    }) != std::end(stb_formats);
+}
+
+
+ERROR_TYPE vk_utils::texture_packer::add_image(const char* path, uint32_t& out_image_index)
+{
+    int w, h, c;
+    std::unique_ptr<stbi_uc, std::function<void(stbi_uc*)>> image_handler{
+        stbi_load(path, &w, &h, &c, 0),
+        [](stbi_uc* ptr) {if (ptr != nullptr) stbi_image_free(ptr); }};
+
+    if (image_handler == nullptr) {
+        RAISE_ERROR_WARN(-1, "cannot load image.");
+    }
+
+    auto& image = m_images.emplace_back();
+    image.width = w;
+    image.height = h;
+    image.pixels.resize(size_t(w) * h * pixel_size);
+    convert_to_rgba(image_handler.get(), c, image.pixels.data(), size_t(w) * h);
+
+    out_image_index = m_images.size() - 1;
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::texture_packer::pack(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    const sampler_info& sampler,
+    std::vector<page>& out_pages,
+    std::vector<packed_region>& out_regions)
+{
+    if (!check_opt_tiling_format(m_format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        m_format = VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    out_regions.resize(m_images.size());
+
+    PASS_ERROR(pack_arrays(transfer_queue, transfer_queue_family_index, command_pool, sampler, out_pages, out_regions));
+    PASS_ERROR(pack_atlases(transfer_queue, transfer_queue_family_index, command_pool, sampler, out_pages, out_regions));
+
+    m_images.clear();
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::texture_packer::pack_arrays(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    const sampler_info& sampler,
+    std::vector<page>& out_pages,
+    std::vector<packed_region>& out_regions)
+{
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> size_groups{};
+
+    for (uint32_t i = 0; i < m_images.size(); ++i) {
+        if (!is_atlas_tile(m_images[i])) {
+            size_groups[{m_images[i].width, m_images[i].height}].push_back(i);
+        }
+    }
+
+    for (const auto& [size, images] : size_groups) {
+        const auto [width, height] = size;
+        const size_t layer_size = width * height * pixel_size;
+
+        std::vector<uint8_t> layers_data(layer_size * images.size());
+
+        for (uint32_t layer = 0; layer < images.size(); ++layer) {
+            std::memcpy(layers_data.data() + layer * layer_size, m_images[images[layer]].pixels.data(), layer_size);
+            out_regions[images[layer]] = {.page = static_cast<uint32_t>(out_pages.size()), .layer = layer};
+        }
+
+        auto& new_page = out_pages.emplace_back();
+
+        PASS_ERROR(create_texture_2D_array(
+            transfer_queue,
+            transfer_queue_family_index,
+            command_pool,
+            sampler,
+            width,
+            height,
+            static_cast<uint32_t>(images.size()),
+            get_full_mip_levels(width, height),
+            m_format,
+            layers_data.data(),
+            new_page.image,
+            new_page.image_view,
+            new_page.sampler));
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::texture_packer::pack_atlases(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    const sampler_info& sampler,
+    std::vector<page>& out_pages,
+    std::vector<packed_region>& out_regions)
+{
+    std::vector<uint32_t> tiles{};
+
+    for (uint32_t i = 0; i < m_images.size(); ++i) {
+        if (is_atlas_tile(m_images[i])) {
+            tiles.push_back(i);
+        }
+    }
+
+    if (tiles.empty()) {
+        RAISE_ERROR_OK();
+    }
+
+    std::sort(tiles.begin(), tiles.end(), [this](uint32_t l, uint32_t r) {
+        return m_images[l].height > m_images[r].height;
+    });
+
+    const size_t layer_size = m_atlas_size * m_atlas_size * pixel_size;
+    const uint32_t page_index = out_pages.size();
+
+    std::vector<uint8_t> layers_data{};
+
+    uint32_t layer = 0;
+    uint32_t shelf_x = 0;
+    uint32_t shelf_y = 0;
+    uint32_t shelf_height = 0;
+
+    for (const auto tile : tiles) {
+        const auto& image = m_images[tile];
+        const uint32_t padded_width = image.width + 2 * m_atlas_padding;
+        const uint32_t padded_height = image.height + 2 * m_atlas_padding;
+
+        if (shelf_x + padded_width > m_atlas_size) {
+            shelf_x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+
+        if (layers_data.empty() || shelf_y + padded_height > m_atlas_size) {
+            layer = layers_data.empty() ? 0 : layer + 1;
+            shelf_x = 0;
+            shelf_y = 0;
+            shelf_height = 0;
+            layers_data.resize(layer_size * (layer + 1));
+        }
+
+        uint8_t* layer_data = layers_data.data() + layer * layer_size;
+
+        for (uint32_t y = 0; y < padded_height; ++y) {
+            const uint32_t src_y = std::clamp<int64_t>(int64_t(y) - m_atlas_padding, 0, image.height - 1);
+
+            for (uint32_t x = 0; x < padded_width; ++x) {
+                const uint32_t src_x = std::clamp<int64_t>(int64_t(x) - m_atlas_padding, 0, image.width - 1);
+                std::memcpy(
+                    layer_data + ((shelf_y + y) * m_atlas_size + shelf_x + x) * pixel_size,
+                    image.pixels.data() + (src_y * image.width + src_x) * pixel_size,
+                    pixel_size);
+            }
+        }
+
+        const float atlas_size = m_atlas_size;
+
+        out_regions[tile] = {
+            .page = page_index,
+            .layer = layer,
+            .uv_transform = {
+                image.width / atlas_size,
+                image.height / atlas_size,
+                (shelf_x + m_atlas_padding) / atlas_size,
+                (shelf_y + m_atlas_padding) / atlas_size}};
+
+        shelf_x += padded_width;
+        shelf_height = std::max(shelf_height, padded_height);
+    }
+
+    auto& new_page = out_pages.emplace_back();
+
+    // tiles stay separated by at least one texel on every mip level
+    const uint32_t mip_levels = std::max(1u, static_cast<uint32_t>(std::log2(std::max(1u, m_atlas_padding))) + 1);
+
+    PASS_ERROR(create_texture_2D_array(
+        transfer_queue,
+        transfer_queue_family_index,
+        command_pool,
+        sampler,
+        m_atlas_size,
+        m_atlas_size,
+        layer + 1,
+        mip_levels,
+        m_format,
+        layers_data.data(),
+        new_page.image,
+        new_page.image_view,
+        new_page.sampler));
+
+    RAISE_ERROR_OK();
+}
+
+
+bool vk_utils::texture_packer::is_atlas_tile(const image_data& image) const
+{
+    return std::max(image.width, image.height) <= m_atlas_tile_max_size;
+}
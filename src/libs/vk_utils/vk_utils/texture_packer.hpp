@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/tools.hpp>
+#include <errors/error_handler.hpp>
+
+#include <array>
+#include <vector>
+
+namespace vk_utils
+{
+    // Packs decoded images into 2D array textures: same sized large images become layers of one array,
+    // small images are atlased into fixed size pages which are layers of another array.
+    class texture_packer
+    {
+    public:
+        struct packed_region
+        {
+            uint32_t page{0};
+            uint32_t layer{0};
+            // uv scale xy, uv offset zw
+            std::array<float, 4> uv_transform{1, 1, 0, 0};
+        };
+
+        struct page
+        {
+            vk_utils::vma_image_handler image{};
+            vk_utils::image_view_handler image_view{};
+            vk_utils::sampler_handler sampler{};
+        };
+
+        explicit texture_packer(uint32_t atlas_size = 1024, uint32_t atlas_tile_max_size = 256, uint32_t atlas_padding = 4);
+
+        static bool is_packable(const char* path);
+
+        ERROR_TYPE add_image(const char* path, uint32_t& out_image_index);
+
+        ERROR_TYPE pack(
+            VkQueue transfer_queue,
+            uint32_t transfer_queue_family_index,
+            VkCommandPool command_pool,
+            const sampler_info& sampler,
+            std::vector<page>& out_pages,
+            std::vector<packed_region>& out_regions);
+
+    private:
+        struct image_data
+        {
+            uint32_t width{0};
+            uint32_t height{0};
+            std::vector<uint8_t> pixels{};
+        };
+
+        ERROR_TYPE pack_arrays(
+            VkQueue transfer_queue,
+            uint32_t transfer_queue_family_index,
+            VkCommandPool command_pool,
+            const sampler_info& sampler,
+            std::vector<page>& out_pages,
+            std::vector<packed_region>& out_regions);
+
+        ERROR_TYPE pack_atlases(
+            VkQueue transfer_queue,
+            uint32_t transfer_queue_family_index,
+            VkCommandPool command_pool,
+            const sampler_info& sampler,
+            std::vector<page>& out_pages,
+            std::vector<packed_region>& out_regions);
+
+        bool is_atlas_tile(const image_data& image) const;
+
+        uint32_t m_atlas_size;
+        uint32_t m_atlas_tile_max_size;
+        uint32_t m_atlas_padding;
+        VkFormat m_format{VK_FORMAT_R8G8B8A8_SRGB};
+        std::vector<image_data> m_images{};
+    };
+} // namespace vk_utils
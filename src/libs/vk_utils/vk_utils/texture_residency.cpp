@@ -0,0 +1,536 @@
+
+#include "texture_residency.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/mip_streamer.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // the loader skips levels for the texture mip bias as well as for the global quality settings.
+    uint32_t get_top_level(VkExtent2D file_extent, VkExtent3D image_extent)
+    {
+        const uint32_t file_dimension = std::max(file_extent.width, file_extent.height);
+        const uint32_t image_dimension = std::max(image_extent.width, image_extent.height);
+
+        uint32_t top_level = 0;
+
+        while (std::max(1u, file_dimension >> top_level) > image_dimension) {
+            ++top_level;
+        }
+
+        return top_level;
+    }
+} // namespace
+
+
+vk_utils::texture_residency::~texture_residency()
+{
+    if (m_streamer == nullptr) {
+        return;
+    }
+
+    m_streamer->set_on_level_resident({});
+
+    for (auto& entry : m_textures) {
+        if (entry.alive && entry.state != RESIDENCY_STATE_EVICTED) {
+            m_streamer->cancel(entry.resources.image);
+        }
+    }
+}
+
+
+ERROR_TYPE vk_utils::texture_residency::init(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    mip_streamer* streamer)
+{
+    if (transfer_queue == nullptr || command_pool == nullptr) {
+        RAISE_ERROR_WARN(-1, "invalid texture residency transfer queue or command pool.");
+    }
+
+    m_transfer_queue = transfer_queue;
+    m_transfer_queue_family_index = transfer_queue_family_index;
+    m_command_pool = command_pool;
+    m_streamer = streamer;
+
+    if (m_streamer != nullptr) {
+        m_streamer->set_on_level_resident([this](VkImage image, uint32_t base_level, vk_utils::sampler_handler sampler) {
+            on_level_resident(image, std::move(sampler));
+        });
+    }
+
+    if (!vk_utils::context::get().memory_budget_supported()) {
+        LOG_WARN("VK_EXT_memory_budget is not supported, texture residency uses estimated heap budgets.");
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::texture_residency::set_budget_usage(float budget_usage)
+{
+    m_budget_usage = std::clamp(budget_usage, 0.0f, 1.0f);
+}
+
+
+void vk_utils::texture_residency::set_budget_size(VkDeviceSize budget_size)
+{
+    m_budget_size = budget_size;
+}
+
+
+void vk_utils::texture_residency::set_protected_frames_count(uint32_t frames_count)
+{
+    m_protected_frames_count = std::max(1u, frames_count);
+}
+
+
+void vk_utils::texture_residency::set_min_dimension(uint32_t dimension)
+{
+    m_min_dimension = std::max(1u, dimension);
+}
+
+
+void vk_utils::texture_residency::set_feedback_drop_frames(uint32_t frames_count)
+{
+    m_feedback_drop_frames = std::max(1u, frames_count);
+}
+
+
+void vk_utils::texture_residency::set_on_texture_changed(on_texture_changed_callback callback)
+{
+    m_on_texture_changed = std::move(callback);
+}
+
+
+ERROR_TYPE vk_utils::texture_residency::add_texture(const char* path, const sampler_info& sampler, texture_id& out_id)
+{
+    texture_id id = m_textures.size();
+
+    if (!m_free_ids.empty()) {
+        id = m_free_ids.back();
+        m_free_ids.pop_back();
+    } else {
+        m_textures.emplace_back();
+    }
+
+    auto& entry = m_textures[id];
+    entry.path = path;
+    entry.sampler = sampler;
+    entry.state = RESIDENCY_STATE_EVICTED;
+    entry.last_used_frame = m_frame_index;
+    entry.feedback_level = INT_MAX;
+    entry.coarser_frames = 0;
+    entry.reload_requested = false;
+    entry.alive = true;
+
+    out_id = id;
+
+    PASS_ERROR(get_texture_extent(path, entry.file_extent));
+    PASS_ERROR(load(id));
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::texture_residency::remove_texture(texture_id id)
+{
+    auto& entry = m_textures[id];
+
+    if (!entry.alive) {
+        return;
+    }
+
+    if (entry.state != RESIDENCY_STATE_EVICTED) {
+        retire(entry);
+    }
+
+    entry = texture_entry{};
+    m_free_ids.push_back(id);
+}
+
+
+void vk_utils::texture_residency::use(texture_id id)
+{
+    auto& entry = m_textures[id];
+    entry.last_used_frame = m_frame_index;
+
+    if (entry.state != RESIDENCY_STATE_RESIDENT) {
+        entry.reload_requested = true;
+    }
+}
+
+
+void vk_utils::texture_residency::apply_feedback(texture_id id, int32_t sampled_level)
+{
+    if (id >= m_textures.size() || !m_textures[id].alive) {
+        return;
+    }
+
+    use(id);
+
+    auto& entry = m_textures[id];
+    entry.feedback_level = std::min(entry.feedback_level, sampled_level);
+}
+
+
+const vk_utils::texture_residency::texture& vk_utils::texture_residency::get_texture(texture_id id) const
+{
+    return m_textures[id].resources;
+}
+
+
+vk_utils::texture_residency::residency_state vk_utils::texture_residency::get_state(texture_id id) const
+{
+    return m_textures[id].state;
+}
+
+
+VkDeviceSize vk_utils::texture_residency::get_resident_size() const
+{
+    return m_resident_size;
+}
+
+
+ERROR_TYPE vk_utils::texture_residency::update()
+{
+    const auto allocator = vk_utils::context::get().allocator();
+
+    m_frame_index++;
+    vmaSetCurrentFrameIndex(allocator, static_cast<uint32_t>(m_frame_index));
+
+    m_retired_textures.erase(
+        std::remove_if(m_retired_textures.begin(), m_retired_textures.end(), [](const retired_texture& t) {
+            return vk_utils::context::get().is_completed(t.submission);
+        }),
+        m_retired_textures.end());
+
+    stream_feedback_levels();
+
+    for (texture_id id = 0; id < m_textures.size(); ++id) {
+        if (m_textures[id].alive && m_textures[id].reload_requested) {
+            m_textures[id].reload_requested = false;
+            PASS_ERROR(load(id));
+        }
+    }
+
+    const VkPhysicalDeviceMemoryProperties* memory_props{nullptr};
+    vmaGetMemoryProperties(allocator, &memory_props);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+    vmaGetBudget(allocator, budgets);
+
+    std::vector<VkDeviceSize> heaps_excess(memory_props->memoryHeapCount, 0);
+
+    for (const auto& retired : m_retired_textures) {
+        budgets[retired.heap_index].usage -= std::min(budgets[retired.heap_index].usage, retired.size);
+    }
+
+    bool over_budget = false;
+
+    for (uint32_t heap = 0; heap < memory_props->memoryHeapCount; ++heap) {
+        const auto heap_limit = static_cast<VkDeviceSize>(budgets[heap].budget * m_budget_usage);
+
+        if (budgets[heap].usage > heap_limit) {
+            heaps_excess[heap] = budgets[heap].usage - heap_limit;
+            over_budget = true;
+        }
+    }
+
+    VkDeviceSize budget_excess = 0;
+
+    if (m_budget_size > 0 && m_resident_size > m_budget_size) {
+        budget_excess = m_resident_size - m_budget_size;
+        over_budget = true;
+    }
+
+    if (over_budget) {
+        PASS_ERROR(trim(heaps_excess, budget_excess));
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::texture_residency::load(texture_id id)
+{
+    auto& entry = m_textures[id];
+
+    texture new_resources{};
+
+    PASS_ERROR(load_texture(
+        entry.path.c_str(),
+        m_transfer_queue,
+        m_transfer_queue_family_index,
+        m_command_pool,
+        entry.sampler,
+        new_resources.image,
+        new_resources.image_view,
+        new_resources.sampler,
+        m_streamer));
+
+    if (entry.state != RESIDENCY_STATE_EVICTED) {
+        retire(entry);
+    }
+
+    entry.resources = std::move(new_resources);
+    entry.state = RESIDENCY_STATE_RESIDENT;
+    entry.top_level = get_top_level(entry.file_extent, entry.resources.image.get_create_info().extent);
+    entry.coarser_frames = 0;
+    update_entry_memory(entry);
+
+    if (m_on_texture_changed) {
+        m_on_texture_changed(id, entry.resources);
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::texture_residency::stream_feedback_levels()
+{
+    for (texture_id id = 0; id < m_textures.size(); ++id) {
+        auto& entry = m_textures[id];
+
+        if (!entry.alive || entry.feedback_level == INT_MAX) {
+            continue;
+        }
+
+        const int32_t sampled_level = entry.feedback_level;
+        entry.feedback_level = INT_MAX;
+
+        if (entry.state == RESIDENCY_STATE_EVICTED) {
+            continue;
+        }
+
+        if (sampled_level < 0) {
+            entry.coarser_frames = 0;
+
+            const auto demanded_level = static_cast<uint32_t>(std::max(0, static_cast<int32_t>(entry.top_level) + sampled_level));
+
+            // reloads with the per texture mip bias, the global texture quality still caps the loaded size.
+            if (demanded_level < entry.sampler.quality.mip_bias) {
+                entry.sampler.quality.mip_bias = demanded_level;
+                entry.reload_requested = true;
+            }
+
+            continue;
+        }
+
+        if (sampled_level == 0 || entry.reload_requested) {
+            entry.coarser_frames = 0;
+            continue;
+        }
+
+        if (++entry.coarser_frames < m_feedback_drop_frames) {
+            continue;
+        }
+
+        if (m_streamer != nullptr && m_streamer->contains(entry.resources.image)) {
+            continue;
+        }
+
+        entry.coarser_frames = 0;
+
+        const auto& image_info = entry.resources.image.get_create_info();
+        const uint32_t max_dimension = std::max(image_info.extent.width, image_info.extent.height);
+
+        uint32_t dropped_levels = 0;
+
+        while (dropped_levels < static_cast<uint32_t>(sampled_level)
+               && dropped_levels + 1 < image_info.mipLevels
+               && (max_dimension >> (dropped_levels + 1)) >= m_min_dimension) {
+            dropped_levels++;
+        }
+
+        // the image is still sampled by frames in flight, so it is reloaded at the coarser level and retired
+        // instead of being replaced in place by drop_texture_mips.
+        if (dropped_levels > 0) {
+            entry.sampler.quality.mip_bias = entry.top_level + dropped_levels;
+            entry.reload_requested = true;
+        }
+    }
+}
+
+
+void vk_utils::texture_residency::on_level_resident(VkImage image, vk_utils::sampler_handler sampler)
+{
+    for (texture_id id = 0; id < m_textures.size(); ++id) {
+        auto& entry = m_textures[id];
+
+        if (!entry.alive || entry.state == RESIDENCY_STATE_EVICTED || static_cast<VkImage>(entry.resources.image) != image) {
+            continue;
+        }
+
+        // frames in flight may still sample with the sampler clamped to the previous level.
+        texture retired_resources{};
+        retired_resources.sampler = std::move(entry.resources.sampler);
+        retire_resources(std::move(retired_resources), entry.heap_index, 0);
+
+        entry.resources.sampler = std::move(sampler);
+
+        if (m_on_texture_changed) {
+            m_on_texture_changed(id, entry.resources);
+        }
+
+        return;
+    }
+}
+
+
+ERROR_TYPE vk_utils::texture_residency::trim(std::vector<VkDeviceSize>& heaps_excess, VkDeviceSize& budget_excess)
+{
+    std::vector<texture_id> candidates{};
+
+    for (texture_id id = 0; id < m_textures.size(); ++id) {
+        if (is_trimmable(m_textures[id])) {
+            candidates.push_back(id);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](texture_id l, texture_id r) {
+        return m_textures[l].last_used_frame < m_textures[r].last_used_frame;
+    });
+
+    auto get_excess = [&heaps_excess, &budget_excess](const texture_entry& entry) {
+        return std::max(heaps_excess[entry.heap_index], budget_excess);
+    };
+
+    auto release = [&heaps_excess, &budget_excess](const texture_entry& entry, VkDeviceSize size) {
+        heaps_excess[entry.heap_index] -= std::min(heaps_excess[entry.heap_index], size);
+        budget_excess -= std::min(budget_excess, size);
+    };
+
+    for (const auto id : candidates) {
+        auto& entry = m_textures[id];
+        const VkDeviceSize excess = get_excess(entry);
+
+        if (excess == 0) {
+            continue;
+        }
+
+        const auto& image_info = entry.resources.image.get_create_info();
+        const uint32_t max_dimension = std::max(image_info.extent.width, image_info.extent.height);
+
+        uint32_t dropped_levels = 0;
+
+        while (dropped_levels + 1 < image_info.mipLevels && (max_dimension >> (dropped_levels + 1)) >= m_min_dimension) {
+            dropped_levels++;
+
+            const auto remaining_size = static_cast<VkDeviceSize>(entry.size / std::pow(4.0, dropped_levels));
+
+            if (entry.size - remaining_size >= excess) {
+                break;
+            }
+        }
+
+        if (dropped_levels == 0) {
+            continue;
+        }
+
+        texture new_resources{};
+
+        HANDLE_ERROR(drop_texture_mips(
+            m_transfer_queue,
+            m_transfer_queue_family_index,
+            m_command_pool,
+            entry.sampler,
+            dropped_levels,
+            entry.resources.image,
+            new_resources.image,
+            new_resources.image_view,
+            new_resources.sampler));
+
+        if (static_cast<VkImage>(new_resources.image) == nullptr) {
+            continue;
+        }
+
+        const VkDeviceSize old_size = entry.size;
+
+        retire(entry);
+        entry.resources = std::move(new_resources);
+        entry.state = RESIDENCY_STATE_DEGRADED;
+        entry.top_level += dropped_levels;
+        update_entry_memory(entry);
+        release(entry, old_size > entry.size ? old_size - entry.size : 0);
+
+        if (m_on_texture_changed) {
+            m_on_texture_changed(id, entry.resources);
+        }
+    }
+
+    for (const auto id : candidates) {
+        auto& entry = m_textures[id];
+
+        if (get_excess(entry) == 0) {
+            continue;
+        }
+
+        release(entry, entry.size);
+        retire(entry);
+
+        if (m_on_texture_changed) {
+            m_on_texture_changed(id, entry.resources);
+        }
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::texture_residency::retire(texture_entry& entry)
+{
+    if (m_streamer != nullptr) {
+        m_streamer->cancel(entry.resources.image);
+    }
+
+    retire_resources(std::move(entry.resources), entry.heap_index, entry.size);
+
+    m_resident_size -= entry.size;
+    entry.size = 0;
+    entry.state = RESIDENCY_STATE_EVICTED;
+}
+
+
+void vk_utils::texture_residency::retire_resources(texture resources, uint32_t heap_index, VkDeviceSize size)
+{
+    const auto& ctx = vk_utils::context::get();
+
+    auto& retired = m_retired_textures.emplace_back();
+    retired.resources = std::move(resources);
+    retired.heap_index = heap_index;
+    retired.size = size;
+    retired.submission = ctx.last_submission(ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS));
+}
+
+
+void vk_utils::texture_residency::update_entry_memory(texture_entry& entry)
+{
+    const VkPhysicalDeviceMemoryProperties* memory_props{nullptr};
+    vmaGetMemoryProperties(vk_utils::context::get().allocator(), &memory_props);
+
+    const auto& alloc_info = entry.resources.image.get_alloc_info();
+
+    m_resident_size -= entry.size;
+    entry.size = alloc_info.size;
+    entry.heap_index = memory_props->memoryTypes[alloc_info.memoryType].heapIndex;
+    m_resident_size += entry.size;
+}
+
+
+bool vk_utils::texture_residency::is_trimmable(const texture_entry& entry) const
+{
+    if (!entry.alive || entry.state == RESIDENCY_STATE_EVICTED || entry.reload_requested) {
+        return false;
+    }
+
+    if (entry.last_used_frame + m_protected_frames_count > m_frame_index) {
+        return false;
+    }
+
+    return m_streamer == nullptr || !m_streamer->contains(entry.resources.image);
+}
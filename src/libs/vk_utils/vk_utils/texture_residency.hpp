@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/tools.hpp>
+#include <errors/error_handler.hpp>
+
+#include <climits>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vk_utils
+{
+    class mip_streamer;
+
+    // Keeps file backed textures within the device memory budget.
+    // Under pressure least recently used textures lose their top mips first and are evicted after that,
+    // degraded or evicted textures are reloaded from their files when they are used again.
+    // With sampler feedback the resident top mip follows the level shaders sample: finer levels are reloaded on demand,
+    // levels which are not sampled for a while are dropped.
+    class texture_residency
+    {
+    public:
+        using texture_id = uint32_t;
+
+        enum residency_state
+        {
+            RESIDENCY_STATE_RESIDENT,
+            RESIDENCY_STATE_DEGRADED,
+            RESIDENCY_STATE_EVICTED
+        };
+
+        struct texture
+        {
+            vk_utils::vma_image_handler image{};
+            vk_utils::image_view_handler image_view{};
+            vk_utils::sampler_handler sampler{};
+        };
+
+        // called when texture image was replaced, descriptors which reference the old view or sampler have to be updated.
+        // evicted textures have null image, image view and sampler.
+        using on_texture_changed_callback = std::function<void(texture_id id, const texture& resources)>;
+
+        texture_residency() = default;
+        texture_residency(const texture_residency&) = delete;
+        texture_residency& operator=(const texture_residency&) = delete;
+        ~texture_residency();
+
+        // the streamer streams the residency textures only, their samplers are replaced as streamed levels become resident.
+        ERROR_TYPE init(VkQueue transfer_queue, uint32_t transfer_queue_family_index, VkCommandPool command_pool, mip_streamer* streamer = nullptr);
+
+        // fraction of the heap budget reported by VMA which textures may be kept within.
+        void set_budget_usage(float budget_usage);
+        // explicit limit of resident textures size, 0 means only heap budget is used.
+        void set_budget_size(VkDeviceSize budget_size);
+        // textures used during this amount of last frames are never trimmed, must be not less than frames in flight count.
+        // replaced resources are destroyed once the graphics queue submissions made before their replacement completed.
+        void set_protected_frames_count(uint32_t frames_count);
+        // mips are not dropped below this dimension, textures get evicted instead.
+        void set_min_dimension(uint32_t dimension);
+        // updates during which a texture has to be sampled only at coarser levels before they are dropped.
+        void set_feedback_drop_frames(uint32_t frames_count);
+        void set_on_texture_changed(on_texture_changed_callback callback);
+
+        ERROR_TYPE add_texture(const char* path, const sampler_info& sampler, texture_id& out_id);
+        void remove_texture(texture_id id);
+
+        // marks texture as used by the current frame, not resident textures are scheduled for reload.
+        void use(texture_id id);
+        // marks texture as used and records the level reported by sampler_feedback for its current image,
+        // texture ids have to be used as sampler feedback ids.
+        void apply_feedback(texture_id id, int32_t sampled_level);
+
+        const texture& get_texture(texture_id id) const;
+        residency_state get_state(texture_id id) const;
+        VkDeviceSize get_resident_size() const;
+
+        // should be called once per frame after the previous frame was submitted.
+        ERROR_TYPE update();
+
+    private:
+        struct texture_entry
+        {
+            std::string path{};
+            sampler_info sampler{};
+            texture resources{};
+            residency_state state{RESIDENCY_STATE_EVICTED};
+            uint32_t heap_index{0};
+            VkDeviceSize size{0};
+            uint64_t last_used_frame{0};
+            VkExtent2D file_extent{};
+            // levels skipped from the file top mip by the current image.
+            uint32_t top_level{0};
+            int32_t feedback_level{INT_MAX};
+            uint32_t coarser_frames{0};
+            bool reload_requested{false};
+            bool alive{false};
+        };
+
+        struct retired_texture
+        {
+            texture resources{};
+            uint32_t heap_index{0};
+            VkDeviceSize size{0};
+            // graphics queue submissions which may still sample the resources.
+            submission_token submission{};
+        };
+
+        ERROR_TYPE load(texture_id id);
+        void stream_feedback_levels();
+        void on_level_resident(VkImage image, vk_utils::sampler_handler sampler);
+        ERROR_TYPE trim(std::vector<VkDeviceSize>& heaps_excess, VkDeviceSize& budget_excess);
+        void retire(texture_entry& entry);
+        void retire_resources(texture resources, uint32_t heap_index, VkDeviceSize size);
+        void update_entry_memory(texture_entry& entry);
+        bool is_trimmable(const texture_entry& entry) const;
+
+        VkQueue m_transfer_queue{nullptr};
+        uint32_t m_transfer_queue_family_index{0};
+        VkCommandPool m_command_pool{nullptr};
+        mip_streamer* m_streamer{nullptr};
+
+        float m_budget_usage{0.8f};
+        VkDeviceSize m_budget_size{0};
+        uint32_t m_protected_frames_count{3};
+        uint32_t m_min_dimension{64};
+        uint32_t m_feedback_drop_frames{60};
+
+        on_texture_changed_callback m_on_texture_changed{};
+
+        uint64_t m_frame_index{0};
+        VkDeviceSize m_resident_size{0};
+
+        std::vector<texture_entry> m_textures{};
+        std::vector<texture_id> m_free_ids{};
+        std::vector<retired_texture> m_retired_textures{};
+    };
+} // namespace vk_utils
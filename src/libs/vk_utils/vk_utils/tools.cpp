@@ -2,6 +2,14 @@
 #include "tools.hpp"
 
 #include <vk_utils/context.hpp>
+#include <vk_utils/image_decoder.hpp>
+#include <vk_utils/mapped_file.hpp>
+#include <vk_utils/mip_generator.hpp>
+#include <vk_utils/mip_streamer.hpp>
+#include <vk_utils/pixel_convert.hpp>
+#include <vk_utils/staging_ring.hpp>
+#include <vk_utils/transfer_upload.hpp>
+#include <vk_utils/upload_context.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -12,7 +20,10 @@
 #include <cstring>
 #include <memory>
 #include <algorithm>
+#include <filesystem>
 #include <map>
+#include <numeric>
+#include <string>
 
 namespace
 {
@@ -57,7 +68,51 @@ namespace
 
     #define read_u32 read_struct<uint32_t>
 
-    VkSamplerCreateInfo get_sampler_info(const vk_utils::sampler_info& sampler, uint32_t level_count)
+    bool read_file(const char* path, std::vector<uint8_t>& out_data)
+    {
+        std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(nullptr, [](FILE* f) { fclose(f); });
+        f_handle.reset(fopen(path, "rb"));
+
+        if (f_handle == nullptr) {
+            return false;
+        }
+
+        fseek(f_handle.get(), 0L, SEEK_END);
+        const size_t size = ftell(f_handle.get());
+        fseek(f_handle.get(), 0L, SEEK_SET);
+
+        out_data.resize(size);
+
+        return fread(out_data.data(), 1, size, f_handle.get()) == size;
+    }
+
+    vk_utils::mip_generator* global_mip_generator{nullptr};
+    vk_utils::texture_quality global_texture_quality{};
+    std::string global_texture_cache_directory{};
+    vk_utils::staging_ring* global_staging_ring{nullptr};
+    vk_utils::defragmenter* global_defragmenter{nullptr};
+    vk_utils::upload_context* global_upload_context{nullptr};
+    vk_utils::deletion_queue* global_deletion_queue{nullptr};
+    vk_utils::uniform_pool* global_uniform_pool{nullptr};
+
+    uint32_t get_skipped_levels(const vk_utils::sampler_info& sampler, uint32_t width, uint32_t height, uint32_t level_count)
+    {
+        const uint32_t max_dimension = sampler.quality.max_dimension != 0 ? sampler.quality.max_dimension : global_texture_quality.max_dimension;
+        uint32_t skipped_levels = sampler.quality.mip_bias != 0 ? sampler.quality.mip_bias : global_texture_quality.mip_bias;
+
+        while (max_dimension != 0 && skipped_levels < level_count && std::max(width >> skipped_levels, height >> skipped_levels) > max_dimension) {
+            ++skipped_levels;
+        }
+
+        return level_count == 0 ? 0 : std::min(skipped_levels, level_count - 1);
+    }
+
+    bool use_mip_generator(VkFormat format, uint32_t queue_family_index)
+    {
+        return global_mip_generator != nullptr && global_mip_generator->is_supported(format, queue_family_index);
+    }
+
+    VkSamplerCreateInfo get_sampler_info(const vk_utils::sampler_info& sampler, uint32_t level_count, uint32_t base_level = 0)
     {
         return {
             .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -74,13 +129,160 @@ namespace
             .maxAnisotropy = sampler.max_anisatropy,
             .compareEnable = VK_FALSE,
             .compareOp = VK_COMPARE_OP_NEVER,
-            .minLod = 0,
+            .minLod = static_cast<float>(base_level),
             .maxLod = level_count - 1.0f,
             .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
             .unnormalizedCoordinates = VK_FALSE
         };
     }
 
+    void record_mip_chain_blit(VkCommandBuffer cmd, VkImage image, uint32_t width, uint32_t height, uint32_t base_level, uint32_t end_level, uint32_t layer_count = 1)
+    {
+        VkImageMemoryBarrier mip_gen_barriers{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count,
+            }};
+
+        uint32_t mip_width = width;
+        uint32_t mip_height = height;
+
+        for (uint32_t i = base_level + 1; i < end_level; ++i) {
+            mip_gen_barriers.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            mip_gen_barriers.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            mip_gen_barriers.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            mip_gen_barriers.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            mip_gen_barriers.subresourceRange.baseMipLevel = i - 1;
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &mip_gen_barriers);
+
+            VkImageBlit blit_region{};
+
+            blit_region.srcOffsets[0] = {0, 0, 0};
+            blit_region.srcOffsets[1] = {static_cast<int32_t>(mip_width), static_cast<int32_t>(mip_height), 1};
+
+            blit_region.srcSubresource.baseArrayLayer = 0;
+            blit_region.srcSubresource.layerCount = layer_count;
+            blit_region.srcSubresource.mipLevel = i - 1;
+            blit_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+            mip_width = std::max(1u, mip_width / 2);
+            mip_height = std::max(1u, mip_height / 2);
+
+            blit_region.dstOffsets[0] = {0, 0, 0};
+            blit_region.dstOffsets[1] = {static_cast<int32_t>(mip_width), static_cast<int32_t>(mip_height), 1};
+
+            blit_region.dstSubresource.baseArrayLayer = 0;
+            blit_region.dstSubresource.layerCount = layer_count;
+            blit_region.dstSubresource.mipLevel = i;
+            blit_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+            vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit_region, VK_FILTER_LINEAR);
+        }
+
+        if (end_level - base_level > 1) {
+            mip_gen_barriers.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            mip_gen_barriers.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            mip_gen_barriers.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            mip_gen_barriers.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            mip_gen_barriers.subresourceRange.baseMipLevel = base_level;
+            mip_gen_barriers.subresourceRange.levelCount = end_level - base_level - 1;
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &mip_gen_barriers);
+        }
+
+        mip_gen_barriers.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        mip_gen_barriers.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        mip_gen_barriers.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        mip_gen_barriers.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        mip_gen_barriers.subresourceRange.baseMipLevel = end_level - 1;
+        mip_gen_barriers.subresourceRange.levelCount = 1;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &mip_gen_barriers);
+    }
+
+    void record_levels_layout_transition(
+        VkCommandBuffer cmd,
+        VkImage image,
+        uint32_t base_level,
+        uint32_t level_count,
+        uint32_t layer_count,
+        VkImageLayout old_layout,
+        VkImageLayout new_layout)
+    {
+        const bool to_transfer = new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        const bool from_shader = old_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkImageMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = from_shader ? VK_ACCESS_SHADER_READ_BIT : (to_transfer ? 0u : VK_ACCESS_TRANSFER_WRITE_BIT),
+            .dstAccessMask = to_transfer ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = base_level,
+                .levelCount = level_count,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count,
+            }};
+
+        vkCmdPipelineBarrier(
+            cmd,
+            from_shader ? VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT : (to_transfer ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT),
+            to_transfer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    std::vector<uint8_t> downsample_image(const uint8_t* data, uint32_t width, uint32_t height, uint32_t pixel_size, uint32_t levels)
+    {
+        std::vector<uint8_t> src(data, data + width * height * pixel_size);
+        std::vector<uint8_t> dst{};
+
+        for (uint32_t level = 0; level < levels; ++level) {
+            const uint32_t dst_width = std::max(1u, width / 2);
+            const uint32_t dst_height = std::max(1u, height / 2);
+
+            dst.resize(dst_width * dst_height * pixel_size);
+
+            for (uint32_t y = 0; y < dst_height; ++y) {
+                const uint32_t y0 = std::min(y * 2, height - 1);
+                const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+                for (uint32_t x = 0; x < dst_width; ++x) {
+                    const uint32_t x0 = std::min(x * 2, width - 1);
+                    const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+                    for (uint32_t c = 0; c < pixel_size; ++c) {
+                        const uint32_t sum = src[(y0 * width + x0) * pixel_size + c]
+                                           + src[(y0 * width + x1) * pixel_size + c]
+                                           + src[(y1 * width + x0) * pixel_size + c]
+                                           + src[(y1 * width + x1) * pixel_size + c];
+
+                        dst[(y * dst_width + x) * pixel_size + c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+
+            std::swap(src, dst);
+            width = dst_width;
+            height = dst_height;
+        }
+
+        return src;
+    }
+
     struct vk_format_info
     {
         uint32_t size;
@@ -326,6 +528,91 @@ namespace
 
 }
 
+
+void vk_utils::set_mip_generator(vk_utils::mip_generator* generator)
+{
+    global_mip_generator = generator;
+}
+
+
+void vk_utils::set_texture_quality(const texture_quality& quality)
+{
+    global_texture_quality = quality;
+}
+
+
+const vk_utils::texture_quality& vk_utils::get_texture_quality()
+{
+    return global_texture_quality;
+}
+
+
+void vk_utils::set_texture_cache_directory(const char* directory)
+{
+    global_texture_cache_directory = directory != nullptr ? directory : "";
+}
+
+
+void vk_utils::set_staging_ring(vk_utils::staging_ring* ring)
+{
+    global_staging_ring = ring;
+}
+
+
+vk_utils::staging_ring* vk_utils::get_staging_ring()
+{
+    return global_staging_ring;
+}
+
+
+void vk_utils::set_defragmenter(vk_utils::defragmenter* defragmenter)
+{
+    global_defragmenter = defragmenter;
+}
+
+
+vk_utils::defragmenter* vk_utils::get_defragmenter()
+{
+    return global_defragmenter;
+}
+
+
+void vk_utils::set_upload_context(vk_utils::upload_context* context)
+{
+    global_upload_context = context;
+}
+
+
+vk_utils::upload_context* vk_utils::get_upload_context()
+{
+    return global_upload_context;
+}
+
+
+void vk_utils::set_deletion_queue(vk_utils::deletion_queue* queue)
+{
+    global_deletion_queue = queue;
+}
+
+
+vk_utils::deletion_queue* vk_utils::get_deletion_queue()
+{
+    return global_deletion_queue;
+}
+
+
+void vk_utils::set_uniform_pool(vk_utils::uniform_pool* pool)
+{
+    global_uniform_pool = pool;
+}
+
+
+vk_utils::uniform_pool* vk_utils::get_uniform_pool()
+{
+    return global_uniform_pool;
+}
+
+
 ERROR_TYPE vk_utils::load_texture(
   const char* path, 
   VkQueue transfer_queue, 
@@ -334,7 +621,8 @@ ERROR_TYPE vk_utils::load_texture(
   const sampler_info& sampler, 
   vk_utils::vma_image_handler& out_image, 
   vk_utils::image_view_handler& out_image_view, 
-  vk_utils::sampler_handler& out_image_sampler)
+  vk_utils::sampler_handler& out_image_sampler,
+  vk_utils::mip_streamer* streamer)
 {
     constexpr const char* ktx_formats[] {".ktx", ".ktx2"};
     constexpr const char* stb_formats[] {".png", ".jpg", ".jpeg"};
@@ -344,9 +632,9 @@ ERROR_TYPE vk_utils::load_texture(
     };
 
     if (std::find_if(std::begin(ktx_formats), std::end(ktx_formats), find_cond) != std::end(ktx_formats)) {
-        PASS_ERROR(load_ktx_texture(path, transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_image_view, out_image_sampler));
+        PASS_ERROR(load_ktx_texture(path, transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_image_view, out_image_sampler, streamer));
     } else if (std::find_if(std::begin(stb_formats), std::end(stb_formats), find_cond) != std::end(stb_formats)) {
-        PASS_ERROR(load_texture_2D(path, transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_image_view, out_image_sampler));
+        PASS_ERROR(load_texture_2D(path, transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_image_view, out_image_sampler, true, streamer));
     } else {
         RAISE_ERROR_WARN(-1, "unsupported image type.");
     }
@@ -354,6 +642,204 @@ ERROR_TYPE vk_utils::load_texture(
     RAISE_ERROR_OK();
 }
 
+
+ERROR_TYPE vk_utils::get_texture_extent(const char* path, VkExtent2D& out_extent)
+{
+    if (strstr(path, ".ktx") != nullptr) {
+        std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(nullptr, [](FILE* f) { fclose(f); });
+        f_handle.reset(fopen(path, "rb"));
+
+        ktx2_header header{};
+
+        if (f_handle == nullptr || fread(&header, sizeof(header), 1, f_handle.get()) != 1) {
+            RAISE_ERROR_WARN(-1, "bad ktx file.");
+        }
+
+        out_extent = {header.pixel_width, std::max(1u, header.pixel_height)};
+        RAISE_ERROR_OK();
+    }
+
+    int w{0}, h{0}, c{0};
+
+    if (stbi_info(path, &w, &h, &c) == 0) {
+        RAISE_ERROR_WARN(-1, "unsupported image type.");
+    }
+
+    out_extent = {static_cast<uint32_t>(w), static_cast<uint32_t>(h)};
+
+    RAISE_ERROR_OK();
+}
+
+namespace
+{
+    // bump when the cached data layout or the mips filter changes.
+    constexpr uint32_t texture_cache_version = 1;
+
+    uint64_t hash_bytes(const uint8_t* data, size_t size)
+    {
+        const auto mix = [](uint64_t x) {
+            x ^= x >> 30;
+            x *= 0xBF58476D1CE4E5B9ull;
+            x ^= x >> 27;
+            x *= 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        };
+
+        uint64_t hash = mix(size);
+        size_t i = 0;
+
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = mix(hash ^ word);
+        }
+
+        for (; i < size; ++i) {
+            hash = mix(hash ^ data[i]);
+        }
+
+        return hash;
+    }
+
+    std::string get_texture_cache_path(const std::vector<uint8_t>& file_data, VkFormat format, bool gen_mips)
+    {
+        char name[64]{};
+        snprintf(
+            name,
+            sizeof(name),
+            "%016llx_%u_%u_v%u.ktx2",
+            static_cast<unsigned long long>(hash_bytes(file_data.data(), file_data.size())),
+            static_cast<uint32_t>(format),
+            gen_mips ? 1u : 0u,
+            texture_cache_version);
+
+        return (std::filesystem::path(global_texture_cache_directory) / name).string();
+    }
+
+    bool is_cached_texture_valid(const vk_utils::mapped_file& file, VkFormat format, uint32_t width, uint32_t height)
+    {
+        if (file.size() < sizeof(ktx2_header)) {
+            return false;
+        }
+
+        const uint8_t* begin = file.data();
+        const auto header = read_struct<ktx2_header>(&begin);
+
+        if (std::memcmp(header.identifier, ktx2_identifier, sizeof(ktx2_identifier)) != 0
+            || header.vk_format != static_cast<uint32_t>(format)
+            || header.pixel_width != width
+            || header.pixel_height != height
+            || header.level_count == 0
+            || file.size() < sizeof(ktx2_header) + header.level_count * sizeof(level_index)) {
+            return false;
+        }
+
+        for (uint32_t level = 0; level < header.level_count; ++level) {
+            const auto index = read_struct<level_index>(&begin);
+
+            if (index.byte_offset + index.byte_length > file.size()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // stores the full mips chain as KTX2 with the view swizzle of the texture in KTXswizzle,
+    // levels are filtered on CPU with the same box filter used for skipped and streamed levels.
+    std::vector<uint8_t> create_cached_texture(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels_count, VkFormat format, bool gen_mips)
+    {
+        constexpr const char* swizzles[]{"rrr1", "r00g", "rgb1", "rgba"};
+        constexpr char swizzle_key[] = "KTXswizzle";
+
+        const uint32_t level_count = gen_mips ? get_full_mip_levels(width, height) : 1;
+        const uint32_t level_alignment = std::lcm(channels_count, 4u);
+
+        std::vector<std::vector<uint8_t>> levels_data(level_count);
+        levels_data[0].assign(pixels, pixels + size_t(width) * height * channels_count);
+
+        for (uint32_t level = 1; level < level_count; ++level) {
+            levels_data[level] = downsample_image(
+                levels_data[level - 1].data(), std::max(1u, width >> (level - 1)), std::max(1u, height >> (level - 1)), channels_count, 1);
+        }
+
+        const uint32_t swizzle_size = sizeof(swizzle_key) + strlen(swizzles[channels_count - 1]) + 1;
+        const uint32_t kvd_offset = sizeof(ktx2_header) + level_count * sizeof(level_index);
+        const uint32_t kvd_size = sizeof(uint32_t) + swizzle_size;
+
+        uint64_t data_offset = kvd_offset + kvd_size;
+        std::vector<level_index> levels(level_count);
+
+        // smallest levels go first as in KTX2 files written by other tools.
+        for (uint32_t level = level_count; level > 0; --level) {
+            data_offset = (data_offset + level_alignment - 1) / level_alignment * level_alignment;
+            levels[level - 1] = {
+                .byte_offset = data_offset,
+                .byte_length = levels_data[level - 1].size(),
+                .uncompressed_byte_length = levels_data[level - 1].size(),
+            };
+            data_offset += levels_data[level - 1].size();
+        }
+
+        ktx2_header header{
+            .vk_format = static_cast<uint32_t>(format),
+            .type_size = 1,
+            .pixel_width = width,
+            .pixel_height = height,
+            .pixel_depth = 0,
+            .layer_count = 0,
+            .face_count = 1,
+            .level_count = level_count,
+            .supercompression_scheme = 0,
+            .kvd_byte_offset = kvd_offset,
+            .kvd_byte_length = kvd_size,
+        };
+        std::memcpy(header.identifier, ktx2_identifier, sizeof(ktx2_identifier));
+
+        std::vector<uint8_t> result(data_offset, 0);
+        std::memcpy(result.data(), &header, sizeof(header));
+        std::memcpy(result.data() + sizeof(header), levels.data(), levels.size() * sizeof(level_index));
+        std::memcpy(result.data() + kvd_offset, &swizzle_size, sizeof(swizzle_size));
+        std::memcpy(result.data() + kvd_offset + sizeof(uint32_t), swizzle_key, sizeof(swizzle_key));
+        std::memcpy(result.data() + kvd_offset + sizeof(uint32_t) + sizeof(swizzle_key), swizzles[channels_count - 1], strlen(swizzles[channels_count - 1]));
+
+        for (uint32_t level = 0; level < level_count; ++level) {
+            std::memcpy(result.data() + levels[level].byte_offset, levels_data[level].data(), levels_data[level].size());
+        }
+
+        return result;
+    }
+
+    // written next to the final path and renamed, so concurrent runs never map partially written files.
+    bool write_cached_texture(const std::string& path, const std::vector<uint8_t>& data)
+    {
+        std::error_code error{};
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+        const std::string tmp_path = path + ".tmp";
+
+        {
+            std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(fopen(tmp_path.c_str(), "wb"), [](FILE* f) {if (f != nullptr) fclose(f); });
+
+            if (f_handle == nullptr || fwrite(data.data(), 1, data.size(), f_handle.get()) != data.size()) {
+                f_handle.reset();
+                std::filesystem::remove(tmp_path, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tmp_path, path, error);
+
+        if (error) {
+            std::filesystem::remove(tmp_path, error);
+            return false;
+        }
+
+        return true;
+    }
+} // namespace
+
+
 ERROR_TYPE vk_utils::load_texture_2D(
     const char* path,
     VkQueue transfer_queue,
@@ -363,33 +849,28 @@ ERROR_TYPE vk_utils::load_texture_2D(
     vk_utils::vma_image_handler& out_image,
     vk_utils::image_view_handler& out_image_view,
     vk_utils::sampler_handler& out_image_sampler,
-    bool gen_mips)
+    bool gen_mips,
+    vk_utils::mip_streamer* streamer)
 {
-    int w, h, c;
-    std::unique_ptr<stbi_uc, std::function<void(stbi_uc*)>> image_handler{
-        stbi_load(path, &w, &h, &c, 0),
-        [](stbi_uc* ptr) {if (ptr != nullptr) stbi_image_free(ptr); }};
+    std::vector<uint8_t> file_data{};
 
-    if (image_handler == nullptr) {
+    if (!read_file(path, file_data)) {
         RAISE_ERROR_WARN(-1, "cannot load image.");
     }
 
-    std::vector<uint8_t> rgba_image_buffer;
-    const uint8_t* img_data_ptr = image_handler.get();
+    decoded_image_info image_info{};
+    const image_decoder* decoder = find_image_decoder(file_data.data(), file_data.size(), image_info);
 
-    if (c == STBI_rgb && !check_opt_tiling_format(VK_FORMAT_R8G8B8_SRGB, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) && !check_opt_tiling_format(VK_FORMAT_R8G8B8_UINT, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
-        c = STBI_rgb_alpha;
-
-        rgba_image_buffer.reserve(w * h * 4);
+    if (decoder == nullptr) {
+        RAISE_ERROR_WARN(-1, "cannot decode image.");
+    }
 
-        for (size_t i = 0; i < w * h; ++i) {
-            rgba_image_buffer.push_back(img_data_ptr[i * 3]);
-            rgba_image_buffer.push_back(img_data_ptr[i * 3 + 1]);
-            rgba_image_buffer.push_back(img_data_ptr[i * 3 + 2]);
-            rgba_image_buffer.push_back(255);
-        }
+    const uint32_t w = image_info.width;
+    const uint32_t h = image_info.height;
+    uint32_t c = image_info.channels_count;
 
-        img_data_ptr = rgba_image_buffer.data();
+    if (c == STBI_rgb && !check_opt_tiling_format(VK_FORMAT_R8G8B8_SRGB, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) && !check_opt_tiling_format(VK_FORMAT_R8G8B8_UINT, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        c = STBI_rgb_alpha;
     }
 
     VkFormat fmt{};
@@ -439,12 +920,345 @@ ERROR_TYPE vk_utils::load_texture_2D(
             RAISE_ERROR_WARN(-1, "invalid img format.");
     }
 
-    PASS_ERROR(create_texture_2D(transfer_queue, transfer_queue_family_index, cmd_pool, sampler, w, h, fmt, gen_mips, img_data_ptr, out_image, out_image_view, out_image_sampler));
+    if (!global_texture_cache_directory.empty()) {
+        const std::string cache_path = get_texture_cache_path(file_data, fmt, gen_mips);
+
+        if (vk_utils::mapped_file cached_file{}; cached_file.open(cache_path.c_str()) && is_cached_texture_valid(cached_file, fmt, w, h)) {
+            PASS_ERROR(create_ktx_texture(cached_file.data(), cached_file.size(), transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_image_view, out_image_sampler, streamer));
+            RAISE_ERROR_OK();
+        }
+
+        std::vector<uint8_t> pixels(size_t(w) * h * c);
+
+        if (!decoder->decode(file_data.data(), file_data.size(), c, pixels.data())) {
+            RAISE_ERROR_WARN(-1, "cannot decode image.");
+        }
+
+        const auto cached_texture = create_cached_texture(pixels.data(), w, h, c, fmt, gen_mips);
+
+        if (!write_cached_texture(cache_path, cached_texture)) {
+            LOG_WARN("cannot write texture cache ", cache_path);
+        }
+
+        PASS_ERROR(create_ktx_texture(cached_texture.data(), cached_texture.size(), transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_image_view, out_image_sampler, streamer));
+        RAISE_ERROR_OK();
+    }
+
+    const uint32_t skipped_levels = get_skipped_levels(sampler, w, h, get_full_mip_levels(w, h));
+
+    if ((streamer != nullptr && gen_mips) || skipped_levels > 0) {
+        std::vector<uint8_t> pixels(size_t(w) * h * c);
+
+        if (!decoder->decode(file_data.data(), file_data.size(), c, pixels.data())) {
+            RAISE_ERROR_WARN(-1, "cannot decode image.");
+        }
+
+        PASS_ERROR(create_texture_2D(transfer_queue, transfer_queue_family_index, cmd_pool, sampler, w, h, fmt, gen_mips, pixels.data(), out_image, out_image_view, out_image_sampler, streamer));
+    } else {
+        vk_utils::staging_buffer staging_buffer{};
+        PASS_ERROR(staging_buffer.init(w * h * c, std::lcm(c, 4u), global_staging_ring));
+
+        const bool decoded = decoder->decode(file_data.data(), file_data.size(), c, staging_buffer.get_mapped_data());
+        staging_buffer.flush();
+
+        if (!decoded) {
+            RAISE_ERROR_WARN(-1, "cannot decode image.");
+        }
+
+        PASS_ERROR(create_texture_2D(transfer_queue, transfer_queue_family_index, cmd_pool, sampler, w, h, fmt, gen_mips, std::move(staging_buffer), out_image, out_image_view, out_image_sampler));
+    }
 
     RAISE_ERROR_OK();
 }
 
 
+namespace
+{
+    bool get_texture_2D_layout(VkFormat format, uint32_t& pixel_size, VkComponentMapping& components)
+    {
+        switch (format) {
+            case VK_FORMAT_R8_SRGB:
+                [[fallthrough]];
+            case VK_FORMAT_R8_UINT:
+                pixel_size = 1;
+                components = {
+                    .r = VK_COMPONENT_SWIZZLE_R,
+                    .g = VK_COMPONENT_SWIZZLE_R,
+                    .b = VK_COMPONENT_SWIZZLE_R,
+                    .a = VK_COMPONENT_SWIZZLE_ONE};
+                break;
+            case VK_FORMAT_R8G8_SRGB:
+                [[fallthrough]];
+            case VK_FORMAT_R8G8_UINT:
+                pixel_size = 2;
+                components = {
+                    .r = VK_COMPONENT_SWIZZLE_R,
+                    .g = VK_COMPONENT_SWIZZLE_ZERO,
+                    .b = VK_COMPONENT_SWIZZLE_ZERO,
+                    .a = VK_COMPONENT_SWIZZLE_G};
+                break;
+            case VK_FORMAT_R8G8B8_SRGB:
+                [[fallthrough]];
+            case VK_FORMAT_R8G8B8_UINT:
+                pixel_size = 3;
+                components = {
+                    .r = VK_COMPONENT_SWIZZLE_R,
+                    .g = VK_COMPONENT_SWIZZLE_G,
+                    .b = VK_COMPONENT_SWIZZLE_B,
+                    .a = VK_COMPONENT_SWIZZLE_ONE};
+                break;
+            case VK_FORMAT_R8G8B8A8_SRGB:
+                [[fallthrough]];
+            case VK_FORMAT_R8G8B8A8_UINT:
+                pixel_size = 4;
+                components = {
+                    .r = VK_COMPONENT_SWIZZLE_R,
+                    .g = VK_COMPONENT_SWIZZLE_G,
+                    .b = VK_COMPONENT_SWIZZLE_B,
+                    .a = VK_COMPONENT_SWIZZLE_A};
+                break;
+            default:
+                return false;
+        }
+
+        return true;
+    }
+
+
+    ERROR_TYPE upload_texture_2D(
+        VkQueue transfer_queue,
+        uint32_t transfer_queue_family_index,
+        VkCommandPool command_pool,
+        const vk_utils::sampler_info& sampler,
+        uint32_t width,
+        uint32_t height,
+        VkFormat format,
+        const VkComponentMapping& components,
+        uint32_t mip_levels,
+        uint32_t first_resident_level,
+        bool gen_mips,
+        vk_utils::staging_buffer staging_buffer,
+        vk_utils::staging_buffer tail_staging_buffer,
+        vk_utils::mip_streamer* streamer,
+        vk_utils::vma_image_handler& out_image,
+        vk_utils::image_view_handler& out_image_view,
+        vk_utils::sampler_handler& out_image_sampler)
+    {
+        vk_utils::vma_image_handler image;
+        vk_utils::image_view_handler image_view;
+        vk_utils::sampler_handler image_sampler;
+
+        const uint32_t tail_width = std::max(1u, width >> first_resident_level);
+        const uint32_t tail_height = std::max(1u, height >> first_resident_level);
+
+        VkImageCreateInfo image_info{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = format,
+            .extent = {
+                .width = width,
+                .height = height,
+                .depth = 1},
+            .mipLevels = mip_levels,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 1,
+            .pQueueFamilyIndices = &transfer_queue_family_index,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        const bool compute_mips = gen_mips && staging_buffer.get_buffer() != nullptr && use_mip_generator(format, transfer_queue_family_index);
+
+        if (compute_mips) {
+            image_info.usage |= global_mip_generator->get_image_usage(format);
+            image_info.flags |= global_mip_generator->get_image_create_flags(format);
+        }
+
+        VmaAllocationCreateInfo image_alloc_info{
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY
+        };
+
+        if (const auto e = image.init(vk_utils::context::get().allocator(), &image_info, &image_alloc_info, vk_utils::MEMORY_TAG_TEXTURES); e != VK_SUCCESS) {
+            RAISE_ERROR_WARN(e, "Cannot init image.");
+        }
+
+        VkImageViewCreateInfo img_view_info{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .image = image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = image_info.format,
+            .components = components,
+         
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = mip_levels,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            }
+        };
+
+        if (const auto e = image_view.init(vk_utils::context::get().device(), &img_view_info); e != VK_SUCCESS) {
+            image.destroy();
+            RAISE_ERROR_WARN(e, "Cannot init image view.");
+        }
+
+        VkSamplerCreateInfo sampler_info = get_sampler_info(sampler, mip_levels, first_resident_level);
+
+        if (const auto e = image_sampler.init(vk_utils::context::get().device(), &sampler_info); e != VK_SUCCESS) {
+            image.destroy();
+            image_view.destroy();
+            RAISE_ERROR_WARN(e, "Cannot init sampler.");
+        }
+
+        VkCommandBufferAllocateInfo buffer_alloc_info{};
+        buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buffer_alloc_info.pNext = nullptr;
+        buffer_alloc_info.commandBufferCount = 1;
+        buffer_alloc_info.commandPool = command_pool;
+        buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+        vk_utils::cmd_buffers_handler images_data_transfer_buffer;
+        images_data_transfer_buffer.init(vk_utils::context::get().device(), command_pool, &buffer_alloc_info, 1);
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.pNext = nullptr;
+        begin_info.pInheritanceInfo = nullptr;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vk_utils::mip_generator::recorded_resources mip_generator_resources{};
+
+        vkBeginCommandBuffer(images_data_transfer_buffer[0], &begin_info);
+
+        VkImageMemoryBarrier img_transfer_barrier{};
+        img_transfer_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        img_transfer_barrier.pNext = nullptr;
+        img_transfer_barrier.image = image;
+        img_transfer_barrier.srcAccessMask = 0;
+        img_transfer_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        img_transfer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        img_transfer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        img_transfer_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        img_transfer_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+        img_transfer_barrier.subresourceRange.layerCount = 1;
+        img_transfer_barrier.subresourceRange.baseArrayLayer = 0;
+        img_transfer_barrier.subresourceRange.layerCount = 1;
+        img_transfer_barrier.subresourceRange.baseMipLevel = 0;
+        img_transfer_barrier.subresourceRange.levelCount = mip_levels;
+        img_transfer_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+        vkCmdPipelineBarrier(images_data_transfer_buffer[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &img_transfer_barrier);
+
+        VkBufferImageCopy img_copy{};
+        img_copy.imageExtent = image_info.extent;
+        img_copy.imageOffset = {0, 0, 0};
+        img_copy.bufferRowLength = 0;
+        img_copy.bufferImageHeight = 0;
+        img_copy.bufferOffset = staging_buffer.get_offset();
+        img_copy.imageSubresource.mipLevel = 0;
+        img_copy.imageSubresource.baseArrayLayer = 0;
+        img_copy.imageSubresource.layerCount = 1;
+        img_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+        if (first_resident_level > 0) {
+            VkBufferImageCopy tail_copy = img_copy;
+            tail_copy.imageExtent = {.width = tail_width, .height = tail_height, .depth = 1};
+            tail_copy.bufferOffset = tail_staging_buffer.get_offset();
+            tail_copy.imageSubresource.mipLevel = first_resident_level;
+
+            vkCmdCopyBufferToImage(images_data_transfer_buffer[0], tail_staging_buffer.get_buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &tail_copy);
+
+            if (compute_mips) {
+                PASS_ERROR(global_mip_generator->record(
+                    images_data_transfer_buffer[0], image, format, tail_width, tail_height, first_resident_level, mip_levels, 1, mip_generator_resources));
+            } else {
+                record_mip_chain_blit(images_data_transfer_buffer[0], image, tail_width, tail_height, first_resident_level, mip_levels);
+            }
+
+            record_levels_layout_transition(
+                images_data_transfer_buffer[0], image, 0, first_resident_level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        } else if (gen_mips) {
+            vkCmdCopyBufferToImage(images_data_transfer_buffer[0], staging_buffer.get_buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_copy);
+
+            if (compute_mips) {
+                PASS_ERROR(global_mip_generator->record(images_data_transfer_buffer[0], image, format, width, height, 0, mip_levels, 1, mip_generator_resources));
+            } else {
+                record_mip_chain_blit(images_data_transfer_buffer[0], image, width, height, 0, mip_levels);
+            }
+        } else {
+            vkCmdCopyBufferToImage(images_data_transfer_buffer[0], staging_buffer.get_buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_copy);
+
+            VkImageMemoryBarrier img_barrier{};
+            img_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            img_barrier.pNext = nullptr;
+            img_barrier.image = image;
+            img_barrier.srcAccessMask = 0;
+            img_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            img_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            img_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            img_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            img_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+            img_barrier.subresourceRange.layerCount = 1;
+            img_barrier.subresourceRange.baseArrayLayer = 0;
+            img_barrier.subresourceRange.layerCount = 1;
+            img_barrier.subresourceRange.baseMipLevel = 0;
+            img_barrier.subresourceRange.levelCount = mip_levels;
+            img_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+            vkCmdPipelineBarrier(images_data_transfer_buffer[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &img_barrier);
+        }
+
+        vkEndCommandBuffer(images_data_transfer_buffer[0]);
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = nullptr;
+        submit_info.pCommandBuffers = images_data_transfer_buffer;
+        submit_info.commandBufferCount = 1;
+
+        vk_utils::submission_token submission{};
+        if (const auto e = vk_utils::context::get().submit(transfer_queue, submit_info, submission); e != VK_SUCCESS) {
+            RAISE_ERROR_WARN(e, "cannot submit texture upload.");
+        }
+
+        vk_utils::context::get().wait(submission);
+
+        if (first_resident_level > 0) {
+            const VkImage streamed_image = image;
+            const VkBuffer streamed_buffer = staging_buffer.get_buffer();
+
+            std::vector<vk_utils::mip_streamer::stream_step> steps{};
+            steps.push_back({
+                .level = 0,
+                .record = [=](VkCommandBuffer cmd) {
+                    record_levels_layout_transition(
+                        cmd, streamed_image, 0, first_resident_level, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                    vkCmdCopyBufferToImage(cmd, streamed_buffer, streamed_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_copy);
+                    record_mip_chain_blit(cmd, streamed_image, width, height, 0, first_resident_level);
+                }});
+
+            // streamed uploads always get dedicated staging buffers, the streamer keeps them until the last step is submitted.
+            streamer->enqueue(image, sampler_info, std::move(staging_buffer.get_dedicated_buffer()), std::move(steps));
+        }
+
+        out_image = std::move(image);
+        out_image_view = std::move(image_view);
+        out_image_sampler = std::move(image_sampler);
+
+        RAISE_ERROR_OK();
+    }
+} // namespace
+
+
 ERROR_TYPE vk_utils::create_texture_2D(
     VkQueue transfer_queue,
     uint32_t transfer_queue_family_index,
@@ -457,68 +1271,161 @@ ERROR_TYPE vk_utils::create_texture_2D(
     const void* data,
     vk_utils::vma_image_handler& out_image,
     vk_utils::image_view_handler& out_image_view,
+    vk_utils::sampler_handler& out_image_sampler,
+    vk_utils::mip_streamer* streamer,
+    uint32_t data_channels)
+{
+    uint32_t pixel_size = 0;
+    VkComponentMapping components{};
+
+    if (!get_texture_2D_layout(format, pixel_size, components)) {
+        RAISE_ERROR_FATAL(-1, "unsupported pixels format.");
+    }
+
+    std::vector<uint8_t> converted_data{};
+    const bool convert_data = data != nullptr && data_channels != 0 && data_channels != pixel_size;
+
+    if (convert_data && pixel_size != 4) {
+        RAISE_ERROR_WARN(-1, "pixels can be converted only to 4 channels formats.");
+    }
+
+    const uint32_t skipped_levels = data != nullptr ? get_skipped_levels(sampler, width, height, get_full_mip_levels(width, height)) : 0;
+
+    if (skipped_levels > 0) {
+        if (convert_data) {
+            converted_data.resize(width * height * pixel_size);
+            convert_to_rgba(static_cast<const uint8_t*>(data), data_channels, converted_data.data(), width * height);
+            data = converted_data.data();
+        }
+
+        converted_data = downsample_image(static_cast<const uint8_t*>(data), width, height, pixel_size, skipped_levels);
+        data = converted_data.data();
+        width = std::max(1u, width >> skipped_levels);
+        height = std::max(1u, height >> skipped_levels);
+    }
+
+    const uint32_t mip_levels = gen_mips ? get_full_mip_levels(width, height) : 1;
+    const uint32_t first_resident_level = streamer != nullptr && gen_mips && data != nullptr ? streamer->get_first_resident_level(width, height, mip_levels) : 0;
+
+    vk_utils::staging_buffer staging_buffer{};
+    vk_utils::staging_buffer tail_staging_buffer{};
+    vk_utils::staging_ring* ring = first_resident_level == 0 ? global_staging_ring : nullptr;
+    const uint32_t alignment = std::lcm(pixel_size, 4u);
+
+    if (convert_data && converted_data.empty() && first_resident_level > 0) {
+        converted_data.resize(width * height * pixel_size);
+        convert_to_rgba(static_cast<const uint8_t*>(data), data_channels, converted_data.data(), width * height);
+        data = converted_data.data();
+    }
+
+    if (convert_data && converted_data.empty()) {
+        PASS_ERROR(staging_buffer.init(width * height * pixel_size, alignment, ring));
+        convert_to_rgba(static_cast<const uint8_t*>(data), data_channels, staging_buffer.get_mapped_data(), width * height);
+        staging_buffer.flush();
+    } else if (data != nullptr) {
+        PASS_ERROR(staging_buffer.init(width * height * pixel_size, alignment, ring, data));
+    }
+
+    if (first_resident_level > 0) {
+        const auto tail_data = downsample_image(static_cast<const uint8_t*>(data), width, height, pixel_size, first_resident_level);
+        PASS_ERROR(tail_staging_buffer.init(tail_data.size(), alignment, global_staging_ring, tail_data.data()));
+    }
+
+    PASS_ERROR(upload_texture_2D(
+        transfer_queue,
+        transfer_queue_family_index,
+        command_pool,
+        sampler,
+        width,
+        height,
+        format,
+        components,
+        mip_levels,
+        first_resident_level,
+        gen_mips,
+        std::move(staging_buffer),
+        std::move(tail_staging_buffer),
+        streamer,
+        out_image,
+        out_image_view,
+        out_image_sampler));
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::create_texture_2D(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    const sampler_info& sampler,
+    uint32_t width,
+    uint32_t height,
+    VkFormat format,
+    bool gen_mips,
+    vk_utils::staging_buffer staging_buffer,
+    vk_utils::vma_image_handler& out_image,
+    vk_utils::image_view_handler& out_image_view,
     vk_utils::sampler_handler& out_image_sampler)
 {
-    vk_utils::vma_image_handler image;
-    vk_utils::image_view_handler image_view;
-    vk_utils::sampler_handler image_sampler;
-
-    size_t pixel_size = 1;
-    VkComponentMapping components;
-
-    switch (format) {
-        case VK_FORMAT_R8_SRGB:
-            [[fallthrough]];
-        case VK_FORMAT_R8_UINT:
-            pixel_size = 1;
-            components = {
-                .r = VK_COMPONENT_SWIZZLE_R,
-                .g = VK_COMPONENT_SWIZZLE_R,
-                .b = VK_COMPONENT_SWIZZLE_R,
-                .a = VK_COMPONENT_SWIZZLE_ONE};
-            break;
-        case VK_FORMAT_R8G8_SRGB:
-            [[fallthrough]];
-        case VK_FORMAT_R8G8_UINT:
-            pixel_size = 2;
-            components = {
-                .r = VK_COMPONENT_SWIZZLE_R,
-                .g = VK_COMPONENT_SWIZZLE_ZERO,
-                .b = VK_COMPONENT_SWIZZLE_ZERO,
-                .a = VK_COMPONENT_SWIZZLE_G};
-            break;
-        case VK_FORMAT_R8G8B8_SRGB:
-            [[fallthrough]];
-        case VK_FORMAT_R8G8B8_UINT:
-            pixel_size = 3;
-            components = {
-                .r = VK_COMPONENT_SWIZZLE_R,
-                .g = VK_COMPONENT_SWIZZLE_G,
-                .b = VK_COMPONENT_SWIZZLE_B,
-                .a = VK_COMPONENT_SWIZZLE_ONE};
-            break;
-        case VK_FORMAT_R8G8B8A8_SRGB:
-            [[fallthrough]];
-        case VK_FORMAT_R8G8B8A8_UINT:
-            pixel_size = 4;
-            components = {
-                .r = VK_COMPONENT_SWIZZLE_R,
-                .g = VK_COMPONENT_SWIZZLE_G,
-                .b = VK_COMPONENT_SWIZZLE_B,
-                .a = VK_COMPONENT_SWIZZLE_A};
-            break;
-        default:
-            RAISE_ERROR_FATAL(-1, "unsupported pixels format.");
+    uint32_t pixel_size = 0;
+    VkComponentMapping components{};
+
+    if (!get_texture_2D_layout(format, pixel_size, components)) {
+        RAISE_ERROR_FATAL(-1, "unsupported pixels format.");
     }
 
-    const uint32_t mip_levels = gen_mips ? log2(std::max(width, height)) : 1;
+    const uint32_t mip_levels = gen_mips ? get_full_mip_levels(width, height) : 1;
+
+    PASS_ERROR(upload_texture_2D(
+        transfer_queue,
+        transfer_queue_family_index,
+        command_pool,
+        sampler,
+        width,
+        height,
+        format,
+        components,
+        mip_levels,
+        0,
+        gen_mips,
+        std::move(staging_buffer),
+        {},
+        nullptr,
+        out_image,
+        out_image_view,
+        out_image_sampler));
 
-    vk_utils::vma_buffer_handler staging_buffer{};
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::create_texture_2D_array(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    const sampler_info& sampler,
+    uint32_t width,
+    uint32_t height,
+    uint32_t layers_count,
+    uint32_t mip_levels,
+    VkFormat format,
+    const void* data,
+    vk_utils::vma_image_handler& out_image,
+    vk_utils::image_view_handler& out_image_view,
+    vk_utils::sampler_handler& out_image_sampler)
+{
+    const uint32_t pixel_size = get_format_texel_block_size(format);
 
-    if (data != nullptr) {
-        create_buffer(staging_buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, width * height * pixel_size, data);
+    if (pixel_size == 0 || data == nullptr || layers_count == 0) {
+        RAISE_ERROR_WARN(-1, "invalid texture array data.");
     }
 
+    mip_levels = std::clamp(mip_levels, 1u, get_full_mip_levels(width, height));
+
+    vk_utils::staging_buffer staging_buffer{};
+    PASS_ERROR(staging_buffer.init(width * height * pixel_size * layers_count, std::lcm(pixel_size, 4u), global_staging_ring, data));
+
     VkImageCreateInfo image_info{
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = nullptr,
@@ -530,7 +1437,7 @@ ERROR_TYPE vk_utils::create_texture_2D(
             .height = height,
             .depth = 1},
         .mipLevels = mip_levels,
-        .arrayLayers = 1,
+        .arrayLayers = layers_count,
         .samples = VK_SAMPLE_COUNT_1_BIT,
         .tiling = VK_IMAGE_TILING_OPTIMAL,
         .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
@@ -540,11 +1447,20 @@ ERROR_TYPE vk_utils::create_texture_2D(
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
 
+    const bool compute_mips = mip_levels > 1 && use_mip_generator(format, transfer_queue_family_index);
+
+    if (compute_mips) {
+        image_info.usage |= global_mip_generator->get_image_usage(format);
+        image_info.flags |= global_mip_generator->get_image_create_flags(format);
+    }
+
     VmaAllocationCreateInfo image_alloc_info{
         .usage = VMA_MEMORY_USAGE_GPU_ONLY
     };
 
-    if (const auto e = image.init(vk_utils::context::get().allocator(), &image_info, &image_alloc_info); e != VK_SUCCESS) {
+    vk_utils::vma_image_handler image{};
+
+    if (const auto e = image.init(vk_utils::context::get().allocator(), &image_info, &image_alloc_info, vk_utils::MEMORY_TAG_TEXTURES); e != VK_SUCCESS) {
         RAISE_ERROR_WARN(e, "Cannot init image.");
     }
 
@@ -552,29 +1468,209 @@ ERROR_TYPE vk_utils::create_texture_2D(
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .pNext = nullptr,
         .image = image,
-        .viewType = VK_IMAGE_VIEW_TYPE_2D,
-        .format = image_info.format,
-        .components = components,
-     
+        .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        .format = format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_R,
+            .g = VK_COMPONENT_SWIZZLE_G,
+            .b = VK_COMPONENT_SWIZZLE_B,
+            .a = VK_COMPONENT_SWIZZLE_A},
         .subresourceRange = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
             .baseMipLevel = 0,
             .levelCount = mip_levels,
             .baseArrayLayer = 0,
-            .layerCount = 1,
+            .layerCount = layers_count,
         }
     };
 
+    vk_utils::image_view_handler image_view{};
+
     if (const auto e = image_view.init(vk_utils::context::get().device(), &img_view_info); e != VK_SUCCESS) {
-        image.destroy();
         RAISE_ERROR_WARN(e, "Cannot init image view.");
     }
 
     VkSamplerCreateInfo sampler_info = get_sampler_info(sampler, mip_levels);
 
+    vk_utils::sampler_handler image_sampler{};
+
     if (const auto e = image_sampler.init(vk_utils::context::get().device(), &sampler_info); e != VK_SUCCESS) {
-        image.destroy();
-        image_view.destroy();
+        RAISE_ERROR_WARN(e, "Cannot init sampler.");
+    }
+
+    VkCommandBufferAllocateInfo cmd_buffer_alloc_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    vk_utils::cmd_buffers_handler cmd_buffer{};
+    cmd_buffer.init(vk_utils::context::get().device(), command_pool, &cmd_buffer_alloc_info, 1);
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+
+    vkBeginCommandBuffer(cmd_buffer[0], &begin_info);
+
+    record_levels_layout_transition(cmd_buffer[0], image, 0, mip_levels, layers_count, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    VkBufferImageCopy img_copy{
+        .bufferOffset = staging_buffer.get_offset(),
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = layers_count,
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = image_info.extent,
+    };
+
+    vkCmdCopyBufferToImage(cmd_buffer[0], staging_buffer.get_buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_copy);
+
+    vk_utils::mip_generator::recorded_resources mip_generator_resources{};
+
+    if (compute_mips) {
+        PASS_ERROR(global_mip_generator->record(cmd_buffer[0], image, format, width, height, 0, mip_levels, layers_count, mip_generator_resources));
+    } else {
+        record_mip_chain_blit(cmd_buffer[0], image, width, height, 0, mip_levels, layers_count);
+    }
+
+    vkEndCommandBuffer(cmd_buffer[0]);
+
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = cmd_buffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    vk_utils::submission_token submission{};
+    if (const auto e = vk_utils::context::get().submit(transfer_queue, submit_info, submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit texture upload.");
+    }
+
+    vk_utils::context::get().wait(submission);
+
+    out_image = std::move(image);
+    out_image_view = std::move(image_view);
+    out_image_sampler = std::move(image_sampler);
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::create_image_view(const vk_utils::vma_image_handler& image, vk_utils::image_view_handler& out_image_view)
+{
+    const VkImageCreateInfo& image_info = image.get_create_info();
+
+    VkImageViewType image_view_type = VK_IMAGE_VIEW_TYPE_2D;
+    const bool is_array = (image_info.flags & VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT) != 0 || image_info.arrayLayers > 1;
+
+    if (image_info.imageType == VK_IMAGE_TYPE_3D) {
+        image_view_type = VK_IMAGE_VIEW_TYPE_3D;
+    } else if (image_info.imageType == VK_IMAGE_TYPE_1D) {
+        image_view_type = is_array ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
+    } else if ((image_info.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) != 0) {
+        image_view_type = image_info.arrayLayers > 6 || (image_info.flags & VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT) != 0 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+    } else {
+        image_view_type = is_array ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    }
+
+    VkImageViewCreateInfo img_view_info{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .image = image,
+        .viewType = image_view_type,
+        .format = image_info.format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_R,
+            .g = VK_COMPONENT_SWIZZLE_G,
+            .b = VK_COMPONENT_SWIZZLE_B,
+            .a = VK_COMPONENT_SWIZZLE_A,
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = image_info.mipLevels,
+            .baseArrayLayer = 0,
+            .layerCount = image_info.arrayLayers,
+        }};
+
+    if (const auto e = out_image_view.init(vk_utils::context::get().device(), &img_view_info); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "Cannot init image view.");
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::drop_texture_mips(
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool command_pool,
+    const sampler_info& sampler,
+    uint32_t dropped_levels,
+    const vk_utils::vma_image_handler& image,
+    vk_utils::vma_image_handler& out_image,
+    vk_utils::image_view_handler& out_image_view,
+    vk_utils::sampler_handler& out_image_sampler)
+{
+    if (dropped_levels == 0) {
+        RAISE_ERROR_OK();
+    }
+
+    VkImageCreateInfo image_info = image.get_create_info();
+
+    if (dropped_levels >= image_info.mipLevels) {
+        RAISE_ERROR_WARN(-1, "cannot drop all texture mip levels.");
+    }
+
+    if ((image_info.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0) {
+        RAISE_ERROR_WARN(-1, "texture image cannot be used as transfer source.");
+    }
+
+    image_info.extent = {
+        .width = std::max(1u, image_info.extent.width >> dropped_levels),
+        .height = std::max(1u, image_info.extent.height >> dropped_levels),
+        .depth = std::max(1u, image_info.extent.depth >> dropped_levels),
+    };
+    image_info.mipLevels -= dropped_levels;
+    image_info.queueFamilyIndexCount = 1;
+    image_info.pQueueFamilyIndices = &transfer_queue_family_index;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo image_alloc_info{
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY
+    };
+
+    vk_utils::vma_image_handler new_image{};
+
+    if (const auto e = new_image.init(vk_utils::context::get().allocator(), &image_info, &image_alloc_info, vk_utils::MEMORY_TAG_TEXTURES); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "Cannot init image.");
+    }
+
+    vk_utils::image_view_handler new_image_view{};
+    PASS_ERROR(create_image_view(new_image, new_image_view));
+
+    VkSamplerCreateInfo sampler_info = get_sampler_info(sampler, image_info.mipLevels);
+    vk_utils::sampler_handler new_image_sampler{};
+
+    if (const auto e = new_image_sampler.init(vk_utils::context::get().device(), &sampler_info); e != VK_SUCCESS) {
         RAISE_ERROR_WARN(e, "Cannot init sampler.");
     }
 
@@ -585,8 +1681,8 @@ ERROR_TYPE vk_utils::create_texture_2D(
     buffer_alloc_info.commandPool = command_pool;
     buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-    vk_utils::cmd_buffers_handler images_data_transfer_buffer;
-    images_data_transfer_buffer.init(vk_utils::context::get().device(), command_pool, &buffer_alloc_info, 1);
+    vk_utils::cmd_buffers_handler copy_cmd_buffer;
+    copy_cmd_buffer.init(vk_utils::context::get().device(), command_pool, &buffer_alloc_info, 1);
 
     VkCommandBufferBeginInfo begin_info{};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -594,195 +1690,240 @@ ERROR_TYPE vk_utils::create_texture_2D(
     begin_info.pInheritanceInfo = nullptr;
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    vkBeginCommandBuffer(images_data_transfer_buffer[0], &begin_info);
-
-    VkImageMemoryBarrier img_transfer_barrier{};
-    img_transfer_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    img_transfer_barrier.pNext = nullptr;
-    img_transfer_barrier.image = image;
-    img_transfer_barrier.srcAccessMask = 0;
-    img_transfer_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    img_transfer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    img_transfer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    img_transfer_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    img_transfer_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-
-    img_transfer_barrier.subresourceRange.layerCount = 1;
-    img_transfer_barrier.subresourceRange.baseArrayLayer = 0;
-    img_transfer_barrier.subresourceRange.layerCount = 1;
-    img_transfer_barrier.subresourceRange.baseMipLevel = 0;
-    img_transfer_barrier.subresourceRange.levelCount = mip_levels;
-    img_transfer_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-
-    vkCmdPipelineBarrier(images_data_transfer_buffer[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &img_transfer_barrier);
-
-    VkBufferImageCopy img_copy{};
-    img_copy.imageExtent = image_info.extent;
-    img_copy.imageOffset = {0, 0, 0};
-    img_copy.bufferRowLength = 0;
-    img_copy.bufferImageHeight = 0;
-    img_copy.bufferOffset = 0;
-    img_copy.imageSubresource.mipLevel = 0;
-    img_copy.imageSubresource.baseArrayLayer = 0;
-    img_copy.imageSubresource.layerCount = 1;
-    img_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-
-    vkCmdCopyBufferToImage(images_data_transfer_buffer[0], staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_copy);
-    if (gen_mips) {
-        std::vector<VkImageMemoryBarrier> barriers_list{};
-        barriers_list.reserve(mip_levels + 1);
+    vkBeginCommandBuffer(copy_cmd_buffer[0], &begin_info);
 
-        VkImageMemoryBarrier mip_gen_barriers{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .pNext = nullptr,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = image,
-            .subresourceRange = {
+    VkImageMemoryBarrier copy_barriers[2]{};
+
+    for (auto& barrier : copy_barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = image_info.arrayLayers;
+        barrier.subresourceRange.levelCount = image_info.mipLevels;
+    }
+
+    copy_barriers[0].image = image;
+    copy_barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    copy_barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    copy_barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    copy_barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    copy_barriers[0].subresourceRange.baseMipLevel = dropped_levels;
+
+    copy_barriers[1].image = new_image;
+    copy_barriers[1].srcAccessMask = 0;
+    copy_barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    copy_barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    copy_barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    copy_barriers[1].subresourceRange.baseMipLevel = 0;
+
+    // all commands stages are valid on transfer only queue families as well.
+    vkCmdPipelineBarrier(copy_cmd_buffer[0], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, std::size(copy_barriers), copy_barriers);
+
+    std::vector<VkImageCopy> levels_copies{};
+    levels_copies.reserve(image_info.mipLevels);
+
+    for (uint32_t level = 0; level < image_info.mipLevels; ++level) {
+        levels_copies.push_back({
+            .srcSubresource = {
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .levelCount = 1,
+                .mipLevel = level + dropped_levels,
                 .baseArrayLayer = 0,
-                .layerCount = 1,
-            }};
+                .layerCount = image_info.arrayLayers,
+            },
+            .srcOffset = {0, 0, 0},
+            .dstSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = image_info.arrayLayers,
+            },
+            .dstOffset = {0, 0, 0},
+            .extent = {
+                .width = std::max(1u, image_info.extent.width >> level),
+                .height = std::max(1u, image_info.extent.height >> level),
+                .depth = std::max(1u, image_info.extent.depth >> level),
+            },
+        });
+    }
 
-        uint32_t mip_width = width;
-        uint32_t mip_height = height;
+    vkCmdCopyImage(
+        copy_cmd_buffer[0],
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        new_image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        levels_copies.size(),
+        levels_copies.data());
 
-        for (uint32_t i = 1; i < mip_levels; ++i) {
-            mip_gen_barriers.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            mip_gen_barriers.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            mip_gen_barriers.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            mip_gen_barriers.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            mip_gen_barriers.subresourceRange.baseMipLevel = i - 1;
+    // the source image is sampled by frames in flight until they complete.
+    copy_barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    copy_barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    copy_barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    copy_barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            vkCmdPipelineBarrier(
-                images_data_transfer_buffer[0],
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                0,
-                0,
-                nullptr,
-                0,
-                nullptr,
-                1,
-                &mip_gen_barriers);
+    copy_barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    copy_barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    copy_barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    copy_barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            VkImageBlit blit_region{};
+    vkCmdPipelineBarrier(copy_cmd_buffer[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, std::size(copy_barriers), copy_barriers);
 
-            blit_region.srcOffsets[0].x = 0;
-            blit_region.srcOffsets[0].y = 0;
-            blit_region.srcOffsets[0].z = 0;
-            blit_region.srcOffsets[1].x = mip_width;
-            blit_region.srcOffsets[1].y = mip_height;
-            blit_region.srcOffsets[1].z = 1;
+    vkEndCommandBuffer(copy_cmd_buffer[0]);
 
-            blit_region.srcSubresource.baseArrayLayer = 0;
-            blit_region.srcSubresource.layerCount = 1;
-            blit_region.srcSubresource.mipLevel = i - 1;
-            blit_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = nullptr;
+    submit_info.pCommandBuffers = copy_cmd_buffer;
+    submit_info.commandBufferCount = 1;
 
-            mip_width = std::max(1u, mip_width / 2);
-            mip_height = std::max(1u, mip_height / 2);
+    vk_utils::submission_token submission{};
+    if (const auto e = vk_utils::context::get().submit(transfer_queue, submit_info, submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit texture mips copy.");
+    }
 
-            blit_region.dstOffsets[0].x = 0;
-            blit_region.dstOffsets[0].y = 0;
-            blit_region.dstOffsets[0].z = 0;
-            blit_region.dstOffsets[1].x = mip_width;
-            blit_region.dstOffsets[1].y = mip_height;
-            blit_region.dstOffsets[1].z = 1;
+    vk_utils::context::get().wait(submission);
 
-            blit_region.dstSubresource.baseArrayLayer = 0;
-            blit_region.dstSubresource.layerCount = 1;
-            blit_region.dstSubresource.mipLevel = i;
-            blit_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    out_image = std::move(new_image);
+    out_image_view = std::move(new_image_view);
+    out_image_sampler = std::move(new_image_sampler);
 
-            vkCmdBlitImage(
-                images_data_transfer_buffer[0],
-                image,
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                image,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1,
-                &blit_region,
-                VK_FILTER_LINEAR);
+    RAISE_ERROR_OK();
+}
+
+
+namespace
+{
+    VkQueue get_family_queue(uint32_t queue_family_index)
+    {
+        const auto& ctx = vk_utils::context::get();
+
+        for (const auto type : {vk_utils::context::QUEUE_TYPE_GRAPHICS, vk_utils::context::QUEUE_TYPE_TRANSFER, vk_utils::context::QUEUE_TYPE_COMPUTE}) {
+            if (ctx.queue_family_index(type) == static_cast<int32_t>(queue_family_index) && ctx.queue(type) != nullptr) {
+                return ctx.queue(type);
+            }
         }
-        mip_gen_barriers.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        mip_gen_barriers.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        mip_gen_barriers.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        mip_gen_barriers.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        mip_gen_barriers.subresourceRange.baseMipLevel = 0;
-        mip_gen_barriers.subresourceRange.levelCount = mip_levels - 1;
 
-        vkCmdPipelineBarrier(
-            images_data_transfer_buffer[0],
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-            0,
-            0,
-            nullptr,
-            0,
-            nullptr,
-            1,
-            &mip_gen_barriers);
+        return nullptr;
+    }
 
-        mip_gen_barriers.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        mip_gen_barriers.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        mip_gen_barriers.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        mip_gen_barriers.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        mip_gen_barriers.subresourceRange.baseMipLevel = mip_levels - 1;
-        mip_gen_barriers.subresourceRange.levelCount = 1;
 
-        vkCmdPipelineBarrier(
-            images_data_transfer_buffer[0],
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-            0,
-            0,
-            nullptr,
-            0,
-            nullptr,
-            1,
-            &mip_gen_barriers);
-    } else {
-        VkImageMemoryBarrier img_barrier{};
-        img_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        img_barrier.pNext = nullptr;
-        img_barrier.image = image;
-        img_barrier.srcAccessMask = 0;
-        img_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        img_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        img_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        img_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        img_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // the copy is made visible to every later use of the buffer, create_buffer doesn't know them.
+    void record_buffer_copy(VkCommandBuffer cmd_buffer, VkBuffer src, VkDeviceSize src_offset, VkBuffer dst, VkDeviceSize size)
+    {
+        VkBufferCopy buffer_copy{
+            .srcOffset = src_offset,
+            .dstOffset = 0,
+            .size = size,
+        };
 
-        img_barrier.subresourceRange.layerCount = 1;
-        img_barrier.subresourceRange.baseArrayLayer = 0;
-        img_barrier.subresourceRange.layerCount = 1;
-        img_barrier.subresourceRange.baseMipLevel = 0;
-        img_barrier.subresourceRange.levelCount = mip_levels;
-        img_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        vkCmdCopyBuffer(cmd_buffer, src, dst, 1, &buffer_copy);
 
-        vkCmdPipelineBarrier(images_data_transfer_buffer[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &img_barrier);
+        VkBufferMemoryBarrier buffer_barrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = dst,
+            .offset = 0,
+            .size = size,
+        };
+
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
     }
 
-    vkEndCommandBuffer(images_data_transfer_buffer[0]);
 
-    VkSubmitInfo submit_info{};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.pNext = nullptr;
-    submit_info.pCommandBuffers = images_data_transfer_buffer;
-    submit_info.commandBufferCount = 1;
+    // uploads of the graphics family are batched into the upload context, others are submitted and waited for here.
+    ERROR_TYPE stage_buffer_data(VkBuffer buffer, const void* data, VkDeviceSize size, uint32_t queue_family_index)
+    {
+        const auto& ctx = vk_utils::context::get();
 
-    const auto fence = create_fence();
-    vkQueueSubmit(transfer_queue, 1, &submit_info, fence);
-    vkWaitForFences(vk_utils::context::get().device(), 1, fence, VK_TRUE, UINT64_MAX);
+        if (auto* upload_context = vk_utils::get_upload_context(); upload_context != nullptr && upload_context->get_queue_family_index() == queue_family_index) {
+            VkBuffer staging{nullptr};
+            VkDeviceSize staging_offset{0};
+            VkCommandBuffer cmd_buffer{nullptr};
 
-    out_image = std::move(image);
-    out_image_view = std::move(image_view);
-    out_image_sampler = std::move(image_sampler);
+            PASS_ERROR(upload_context->allocate_staging(size, 4, data, staging, staging_offset));
+            PASS_ERROR(upload_context->get_command_buffer(cmd_buffer));
 
-    RAISE_ERROR_OK();
-}
+            record_buffer_copy(cmd_buffer, staging, staging_offset, buffer, size);
+
+            RAISE_ERROR_OK();
+        }
+
+        const VkQueue queue = get_family_queue(queue_family_index);
+
+        if (queue == nullptr) {
+            RAISE_ERROR_WARN(-1, "no queue to stage buffer data on.");
+        }
+
+        vk_utils::staging_buffer staging_buffer{};
+        PASS_ERROR(staging_buffer.init(size, 4, global_staging_ring, data));
+
+        VkCommandPoolCreateInfo cmd_pool_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = queue_family_index,
+        };
+
+        vk_utils::cmd_pool_handler cmd_pool{};
+
+        if (cmd_pool.init(ctx.device(), &cmd_pool_info) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init buffer upload command pool.");
+        }
+
+        VkCommandBufferAllocateInfo cmd_buffer_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = cmd_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        vk_utils::cmd_buffers_handler cmd_buffer{};
+
+        if (cmd_buffer.init(ctx.device(), cmd_pool, &cmd_buffer_info, 1) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init buffer upload command buffer.");
+        }
+
+        VkCommandBufferBeginInfo begin_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+
+        vkBeginCommandBuffer(cmd_buffer[0], &begin_info);
+        record_buffer_copy(cmd_buffer[0], staging_buffer.get_buffer(), staging_buffer.get_offset(), buffer, size);
+        vkEndCommandBuffer(cmd_buffer[0]);
+
+        VkSubmitInfo submit_info{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = cmd_buffer,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = nullptr,
+        };
+
+        vk_utils::submission_token submission{};
+        if (const auto e = ctx.submit(queue, submit_info, submission); e != VK_SUCCESS) {
+            RAISE_ERROR_WARN(e, "cannot submit buffer upload.");
+        }
+
+        ctx.wait(submission);
+
+        RAISE_ERROR_OK();
+    }
+} // namespace
 
 
 ERROR_TYPE vk_utils::create_buffer(
@@ -791,21 +1932,31 @@ ERROR_TYPE vk_utils::create_buffer(
     VmaMemoryUsage memory_usage,
     uint32_t size,
     const void* data,
-    uint32_t transfer_queue_family)
+    uint32_t transfer_queue_family,
+    memory_tag tag)
 {
+    const uint32_t family_index = transfer_queue_family == -1
+        ? vk_utils::context::get().queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS)
+        : transfer_queue_family;
+
+    // gpu only data is written directly when there is direct write memory left, it is staged otherwise.
+    const bool staged = data != nullptr && memory_usage == VMA_MEMORY_USAGE_GPU_ONLY;
+
+    if (staged && create_direct_write_buffer(out_buffer, buffer_usage, size, family_index, tag)) {
+        std::memcpy(out_buffer.get_alloc_info().pMappedData, data, size);
+        vmaFlushAllocation(vk_utils::context::get().allocator(), out_buffer, 0, VK_WHOLE_SIZE);
+
+        RAISE_ERROR_OK();
+    }
+
     vk_utils::vma_buffer_handler buffer;
 
     VkBufferCreateInfo buffer_info{};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buffer_info.pNext = nullptr;
     buffer_info.size = size;
-    buffer_info.usage = buffer_usage;
+    buffer_info.usage = staged ? buffer_usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT : buffer_usage;
     buffer_info.queueFamilyIndexCount = 1;
-
-    const uint32_t family_index = transfer_queue_family == -1
-        ? vk_utils::context::get().queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS)
-        : transfer_queue_family;
-
     buffer_info.pQueueFamilyIndices = &family_index;
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -813,11 +1964,13 @@ ERROR_TYPE vk_utils::create_buffer(
     alloc_info.usage = memory_usage;
     alloc_info.flags = 0;
 
-    if (const auto err = buffer.init(vk_utils::context::get().allocator(), &buffer_info, &alloc_info); err != VK_SUCCESS) {
+    if (const auto err = buffer.init(vk_utils::context::get().allocator(), &buffer_info, &alloc_info, tag); err != VK_SUCCESS) {
         RAISE_ERROR_WARN(err, "cannot init buffer.");
     }
 
-    if (data != nullptr) {
+    if (staged) {
+        PASS_ERROR(stage_buffer_data(buffer, data, size, family_index));
+    } else if (data != nullptr) {
         void* mapped_data;
         vmaMapMemory(vk_utils::context::get().allocator(), buffer, &mapped_data);
         std::memcpy(mapped_data, data, size);
@@ -835,6 +1988,52 @@ ERROR_TYPE vk_utils::create_buffer(
 }
 
 
+bool vk_utils::create_direct_write_buffer(
+    vk_utils::vma_buffer_handler& out_buffer,
+    VkBufferUsageFlags buffer_usage,
+    VkDeviceSize size,
+    uint32_t queue_family,
+    memory_tag tag)
+{
+    const auto& ctx = vk_utils::context::get();
+
+    if (ctx.direct_write_memory_types() == 0) {
+        return false;
+    }
+
+    const uint32_t family_index = queue_family == -1
+        ? ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS)
+        : queue_family;
+
+    VkBufferCreateInfo buffer_info{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .size = size,
+        .usage = buffer_usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &family_index};
+
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_info.usage = VMA_MEMORY_USAGE_UNKNOWN;
+    alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    alloc_info.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    alloc_info.memoryTypeBits = ctx.direct_write_memory_types();
+
+    vk_utils::vma_buffer_handler buffer;
+
+    if (buffer.init(ctx.allocator(), &buffer_info, &alloc_info, tag) != VK_SUCCESS) {
+        return false;
+    }
+
+    out_buffer = std::move(buffer);
+
+    return true;
+}
+
+
 vk_utils::fence_handler vk_utils::create_fence(VkFenceCreateFlagBits flags)
 {
     VkFenceCreateInfo fence_info{};
@@ -870,13 +2069,36 @@ bool vk_utils::check_opt_tiling_format(VkFormat req_fmt, VkFormatFeatureFlagBits
 }
 
 
-bool vk_utils::check_linear_tiling_format(VkFormat req_fmt, VkFormatFeatureFlagBits features_flags)
+bool vk_utils::check_linear_tiling_format(VkFormat req_fmt, VkFormatFeatureFlagBits features_flags)
+{
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(vk_utils::context::get().gpu(), req_fmt, &props);
+    return props.linearTilingFeatures & features_flags;
+}
+
+
+uint32_t vk_utils::get_format_texel_block_size(VkFormat format)
+{
+    if (const auto it = vk_format_table.find(format); it != vk_format_table.end()) {
+        return it->second.size;
+    }
+
+    return 0;
+}
+
+
+uint32_t vk_utils::get_full_mip_levels(uint32_t width, uint32_t height)
 {
-    VkFormatProperties props;
-    vkGetPhysicalDeviceFormatProperties(vk_utils::context::get().gpu(), req_fmt, &props);
-    return props.linearTilingFeatures & features_flags;
+    uint32_t levels = 1;
+
+    for (uint32_t dimension = std::max(width, height); dimension > 1; dimension >>= 1) {
+        ++levels;
+    }
+
+    return levels;
 }
 
+
 ERROR_TYPE vk_utils::load_shader(
     const char* shader_path,
     vk_utils::shader_module_handler& handle,
@@ -980,7 +2202,8 @@ ERROR_TYPE vk_utils::load_shader(
 ERROR_TYPE vk_utils::create_shader_module(
     const uint32_t* code,
     uint32_t code_size,
-    vk_utils::shader_module_handler& handle)
+    vk_utils::shader_module_handler& handle,
+    vk_utils::host_arena* arena)
 {
     VkShaderModuleCreateInfo shader_module_info{};
     shader_module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -990,7 +2213,11 @@ ERROR_TYPE vk_utils::create_shader_module(
 
     vk_utils::shader_module_handler module;
 
-    if (module.init(vk_utils::context::get().device(), &shader_module_info) != VK_SUCCESS) {
+    const auto res = arena != nullptr
+                         ? module.init(vk_utils::context::get().device(), &shader_module_info, arena->get_callbacks())
+                         : module.init(vk_utils::context::get().device(), &shader_module_info);
+
+    if (res != VK_SUCCESS) {
         RAISE_ERROR_WARN(-1, "cannot create shader module.");
     }
 
@@ -999,336 +2226,516 @@ ERROR_TYPE vk_utils::create_shader_module(
     RAISE_ERROR_OK();
 }
 
-ERROR_TYPE vk_utils::load_ktx_texture(
-  const char* path, 
-  VkQueue transfer_queue,
-  uint32_t transfer_queue_family_index, 
-  VkCommandPool cmd_pool, 
-  const sampler_info& sampler, 
-  vk_utils::vma_image_handler& out_image, 
-  vk_utils::image_view_handler& out_image_view, 
-  vk_utils::sampler_handler& out_image_sampler)
+namespace
 {
-    std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(nullptr, [](FILE* f) { fclose(f); });
-    f_handle.reset(fopen(path, "rb"));
+    using read_bytes_func = std::function<bool(uint64_t offset, uint64_t size, void* dst)>;
 
-    if (f_handle == nullptr) {
-        RAISE_ERROR_WARN(-1, "cannot load texture file.");
-    }
+    // applies the KTXswizzle key value, e.g. "rrr1", to the view components.
+    void read_ktx_swizzle(const std::vector<uint8_t>& kvd, VkComponentMapping& components)
+    {
+        constexpr char swizzle_key[] = "KTXswizzle";
 
-    fseek(f_handle.get(), 0L, SEEK_END);
-    size_t size = ftell(f_handle.get());
-    fseek(f_handle.get(), 0L, SEEK_SET);
+        for (size_t offset = 0; offset + sizeof(uint32_t) <= kvd.size();) {
+            uint32_t entry_size{0};
+            std::memcpy(&entry_size, kvd.data() + offset, sizeof(entry_size));
+            offset += sizeof(uint32_t);
 
-    std::vector<uint8_t> file_data(size);
-    fread(file_data.data(), 1, size, f_handle.get());
+            if (entry_size > kvd.size() - offset) {
+                return;
+            }
 
-    PASS_ERROR(create_ktx_texture(
-      file_data.data(),
-      size,
-      transfer_queue, 
-      transfer_queue_family_index, 
-      cmd_pool, 
-      sampler, 
-      out_image,
-      out_image_view, 
-      out_image_sampler));
+            const char* entry = reinterpret_cast<const char*>(kvd.data() + offset);
+
+            if (entry_size >= sizeof(swizzle_key) + 4 && std::memcmp(entry, swizzle_key, sizeof(swizzle_key)) == 0) {
+                VkComponentSwizzle* swizzles[]{&components.r, &components.g, &components.b, &components.a};
+
+                for (uint32_t i = 0; i < 4; ++i) {
+                    switch (entry[sizeof(swizzle_key) + i]) {
+                        case 'r':
+                            *swizzles[i] = VK_COMPONENT_SWIZZLE_R;
+                            break;
+                        case 'g':
+                            *swizzles[i] = VK_COMPONENT_SWIZZLE_G;
+                            break;
+                        case 'b':
+                            *swizzles[i] = VK_COMPONENT_SWIZZLE_B;
+                            break;
+                        case 'a':
+                            *swizzles[i] = VK_COMPONENT_SWIZZLE_A;
+                            break;
+                        case '0':
+                            *swizzles[i] = VK_COMPONENT_SWIZZLE_ZERO;
+                            break;
+                        case '1':
+                            *swizzles[i] = VK_COMPONENT_SWIZZLE_ONE;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                return;
+            }
 
-    RAISE_ERROR_OK();
-}
+            offset += (entry_size + 3) & ~3u;
+        }
+    }
 
- #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb/stb_image_write.h>
 
-ERROR_TYPE vk_utils::create_ktx_texture(
-    const void* data,
-    size_t data_size,
-    VkQueue transfer_queue,
-    uint32_t transfer_queue_family_index,
-    VkCommandPool cmd_pool,
-    const sampler_info& sampler,
-    vk_utils::vma_image_handler& out_image,
-    vk_utils::image_view_handler& out_img_view,
-    vk_utils::sampler_handler& out_sampler)
-{
+    ERROR_TYPE upload_ktx_texture(
+        const ktx2_header& header,
+        const std::vector<level_index>& levels,
+        const read_bytes_func& read_bytes,
+        VkQueue transfer_queue,
+        uint32_t transfer_queue_family_index,
+        VkCommandPool cmd_pool,
+        const vk_utils::sampler_info& sampler,
+        vk_utils::vma_image_handler& out_image,
+        vk_utils::image_view_handler& out_img_view,
+        vk_utils::sampler_handler& out_sampler,
+        vk_utils::mip_streamer* streamer)
+    {
+        if (strncmp(reinterpret_cast<const char*>(ktx2_identifier), header.identifier, 12) != 0) {
+            RAISE_ERROR_WARN(-1, "bad ktx file.");
+        }
 
-    const uint8_t* header_begin = static_cast<const uint8_t*>(data);
+        if (!vk_utils::check_opt_tiling_format(static_cast<VkFormat>(header.vk_format), VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            RAISE_ERROR_WARN(-1, "unsupported vk format.");
+        }
 
-    const auto header = read_struct<ktx2_header>(&header_begin);
+        vk_utils::vma_image_handler image{};
+        vk_utils::image_view_handler image_view{};
+        vk_utils::sampler_handler image_sampler{};
 
-    auto c = strncmp(reinterpret_cast<const char*>(ktx2_identifier), header.identifier, 12);
+        uint32_t level_count = header.level_count;
+        uint32_t layer_count = header.layer_count == 0 ? 1 : header.layer_count;
 
-    if (c != 0) {
-        RAISE_ERROR_WARN(-1, "bad ktx file.");
-    }
-  
-    if (!check_opt_tiling_format(static_cast<VkFormat>(header.vk_format), VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
-        RAISE_ERROR_WARN(-1, "unsupported vk format.");
-    }
-  
-    vk_utils::vma_image_handler image{};
-    vk_utils::image_view_handler image_view{};
-    vk_utils::sampler_handler image_sampler{};
+        bool gen_mips = false;
 
-    uint32_t level_count = header.level_count;
-    uint32_t layer_count = header.layer_count == 0 ? 1 : header.layer_count;
+        if (level_count == 0) {
+            level_count = get_full_mip_levels(header.pixel_width, header.pixel_height);
+            gen_mips = true;
+        }
 
-    bool gen_mips = false;
+        // the skipped top levels are neither read nor allocated.
+        const uint32_t skipped_levels = gen_mips ? 0 : get_skipped_levels(sampler, header.pixel_width, std::max(1u, header.pixel_height), level_count);
+        const uint32_t pixel_width = std::max(1u, header.pixel_width >> skipped_levels);
+        const uint32_t pixel_height = header.pixel_height == 0 ? 0 : std::max(1u, header.pixel_height >> skipped_levels);
+        const uint32_t pixel_depth = header.pixel_depth == 0 ? 0 : std::max(1u, header.pixel_depth >> skipped_levels);
 
-    if (level_count == 0) {
-        level_count = std::log2(std::max(header.pixel_width, header.pixel_height));
-        gen_mips = true;
-    }
+        level_count -= skipped_levels;
 
-    const auto image_type = header.pixel_depth != 0 ? VK_IMAGE_TYPE_3D : (header.pixel_height != 0 ? VK_IMAGE_TYPE_2D : VK_IMAGE_TYPE_1D);
-    uint32_t flags = 0;
+        const uint32_t first_resident_level = streamer != nullptr && !gen_mips ? streamer->get_first_resident_level(pixel_width, std::max(1u, pixel_height), level_count) : 0;
 
-    if (header.layer_count > 0 && image_type != VK_IMAGE_TYPE_1D) {
-        if (image_type == VK_IMAGE_TYPE_3D) {
-            RAISE_ERROR_WARN(-1, "3D textures cannot be arrays.");
+        const auto image_type = header.pixel_depth != 0 ? VK_IMAGE_TYPE_3D : (header.pixel_height != 0 ? VK_IMAGE_TYPE_2D : VK_IMAGE_TYPE_1D);
+        uint32_t flags = 0;
+
+        if (header.layer_count > 0 && image_type != VK_IMAGE_TYPE_1D) {
+            if (image_type == VK_IMAGE_TYPE_3D) {
+                RAISE_ERROR_WARN(-1, "3D textures cannot be arrays.");
+            }
+
+            flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT;
         }
 
-        flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT;
-    }
+        if (header.face_count == 6) {
+            flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        }
 
-    if (header.face_count == 6) {
-        flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-    }
+        // plain level copies run on the dedicated transfer queue when there is one, the image is handed over to the graphics queue afterwards.
+        // generated mips are blitted and streamed levels are copied on the graphics queue, those uploads stay there.
+        const bool use_transfer_upload = first_resident_level == 0 && !gen_mips && vk_utils::transfer_upload::is_available();
+        vk_utils::transfer_upload upload{};
+        uint32_t image_queue_family_index = transfer_queue_family_index;
 
-    VkImageCreateInfo image_info{
-        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = flags,
-        .imageType = image_type,
-        .format = static_cast<VkFormat>(header.vk_format),
-        .extent = {header.pixel_width, header.pixel_height, header.pixel_depth == 0 ? 1 : header.pixel_depth},
-        .mipLevels = level_count,
-        .arrayLayers = layer_count * header.face_count,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &transfer_queue_family_index,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-    };
+        if (use_transfer_upload) {
+            PASS_ERROR(upload.begin());
+            image_queue_family_index = upload.get_queue_family_index();
+        }
 
-    VmaAllocationCreateInfo alloc_info{
-        .usage = VMA_MEMORY_USAGE_GPU_ONLY
-    };
+        VkImageCreateInfo image_info{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = flags,
+            .imageType = image_type,
+            .format = static_cast<VkFormat>(header.vk_format),
+            .extent = {pixel_width, pixel_height, pixel_depth == 0 ? 1 : pixel_depth},
+            .mipLevels = level_count,
+            .arrayLayers = layer_count * header.face_count,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 1,
+            .pQueueFamilyIndices = &image_queue_family_index,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
 
-    if (auto res = image.init(vk_utils::context::get().allocator(), &image_info, &alloc_info); res != VK_SUCCESS) {
-        RAISE_ERROR_WARN(-1, "cannot init image");
-    }
+        VmaAllocationCreateInfo alloc_info{
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY
+        };
 
-    VkImageViewType image_view_type = VK_IMAGE_VIEW_TYPE_3D;
+        if (auto res = image.init(vk_utils::context::get().allocator(), &image_info, &alloc_info, vk_utils::MEMORY_TAG_TEXTURES); res != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init image");
+        }
 
-    if (image_type == VK_IMAGE_TYPE_3D) {
-        image_view_type = VK_IMAGE_VIEW_TYPE_3D;
-    } else if (image_type == VK_IMAGE_TYPE_1D) {
-        image_view_type = header.layer_count > 0 ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
-    } else {
-        if (header.face_count == 6) {
-            image_view_type = header.layer_count > 0 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+        VkImageViewType image_view_type = VK_IMAGE_VIEW_TYPE_3D;
+
+        if (image_type == VK_IMAGE_TYPE_3D) {
+            image_view_type = VK_IMAGE_VIEW_TYPE_3D;
+        } else if (image_type == VK_IMAGE_TYPE_1D) {
+            image_view_type = header.layer_count > 0 ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
         } else {
-            image_view_type = header.layer_count > 0 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+            if (header.face_count == 6) {
+                image_view_type = header.layer_count > 0 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+            } else {
+                image_view_type = header.layer_count > 0 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+            }
         }
-    }
 
-    VkImageViewCreateInfo image_view_info{
-        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
-        .image = image,
-        .viewType = image_view_type,
-        .format = image_info.format,
-        .components = {
+        VkComponentMapping components{
             .r = VK_COMPONENT_SWIZZLE_R,
             .g = VK_COMPONENT_SWIZZLE_G,
             .b = VK_COMPONENT_SWIZZLE_B,
             .a = VK_COMPONENT_SWIZZLE_A,
-        },
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = level_count,
-            .baseArrayLayer = 0,
-            .layerCount = layer_count * header.face_count,
+        };
+
+        if (header.kvd_byte_length > 0) {
+            std::vector<uint8_t> kvd(header.kvd_byte_length);
+
+            if (read_bytes(header.kvd_byte_offset, kvd.size(), kvd.data())) {
+                read_ktx_swizzle(kvd, components);
+            }
         }
-    };
 
-    if (image_view.init(vk_utils::context::get().device(), &image_view_info) != VK_SUCCESS) {
-        RAISE_ERROR_WARN(-1, "cannot init image view");
-    }
+        VkImageViewCreateInfo image_view_info{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .image = image,
+            .viewType = image_view_type,
+            .format = image_info.format,
+            .components = components,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = level_count,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count * header.face_count,
+            }
+        };
 
-    VkSamplerCreateInfo sampler_info = get_sampler_info(sampler, level_count);
+        if (image_view.init(vk_utils::context::get().device(), &image_view_info) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init image view");
+        }
 
-    if (image_sampler.init(vk_utils::context::get().device(), &sampler_info) != VK_SUCCESS) {
-        RAISE_ERROR_WARN(-1, "cannot init image sampler");
-    }
+        VkSamplerCreateInfo sampler_info = get_sampler_info(sampler, level_count, first_resident_level);
+
+        if (image_sampler.init(vk_utils::context::get().device(), &sampler_info) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init image sampler");
+        }
     
-    uint32_t faces_count = header.face_count;
-    uint32_t level_width = header.pixel_width;
-    uint32_t level_height = header.pixel_height;
-    uint32_t level_depth = header.pixel_depth == 0 ? 1 : header.pixel_depth;
-    uint32_t pixel_size = vk_format_table[static_cast<VkFormat>(header.vk_format)].size;
+        uint32_t faces_count = header.face_count;
+        uint32_t level_width = pixel_width;
+        uint32_t level_height = pixel_height;
+        uint32_t level_depth = pixel_depth == 0 ? 1 : pixel_depth;
+        uint32_t pixel_size = vk_format_table[static_cast<VkFormat>(header.vk_format)].size;
+
+        uint32_t image_size{0};
+
+        std::vector<VkBufferImageCopy> image_copies;
+        image_copies.reserve(level_count * layer_count * faces_count);
 
-    uint32_t image_size{0};
+        std::vector<std::vector<VkBufferImageCopy>> level_copies(level_count);
 
-    std::vector<VkBufferImageCopy> image_copies;
-    image_copies.reserve(level_count * layer_count * faces_count);
+        const uint32_t stored_levels = std::min<uint32_t>(level_count, levels.size() - skipped_levels);
+        uint64_t data_begin = UINT64_MAX;
+        uint64_t data_end = 0;
 
-    auto level_index_begin = header_begin;
-    const uint8_t* data_begin = reinterpret_cast<const uint8_t*>(data);
+        for (uint32_t level = 0; level < stored_levels; ++level) {
+            data_begin = std::min(data_begin, levels[level + skipped_levels].byte_offset);
+            data_end = std::max(data_end, levels[level + skipped_levels].byte_offset + levels[level + skipped_levels].byte_length);
+        }
 
-    for (uint32_t level = 0; level < level_count; ++level) {
-        const auto curr_level_index = read_struct<level_index>(&level_index_begin);
+        for (uint32_t level = 0; level < stored_levels; ++level) {
+            const auto& curr_level_index = levels[level + skipped_levels];
 
-        auto level_size = level_width * level_height * level_depth * pixel_size;
-        auto mip_padding = 4 - level_size & (4 - 1);
+            auto level_size = level_width * level_height * level_depth * pixel_size;
+            auto mip_padding = 4 - level_size & (4 - 1);
                   
-        for (uint32_t layer = 0; layer < layer_count; ++layer) {
-            for (uint32_t face = 0; face < faces_count; ++face) {
-                VkBufferImageCopy curr_copy_info{
-                    .bufferOffset = curr_level_index.byte_offset,
-                    .bufferRowLength = level_width,
-                    .bufferImageHeight = level_height,
-
-                    .imageSubresource = {
-                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                        .mipLevel = level,
+            for (uint32_t layer = 0; layer < layer_count; ++layer) {
+                for (uint32_t face = 0; face < faces_count; ++face) {
+                    VkBufferImageCopy curr_copy_info{
+                        .bufferOffset = curr_level_index.byte_offset - data_begin,
+                        .bufferRowLength = 0,
+                        .bufferImageHeight = 0,
+
+                        .imageSubresource = {
+                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                            .mipLevel = level,
                    
-                        .baseArrayLayer = layer + face,
-                        .layerCount = 1,
-                    },
+                            .baseArrayLayer = layer + face,
+                            .layerCount = 1,
+                        },
 
-                    .imageOffset = {.x = 0, .y = 0, .z = 0},
+                        .imageOffset = {.x = 0, .y = 0, .z = 0},
 
-                    .imageExtent = {.width = level_width, .height = level_height, .depth = level_depth}
-                };
+                        .imageExtent = {.width = level_width, .height = level_height, .depth = level_depth}
+                    };
 
-                image_size += level_width * level_height * level_depth * pixel_size;
+                    image_size += level_width * level_height * level_depth * pixel_size;
 
-                image_copies.emplace_back() = curr_copy_info;
+                    level_copies[level].emplace_back() = curr_copy_info;
+                }
             }
-        }
         
-        image_size += mip_padding;
+            image_size += mip_padding;
 
-        level_width = std::max(1u, level_width / 2u);
-        level_height = std::max(1u, level_height / 2u);
-        level_depth = std::max(1u, level_depth / 2u);
-    }
+            level_width = std::max(1u, level_width / 2u);
+            level_height = std::max(1u, level_height / 2u);
+            level_depth = std::max(1u, level_depth / 2u);
+        }
 
-    VkBufferCreateInfo staging_buffer_info{
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .pNext = nullptr,
-        .size = data_size,
-        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &transfer_queue_family_index
-    };
+        for (uint32_t level = level_count; level > first_resident_level; --level) {
+            image_copies.insert(image_copies.end(), level_copies[level - 1].begin(), level_copies[level - 1].end());
+        }
 
-    VmaAllocationCreateInfo staging_buffer_alloc_info{
-        .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
-    };
+        // streamed levels stay in their staging buffer until the streamer uploads them, so only synchronous uploads use the ring.
+        const uint32_t texel_block_size = std::max(1u, vk_utils::get_format_texel_block_size(static_cast<VkFormat>(header.vk_format)));
+        vk_utils::staging_buffer staging_buffer{};
+        PASS_ERROR(staging_buffer.init(data_end - data_begin, std::lcm(texel_block_size, 4u), first_resident_level == 0 ? global_staging_ring : nullptr));
+
+        if (!read_bytes(data_begin, staging_buffer.get_size(), staging_buffer.get_mapped_data())) {
+            RAISE_ERROR_WARN(-1, "cannot read ktx levels data.");
+        }
 
-    vk_utils::vma_buffer_handler staging_buffer{};
+        staging_buffer.flush();
 
-    if (staging_buffer.init(vk_utils::context::get().allocator(), &staging_buffer_info, &staging_buffer_alloc_info) != VK_SUCCESS) {
-        RAISE_ERROR_WARN(-1, "cannot init staging buffer");
-    }
+        for (auto& copy : image_copies) {
+            copy.bufferOffset += staging_buffer.get_offset();
+        }
 
-    void* staging_buffer_mapped_data{nullptr};
-    if (vmaMapMemory(vk_utils::context::get().allocator(), staging_buffer, &staging_buffer_mapped_data) != VK_SUCCESS) {
-        RAISE_ERROR_WARN(-1, "cannot map vk memory.");
-    }
+        vk_utils::cmd_buffers_handler copy_cmd_buffer{};
+        VkCommandBuffer upload_cmd_buffer = use_transfer_upload ? upload.get_command_buffer() : nullptr;
+
+        if (!use_transfer_upload) {
+            VkCommandBufferAllocateInfo copy_buffer_alloc_info{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .commandPool = cmd_pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                .commandBufferCount = 1
+            };
+
+            copy_cmd_buffer.init(vk_utils::context::get().device(), cmd_pool, &copy_buffer_alloc_info, 1);
+
+            VkCommandBufferBeginInfo copy_buffer_begin_info{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                .pNext = nullptr,
+                .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                .pInheritanceInfo = nullptr,
+            };
+
+            vkBeginCommandBuffer(copy_cmd_buffer[0], &copy_buffer_begin_info);
+            upload_cmd_buffer = copy_cmd_buffer[0];
+        }
 
-    std::memcpy(staging_buffer_mapped_data, data, staging_buffer_info.size);
+            VkImageMemoryBarrier image_barrier{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .pNext = nullptr,
 
-    vk_utils::cmd_buffers_handler copy_cmd_buffer{};
-    VkCommandBufferAllocateInfo copy_buffer_alloc_info{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext = nullptr,
-        .commandPool = cmd_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1
-    };
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+
+                .oldLayout = image_info.initialLayout,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+
+                .image = image,
 
-    copy_cmd_buffer.init(vk_utils::context::get().device(), cmd_pool, &copy_buffer_alloc_info, 1);
+                .subresourceRange = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = level_count,
+                    .baseArrayLayer = 0,
+                    .layerCount = layer_count * faces_count,
+                }
+            };
+
+        vkCmdPipelineBarrier(upload_cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
     
-    VkCommandBufferBeginInfo copy_buffer_begin_info{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = nullptr,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        .pInheritanceInfo = nullptr,
-    };
+        vkCmdCopyBufferToImage(upload_cmd_buffer, staging_buffer.get_buffer(), image, image_barrier.newLayout, image_copies.size(), image_copies.data());
 
-    vkBeginCommandBuffer(copy_cmd_buffer[0], &copy_buffer_begin_info);
+        if (use_transfer_upload) {
+            upload.get_ownership_transfer().add_image(
+                image,
+                image_barrier.subresourceRange,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_SHADER_READ_BIT);
 
-        VkImageMemoryBarrier image_barrier{
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .pNext = nullptr,
+            upload.retain(std::move(staging_buffer));
+            PASS_ERROR(upload.submit(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT));
+        } else {
+            image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            image_barrier.oldLayout = image_barrier.newLayout;
+            image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            vkCmdPipelineBarrier(upload_cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
 
-            .oldLayout = image_info.initialLayout,
-            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            if (vkEndCommandBuffer(upload_cmd_buffer) != VK_SUCCESS) {
+                RAISE_ERROR_WARN(-1, "cannot map write cmd buffer.");
+            }
 
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            VkSubmitInfo submit_info
+            {
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                .pNext = nullptr,
+                .waitSemaphoreCount = 0,
+                .pWaitSemaphores = nullptr,
+                .pWaitDstStageMask = nullptr,
 
-            .image = image,
+                .commandBufferCount = 1,
+                .pCommandBuffers = copy_cmd_buffer,
 
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = level_count,
-                .baseArrayLayer = 0,
-                .layerCount = layer_count * faces_count,
+                .signalSemaphoreCount = 0,
+                .pSignalSemaphores = nullptr,
+            };
+
+            vk_utils::submission_token submission{};
+            if (const auto e = vk_utils::context::get().submit(transfer_queue, submit_info, submission); e != VK_SUCCESS) {
+                RAISE_ERROR_WARN(e, "cannot submit texture upload.");
             }
-        };
 
-    vkCmdPipelineBarrier(copy_cmd_buffer[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
-    
-    vkCmdCopyBufferToImage(copy_cmd_buffer[0], staging_buffer, image, image_barrier.newLayout, image_copies.size(), image_copies.data());
-    
-    image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    image_barrier.oldLayout = image_barrier.newLayout;
-    image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    
-    vkCmdPipelineBarrier(copy_cmd_buffer[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+            vk_utils::context::get().wait(submission);
+        }
+
+        if (first_resident_level > 0) {
+            const VkImage streamed_image = image;
+            const VkBuffer streamed_buffer = staging_buffer.get_buffer();
+            const uint32_t streamed_layers = layer_count * faces_count;
+
+            std::vector<vk_utils::mip_streamer::stream_step> steps{};
+            steps.reserve(first_resident_level);
+
+            for (uint32_t level = first_resident_level; level > 0; --level) {
+                steps.push_back({
+                    .level = level - 1,
+                    .record = [streamed_image, streamed_buffer, streamed_layers, level, copies = std::move(level_copies[level - 1])](VkCommandBuffer cmd) {
+                        record_levels_layout_transition(
+                            cmd, streamed_image, level - 1, 1, streamed_layers, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                        vkCmdCopyBufferToImage(cmd, streamed_buffer, streamed_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copies.size(), copies.data());
+                        record_levels_layout_transition(
+                            cmd, streamed_image, level - 1, 1, streamed_layers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                    }});
+            }
 
-    if (vkEndCommandBuffer(copy_cmd_buffer[0]) != VK_SUCCESS) {
-        RAISE_ERROR_WARN(-1, "cannot map write cmd buffer.");
+            streamer->enqueue(image, sampler_info, std::move(staging_buffer.get_dedicated_buffer()), std::move(steps));
+        }
+
+        out_image = std::move(image);
+        out_img_view = std::move(image_view);
+        out_sampler = std::move(image_sampler);
+
+        RAISE_ERROR_OK();
     }
+} // namespace
 
-    VkSubmitInfo submit_info
-    {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = nullptr,
-        .waitSemaphoreCount = 0,
-        .pWaitSemaphores = nullptr,
-        .pWaitDstStageMask = nullptr,
 
-        .commandBufferCount = 1,
-        .pCommandBuffers = copy_cmd_buffer,
+ERROR_TYPE vk_utils::load_ktx_texture(
+  const char* path, 
+  VkQueue transfer_queue,
+  uint32_t transfer_queue_family_index, 
+  VkCommandPool cmd_pool, 
+  const sampler_info& sampler, 
+  vk_utils::vma_image_handler& out_image, 
+  vk_utils::image_view_handler& out_image_view, 
+  vk_utils::sampler_handler& out_image_sampler,
+  vk_utils::mip_streamer* streamer)
+{
+    std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(nullptr, [](FILE* f) { fclose(f); });
+    f_handle.reset(fopen(path, "rb"));
 
-        .signalSemaphoreCount = 0,
-        .pSignalSemaphores = nullptr,
+    if (f_handle == nullptr) {
+        RAISE_ERROR_WARN(-1, "cannot load texture file.");
+    }
+
+    ktx2_header header{};
+
+    if (fread(&header, sizeof(header), 1, f_handle.get()) != 1) {
+        RAISE_ERROR_WARN(-1, "bad ktx file.");
+    }
+
+    std::vector<level_index> levels(std::max(1u, header.level_count));
+
+    if (fread(levels.data(), sizeof(level_index), levels.size(), f_handle.get()) != levels.size()) {
+        RAISE_ERROR_WARN(-1, "bad ktx file.");
+    }
+
+    const auto read_bytes = [file = f_handle.get()](uint64_t offset, uint64_t size, void* dst) {
+        return fseek(file, offset, SEEK_SET) == 0 && fread(dst, 1, size, file) == size;
     };
 
-    auto fence = create_fence();
+    PASS_ERROR(upload_ktx_texture(
+      header,
+      levels,
+      read_bytes,
+      transfer_queue, 
+      transfer_queue_family_index, 
+      cmd_pool, 
+      sampler, 
+      out_image,
+      out_image_view, 
+      out_image_sampler,
+      streamer));
+
+    RAISE_ERROR_OK();
+}
 
-    vkQueueSubmit(transfer_queue, 1, &submit_info, fence);
-    vkWaitForFences(vk_utils::context::get().device(), 1, fence, VK_TRUE, UINT64_MAX);
+ #define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
 
-    out_image = std::move(image);
-    out_img_view = std::move(image_view);
-    out_sampler = std::move(image_sampler);
+ERROR_TYPE vk_utils::create_ktx_texture(
+    const void* data,
+    size_t data_size,
+    VkQueue transfer_queue,
+    uint32_t transfer_queue_family_index,
+    VkCommandPool cmd_pool,
+    const sampler_info& sampler,
+    vk_utils::vma_image_handler& out_image,
+    vk_utils::image_view_handler& out_img_view,
+    vk_utils::sampler_handler& out_sampler,
+    vk_utils::mip_streamer* streamer)
+{
+    if (data_size < sizeof(ktx2_header)) {
+        RAISE_ERROR_WARN(-1, "bad ktx file.");
+    }
+
+    const uint8_t* header_begin = static_cast<const uint8_t*>(data);
+
+    const auto header = read_struct<ktx2_header>(&header_begin);
+    std::vector<level_index> levels(std::max(1u, header.level_count));
+
+    if (data_size < sizeof(ktx2_header) + levels.size() * sizeof(level_index)) {
+        RAISE_ERROR_WARN(-1, "bad ktx file.");
+    }
+
+    std::memcpy(levels.data(), header_begin, levels.size() * sizeof(level_index));
+
+    const auto read_bytes = [data, data_size](uint64_t offset, uint64_t size, void* dst) {
+        if (offset + size > data_size) {
+            return false;
+        }
+
+        std::memcpy(dst, static_cast<const uint8_t*>(data) + offset, size);
+        return true;
+    };
+
+    PASS_ERROR(upload_ktx_texture(header, levels, read_bytes, transfer_queue, transfer_queue_family_index, cmd_pool, sampler, out_image, out_img_view, out_sampler, streamer));
 
     RAISE_ERROR_OK();
 }
\ No newline at end of file
@@ -1,18 +1,68 @@
 #pragma once
 
 #include <vk_utils/handlers.hpp>
+#include <vk_utils/defragmenter.hpp>
+#include <vk_utils/staging_ring.hpp>
 #include <errors/error_handler.hpp>
 
 
 namespace vk_utils
 {
+    class mip_streamer;
+    class mip_generator;
+    class upload_context;
+    class deletion_queue;
+    class uniform_pool;
+
+    struct texture_quality
+    {
+        // top mips of textures larger than max_dimension are skipped on load, 0 keeps the full resolution.
+        uint32_t max_dimension = 0;
+        // count of top mips always skipped on load.
+        uint32_t mip_bias = 0;
+    };
+
     struct sampler_info
     {
         bool tiled = false;
         VkFilter fitering = VK_FILTER_LINEAR;
         float max_anisatropy = 0;
+        // per load quality, its non zero fields override the global ones.
+        texture_quality quality{};
     };
 
+    void set_texture_quality(const texture_quality& quality);
+    const texture_quality& get_texture_quality();
+
+    // textures mips are generated with the compute shader generator when it supports the format, with blits otherwise.
+    void set_mip_generator(vk_utils::mip_generator* generator);
+
+    // png/jpg textures are cached in the directory as KTX2 files with their mips, keyed by the file content, format and options.
+    // cached files are memory mapped and uploaded directly on later loads, an empty directory disables the cache.
+    void set_texture_cache_directory(const char* directory);
+
+    // synchronous uploads sub-allocate their staging memory from the ring instead of creating a buffer per upload,
+    // uploads which do not fit fall back to dedicated buffers. nullptr disables the ring.
+    void set_staging_ring(vk_utils::staging_ring* ring);
+    vk_utils::staging_ring* get_staging_ring();
+
+    // long living device local resources register themselves for defragmentation when a defragmenter is set.
+    void set_defragmenter(vk_utils::defragmenter* defragmenter);
+    vk_utils::defragmenter* get_defragmenter();
+
+    // loaders and builders without an explicit command buffer record their uploads into the context when it is set,
+    // the app flushes it before every frame submission.
+    void set_upload_context(vk_utils::upload_context* context);
+    vk_utils::upload_context* get_upload_context();
+
+    // objects replaced at runtime are retired into the queue when it is set instead of waiting for the device.
+    void set_deletion_queue(vk_utils::deletion_queue* queue);
+    vk_utils::deletion_queue* get_deletion_queue();
+
+    // uniform data of all objects is sub-allocated from the pool, the app flushes it once per frame.
+    void set_uniform_pool(vk_utils::uniform_pool* pool);
+    vk_utils::uniform_pool* get_uniform_pool();
+
     ERROR_TYPE load_texture(
       const char*, 
       VkQueue transfer_queue, 
@@ -21,7 +71,11 @@ namespace vk_utils
       const sampler_info& sampler, 
       vk_utils::vma_image_handler& out_image, 
       vk_utils::image_view_handler& out_image_view, 
-      vk_utils::sampler_handler& out_image_sampler);
+      vk_utils::sampler_handler& out_image_sampler,
+      vk_utils::mip_streamer* streamer = nullptr);
+
+    // top level size stored in a texture file, read without loading the texture.
+    ERROR_TYPE get_texture_extent(const char* path, VkExtent2D& out_extent);
 
     ERROR_TYPE load_texture_2D(
         const char*,
@@ -32,8 +86,26 @@ namespace vk_utils
         vk_utils::vma_image_handler& out_image,
         vk_utils::image_view_handler& out_image_view,
         vk_utils::sampler_handler& out_image_sampler,
-        bool gen_mips = true);
+        bool gen_mips = true,
+        vk_utils::mip_streamer* streamer = nullptr);
+
+    ERROR_TYPE create_texture_2D(
+        VkQueue transfer_queue,
+        uint32_t transfer_queue_family_index,
+        VkCommandPool command_pool,
+        const sampler_info& sampler,
+        uint32_t width,
+        uint32_t height,
+        VkFormat format,
+        bool gen_mips,
+        const void* data,
+        vk_utils::vma_image_handler& out_image,
+        vk_utils::image_view_handler& out_image_view,
+        vk_utils::sampler_handler& out_image_sampler,
+        vk_utils::mip_streamer* streamer = nullptr,
+        uint32_t data_channels = 0);
 
+    // takes the pixels from a staging buffer holding width * height texels of format.
     ERROR_TYPE create_texture_2D(
         VkQueue transfer_queue,
         uint32_t transfer_queue_family_index,
@@ -43,28 +115,73 @@ namespace vk_utils
         uint32_t height,
         VkFormat format,
         bool gen_mips,
+        vk_utils::staging_buffer staging_buffer,
+        vk_utils::vma_image_handler& out_image,
+        vk_utils::image_view_handler& out_image_view,
+        vk_utils::sampler_handler& out_image_sampler);
+
+    ERROR_TYPE create_texture_2D_array(
+        VkQueue transfer_queue,
+        uint32_t transfer_queue_family_index,
+        VkCommandPool command_pool,
+        const sampler_info& sampler,
+        uint32_t width,
+        uint32_t height,
+        uint32_t layers_count,
+        uint32_t mip_levels,
+        VkFormat format,
         const void* data,
         vk_utils::vma_image_handler& out_image,
         vk_utils::image_view_handler& out_image_view,
         vk_utils::sampler_handler& out_image_sampler);
 
+    // color view over all mips and layers, the view type is deduced from the image create info.
+    ERROR_TYPE create_image_view(const vk_utils::vma_image_handler& image, vk_utils::image_view_handler& out_image_view);
+
+    // copies the remaining levels into a new image, the source image is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    // and has to be kept alive by the caller until frames sampling it completed.
+    ERROR_TYPE drop_texture_mips(
+        VkQueue transfer_queue,
+        uint32_t transfer_queue_family_index,
+        VkCommandPool command_pool,
+        const sampler_info& sampler,
+        uint32_t dropped_levels,
+        const vk_utils::vma_image_handler& image,
+        vk_utils::vma_image_handler& out_image,
+        vk_utils::image_view_handler& out_image_view,
+        vk_utils::sampler_handler& out_image_sampler);
+
+    // gpu only buffers with data are placed into host visible device local memory when there is some left,
+    // otherwise the data is staged: copies on the upload context family go to its next flush, others are waited for.
     ERROR_TYPE create_buffer(
         vk_utils::vma_buffer_handler& buffer,
         VkBufferUsageFlags buffer_usage,
         VmaMemoryUsage memory_usage,
         uint32_t size,
         const void* data = nullptr,
-        uint32_t transfer_queue_family = -1);
+        uint32_t transfer_queue_family = -1,
+        memory_tag tag = MEMORY_TAG_UNTAGGED);
+
+    // persistently mapped device local buffer written by the host without staging.
+    // returns false when the device has no such memory or it is exhausted.
+    bool create_direct_write_buffer(
+        vk_utils::vma_buffer_handler& buffer,
+        VkBufferUsageFlags buffer_usage,
+        VkDeviceSize size,
+        uint32_t queue_family = -1,
+        memory_tag tag = MEMORY_TAG_UNTAGGED);
 
     ERROR_TYPE load_shader(
         const char* shader_path,
         vk_utils::shader_module_handler& handle,
         VkShaderStageFlagBits& stage);
 
+    // modules only used to create pipelines may be allocated from an arena outliving them.
     ERROR_TYPE create_shader_module(
         const uint32_t* code,
         uint32_t code_size,
-        vk_utils::shader_module_handler& handle);
+        vk_utils::shader_module_handler& handle,
+        vk_utils::host_arena* arena = nullptr);
 
     vk_utils::fence_handler create_fence(VkFenceCreateFlagBits flags = static_cast<VkFenceCreateFlagBits>(0));
     vk_utils::semaphore_handler create_semaphore();
@@ -72,6 +189,10 @@ namespace vk_utils
     bool check_opt_tiling_format(VkFormat req_fmt, VkFormatFeatureFlagBits features_flags);
     bool check_linear_tiling_format(VkFormat req_fmt, VkFormatFeatureFlagBits features_flags);
 
+    uint32_t get_format_texel_block_size(VkFormat format);
+    // levels of a full mip chain down to 1x1.
+    uint32_t get_full_mip_levels(uint32_t width, uint32_t height);
+
     ERROR_TYPE load_ktx_texture(
         const char* path,
         VkQueue transfer_queue,
@@ -80,7 +201,8 @@ namespace vk_utils
         const sampler_info& sampler,
         vk_utils::vma_image_handler& out_image,
         vk_utils::image_view_handler& out_image_view,
-        vk_utils::sampler_handler& out_image_sampler);
+        vk_utils::sampler_handler& out_image_sampler,
+        vk_utils::mip_streamer* streamer = nullptr);
 
     ERROR_TYPE create_ktx_texture(
         const void* data,
@@ -91,5 +213,6 @@ namespace vk_utils
         const sampler_info& sampler,
         vk_utils::vma_image_handler& out_image,
         vk_utils::image_view_handler& out_image_view,
-        vk_utils::sampler_handler& out_image_sampler);
+        vk_utils::sampler_handler& out_image_sampler,
+        vk_utils::mip_streamer* streamer = nullptr);
 }
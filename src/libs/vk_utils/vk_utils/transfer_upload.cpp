@@ -0,0 +1,422 @@
+
+#include "transfer_upload.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/deletion_queue.hpp>
+#include <vk_utils/tools.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    ERROR_TYPE init_command_pool(uint32_t queue_family_index, vk_utils::cmd_pool_handler& out_pool)
+    {
+        VkCommandPoolCreateInfo cmd_pool_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = queue_family_index,
+        };
+
+        if (out_pool.init(vk_utils::context::get().device(), &cmd_pool_info) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init upload command pool.");
+        }
+
+        RAISE_ERROR_OK();
+    }
+
+
+    VkResult init_command_buffer(VkCommandPool pool, vk_utils::cmd_buffers_handler& out_buffer)
+    {
+        VkCommandBufferAllocateInfo cmd_buffer_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        return out_buffer.init(vk_utils::context::get().device(), pool, &cmd_buffer_info, 1);
+    }
+
+
+    // the pools are created with the reset command buffer flag, beginning resets the recycled buffers.
+    VkResult begin_command_buffer(VkCommandBuffer cmd_buffer)
+    {
+        VkCommandBufferBeginInfo begin_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+
+        return vkBeginCommandBuffer(cmd_buffer, &begin_info);
+    }
+} // namespace
+
+
+vk_utils::queue_ownership_transfer::queue_ownership_transfer(uint32_t src_queue_family_index, uint32_t dst_queue_family_index)
+    : m_src_queue_family_index(src_queue_family_index)
+    , m_dst_queue_family_index(dst_queue_family_index)
+{
+}
+
+
+bool vk_utils::queue_ownership_transfer::is_required() const
+{
+    return m_src_queue_family_index != m_dst_queue_family_index;
+}
+
+
+bool vk_utils::queue_ownership_transfer::empty() const
+{
+    return m_buffer_barriers.empty() && m_image_barriers.empty();
+}
+
+
+uint32_t vk_utils::queue_ownership_transfer::get_src_queue_family_index() const
+{
+    return m_src_queue_family_index;
+}
+
+
+uint32_t vk_utils::queue_ownership_transfer::get_dst_queue_family_index() const
+{
+    return m_dst_queue_family_index;
+}
+
+
+void vk_utils::queue_ownership_transfer::add_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkAccessFlags src_access, VkAccessFlags dst_access)
+{
+    if (!is_required()) {
+        return;
+    }
+
+    m_buffer_barriers.push_back({
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .srcQueueFamilyIndex = m_src_queue_family_index,
+        .dstQueueFamilyIndex = m_dst_queue_family_index,
+        .buffer = buffer,
+        .offset = offset,
+        .size = size,
+    });
+}
+
+
+void vk_utils::queue_ownership_transfer::add_image(
+    VkImage image,
+    const VkImageSubresourceRange& range,
+    VkImageLayout old_layout,
+    VkImageLayout new_layout,
+    VkAccessFlags src_access,
+    VkAccessFlags dst_access)
+{
+    if (!is_required()) {
+        return;
+    }
+
+    m_image_barriers.push_back({
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = new_layout,
+        .srcQueueFamilyIndex = m_src_queue_family_index,
+        .dstQueueFamilyIndex = m_dst_queue_family_index,
+        .image = image,
+        .subresourceRange = range,
+    });
+}
+
+
+void vk_utils::queue_ownership_transfer::record_release(VkCommandBuffer cmd, VkPipelineStageFlags src_stages) const
+{
+    if (empty()) {
+        return;
+    }
+
+    // destination access masks are ignored by release barriers.
+    auto buffer_barriers = m_buffer_barriers;
+    auto image_barriers = m_image_barriers;
+
+    for (auto& barrier : buffer_barriers) {
+        barrier.dstAccessMask = 0;
+    }
+
+    for (auto& barrier : image_barriers) {
+        barrier.dstAccessMask = 0;
+    }
+
+    vkCmdPipelineBarrier(
+        cmd,
+        src_stages,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        buffer_barriers.size(),
+        buffer_barriers.data(),
+        image_barriers.size(),
+        image_barriers.data());
+}
+
+
+void vk_utils::queue_ownership_transfer::record_acquire(VkCommandBuffer cmd, VkPipelineStageFlags dst_stages) const
+{
+    if (empty()) {
+        return;
+    }
+
+    // source access masks are ignored by acquire barriers, the writes were made available by the release ones.
+    // the source stages are the stages the submission waits on the source queue timeline at, so the transfer
+    // and the layout transition chain with that wait and run after the copies.
+    auto buffer_barriers = m_buffer_barriers;
+    auto image_barriers = m_image_barriers;
+
+    for (auto& barrier : buffer_barriers) {
+        barrier.srcAccessMask = 0;
+    }
+
+    for (auto& barrier : image_barriers) {
+        barrier.srcAccessMask = 0;
+    }
+
+    vkCmdPipelineBarrier(
+        cmd,
+        dst_stages,
+        dst_stages,
+        0,
+        0,
+        nullptr,
+        buffer_barriers.size(),
+        buffer_barriers.data(),
+        image_barriers.size(),
+        image_barriers.data());
+}
+
+
+void vk_utils::queue_ownership_transfer::clear()
+{
+    m_buffer_barriers.clear();
+    m_image_barriers.clear();
+}
+
+
+bool vk_utils::transfer_upload::is_available()
+{
+    const auto& ctx = vk_utils::context::get();
+    const int32_t transfer_family = ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_TRANSFER);
+
+    return transfer_family >= 0 &&
+           transfer_family != ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS) &&
+           ctx.queue(vk_utils::context::QUEUE_TYPE_TRANSFER) != nullptr;
+}
+
+
+vk_utils::transfer_upload::~transfer_upload()
+{
+    // an upload which was never submitted gives its command buffers back right away.
+    if (m_command_buffers != nullptr) {
+        m_command_buffers->recording = false;
+    }
+}
+
+
+ERROR_TYPE vk_utils::transfer_upload::begin()
+{
+    const auto& ctx = vk_utils::context::get();
+
+    m_ownership_transfer = queue_ownership_transfer{
+        static_cast<uint32_t>(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_TRANSFER)),
+        static_cast<uint32_t>(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS))};
+
+    PASS_ERROR(acquire_command_buffers(m_command_buffers));
+
+    if (begin_command_buffer(m_command_buffers->transfer[0]) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot begin upload command buffer.");
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::transfer_upload::submit(VkPipelineStageFlags dst_stages, submission_token& out_submission)
+{
+    const auto& ctx = vk_utils::context::get();
+    auto& buffers = *m_command_buffers;
+
+    m_ownership_transfer.record_release(buffers.transfer[0], VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    if (vkEndCommandBuffer(buffers.transfer[0]) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot end upload command buffer.");
+    }
+
+    const bool acquire = !m_ownership_transfer.empty();
+    const auto transfer_queue = ctx.queue(vk_utils::context::QUEUE_TYPE_TRANSFER);
+    const auto graphics_queue = ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS);
+
+    VkSubmitInfo transfer_submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = buffers.transfer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    vk_utils::submission_token transfer_submission{};
+    if (const auto e = ctx.submit(transfer_queue, transfer_submit_info, transfer_submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit upload.");
+    }
+
+    if (!acquire) {
+        finish(transfer_submission);
+        out_submission = transfer_submission;
+        RAISE_ERROR_OK();
+    }
+
+    if (begin_command_buffer(buffers.graphics[0]) != VK_SUCCESS) {
+        ctx.wait(transfer_submission);
+        finish(transfer_submission);
+        RAISE_ERROR_WARN(-1, "cannot begin upload acquire command buffer.");
+    }
+
+    m_ownership_transfer.record_acquire(buffers.graphics[0], dst_stages);
+    vkEndCommandBuffer(buffers.graphics[0]);
+
+    const VkSemaphore transfer_timeline = ctx.timeline_semaphore(transfer_queue);
+
+    VkTimelineSemaphoreSubmitInfo timeline_info{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &transfer_submission.value,
+        .signalSemaphoreValueCount = 0,
+        .pSignalSemaphoreValues = nullptr,
+    };
+
+    // the acquire barriers run before the first stage reading the resources, nothing earlier waits on the copy.
+    VkSubmitInfo graphics_submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &transfer_timeline,
+        .pWaitDstStageMask = &dst_stages,
+        .commandBufferCount = 1,
+        .pCommandBuffers = buffers.graphics,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    vk_utils::submission_token graphics_submission{};
+    if (const auto e = ctx.submit(graphics_queue, graphics_submit_info, graphics_submission); e != VK_SUCCESS) {
+        ctx.wait(transfer_submission);
+        finish(transfer_submission);
+        RAISE_ERROR_WARN(e, "cannot submit upload acquire.");
+    }
+
+    // the acquire submission waited on the copy, its completion covers both queues.
+    finish(graphics_submission);
+    out_submission = graphics_submission;
+
+    m_ownership_transfer.clear();
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::transfer_upload::submit(VkPipelineStageFlags dst_stages)
+{
+    submission_token submission{};
+    PASS_ERROR(submit(dst_stages, submission));
+    RAISE_ERROR_OK();
+}
+
+
+VkCommandBuffer vk_utils::transfer_upload::get_command_buffer()
+{
+    return m_transfer_command_buffer[0];
+}
+
+
+uint32_t vk_utils::transfer_upload::get_queue_family_index() const
+{
+    return m_ownership_transfer.get_src_queue_family_index();
+}
+
+
+vk_utils::queue_ownership_transfer& vk_utils::transfer_upload::get_ownership_transfer()
+{
+    return m_ownership_transfer;
+}
+
+
+vk_utils::transfer_upload::thread_pools::~thread_pools()
+{
+    for (const auto& pending : buffers) {
+        vk_utils::context::get().wait(pending.submission);
+    }
+}
+
+
+ERROR_TYPE vk_utils::transfer_upload::acquire_command_buffers(command_buffers*& out_buffers)
+{
+    // every thread records into pools of its own, so uploads made by several threads need no locking.
+    thread_local thread_pools pools{};
+
+    const auto& ctx = vk_utils::context::get();
+
+    if (static_cast<VkCommandPool>(pools.transfer_pool) == nullptr) {
+        PASS_ERROR(init_command_pool(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_TRANSFER), pools.transfer_pool));
+        PASS_ERROR(init_command_pool(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS), pools.graphics_pool));
+    }
+
+    auto free_buffers = std::find_if(pools.buffers.begin(), pools.buffers.end(), [&ctx](const command_buffers& buffers) {
+        return !buffers.recording && ctx.is_completed(buffers.submission);
+    });
+
+    if (free_buffers == pools.buffers.end()) {
+        auto& new_buffers = pools.buffers.emplace_back();
+
+        if (init_command_buffer(pools.transfer_pool, new_buffers.transfer) != VK_SUCCESS ||
+            init_command_buffer(pools.graphics_pool, new_buffers.graphics) != VK_SUCCESS) {
+            pools.buffers.pop_back();
+            RAISE_ERROR_WARN(-1, "cannot init upload command buffer.");
+        }
+
+        free_buffers = std::prev(pools.buffers.end());
+    }
+
+    free_buffers->recording = true;
+    out_buffers = &*free_buffers;
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::transfer_upload::finish(const submission_token& submission)
+{
+    m_command_buffers->submission = submission;
+    m_command_buffers->recording = false;
+    m_command_buffers = nullptr;
+
+    if (m_retained.empty()) {
+        return;
+    }
+
+    // the deletion queue releases the retained objects once the upload completed, the upload waits for it otherwise.
+    if (auto* deletion_queue = vk_utils::get_deletion_queue(); deletion_queue != nullptr) {
+        deletion_queue->defer(submission, [retained = std::move(m_retained)]() mutable { retained.clear(); });
+    } else {
+        vk_utils::context::get().wait(submission);
+    }
+
+    m_retained.clear();
+}
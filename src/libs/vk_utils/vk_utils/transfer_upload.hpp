@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/submission_queue.hpp>
+#include <errors/error_handler.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vk_utils
+{
+    // Release and acquire barriers handing exclusive resources written on one queue family over to another.
+    // release barriers are recorded into the source queue command buffer, acquire barriers into a destination queue
+    // command buffer submitted after it, waiting on the source queue timeline value of the source submission.
+    class queue_ownership_transfer
+    {
+    public:
+        queue_ownership_transfer() = default;
+        queue_ownership_transfer(uint32_t src_queue_family_index, uint32_t dst_queue_family_index);
+
+        // false when both families are the same, no barriers are recorded then.
+        bool is_required() const;
+        bool empty() const;
+
+        uint32_t get_src_queue_family_index() const;
+        uint32_t get_dst_queue_family_index() const;
+
+        void add_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkAccessFlags src_access, VkAccessFlags dst_access);
+        // the layout transition is a part of the ownership transfer, both barriers use the same layouts.
+        void add_image(
+            VkImage image,
+            const VkImageSubresourceRange& range,
+            VkImageLayout old_layout,
+            VkImageLayout new_layout,
+            VkAccessFlags src_access,
+            VkAccessFlags dst_access);
+
+        void record_release(VkCommandBuffer cmd, VkPipelineStageFlags src_stages) const;
+        // dst_stages are also the stages the acquiring submission waits on the source queue at.
+        void record_acquire(VkCommandBuffer cmd, VkPipelineStageFlags dst_stages) const;
+
+        void clear();
+
+    private:
+        uint32_t m_src_queue_family_index{VK_QUEUE_FAMILY_IGNORED};
+        uint32_t m_dst_queue_family_index{VK_QUEUE_FAMILY_IGNORED};
+
+        std::vector<VkBufferMemoryBarrier> m_buffer_barriers{};
+        std::vector<VkImageMemoryBarrier> m_image_barriers{};
+    };
+
+
+    // One upload recorded for the dedicated transfer queue.
+    // resources written by it are created for get_queue_family_index() and added to get_ownership_transfer(),
+    // submit() releases them and acquires them on the graphics queue without waiting, graphics submissions made after it
+    // see the data. command buffers come from command pools of the calling thread and are recycled once their submissions
+    // completed, objects used by the commands are retained until then.
+    // both queues are submitted to from the calling thread, callers synchronize queue access like for any other submission.
+    class transfer_upload
+    {
+    public:
+        // true when the device exposes a transfer queue family other than the graphics one.
+        static bool is_available();
+
+        transfer_upload() = default;
+        transfer_upload(const transfer_upload&) = delete;
+        transfer_upload& operator=(const transfer_upload&) = delete;
+        ~transfer_upload();
+
+        ERROR_TYPE begin();
+        // out_submission is the graphics acquire submission, it completes after the copies.
+        ERROR_TYPE submit(VkPipelineStageFlags dst_stages, submission_token& out_submission);
+        ERROR_TYPE submit(VkPipelineStageFlags dst_stages);
+
+        // keeps an object used by the recorded commands alive until the upload completed.
+        template<typename T>
+        void retain(T resource)
+        {
+            m_retained.emplace_back([r = std::make_shared<T>(std::move(resource))]() mutable { r.reset(); });
+        }
+
+        VkCommandBuffer get_command_buffer();
+        uint32_t get_queue_family_index() const;
+        queue_ownership_transfer& get_ownership_transfer();
+
+    private:
+        struct command_buffers
+        {
+            vk_utils::cmd_buffers_handler transfer{};
+            vk_utils::cmd_buffers_handler graphics{};
+            submission_token submission{};
+            bool recording{false};
+        };
+
+        struct thread_pools
+        {
+            ~thread_pools();
+
+            vk_utils::cmd_pool_handler transfer_pool{};
+            vk_utils::cmd_pool_handler graphics_pool{};
+            std::deque<command_buffers> buffers{};
+        };
+
+        static ERROR_TYPE acquire_command_buffers(command_buffers*& out_buffers);
+        // recycles the command buffers and retained objects once the submission completed.
+        void finish(const submission_token& submission);
+
+        command_buffers* m_command_buffers{nullptr};
+        std::vector<std::function<void()>> m_retained{};
+
+        queue_ownership_transfer m_ownership_transfer{};
+    };
+} // namespace vk_utils
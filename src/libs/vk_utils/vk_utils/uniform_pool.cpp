@@ -0,0 +1,287 @@
+
+#include "uniform_pool.hpp"
+
+#include <vk_utils/tools.hpp>
+#include <vk_utils/context.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    // staged ranges up to this size are written inline into the command buffer.
+    constexpr VkDeviceSize inline_update_max_size = 256;
+
+
+    VkResult create_mapped_buffer(VkDeviceSize size, VkBufferUsageFlags usage, vk_utils::memory_tag tag, vk_utils::vma_buffer_handler& out_buffer)
+    {
+        VkBufferCreateInfo buffer_info{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = size,
+            .usage = usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+        };
+
+        VmaAllocationCreateInfo alloc_info{
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+        };
+
+        return out_buffer.init(vk_utils::context::get().allocator(), &buffer_info, &alloc_info, tag);
+    }
+}
+
+
+ERROR_TYPE vk_utils::uniform_pool::init(VkDeviceSize block_size, uint32_t frames_count, vk_utils::upload_context* upload_context)
+{
+    if (block_size == 0) {
+        RAISE_ERROR_WARN(-1, "invalid uniform pool block size.");
+    }
+
+    m_block_size = block_size;
+    m_frames_count = std::clamp(frames_count, 1u, 32u);
+    m_upload_context = upload_context;
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(vk_utils::context::get().gpu(), &props);
+
+    m_alignment = std::max<VkDeviceSize>(props.limits.minUniformBufferOffsetAlignment, 1);
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::uniform_pool::allocate(VkDeviceSize size, allocation& out_allocation)
+{
+    if (size == 0) {
+        RAISE_ERROR_WARN(-1, "invalid uniform pool allocation.");
+    }
+
+    VkDeviceSize offset = 0;
+    uint32_t block_index = 0;
+
+    for (; block_index < m_blocks.size(); ++block_index) {
+        if (m_blocks[block_index].ranges.allocate(size, m_alignment, offset)) {
+            break;
+        }
+    }
+
+    if (block_index == m_blocks.size()) {
+        PASS_ERROR(create_block(std::max(m_block_size, size)));
+
+        if (!m_blocks.back().ranges.allocate(size, m_alignment, offset)) {
+            RAISE_ERROR_WARN(-1, "cannot allocate uniform pool range.");
+        }
+    }
+
+    out_allocation = {
+        .buffer = m_blocks[block_index].buffer,
+        .offset = offset,
+        .size = size,
+        .block_index = block_index,
+    };
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::uniform_pool::free(const allocation& allocation)
+{
+    if (allocation.buffer == nullptr) {
+        return;
+    }
+
+    m_blocks[allocation.block_index].ranges.free(allocation.offset, allocation.size);
+}
+
+
+VkBuffer vk_utils::uniform_pool::get_buffer(const allocation& allocation) const
+{
+    if (allocation.buffer == nullptr) {
+        return nullptr;
+    }
+
+    return m_blocks[allocation.block_index].buffer;
+}
+
+
+uint8_t* vk_utils::uniform_pool::get_mapped_data(const allocation& allocation) const
+{
+    if (allocation.buffer == nullptr) {
+        return nullptr;
+    }
+
+    const auto& block = m_blocks[allocation.block_index];
+    const auto& written_buffer = static_cast<VkBuffer>(block.mirror) != nullptr ? block.mirror : block.buffer;
+
+    return static_cast<uint8_t*>(written_buffer.get_alloc_info().pMappedData) + allocation.offset;
+}
+
+
+void vk_utils::uniform_pool::mark_written(const allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (allocation.buffer == nullptr || size == 0) {
+        return;
+    }
+
+    m_blocks[allocation.block_index].written_ranges.push_back({
+        .srcOffset = allocation.offset + offset,
+        .dstOffset = allocation.offset + offset,
+        .size = size,
+    });
+}
+
+
+ERROR_TYPE vk_utils::uniform_pool::flush()
+{
+    const auto& ctx = vk_utils::context::get();
+
+    m_flushed_bytes = 0;
+    ++m_frame_index;
+
+    for (auto& block : m_blocks) {
+        auto& ranges = block.written_ranges;
+
+        if (ranges.empty()) {
+            continue;
+        }
+
+        std::sort(ranges.begin(), ranges.end(), [](const VkBufferCopy& l, const VkBufferCopy& r) {
+            return l.srcOffset < r.srcOffset;
+        });
+
+        // overlapping and adjacent ranges are merged into one region.
+        size_t merged_count = 0;
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            auto& merged = ranges[merged_count];
+
+            if (ranges[i].srcOffset <= merged.srcOffset + merged.size) {
+                merged.size = std::max(merged.size, ranges[i].srcOffset + ranges[i].size - merged.srcOffset);
+            } else {
+                ranges[++merged_count] = ranges[i];
+            }
+        }
+        ranges.resize(merged_count + 1);
+
+        const bool staged = static_cast<VkBuffer>(block.mirror) != nullptr;
+
+        for (const auto& range : ranges) {
+            m_flushed_bytes += range.size;
+            vmaFlushAllocation(ctx.allocator(), staged ? block.mirror : block.buffer, range.srcOffset, range.size);
+        }
+
+        if (staged) {
+            if (m_upload_context == nullptr) {
+                RAISE_ERROR_WARN(-1, "uniform pool writes cannot be staged without an upload context.");
+            }
+
+            VkCommandBuffer command_buffer{nullptr};
+            PASS_ERROR(m_upload_context->get_command_buffer(command_buffer));
+
+            const auto copies_end = std::partition(ranges.begin(), ranges.end(), [](const VkBufferCopy& range) {
+                return range.size > inline_update_max_size || range.size % 4 != 0 || range.dstOffset % 4 != 0;
+            });
+
+            const auto* mirror_data = static_cast<const uint8_t*>(block.mirror.get_alloc_info().pMappedData);
+
+            for (auto it = copies_end; it != ranges.end(); ++it) {
+                vkCmdUpdateBuffer(command_buffer, block.buffer, it->dstOffset, it->size, mirror_data + it->srcOffset);
+            }
+
+            if (copies_end != ranges.begin()) {
+                vkCmdCopyBuffer(command_buffer, block.mirror, block.buffer, static_cast<uint32_t>(copies_end - ranges.begin()), ranges.data());
+            }
+
+            VkBufferMemoryBarrier barrier{
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .pNext = nullptr,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = block.buffer,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+            };
+
+            vkCmdPipelineBarrier(
+                command_buffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0,
+                nullptr,
+                1,
+                &barrier,
+                0,
+                nullptr);
+        }
+
+        ranges.clear();
+    }
+
+    RAISE_ERROR_OK();
+}
+
+
+VkDeviceSize vk_utils::uniform_pool::get_flushed_bytes() const
+{
+    return m_flushed_bytes;
+}
+
+
+VkDeviceSize vk_utils::uniform_pool::get_alignment() const
+{
+    return m_alignment;
+}
+
+
+uint64_t vk_utils::uniform_pool::get_frame_index() const
+{
+    return m_frame_index;
+}
+
+
+uint32_t vk_utils::uniform_pool::get_frames_count() const
+{
+    return m_frames_count;
+}
+
+
+uint32_t vk_utils::uniform_pool::get_blocks_count() const
+{
+    return m_blocks.size();
+}
+
+
+ERROR_TYPE vk_utils::uniform_pool::create_block(VkDeviceSize size)
+{
+    block new_block{};
+
+    if (!vk_utils::create_direct_write_buffer(new_block.buffer, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, size, -1, vk_utils::MEMORY_TAG_UNIFORMS)) {
+        if (m_upload_context != nullptr) {
+            PASS_ERROR(vk_utils::create_buffer(
+                new_block.buffer,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VMA_MEMORY_USAGE_GPU_ONLY,
+                size,
+                nullptr,
+                -1,
+                vk_utils::MEMORY_TAG_UNIFORMS));
+
+            if (const auto err = create_mapped_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, vk_utils::MEMORY_TAG_STAGING, new_block.mirror); err != VK_SUCCESS) {
+                RAISE_ERROR_WARN(err, "cannot init uniform pool mirror buffer.");
+            }
+        } else if (const auto err = create_mapped_buffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, vk_utils::MEMORY_TAG_UNIFORMS, new_block.buffer); err != VK_SUCCESS) {
+            RAISE_ERROR_WARN(err, "cannot init uniform pool buffer.");
+        }
+    }
+
+    new_block.ranges = vk_utils::range_allocator{size};
+    m_blocks.emplace_back(std::move(new_block));
+
+    RAISE_ERROR_OK();
+}
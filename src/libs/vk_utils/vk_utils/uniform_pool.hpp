@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/range_allocator.hpp>
+#include <vk_utils/upload_context.hpp>
+
+#include <errors/error_handler.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace vk_utils
+{
+    // Large uniform buffers shared by uniform data of many objects, bound by their descriptors at the objects offsets.
+    // ranges are aligned to minUniformBufferOffsetAlignment and sub-allocated per block by a range_allocator.
+    // objects write into persistently mapped memory and mark the written ranges, flush() makes all of them visible at once.
+    // on devices with host visible device local memory blocks are written directly, otherwise blocks are device local
+    // and written ranges are copied from a host mirror with one multi region copy per block recorded into the upload context
+    // passed to init. without both, blocks are host visible memory read by the device.
+    class uniform_pool
+    {
+    public:
+        struct allocation
+        {
+            VkBuffer buffer{nullptr};
+            VkDeviceSize offset{0};
+            VkDeviceSize size{0};
+            uint32_t block_index{0};
+        };
+
+        uniform_pool() = default;
+        uniform_pool(const uniform_pool&) = delete;
+        uniform_pool& operator=(const uniform_pool&) = delete;
+        ~uniform_pool() = default;
+
+        // objects keep one slice of their data per frame in flight, at most 32.
+        // ranges larger than the block size get a block of their own size.
+        ERROR_TYPE init(VkDeviceSize block_size, uint32_t frames_count = 3, vk_utils::upload_context* upload_context = nullptr);
+
+        ERROR_TYPE allocate(VkDeviceSize size, allocation& out_allocation);
+        // the range must not be used by pending commands anymore.
+        void free(const allocation& allocation);
+
+        VkBuffer get_buffer(const allocation& allocation) const;
+        uint8_t* get_mapped_data(const allocation& allocation) const;
+        // offset relative to the allocation.
+        void mark_written(const allocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+
+        // called once per frame after the objects of the frame were written and before its submission.
+        // written ranges are merged, staged ones are copied together and tiny ones updated inline.
+        ERROR_TYPE flush();
+        // bytes made visible by the last flush().
+        VkDeviceSize get_flushed_bytes() const;
+        // count of flushes, objects write a new slice at most once per frame.
+        uint64_t get_frame_index() const;
+
+        VkDeviceSize get_alignment() const;
+        uint32_t get_frames_count() const;
+        uint32_t get_blocks_count() const;
+
+    private:
+        struct block
+        {
+            vk_utils::vma_buffer_handler buffer{};
+            // host copy of a device local block, null when the block is mapped.
+            vk_utils::vma_buffer_handler mirror{};
+            vk_utils::range_allocator ranges{};
+            std::vector<VkBufferCopy> written_ranges{};
+        };
+
+        ERROR_TYPE create_block(VkDeviceSize size);
+
+        VkDeviceSize m_block_size{0};
+        VkDeviceSize m_alignment{1};
+        uint32_t m_frames_count{3};
+        VkDeviceSize m_flushed_bytes{0};
+        uint64_t m_frame_index{0};
+        std::deque<block> m_blocks{};
+        vk_utils::upload_context* m_upload_context{nullptr};
+    };
+} // namespace vk_utils
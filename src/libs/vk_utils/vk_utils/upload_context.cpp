@@ -0,0 +1,259 @@
+
+#include "upload_context.hpp"
+
+#include <vk_utils/context.hpp>
+#include <vk_utils/tools.hpp>
+
+#include <algorithm>
+
+
+vk_utils::upload_context::~upload_context()
+{
+    std::lock_guard lock{m_mutex};
+
+    if (!m_submitted_batches.empty()) {
+        vk_utils::context::get().wait(m_submitted_batches.back().submission);
+    }
+
+    m_submitted_batches.clear();
+    m_pending_staging.clear();
+    m_pending_retained.clear();
+    m_threads.clear();
+}
+
+
+ERROR_TYPE vk_utils::upload_context::init(vk_utils::staging_ring* ring)
+{
+    const auto& ctx = vk_utils::context::get();
+
+    if (ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS) < 0) {
+        RAISE_ERROR_WARN(-1, "upload context needs a graphics queue.");
+    }
+
+    m_queue = ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS);
+    m_queue_family_index = ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS);
+    m_staging_ring = ring;
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::upload_context::get_command_buffer(VkCommandBuffer& out_command_buffer)
+{
+    std::lock_guard lock{m_mutex};
+
+    auto& state = m_threads[std::this_thread::get_id()];
+
+    if (state == nullptr) {
+        state = std::make_unique<thread_state>();
+
+        VkCommandPoolCreateInfo cmd_pool_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = m_queue_family_index,
+        };
+
+        if (state->command_pool.init(vk_utils::context::get().device(), &cmd_pool_info) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot init upload command pool.");
+        }
+    }
+
+    if (state->recording == nullptr) {
+        PASS_ERROR(begin_command_buffer(*state));
+    }
+
+    out_command_buffer = state->recording;
+
+    RAISE_ERROR_OK();
+}
+
+
+uint32_t vk_utils::upload_context::get_queue_family_index() const
+{
+    return m_queue_family_index;
+}
+
+
+ERROR_TYPE vk_utils::upload_context::allocate_staging(
+    VkDeviceSize size,
+    VkDeviceSize alignment,
+    const void* data,
+    VkBuffer& out_buffer,
+    VkDeviceSize& out_offset)
+{
+    std::lock_guard lock{m_mutex};
+
+    // ring space of completed batches is given back first.
+    collect_completed();
+
+    vk_utils::staging_buffer staging{};
+    PASS_ERROR(staging.init(size, alignment, m_staging_ring, data));
+
+    out_buffer = staging.get_buffer();
+    out_offset = staging.get_offset();
+
+    m_pending_staging.emplace_back(std::move(staging));
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::upload_context::flush(batch_id& out_batch)
+{
+    std::lock_guard lock{m_mutex};
+
+    collect_completed();
+
+    std::vector<VkCommandBuffer> command_buffers{};
+
+    for (auto& [id, state] : m_threads) {
+        if (state->recording == nullptr) {
+            continue;
+        }
+
+        if (vkEndCommandBuffer(state->recording) != VK_SUCCESS) {
+            RAISE_ERROR_WARN(-1, "cannot end upload command buffer.");
+        }
+
+        command_buffers.push_back(state->recording);
+        state->recording = nullptr;
+    }
+
+    // nothing to wait for, objects retained without commands are released right away.
+    if (command_buffers.empty()) {
+        m_pending_staging.clear();
+        m_pending_retained.clear();
+        out_batch = m_pending_batch - 1;
+        RAISE_ERROR_OK();
+    }
+
+    batch submitted_batch{
+        .id = m_pending_batch,
+        .staging = std::move(m_pending_staging),
+        .retained = std::move(m_pending_retained),
+    };
+
+    m_pending_staging.clear();
+    m_pending_retained.clear();
+
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = static_cast<uint32_t>(command_buffers.size()),
+        .pCommandBuffers = command_buffers.data(),
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    if (const auto e = vk_utils::context::get().submit(m_queue, submit_info, submitted_batch.submission); e != VK_SUCCESS) {
+        RAISE_ERROR_WARN(e, "cannot submit uploads.");
+    }
+
+    out_batch = m_pending_batch++;
+    m_submitted_batches.emplace_back(std::move(submitted_batch));
+
+    RAISE_ERROR_OK();
+}
+
+
+ERROR_TYPE vk_utils::upload_context::flush()
+{
+    batch_id batch{0};
+    PASS_ERROR(flush(batch));
+    RAISE_ERROR_OK();
+}
+
+
+bool vk_utils::upload_context::is_completed(batch_id batch)
+{
+    std::lock_guard lock{m_mutex};
+    collect_completed();
+    return batch <= m_completed_batch;
+}
+
+
+void vk_utils::upload_context::wait(batch_id batch)
+{
+    std::lock_guard lock{m_mutex};
+
+    // batches are submitted to one queue in order, waiting for the last requested one is enough.
+    vk_utils::submission_token submission{};
+    for (const auto& submitted_batch : m_submitted_batches) {
+        if (submitted_batch.id > batch) {
+            break;
+        }
+
+        submission = submitted_batch.submission;
+    }
+
+    vk_utils::context::get().wait(submission);
+
+    collect_completed();
+}
+
+
+ERROR_TYPE vk_utils::upload_context::begin_command_buffer(thread_state& state)
+{
+    collect_completed();
+
+    auto free_buffer = std::find_if(state.command_buffers.begin(), state.command_buffers.end(), [this](const command_buffer& buffer) {
+        return buffer.batch <= m_completed_batch;
+    });
+
+    if (free_buffer == state.command_buffers.end()) {
+        VkCommandBufferAllocateInfo cmd_buffer_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = state.command_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        auto& new_buffer = state.command_buffers.emplace_back();
+
+        if (new_buffer.handler.init(vk_utils::context::get().device(), state.command_pool, &cmd_buffer_info, 1) != VK_SUCCESS) {
+            state.command_buffers.pop_back();
+            RAISE_ERROR_WARN(-1, "cannot init upload command buffer.");
+        }
+
+        free_buffer = std::prev(state.command_buffers.end());
+    }
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+
+    // the pool is created with the reset command buffer flag, beginning resets the recycled buffer.
+    if (vkBeginCommandBuffer(free_buffer->handler[0], &begin_info) != VK_SUCCESS) {
+        RAISE_ERROR_WARN(-1, "cannot begin upload command buffer.");
+    }
+
+    free_buffer->batch = m_pending_batch;
+    state.recording = free_buffer->handler[0];
+
+    RAISE_ERROR_OK();
+}
+
+
+void vk_utils::upload_context::collect_completed()
+{
+    const auto completed_value = vk_utils::context::get().completed_value(m_queue);
+
+    while (!m_submitted_batches.empty() && m_submitted_batches.front().submission.value <= completed_value) {
+        auto& completed_batch = m_submitted_batches.front();
+
+        for (auto& release : completed_batch.retained) {
+            release();
+        }
+
+        m_completed_batch = completed_batch.id;
+        m_submitted_batches.pop_front();
+    }
+}
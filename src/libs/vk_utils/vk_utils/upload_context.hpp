@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vk_utils/handlers.hpp>
+#include <vk_utils/staging_ring.hpp>
+#include <errors/error_handler.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vk_utils
+{
+    // Uploads recorded by any thread for the graphics queue and submitted together by flush().
+    // every recording thread gets a transient command pool of its own, command buffers and staging memory are
+    // recycled once the batch which used them completed, so uploads create no vulkan objects in the steady state.
+    // flush() is called before the submission of the frame using the uploads, barriers recorded by the uploads then
+    // make the data visible to it. threads have to finish recording before flush() is called.
+    class upload_context
+    {
+    public:
+        using batch_id = uint64_t;
+
+        upload_context() = default;
+        upload_context(const upload_context&) = delete;
+        upload_context& operator=(const upload_context&) = delete;
+        ~upload_context();
+
+        // staging memory is sub-allocated from the ring when it has room, the ring is used by the context only then.
+        ERROR_TYPE init(vk_utils::staging_ring* ring = nullptr);
+
+        // command buffer of the calling thread in the pending batch, begun on first use.
+        ERROR_TYPE get_command_buffer(VkCommandBuffer& out_command_buffer);
+        uint32_t get_queue_family_index() const;
+
+        // data is copied into staging memory kept until the pending batch completed.
+        ERROR_TYPE allocate_staging(VkDeviceSize size, VkDeviceSize alignment, const void* data, VkBuffer& out_buffer, VkDeviceSize& out_offset);
+
+        // keeps an object used by the recorded commands alive until the pending batch completed.
+        template<typename T>
+        void retain(T resource)
+        {
+            std::lock_guard lock{m_mutex};
+            m_pending_retained.emplace_back([r = std::make_shared<T>(std::move(resource))]() mutable { r.reset(); });
+        }
+
+        // submits everything recorded since the previous flush in one submission.
+        ERROR_TYPE flush(batch_id& out_batch);
+        ERROR_TYPE flush();
+        bool is_completed(batch_id batch);
+        void wait(batch_id batch);
+
+    private:
+        struct command_buffer
+        {
+            vk_utils::cmd_buffers_handler handler{};
+            batch_id batch{0};
+        };
+
+        struct thread_state
+        {
+            vk_utils::cmd_pool_handler command_pool{};
+            std::deque<command_buffer> command_buffers{};
+            VkCommandBuffer recording{nullptr};
+        };
+
+        struct batch
+        {
+            batch_id id{0};
+            submission_token submission{};
+            std::vector<vk_utils::staging_buffer> staging{};
+            std::vector<std::function<void()>> retained{};
+        };
+
+        ERROR_TYPE begin_command_buffer(thread_state& state);
+        void collect_completed();
+
+        std::mutex m_mutex{};
+
+        VkQueue m_queue{nullptr};
+        uint32_t m_queue_family_index{0};
+        vk_utils::staging_ring* m_staging_ring{nullptr};
+
+        std::unordered_map<std::thread::id, std::unique_ptr<thread_state>> m_threads{};
+
+        std::vector<vk_utils::staging_buffer> m_pending_staging{};
+        std::vector<std::function<void()>> m_pending_retained{};
+
+        std::deque<batch> m_submitted_batches{};
+        batch_id m_pending_batch{1};
+        batch_id m_completed_batch{0};
+    };
+} // namespace vk_utils
@@ -29,7 +29,7 @@ ERROR_TYPE base_obj_viewer_app::on_vulkan_initialized()
     cmd_pool_create_info.pNext = nullptr;
     cmd_pool_create_info.queueFamilyIndex = vk_utils::context::get().queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS);
     m_command_pool.init(vk_utils::context::get().device(), &cmd_pool_create_info);
-    PASS_ERROR(vk_utils::create_buffer(m_ubo, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, sizeof(global_ubo)));
+    PASS_ERROR(vk_utils::create_buffer(m_ubo, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, sizeof(global_ubo), nullptr, -1, vk_utils::MEMORY_TAG_UNIFORMS));
 
     HANDLE_ERROR(m_args_parser->parse_args(m_app_info.argc, m_app_info.argv));
     vk_utils::obj_loader loader{};
@@ -27,9 +27,9 @@ ERROR_TYPE dummy_obj_viewer_app::on_vulkan_initialized()
 ERROR_TYPE dummy_obj_viewer_app::on_swapchain_recreated()
 {
     HANDLE_ERROR(init_main_frame_buffers());
-    m_pipelines_layout.clear();
-    m_graphics_pipelines.clear();
-    m_command_buffers.destroy();
+    m_deletion_queue.retire(std::move(m_pipelines_layout));
+    m_deletion_queue.retire(std::move(m_graphics_pipelines));
+    m_deletion_queue.retire(std::move(m_command_buffers));
     HANDLE_ERROR(record_obj_model_dummy_draw_commands(
         m_model, m_dummy_shader_group, m_command_pool, m_command_buffers, m_pipelines_layout, m_graphics_pipelines));
 
@@ -545,11 +545,11 @@ ERROR_TYPE dummy_obj_viewer_app::init_main_render_pass()
 
 ERROR_TYPE dummy_obj_viewer_app::init_main_frame_buffers()
 {
-    m_main_depth_image.destroy();
-    m_main_depth_image_view.destroy();
-    m_main_msaa_image.destroy();
-    m_main_msaa_image_view.destroy();
-    m_main_pass_framebuffers.clear();
+    m_deletion_queue.retire(std::move(m_main_depth_image));
+    m_deletion_queue.retire(std::move(m_main_depth_image_view));
+    m_deletion_queue.retire(std::move(m_main_msaa_image));
+    m_deletion_queue.retire(std::move(m_main_msaa_image_view));
+    m_deletion_queue.retire(std::move(m_main_pass_framebuffers));
     m_main_pass_framebuffers.reserve(m_swapchain_data.swapchain_images.size());
 
     VkImageCreateInfo img_info{};
@@ -574,14 +574,14 @@ ERROR_TYPE dummy_obj_viewer_app::init_main_frame_buffers()
     VmaAllocationCreateInfo img_alloc_info{};
     img_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-    if (m_main_depth_image.init(vk_utils::context::get().allocator(), &img_info, &img_alloc_info) != VK_SUCCESS) {
+    if (m_main_depth_image.init(vk_utils::context::get().allocator(), &img_info, &img_alloc_info, vk_utils::MEMORY_TAG_ATTACHMENTS) != VK_SUCCESS) {
         RAISE_ERROR_FATAL(-1, "cannot init depth image.");
     }
 
     img_info.format = m_swapchain_data.swapchain_info->imageFormat;
     img_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    if (m_main_msaa_image.init(vk_utils::context::get().allocator(), &img_info, &img_alloc_info)) {
+    if (m_main_msaa_image.init(vk_utils::context::get().allocator(), &img_info, &img_alloc_info, vk_utils::MEMORY_TAG_ATTACHMENTS)) {
         RAISE_ERROR_FATAL(-1, "cannot init msaa image.");
     }
 
@@ -1,5 +1,6 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
 
 layout (location = 0) out vec4 o_FragColor;
 
@@ -10,8 +11,18 @@ layout (location = 3) in vec2 v_uv;
 
 layout (set = 0, binding = 1) uniform sampler2D s_tex_image;
 
+// texture residency id of s_tex_image, negative when it is not streamed.
+layout (constant_id = 0) const int c_feedback_texture_id = -1;
+
+#define SAMPLER_FEEDBACK_BINDING 2
+#include "vk_utils/sampler_feedback.glsl.inc"
+
 void main()
 {
+    if (c_feedback_texture_id >= 0) {
+        write_sampler_feedback(uint(c_feedback_texture_id), s_tex_image, v_uv);
+    }
+
     float diff = max(dot(v_normal, normalize(vec3(0, 1, -1))), 0);
     o_FragColor = vec4(texture(s_tex_image, v_uv).rgb * diff, 1.);
-}
\ No newline at end of file
+}
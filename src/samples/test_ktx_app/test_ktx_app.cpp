@@ -5,6 +5,8 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+
 namespace
 {
     struct test_ktx_args_parser : public base_obj_viewer_app::args_parser
@@ -45,7 +47,16 @@ test_ktx_app::test_ktx_app(const char* app_name)
 
 ERROR_TYPE test_ktx_app::on_vulkan_initialized()
 {
+    PASS_ERROR(init_texture_streaming());
     PASS_ERROR(base_obj_viewer_app::on_vulkan_initialized());
+
+    if (m_model.textures.empty()) {
+        RAISE_ERROR_FATAL(-1, "model has no textures.");
+    }
+
+    m_feedback_texture_id = m_model.textures[0].residency_id;
+    PASS_ERROR(m_sampler_feedback.init(m_model.textures.size(), m_swapchain_data.swapchain_images.size()));
+
     PASS_ERROR(init_render_passes());
     PASS_ERROR(init_framebuffers());
     PASS_ERROR(init_shaders());
@@ -67,7 +78,64 @@ ERROR_TYPE test_ktx_app::draw_frame()
 {
     PASS_ERROR(base_obj_viewer_app::draw_frame());
     PASS_ERROR(begin_frame());
-    PASS_ERROR(finish_frame(m_command_buffers[m_swapchain_data.current_image]));
+
+    const uint32_t image = m_swapchain_data.current_image;
+
+    // the feedback and the descriptor set of the image command buffer are free once its previous submission completed.
+    vk_utils::context::get().wait(m_swapchain_data.images_submissions[image]);
+
+    m_sampler_feedback.read(image, [this](uint32_t texture_id, int32_t level) {
+        m_texture_residency.apply_feedback(texture_id, level);
+    });
+
+    if (m_outdated_sets[image % m_outdated_sets.size()]) {
+        PASS_ERROR(update_texture_descriptor(image));
+    }
+
+    // the model is drawn every frame, so its texture is never trimmed while frames may sample it.
+    if (m_feedback_texture_id >= 0) {
+        m_texture_residency.use(m_feedback_texture_id);
+    }
+
+    PASS_ERROR(finish_frame(m_command_buffers[image][0]));
+    PASS_ERROR(m_texture_residency.update());
+
+    RAISE_ERROR_OK();
+}
+
+ERROR_TYPE test_ktx_app::init_texture_streaming()
+{
+    const auto& ctx = vk_utils::context::get();
+
+    if (!ctx.fragment_stores_supported()) {
+        RAISE_ERROR_FATAL(-1, "sampler feedback requires fragment stores and atomics.");
+    }
+
+    VkCommandPoolCreateInfo cmd_pool_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .queueFamilyIndex = static_cast<uint32_t>(ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS)),
+    };
+
+    if (m_residency_command_pool.init(ctx.device(), &cmd_pool_info) != VK_SUCCESS) {
+        RAISE_ERROR_FATAL(-1, "cannot init texture residency command pool.");
+    }
+
+    PASS_ERROR(m_texture_residency.init(
+        ctx.queue(vk_utils::context::QUEUE_TYPE_GRAPHICS),
+        ctx.queue_family_index(vk_utils::context::QUEUE_TYPE_GRAPHICS),
+        m_residency_command_pool));
+
+    m_texture_residency.set_protected_frames_count(m_swapchain_data.frames_count);
+    m_texture_residency.set_on_texture_changed([this](vk_utils::texture_residency::texture_id id, const vk_utils::texture_residency::texture&) {
+        if (static_cast<int32_t>(id) == m_feedback_texture_id) {
+            std::fill(m_outdated_sets.begin(), m_outdated_sets.end(), true);
+        }
+    });
+
+    // model textures are loaded into the residency, their top mips follow the levels the fragment shader samples.
+    m_args_parser->get_model_info().residency = &m_texture_residency;
 
     RAISE_ERROR_OK();
 }
@@ -196,7 +264,7 @@ ERROR_TYPE test_ktx_app::init_framebuffers()
         .usage = VMA_MEMORY_USAGE_GPU_ONLY
     };
 
-    if (depth_image.init(vk_utils::context::get().allocator(), &img_info, &alloc_info) != VK_SUCCESS) {
+    if (depth_image.init(vk_utils::context::get().allocator(), &img_info, &alloc_info, vk_utils::MEMORY_TAG_ATTACHMENTS) != VK_SUCCESS) {
         RAISE_ERROR_FATAL(-1, "cannot init depth image");
     }
 
@@ -250,6 +318,11 @@ ERROR_TYPE test_ktx_app::init_framebuffers()
         }
     }
 
+    // the previous attachments may still be used by frames in flight after a swapchain recreation.
+    m_deletion_queue.retire(std::move(m_main_depth_image));
+    m_deletion_queue.retire(std::move(m_main_depth_image_view));
+    m_deletion_queue.retire(std::move(m_main_pass_framebuffers));
+
     m_main_depth_image = std::move(depth_image);
     m_main_depth_image_view = std::move(depth_image_view);
     m_main_pass_framebuffers = std::move(framebuffers);
@@ -280,6 +353,12 @@ ERROR_TYPE test_ktx_app::init_shaders()
           .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
           .descriptorCount = 1,
           .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+        },
+        {
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
         }
     };
 
@@ -321,14 +400,20 @@ ERROR_TYPE test_ktx_app::init_shaders()
         RAISE_ERROR_FATAL(-1, "cannot init pipeline layout.");
     }
 
+    const uint32_t sets_count = m_swapchain_data.swapchain_images.size();
+
     VkDescriptorPoolSize desc_pool_sizes[]{
         {
             .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 1,
+            .descriptorCount = sets_count,
         },
         {
             .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = 1,
+            .descriptorCount = sets_count,
+        },
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = sets_count,
         }
     };
 
@@ -338,7 +423,7 @@ ERROR_TYPE test_ktx_app::init_shaders()
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = nullptr,
         .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets = 1,
+        .maxSets = sets_count,
         .poolSizeCount = std::size(desc_pool_sizes),
         .pPoolSizes = desc_pool_sizes,
     };
@@ -347,70 +432,52 @@ ERROR_TYPE test_ktx_app::init_shaders()
         RAISE_ERROR_FATAL(-1, "cannot init descriptor pool.");
     }
 
+    std::vector<VkDescriptorSetLayout> desc_set_layouts(sets_count, static_cast<VkDescriptorSetLayout>(desc_set_layout));
+
     VkDescriptorSetAllocateInfo desc_set_info{
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
         .pNext = nullptr,
         .descriptorPool = descriptor_pool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = desc_set_layout
+        .descriptorSetCount = sets_count,
+        .pSetLayouts = desc_set_layouts.data()
     };
     
     vk_utils::descriptor_set_handler desc_set{};
 
-    if (desc_set.init(vk_utils::context::get().device(), descriptor_pool, &desc_set_info, 1) != VK_SUCCESS) {
+    if (desc_set.init(vk_utils::context::get().device(), descriptor_pool, &desc_set_info, sets_count) != VK_SUCCESS) {
         RAISE_ERROR_FATAL(-1, "cannot init descriptor set.");
     }
 
-    VkDescriptorBufferInfo desc_buffer_info{
-        .buffer = m_ubo,
-        .offset = 0,
-        .range = sizeof(global_ubo)
-    };
-
-    VkDescriptorImageInfo desc_image_info
-    {
-        .sampler = m_model.textures[0].sampler,
-        .imageView = m_model.textures[0].image_view,
-        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    };
-
-    VkWriteDescriptorSet write_ops[]{
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .pNext = nullptr,
-            .dstSet = desc_set[0],
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &desc_buffer_info,
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .pNext = nullptr,
-            .dstSet = desc_set[0],
-            .dstBinding = 1,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-          .pImageInfo = &desc_image_info
-        },
-    };
-
-    vkUpdateDescriptorSets(vk_utils::context::get().device(), std::size(write_ops), write_ops, 0, nullptr);
-
     m_vert_shader = std::move(vs);
     m_frag_shader = std::move(fs);
     m_descriptor_set_layout = std::move(desc_set_layout);
     m_pipeline_layout = std::move(pipeline_layout);
     m_descriptor_pool = std::move(descriptor_pool);
     m_descriptor_set = std::move(desc_set);
+    m_outdated_sets.assign(sets_count, false);
+
+    for (uint32_t i = 0; i < sets_count; ++i) {
+        write_descriptor_set(i);
+    }
 
     RAISE_ERROR_OK();
 }
 
 ERROR_TYPE test_ktx_app::init_pipelines()
 { 
+    VkSpecializationMapEntry feedback_texture_entry{
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(m_feedback_texture_id),
+    };
+
+    VkSpecializationInfo frag_specialization_info{
+        .mapEntryCount = 1,
+        .pMapEntries = &feedback_texture_entry,
+        .dataSize = sizeof(m_feedback_texture_id),
+        .pData = &m_feedback_texture_id,
+    };
+
     VkPipelineShaderStageCreateInfo shader_stages[]{
         {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -428,7 +495,7 @@ ERROR_TYPE test_ktx_app::init_pipelines()
             .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
             .module = m_frag_shader,
             .pName = "main",
-            .pSpecializationInfo = nullptr
+            .pSpecializationInfo = &frag_specialization_info
         },
     };
 
@@ -625,6 +692,20 @@ ERROR_TYPE test_ktx_app::init_pipelines()
 }
 
 ERROR_TYPE test_ktx_app::record_command_buffers()
+{
+    std::vector<vk_utils::cmd_buffers_handler> cmd_buffers(m_main_pass_framebuffers.size());
+
+    for (uint32_t i = 0; i < cmd_buffers.size(); ++i) {
+        PASS_ERROR(record_command_buffer(i, cmd_buffers[i]));
+    }
+
+    m_deletion_queue.retire(std::move(m_command_buffers));
+    m_command_buffers = std::move(cmd_buffers);
+
+    RAISE_ERROR_OK();
+}
+
+ERROR_TYPE test_ktx_app::record_command_buffer(uint32_t image, vk_utils::cmd_buffers_handler& out_cmd_buffer)
 {
     vk_utils::cmd_buffers_handler cmd_buffers{};
 
@@ -633,10 +714,10 @@ ERROR_TYPE test_ktx_app::record_command_buffers()
         .pNext = nullptr,
         .commandPool = m_command_pool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = static_cast<uint32_t>(m_main_pass_framebuffers.size())
+        .commandBufferCount = 1
     };
 
-    if (cmd_buffers.init(vk_utils::context::get().device(), m_command_pool, &buffers_alloc_info, m_main_pass_framebuffers.size()) != VK_SUCCESS) {
+    if (cmd_buffers.init(vk_utils::context::get().device(), m_command_pool, &buffers_alloc_info, 1) != VK_SUCCESS) {
         RAISE_ERROR_FATAL(-1, "cannot init command buffers");
     }
 
@@ -692,55 +773,146 @@ ERROR_TYPE test_ktx_app::record_command_buffers()
 
     float rot_angle = 360.0f / std::size(colors);
 
-    for (int i = 0; i < m_main_pass_framebuffers.size(); ++i) {
-        pass_begin_info.framebuffer = m_main_pass_framebuffers[i];
-
-        vkBeginCommandBuffer(cmd_buffers[i], &cmd_buffer_begin_info);
+    const VkCommandBuffer cmd_buffer = cmd_buffers[0];
+    pass_begin_info.framebuffer = m_main_pass_framebuffers[image];
+    const VkDescriptorSet descriptor_set = m_descriptor_set[image % m_descriptor_set.handlers_count()];
 
-        vkCmdBeginRenderPass(cmd_buffers[i], &pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdSetViewport(cmd_buffers[i], 0, 1, &viewport);
-        vkCmdSetScissor(cmd_buffers[i], 0, 1, &scissor);
+    vkBeginCommandBuffer(cmd_buffer, &cmd_buffer_begin_info);
 
-        VkPipeline last_pipeline = VK_NULL_HANDLE;
+    vkCmdBeginRenderPass(cmd_buffer, &pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
 
-        float curr_angle = 0;
+    VkPipeline last_pipeline = VK_NULL_HANDLE;
 
-        for (size_t j = 0; j < std::size(colors); j++) {
-            push_constant_data data{
-                .color = colors[j],
-                .transform = glm::mat4{1}
-            };
-            
-            data.transform = glm::rotate(data.transform, glm::radians(curr_angle), {0.0f, 0.0f, 1.0f});
-            data.transform = glm::translate(data.transform, {0, 10, 0});
-            
-            curr_angle += rot_angle;
+    float curr_angle = 0;
 
-            vkCmdPushConstants(cmd_buffers[i], m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constant_data), &data);
+    for (size_t j = 0; j < std::size(colors); j++) {
+        push_constant_data data{
+            .color = colors[j],
+            .transform = glm::mat4{1}
+        };
+        
+        data.transform = glm::rotate(data.transform, glm::radians(curr_angle), {0.0f, 0.0f, 1.0f});
+        data.transform = glm::translate(data.transform, {0, 10, 0});
+        
+        curr_angle += rot_angle;
 
-            for (int j = 0; j < m_model.sub_geometries.size(); j++) {
-                if (m_graphics_pipelines[j] != last_pipeline) {
-                    vkCmdBindPipeline(cmd_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipelines[j]);        
-                    vkCmdBindDescriptorSets(cmd_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, m_descriptor_set, 0, nullptr);
-                    last_pipeline = m_graphics_pipelines[j];
-                }
+        vkCmdPushConstants(cmd_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constant_data), &data);
 
-                VkDeviceSize vertex_buffer_offset = m_model.sub_geometries[j].vertices_offset;
-                vkCmdBindVertexBuffers(cmd_buffers[i], 0, 1, m_model.vertex_buffer, &vertex_buffer_offset);
-                vkCmdBindIndexBuffer(cmd_buffers[i], m_model.index_buffer, m_model.sub_geometries[j].indices_offset * sizeof(uint32_t), VK_INDEX_TYPE_UINT32);
-                std::vector<VkDescriptorSet> desc_sets;
-                vkCmdDrawIndexed(cmd_buffers[i], m_model.sub_geometries[j].indices_size, 1, 0, 0, 0);
+        for (int j = 0; j < m_model.sub_geometries.size(); j++) {
+            if (m_graphics_pipelines[j] != last_pipeline) {
+                vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipelines[j]);        
+                vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+                last_pipeline = m_graphics_pipelines[j];
             }
-        }
 
-        vkCmdEndRenderPass(cmd_buffers[i]);
-        
-        if (vkEndCommandBuffer(cmd_buffers[i]) != VK_SUCCESS) {
-            RAISE_ERROR_FATAL(-1, "cannot record command buffer.");
+            VkDeviceSize vertex_buffer_offset = m_model.sub_geometries[j].vertices_offset;
+            vkCmdBindVertexBuffers(cmd_buffer, 0, 1, m_model.vertex_buffer, &vertex_buffer_offset);
+            vkCmdBindIndexBuffer(cmd_buffer, m_model.index_buffer, m_model.sub_geometries[j].indices_offset * sizeof(uint32_t), VK_INDEX_TYPE_UINT32);
+            std::vector<VkDescriptorSet> desc_sets;
+            vkCmdDrawIndexed(cmd_buffer, m_model.sub_geometries[j].indices_size, 1, 0, 0, 0);
         }
     }
 
-    m_command_buffers = std::move(cmd_buffers);
+    vkCmdEndRenderPass(cmd_buffer);
+    vk_utils::sampler_feedback::record_readback_barrier(cmd_buffer);
+
+    if (vkEndCommandBuffer(cmd_buffer) != VK_SUCCESS) {
+        RAISE_ERROR_FATAL(-1, "cannot record command buffer.");
+    }
+
+    out_cmd_buffer = std::move(cmd_buffers);
 
     RAISE_ERROR_OK();
 }
+
+ERROR_TYPE test_ktx_app::update_texture_descriptor(uint32_t image)
+{
+    // evicted textures are reloaded on their next use, the previous descriptor is kept until then.
+    if (get_texture_image_info().imageView == nullptr) {
+        RAISE_ERROR_OK();
+    }
+
+    // the image command buffer is the only one binding the set and its previous submission completed,
+    // other images keep the previous texture until they are drawn again.
+    const uint32_t set = image % m_descriptor_set.handlers_count();
+    write_descriptor_set(set);
+
+    vk_utils::cmd_buffers_handler cmd_buffer{};
+    PASS_ERROR(record_command_buffer(image, cmd_buffer));
+
+    m_deletion_queue.retire(std::move(m_command_buffers[image]));
+    m_command_buffers[image] = std::move(cmd_buffer);
+    m_outdated_sets[set] = false;
+
+    RAISE_ERROR_OK();
+}
+
+void test_ktx_app::write_descriptor_set(uint32_t set)
+{
+    VkDescriptorBufferInfo desc_buffer_info{
+        .buffer = m_ubo,
+        .offset = 0,
+        .range = sizeof(global_ubo)
+    };
+
+    const VkDescriptorImageInfo desc_image_info = get_texture_image_info();
+    const VkDescriptorBufferInfo feedback_buffer_info = m_sampler_feedback.get_buffer_info(set);
+
+    VkWriteDescriptorSet write_ops[]{
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = m_descriptor_set[set],
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .pBufferInfo = &desc_buffer_info,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = m_descriptor_set[set],
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &desc_image_info
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = m_descriptor_set[set],
+            .dstBinding = 2,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &feedback_buffer_info,
+        },
+    };
+
+    vkUpdateDescriptorSets(vk_utils::context::get().device(), std::size(write_ops), write_ops, 0, nullptr);
+}
+
+VkDescriptorImageInfo test_ktx_app::get_texture_image_info() const
+{
+    const auto& model_texture = m_model.textures[0];
+
+    if (model_texture.residency_id < 0) {
+        return {
+            .sampler = model_texture.sampler,
+            .imageView = model_texture.image_view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+    }
+
+    const auto& texture = m_texture_residency.get_texture(model_texture.residency_id);
+
+    return {
+        .sampler = texture.sampler,
+        .imageView = texture.image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+}
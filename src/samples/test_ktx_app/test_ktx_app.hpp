@@ -2,6 +2,9 @@
 
 #include <base_obj_viewer_app.hpp>
 
+#include <vk_utils/texture_residency.hpp>
+#include <vk_utils/sampler_feedback.hpp>
+
 #include <vector>
 
 #include <glm/vec4.hpp>
@@ -23,11 +26,16 @@ protected:
     ERROR_TYPE draw_frame() override;
 
 private:
+    ERROR_TYPE init_texture_streaming();
     ERROR_TYPE init_render_passes();
     ERROR_TYPE init_framebuffers();
     ERROR_TYPE init_shaders();
     ERROR_TYPE init_pipelines();
     ERROR_TYPE record_command_buffers();
+    ERROR_TYPE record_command_buffer(uint32_t image, vk_utils::cmd_buffers_handler& out_cmd_buffer);
+    ERROR_TYPE update_texture_descriptor(uint32_t image);
+    void write_descriptor_set(uint32_t set);
+    VkDescriptorImageInfo get_texture_image_info() const;
 
     std::vector<VkPipeline> m_graphics_pipelines{};
     vk_utils::shader_module_handler m_vert_shader{};
@@ -48,7 +56,17 @@ private:
     vk_utils::pipeline_layout_handler m_pipeline_layout{};
     vk_utils::descriptor_set_layout_handler m_descriptor_set_layout{};
     vk_utils::descriptor_pool_handler m_descriptor_pool{};
+    // one set per swapchain image, each one with its own sampler feedback buffer.
     vk_utils::descriptor_set_handler m_descriptor_set{};
+    // sets still referencing a replaced model texture, updated before their image is drawn again.
+    std::vector<bool> m_outdated_sets{};
+
+    // one command buffer per swapchain image, re-recorded alone when its descriptor set is updated.
+    std::vector<vk_utils::cmd_buffers_handler> m_command_buffers{};
 
-    vk_utils::cmd_buffers_handler m_command_buffers{};
+    vk_utils::cmd_pool_handler m_residency_command_pool{};
+    vk_utils::texture_residency m_texture_residency{};
+    vk_utils::sampler_feedback m_sampler_feedback{};
+    // residency id of the drawn model texture, -1 when it is not streamed.
+    int32_t m_feedback_texture_id{-1};
 };
\ No newline at end of file
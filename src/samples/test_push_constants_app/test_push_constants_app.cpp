@@ -164,7 +164,7 @@ ERROR_TYPE test_push_constants_app::init_framebuffers()
         .usage = VMA_MEMORY_USAGE_GPU_ONLY
     };
 
-    if (depth_image.init(vk_utils::context::get().allocator(), &img_info, &alloc_info) != VK_SUCCESS) {
+    if (depth_image.init(vk_utils::context::get().allocator(), &img_info, &alloc_info, vk_utils::MEMORY_TAG_ATTACHMENTS) != VK_SUCCESS) {
         RAISE_ERROR_FATAL(-1, "cannot init depth image");
     }
 
@@ -218,6 +218,11 @@ ERROR_TYPE test_push_constants_app::init_framebuffers()
         }
     }
 
+    // the previous attachments may still be used by frames in flight after a swapchain recreation.
+    m_deletion_queue.retire(std::move(m_main_depth_image));
+    m_deletion_queue.retire(std::move(m_main_depth_image_view));
+    m_deletion_queue.retire(std::move(m_main_pass_framebuffers));
+
     m_main_depth_image = std::move(depth_image);
     m_main_depth_image_view = std::move(depth_image_view);
     m_main_pass_framebuffers = std::move(framebuffers);
@@ -675,6 +680,7 @@ ERROR_TYPE test_push_constants_app::record_command_buffers()
         }
     }
 
+    m_deletion_queue.retire(std::move(m_command_buffers));
     m_command_buffers = std::move(cmd_buffers);
 
     RAISE_ERROR_OK();
@@ -0,0 +1,135 @@
+#include <vk_utils/image_decoder.hpp>
+
+#include <stb/stb_image.h>
+
+#include <logger/log.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    struct bench_result
+    {
+        double ms{0};
+        double mpix_per_sec{0};
+    };
+
+    bench_result run_bench(uint32_t iterations, size_t pixels_count, const std::function<bool()>& func)
+    {
+        if (!func()) {
+            return {};
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < iterations; ++i) {
+            func();
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+
+        return {
+            .ms = ms,
+            .mpix_per_sec = pixels_count / (ms * 1e-3) / 1e6,
+        };
+    }
+
+
+    bool read_file(const char* path, std::vector<uint8_t>& out_data)
+    {
+        std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(fopen(path, "rb"), [](FILE* f) {if (f != nullptr) fclose(f); });
+
+        if (f_handle == nullptr) {
+            return false;
+        }
+
+        fseek(f_handle.get(), 0L, SEEK_END);
+        const size_t size = ftell(f_handle.get());
+        fseek(f_handle.get(), 0L, SEEK_SET);
+
+        out_data.resize(size);
+
+        return fread(out_data.data(), 1, size, f_handle.get()) == size;
+    }
+} // namespace
+
+
+int main(int argc, const char** argv)
+{
+    uint32_t iterations = 10;
+    std::vector<const char*> paths{};
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        LOG_INFO("usage: image_decode_bench [-n <iterations>] <images...>");
+        LOG_INFO("e.g. image_decode_bench Cat_diffuse.jpg cottage_diffuse.png skybox/*.jpg");
+        return 1;
+    }
+
+    for (const char* path : paths) {
+        std::vector<uint8_t> file_data{};
+
+        if (!read_file(path, file_data)) {
+            LOG_ERROR("cannot read ", path);
+            continue;
+        }
+
+        vk_utils::decoded_image_info info{};
+        const vk_utils::image_decoder* decoder = vk_utils::find_image_decoder(file_data.data(), file_data.size(), info);
+
+        if (decoder == nullptr) {
+            LOG_ERROR("cannot decode ", path);
+            continue;
+        }
+
+        const size_t pixels_count = size_t(info.width) * info.height;
+        const uint32_t channels_count = 4;
+
+        std::vector<uint8_t> stb_pixels(pixels_count * channels_count);
+        std::vector<uint8_t> decoder_pixels(pixels_count * channels_count);
+
+        const auto stb = run_bench(iterations, pixels_count, [&]() {
+            int w, h, c;
+            stbi_uc* pixels = stbi_load_from_memory(file_data.data(), file_data.size(), &w, &h, &c, channels_count);
+
+            if (pixels == nullptr) {
+                return false;
+            }
+
+            std::memcpy(stb_pixels.data(), pixels, stb_pixels.size());
+            stbi_image_free(pixels);
+
+            return true;
+        });
+
+        const auto decoded = run_bench(iterations, pixels_count, [&]() {
+            return decoder->decode(file_data.data(), file_data.size(), channels_count, decoder_pixels.data());
+        });
+
+        uint32_t max_diff = 0;
+
+        for (size_t i = 0; i < stb_pixels.size(); ++i) {
+            max_diff = std::max<uint32_t>(max_diff, std::abs(int(stb_pixels[i]) - int(decoder_pixels[i])));
+        }
+
+        LOG_INFO(
+            path, " (", info.width, "x", info.height, "x", info.channels_count, "): stb ", stb.ms, " ms (", stb.mpix_per_sec, " MPix/s), ",
+            decoder->get_name(), " ", decoded.ms, " ms (", decoded.mpix_per_sec, " MPix/s), speedup ", stb.ms / decoded.ms, "x, max channel diff ", max_diff);
+    }
+
+    return 0;
+}
@@ -0,0 +1,487 @@
+
+#include "bc_encoder.hpp"
+
+#include <vk_utils/tools.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+    constexpr uint32_t block_pixels_count = 16;
+
+    struct bit_writer
+    {
+        void write(uint64_t value, uint32_t bits_count)
+        {
+            for (uint32_t i = 0; i < bits_count; ++i, ++offset) {
+                data[offset / 8] |= static_cast<uint8_t>(((value >> i) & 1u) << (offset % 8));
+            }
+        }
+
+        uint8_t* data;
+        uint32_t offset{0};
+    };
+
+    void load_block(const uint8_t* rgba_pixels, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, uint8_t (&block)[block_pixels_count][4])
+    {
+        for (uint32_t y = 0; y < 4; ++y) {
+            const uint32_t src_y = std::min(block_y * 4 + y, height - 1);
+
+            for (uint32_t x = 0; x < 4; ++x) {
+                const uint32_t src_x = std::min(block_x * 4 + x, width - 1);
+                const uint8_t* src = rgba_pixels + (src_y * width + src_x) * 4;
+                std::copy(src, src + 4, block[y * 4 + x]);
+            }
+        }
+    }
+
+    template<uint32_t ChannelsCount>
+    void get_principal_axis(const uint8_t (&block)[block_pixels_count][4], float (&mean)[ChannelsCount], float (&axis)[ChannelsCount])
+    {
+        for (uint32_t c = 0; c < ChannelsCount; ++c) {
+            mean[c] = 0;
+
+            for (uint32_t i = 0; i < block_pixels_count; ++i) {
+                mean[c] += block[i][c];
+            }
+
+            mean[c] /= block_pixels_count;
+        }
+
+        float covariance[ChannelsCount][ChannelsCount]{};
+
+        for (uint32_t i = 0; i < block_pixels_count; ++i) {
+            for (uint32_t c0 = 0; c0 < ChannelsCount; ++c0) {
+                for (uint32_t c1 = 0; c1 < ChannelsCount; ++c1) {
+                    covariance[c0][c1] += (block[i][c0] - mean[c0]) * (block[i][c1] - mean[c1]);
+                }
+            }
+        }
+
+        for (uint32_t c = 0; c < ChannelsCount; ++c) {
+            axis[c] = 1.0f;
+        }
+
+        for (uint32_t iteration = 0; iteration < 8; ++iteration) {
+            float next_axis[ChannelsCount]{};
+            float max_component = 0;
+
+            for (uint32_t c0 = 0; c0 < ChannelsCount; ++c0) {
+                for (uint32_t c1 = 0; c1 < ChannelsCount; ++c1) {
+                    next_axis[c0] += covariance[c0][c1] * axis[c1];
+                }
+
+                max_component = std::max(max_component, std::abs(next_axis[c0]));
+            }
+
+            if (max_component < 1e-6f) {
+                break;
+            }
+
+            for (uint32_t c = 0; c < ChannelsCount; ++c) {
+                axis[c] = next_axis[c] / max_component;
+            }
+        }
+    }
+
+    template<uint32_t ChannelsCount>
+    void get_axis_endpoints(const uint8_t (&block)[block_pixels_count][4], float (&e0)[ChannelsCount], float (&e1)[ChannelsCount])
+    {
+        float mean[ChannelsCount];
+        float axis[ChannelsCount];
+        get_principal_axis(block, mean, axis);
+
+        float min_t = 0;
+        float max_t = 0;
+
+        for (uint32_t i = 0; i < block_pixels_count; ++i) {
+            float t = 0;
+
+            for (uint32_t c = 0; c < ChannelsCount; ++c) {
+                t += (block[i][c] - mean[c]) * axis[c];
+            }
+
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        float axis_length = 0;
+
+        for (uint32_t c = 0; c < ChannelsCount; ++c) {
+            axis_length += axis[c] * axis[c];
+        }
+
+        axis_length = axis_length > 0 ? axis_length : 1.0f;
+
+        for (uint32_t c = 0; c < ChannelsCount; ++c) {
+            e0[c] = std::clamp(mean[c] + axis[c] * max_t / axis_length, 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + axis[c] * min_t / axis_length, 0.0f, 255.0f);
+        }
+    }
+
+    uint16_t pack_565(const float (&color)[3])
+    {
+        const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+        const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+        const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return (r << 11) | (g << 5) | b;
+    }
+
+    void unpack_565(uint16_t color, int32_t (&res)[3])
+    {
+        const int32_t r = (color >> 11) & 31;
+        const int32_t g = (color >> 5) & 63;
+        const int32_t b = color & 31;
+        res[0] = (r << 3) | (r >> 2);
+        res[1] = (g << 2) | (g >> 4);
+        res[2] = (b << 3) | (b >> 2);
+    }
+
+    void encode_bc1_color(const uint8_t (&block)[block_pixels_count][4], uint8_t* out)
+    {
+        float e0[3];
+        float e1[3];
+        get_axis_endpoints<3>(block, e0, e1);
+
+        uint16_t c0 = pack_565(e0);
+        uint16_t c1 = pack_565(e1);
+
+        if (c0 < c1) {
+            std::swap(c0, c1);
+        }
+
+        uint32_t indices = 0;
+
+        if (c0 != c1) {
+            int32_t palette[4][3];
+            unpack_565(c0, palette[0]);
+            unpack_565(c1, palette[1]);
+
+            for (uint32_t c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (uint32_t i = 0; i < block_pixels_count; ++i) {
+                uint32_t best_index = 0;
+                int32_t best_error = INT32_MAX;
+
+                for (uint32_t p = 0; p < 4; ++p) {
+                    int32_t error = 0;
+
+                    for (uint32_t c = 0; c < 3; ++c) {
+                        const int32_t d = block[i][c] - palette[p][c];
+                        error += d * d;
+                    }
+
+                    if (error < best_error) {
+                        best_error = error;
+                        best_index = p;
+                    }
+                }
+
+                indices |= best_index << (i * 2);
+            }
+        }
+
+        out[0] = c0 & 0xFF;
+        out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF;
+        out[3] = c1 >> 8;
+        out[4] = indices & 0xFF;
+        out[5] = (indices >> 8) & 0xFF;
+        out[6] = (indices >> 16) & 0xFF;
+        out[7] = indices >> 24;
+    }
+
+    void encode_bc4_alpha(const uint8_t (&block)[block_pixels_count][4], uint8_t* out)
+    {
+        uint8_t a0 = 0;
+        uint8_t a1 = 255;
+
+        for (uint32_t i = 0; i < block_pixels_count; ++i) {
+            a0 = std::max(a0, block[i][3]);
+            a1 = std::min(a1, block[i][3]);
+        }
+
+        int32_t palette[8]{a0, a1};
+
+        for (int32_t i = 1; i < 7; ++i) {
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+
+        uint64_t indices = 0;
+
+        if (a0 != a1) {
+            for (uint32_t i = 0; i < block_pixels_count; ++i) {
+                uint64_t best_index = 0;
+                int32_t best_error = INT32_MAX;
+
+                for (uint32_t p = 0; p < 8; ++p) {
+                    const int32_t error = std::abs(block[i][3] - palette[p]);
+
+                    if (error < best_error) {
+                        best_error = error;
+                        best_index = p;
+                    }
+                }
+
+                indices |= best_index << (i * 3);
+            }
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+
+        for (uint32_t i = 0; i < 6; ++i) {
+            out[2 + i] = (indices >> (i * 8)) & 0xFF;
+        }
+    }
+
+    constexpr int32_t bc7_weights4[16]{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct bc7_endpoint
+    {
+        int32_t values[4];
+        int32_t p_bit;
+    };
+
+    bc7_endpoint quantize_bc7_endpoint(const float (&color)[4])
+    {
+        bc7_endpoint best{};
+        float best_error = -1;
+
+        for (int32_t p_bit = 0; p_bit < 2; ++p_bit) {
+            bc7_endpoint endpoint{.p_bit = p_bit};
+            float error = 0;
+
+            for (uint32_t c = 0; c < 4; ++c) {
+                endpoint.values[c] = std::clamp(static_cast<int32_t>(std::lround((color[c] - p_bit) / 2.0f)), 0, 127);
+                const float d = ((endpoint.values[c] << 1) | p_bit) - color[c];
+                error += d * d;
+            }
+
+            if (best_error < 0 || error < best_error) {
+                best_error = error;
+                best = endpoint;
+            }
+        }
+
+        return best;
+    }
+
+    int64_t assign_bc7_indices(const uint8_t (&block)[block_pixels_count][4], const bc7_endpoint& e0, const bc7_endpoint& e1, uint32_t (&indices)[block_pixels_count])
+    {
+        int32_t palette[16][4];
+
+        for (uint32_t c = 0; c < 4; ++c) {
+            const int32_t v0 = (e0.values[c] << 1) | e0.p_bit;
+            const int32_t v1 = (e1.values[c] << 1) | e1.p_bit;
+
+            for (uint32_t p = 0; p < 16; ++p) {
+                palette[p][c] = ((64 - bc7_weights4[p]) * v0 + bc7_weights4[p] * v1 + 32) >> 6;
+            }
+        }
+
+        int64_t total_error = 0;
+
+        for (uint32_t i = 0; i < block_pixels_count; ++i) {
+            int32_t best_error = INT32_MAX;
+
+            for (uint32_t p = 0; p < 16; ++p) {
+                int32_t error = 0;
+
+                for (uint32_t c = 0; c < 4; ++c) {
+                    const int32_t d = block[i][c] - palette[p][c];
+                    error += d * d;
+                }
+
+                if (error < best_error) {
+                    best_error = error;
+                    indices[i] = p;
+                }
+            }
+
+            total_error += best_error;
+        }
+
+        return total_error;
+    }
+
+    bool refine_bc7_endpoints(const uint8_t (&block)[block_pixels_count][4], const uint32_t (&indices)[block_pixels_count], float (&e0)[4], float (&e1)[4])
+    {
+        float aa = 0;
+        float ab = 0;
+        float bb = 0;
+        float ax[4]{};
+        float bx[4]{};
+
+        for (uint32_t i = 0; i < block_pixels_count; ++i) {
+            const float t = bc7_weights4[indices[i]] / 64.0f;
+            const float a = 1.0f - t;
+
+            aa += a * a;
+            ab += a * t;
+            bb += t * t;
+
+            for (uint32_t c = 0; c < 4; ++c) {
+                ax[c] += a * block[i][c];
+                bx[c] += t * block[i][c];
+            }
+        }
+
+        const float det = aa * bb - ab * ab;
+
+        if (std::abs(det) < 1e-6f) {
+            return false;
+        }
+
+        for (uint32_t c = 0; c < 4; ++c) {
+            e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+            e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+        }
+
+        return true;
+    }
+
+    void encode_bc7_mode6(const uint8_t (&block)[block_pixels_count][4], uint8_t* out)
+    {
+        float e0[4];
+        float e1[4];
+        get_axis_endpoints<4>(block, e0, e1);
+
+        auto q0 = quantize_bc7_endpoint(e0);
+        auto q1 = quantize_bc7_endpoint(e1);
+
+        uint32_t indices[block_pixels_count];
+        int64_t error = assign_bc7_indices(block, q0, q1, indices);
+
+        for (uint32_t iteration = 0; iteration < 2 && error > 0; ++iteration) {
+            if (!refine_bc7_endpoints(block, indices, e0, e1)) {
+                break;
+            }
+
+            const auto refined_q0 = quantize_bc7_endpoint(e0);
+            const auto refined_q1 = quantize_bc7_endpoint(e1);
+
+            uint32_t refined_indices[block_pixels_count];
+            const int64_t refined_error = assign_bc7_indices(block, refined_q0, refined_q1, refined_indices);
+
+            if (refined_error >= error) {
+                break;
+            }
+
+            q0 = refined_q0;
+            q1 = refined_q1;
+            error = refined_error;
+            std::copy(std::begin(refined_indices), std::end(refined_indices), std::begin(indices));
+        }
+
+        if (indices[0] & 8u) {
+            std::swap(q0, q1);
+
+            for (auto& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::fill(out, out + 16, 0);
+        bit_writer writer{.data = out};
+
+        writer.write(1u << 6, 7);
+
+        for (uint32_t c = 0; c < 4; ++c) {
+            writer.write(q0.values[c], 7);
+            writer.write(q1.values[c], 7);
+        }
+
+        writer.write(q0.p_bit, 1);
+        writer.write(q1.p_bit, 1);
+
+        for (uint32_t i = 0; i < block_pixels_count; ++i) {
+            writer.write(indices[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    void encode_block(VkFormat format, const uint8_t (&block)[block_pixels_count][4], uint8_t* out)
+    {
+        switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                [[fallthrough]];
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                encode_bc1_color(block, out);
+                break;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+                [[fallthrough]];
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                encode_bc4_alpha(block, out);
+                encode_bc1_color(block, out + 8);
+                break;
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+                [[fallthrough]];
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                encode_bc7_mode6(block, out);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+bool ktx_baker::is_bc_format(VkFormat format)
+{
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+std::vector<uint8_t> ktx_baker::compress_level(VkFormat format, const uint8_t* rgba_pixels, uint32_t width, uint32_t height, uint32_t threads_count)
+{
+    const uint32_t block_size = vk_utils::get_format_texel_block_size(format);
+    const uint32_t blocks_x = (width + 3) / 4;
+    const uint32_t blocks_y = (height + 3) / 4;
+
+    std::vector<uint8_t> res(blocks_x * blocks_y * block_size);
+
+    std::atomic_uint32_t next_row{0};
+
+    auto compress_rows = [&]() {
+        uint8_t block[block_pixels_count][4];
+
+        for (auto row = next_row++; row < blocks_y; row = next_row++) {
+            for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+                load_block(rgba_pixels, width, height, block_x, row, block);
+                encode_block(format, block, res.data() + (row * blocks_x + block_x) * block_size);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers{};
+    const uint32_t workers_count = std::min(std::max(1u, threads_count), blocks_y) - 1;
+    workers.reserve(workers_count);
+
+    for (uint32_t i = 0; i < workers_count; ++i) {
+        workers.emplace_back(compress_rows);
+    }
+
+    compress_rows();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return res;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cinttypes>
+#include <vector>
+
+namespace ktx_baker
+{
+    bool is_bc_format(VkFormat format);
+
+    // scalar BC1, BC3 and BC7 mode 6 encoders, the level block rows are split between threads_count threads.
+    std::vector<uint8_t> compress_level(VkFormat format, const uint8_t* rgba_pixels, uint32_t width, uint32_t height, uint32_t threads_count);
+}
@@ -0,0 +1,237 @@
+
+#include "ktx2_writer.hpp"
+
+#include <vk_utils/tools.hpp>
+
+#include <cstring>
+#include <memory>
+#include <functional>
+#include <numeric>
+
+namespace
+{
+    struct ktx2_header
+    {
+        char identifier[12];
+        uint32_t vk_format;
+        uint32_t type_size;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t layer_count;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t supercompression_scheme;
+
+        uint32_t dfd_byte_offset;
+        uint32_t dfd_byte_length;
+        uint32_t kvd_byte_offset;
+        uint32_t kvd_byte_length;
+        uint64_t sgd_byte_offset;
+        uint64_t sgd_byte_length;
+    };
+
+    struct level_index
+    {
+        uint64_t byte_offset;
+        uint64_t byte_length;
+        uint64_t uncompressed_byte_length;
+    };
+
+    constexpr unsigned char ktx2_identifier[]{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+    constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+    constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+    constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+    constexpr uint32_t KHR_DF_CHANNEL_COLOR = 0;
+    constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+
+    struct dfd_sample
+    {
+        uint32_t bit_offset;
+        uint32_t bit_length;
+        uint32_t channel_type;
+        uint32_t upper;
+    };
+
+    struct format_desc
+    {
+        uint32_t color_model;
+        bool srgb;
+        uint32_t block_dimension;
+        std::vector<dfd_sample> samples;
+    };
+
+    std::vector<dfd_sample> get_uncompressed_samples(uint32_t channel_count)
+    {
+        std::vector<dfd_sample> samples{};
+
+        for (uint32_t channel = 0; channel < channel_count; ++channel) {
+            const bool alpha = (channel_count == 4 && channel == 3) || (channel_count == 2 && channel == 1);
+            samples.push_back({channel * 8, 7, alpha ? KHR_DF_CHANNEL_ALPHA : channel, 255});
+        }
+
+        return samples;
+    }
+
+    bool get_format_desc(VkFormat format, format_desc& desc)
+    {
+        switch (format) {
+            case VK_FORMAT_R8_UNORM:
+                [[fallthrough]];
+            case VK_FORMAT_R8_SRGB:
+                desc = {KHR_DF_MODEL_RGBSDA, format == VK_FORMAT_R8_SRGB, 1, get_uncompressed_samples(1)};
+                return true;
+            case VK_FORMAT_R8G8_UNORM:
+                [[fallthrough]];
+            case VK_FORMAT_R8G8_SRGB:
+                desc = {KHR_DF_MODEL_RGBSDA, format == VK_FORMAT_R8G8_SRGB, 1, get_uncompressed_samples(2)};
+                return true;
+            case VK_FORMAT_R8G8B8_UNORM:
+                [[fallthrough]];
+            case VK_FORMAT_R8G8B8_SRGB:
+                desc = {KHR_DF_MODEL_RGBSDA, format == VK_FORMAT_R8G8B8_SRGB, 1, get_uncompressed_samples(3)};
+                return true;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                [[fallthrough]];
+            case VK_FORMAT_R8G8B8A8_SRGB:
+                desc = {KHR_DF_MODEL_RGBSDA, format == VK_FORMAT_R8G8B8A8_SRGB, 1, get_uncompressed_samples(4)};
+                return true;
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                [[fallthrough]];
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                desc = {KHR_DF_MODEL_BC1A, format == VK_FORMAT_BC1_RGB_SRGB_BLOCK, 4, {{0, 63, KHR_DF_CHANNEL_COLOR, UINT32_MAX}}};
+                return true;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+                [[fallthrough]];
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                desc = {KHR_DF_MODEL_BC3, format == VK_FORMAT_BC3_SRGB_BLOCK, 4, {{0, 63, KHR_DF_CHANNEL_ALPHA, UINT32_MAX}, {64, 63, KHR_DF_CHANNEL_COLOR, UINT32_MAX}}};
+                return true;
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+                [[fallthrough]];
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                desc = {KHR_DF_MODEL_BC7, format == VK_FORMAT_BC7_SRGB_BLOCK, 4, {{0, 127, KHR_DF_CHANNEL_COLOR, UINT32_MAX}}};
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::vector<uint32_t> make_dfd(const format_desc& desc, uint32_t bytes_plane)
+    {
+        const uint32_t block_size = 24 + 16 * desc.samples.size();
+        const uint32_t block_dimension = desc.block_dimension - 1;
+
+        std::vector<uint32_t> dfd{};
+        dfd.reserve(1 + block_size / 4);
+
+        dfd.push_back(4 + block_size);
+        dfd.push_back(0);
+        dfd.push_back(2 | (block_size << 16));
+        dfd.push_back(desc.color_model | (KHR_DF_PRIMARIES_BT709 << 8) | ((desc.srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+        dfd.push_back(block_dimension | (block_dimension << 8));
+        dfd.push_back(bytes_plane);
+        dfd.push_back(0);
+
+        for (const auto& sample : desc.samples) {
+            uint32_t channel_type = sample.channel_type;
+
+            if (sample.channel_type == KHR_DF_CHANNEL_ALPHA && desc.srgb) {
+                channel_type |= KHR_DF_SAMPLE_DATATYPE_LINEAR;
+            }
+
+            dfd.push_back(sample.bit_offset | (sample.bit_length << 16) | (channel_type << 24));
+            dfd.push_back(0);
+            dfd.push_back(0);
+            dfd.push_back(sample.upper);
+        }
+
+        return dfd;
+    }
+
+    uint64_t align_up(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+
+ERROR_TYPE ktx_baker::write_ktx2(const char* path, const ktx2_image& image)
+{
+    format_desc desc{};
+
+    if (!get_format_desc(image.format, desc)) {
+        RAISE_ERROR_WARN(-1, "unsupported ktx2 output format.");
+    }
+
+    if (image.levels.empty()) {
+        RAISE_ERROR_WARN(-1, "ktx2 image has no levels.");
+    }
+
+    const uint32_t texel_block_size = vk_utils::get_format_texel_block_size(image.format);
+    const auto dfd = make_dfd(desc, texel_block_size);
+    const uint32_t level_count = image.levels.size();
+    const uint64_t level_alignment = std::lcm<uint64_t>(texel_block_size, 4);
+
+    ktx2_header header{};
+    std::memcpy(header.identifier, ktx2_identifier, sizeof(ktx2_identifier));
+    header.vk_format = image.format;
+    header.type_size = 1;
+    header.pixel_width = image.width;
+    header.pixel_height = image.height;
+    header.pixel_depth = 0;
+    header.layer_count = 0;
+    header.face_count = 1;
+    header.level_count = level_count;
+    header.supercompression_scheme = 0;
+    header.dfd_byte_offset = sizeof(ktx2_header) + sizeof(level_index) * level_count;
+    header.dfd_byte_length = dfd.size() * sizeof(uint32_t);
+    header.kvd_byte_offset = 0;
+    header.kvd_byte_length = 0;
+    header.sgd_byte_offset = 0;
+    header.sgd_byte_length = 0;
+
+    std::vector<level_index> levels_index(level_count);
+    uint64_t offset = header.dfd_byte_offset + header.dfd_byte_length;
+
+    for (uint32_t level = level_count; level > 0; --level) {
+        auto& index = levels_index[level - 1];
+        offset = align_up(offset, level_alignment);
+        index.byte_offset = offset;
+        index.byte_length = image.levels[level - 1].size();
+        index.uncompressed_byte_length = index.byte_length;
+        offset += index.byte_length;
+    }
+
+    std::unique_ptr<FILE, std::function<void(FILE*)>> f_handle(nullptr, [](FILE* f) { fclose(f); });
+    f_handle.reset(fopen(path, "wb"));
+
+    if (f_handle == nullptr) {
+        RAISE_ERROR_WARN(-1, "cannot open ktx2 output file.");
+    }
+
+    fwrite(&header, sizeof(header), 1, f_handle.get());
+    fwrite(levels_index.data(), sizeof(level_index), levels_index.size(), f_handle.get());
+    fwrite(dfd.data(), sizeof(uint32_t), dfd.size(), f_handle.get());
+
+    uint64_t written = header.dfd_byte_offset + header.dfd_byte_length;
+    constexpr uint8_t padding[16]{};
+
+    for (uint32_t level = level_count; level > 0; --level) {
+        const auto& index = levels_index[level - 1];
+        fwrite(padding, 1, index.byte_offset - written, f_handle.get());
+        fwrite(image.levels[level - 1].data(), 1, index.byte_length, f_handle.get());
+        written = index.byte_offset + index.byte_length;
+    }
+
+    if (ferror(f_handle.get()) != 0) {
+        RAISE_ERROR_WARN(-1, "cannot write ktx2 output file.");
+    }
+
+    RAISE_ERROR_OK();
+}
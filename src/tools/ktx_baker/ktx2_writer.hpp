@@ -0,0 +1,20 @@
+#pragma once
+
+#include <errors/error_handler.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace ktx_baker
+{
+    struct ktx2_image
+    {
+        VkFormat format{VK_FORMAT_UNDEFINED};
+        uint32_t width{0};
+        uint32_t height{0};
+        std::vector<std::vector<uint8_t>> levels{};
+    };
+
+    ERROR_TYPE write_ktx2(const char* path, const ktx2_image& image);
+}
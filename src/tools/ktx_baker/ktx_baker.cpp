@@ -0,0 +1,185 @@
+
+#include "ktx_baker.hpp"
+#include "ktx2_writer.hpp"
+#include "bc_encoder.hpp"
+
+#include <vk_utils/tools.hpp>
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <memory>
+
+namespace
+{
+    struct srgb_tables
+    {
+        srgb_tables()
+        {
+            for (uint32_t i = 0; i < to_linear.size(); ++i) {
+                const float c = i / 255.0f;
+                to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for (uint32_t i = 0; i < to_srgb.size(); ++i) {
+                const float c = i / float(to_srgb.size() - 1);
+                const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                to_srgb[i] = static_cast<uint8_t>(std::clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+        }
+
+        std::array<float, 256> to_linear{};
+        std::array<uint8_t, 4096> to_srgb{};
+    };
+
+    const srgb_tables& get_srgb_tables()
+    {
+        static const srgb_tables tables{};
+        return tables;
+    }
+
+    VkFormat get_output_format(uint32_t channel_count, const ktx_baker::bake_options& options)
+    {
+        const bool linear = options.linear;
+
+        switch (options.compression) {
+            case ktx_baker::COMPRESSION_BC1:
+                return linear ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+            case ktx_baker::COMPRESSION_BC3:
+                return linear ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+            case ktx_baker::COMPRESSION_BC7:
+                return linear ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+            default:
+                break;
+        }
+
+        if (channel_count == STBI_rgb) {
+            return linear ? VK_FORMAT_R8G8B8_UNORM : VK_FORMAT_R8G8B8_SRGB;
+        }
+
+        return linear ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+    }
+
+    std::vector<float> decode_level(const uint8_t* pixels, size_t pixels_count, uint32_t channel_count, bool linear)
+    {
+        const auto& tables = get_srgb_tables();
+        const bool has_alpha = channel_count == 2 || channel_count == 4;
+
+        std::vector<float> res(pixels_count * channel_count);
+
+        for (size_t i = 0; i < res.size(); ++i) {
+            const bool is_alpha = has_alpha && i % channel_count == channel_count - 1;
+            res[i] = linear || is_alpha ? pixels[i] / 255.0f : tables.to_linear[pixels[i]];
+        }
+
+        return res;
+    }
+
+    std::vector<uint8_t> encode_level(const std::vector<float>& pixels, uint32_t channel_count, bool linear)
+    {
+        const auto& tables = get_srgb_tables();
+        const bool has_alpha = channel_count == 2 || channel_count == 4;
+        const float srgb_scale = tables.to_srgb.size() - 1;
+
+        std::vector<uint8_t> res(pixels.size());
+
+        for (size_t i = 0; i < res.size(); ++i) {
+            const float c = std::clamp(pixels[i], 0.0f, 1.0f);
+            const bool is_alpha = has_alpha && i % channel_count == channel_count - 1;
+            res[i] = linear || is_alpha ? static_cast<uint8_t>(c * 255.0f + 0.5f) : tables.to_srgb[static_cast<size_t>(c * srgb_scale + 0.5f)];
+        }
+
+        return res;
+    }
+
+    std::vector<float> downsample_level(const std::vector<float>& src, uint32_t width, uint32_t height, uint32_t channel_count)
+    {
+        const uint32_t dst_width = std::max(1u, width / 2);
+        const uint32_t dst_height = std::max(1u, height / 2);
+
+        std::vector<float> dst(dst_width * dst_height * channel_count);
+
+        for (uint32_t y = 0; y < dst_height; ++y) {
+            const uint32_t y0 = std::min(y * 2, height - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+            for (uint32_t x = 0; x < dst_width; ++x) {
+                const uint32_t x0 = std::min(x * 2, width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+                for (uint32_t c = 0; c < channel_count; ++c) {
+                    dst[(y * dst_width + x) * channel_count + c] = 0.25f * (
+                        src[(y0 * width + x0) * channel_count + c] +
+                        src[(y0 * width + x1) * channel_count + c] +
+                        src[(y1 * width + x0) * channel_count + c] +
+                        src[(y1 * width + x1) * channel_count + c]);
+                }
+            }
+        }
+
+        return dst;
+    }
+}
+
+
+ERROR_TYPE ktx_baker::bake_texture(const char* src_path, const char* dst_path, const bake_options& options)
+{
+    int w, h, c;
+
+    if (stbi_info(src_path, &w, &h, &c) == 0) {
+        RAISE_ERROR_WARN(-1, std::string("cannot read image ") + src_path);
+    }
+
+    // the runtime ktx path uses identity swizzles, so grey images are expanded like rgb ones
+    const uint32_t channel_count = c == STBI_rgb && options.keep_rgb && options.compression == COMPRESSION_NONE ? STBI_rgb : STBI_rgb_alpha;
+
+    std::unique_ptr<stbi_uc, std::function<void(stbi_uc*)>> image_handler{
+        stbi_load(src_path, &w, &h, &c, channel_count),
+        [](stbi_uc* ptr) {if (ptr != nullptr) stbi_image_free(ptr); }};
+
+    if (image_handler == nullptr) {
+        RAISE_ERROR_WARN(-1, std::string("cannot load image ") + src_path);
+    }
+
+    ktx2_image image{
+        .format = get_output_format(channel_count, options),
+        .width = static_cast<uint32_t>(w),
+        .height = static_cast<uint32_t>(h),
+    };
+
+    const uint32_t level_count = options.gen_mips ? vk_utils::get_full_mip_levels(image.width, image.height) : 1;
+    image.levels.reserve(level_count);
+    image.levels.emplace_back(image_handler.get(), image_handler.get() + w * h * channel_count);
+
+    uint32_t level_width = w;
+    uint32_t level_height = h;
+    auto level_pixels = decode_level(image_handler.get(), w * h, channel_count, options.linear);
+
+    image_handler.reset();
+
+    for (uint32_t level = 1; level < level_count; ++level) {
+        level_pixels = downsample_level(level_pixels, level_width, level_height, channel_count);
+        level_width = std::max(1u, level_width / 2);
+        level_height = std::max(1u, level_height / 2);
+
+        image.levels.emplace_back(encode_level(level_pixels, channel_count, options.linear));
+    }
+
+    if (is_bc_format(image.format)) {
+        uint32_t compressed_width = image.width;
+        uint32_t compressed_height = image.height;
+
+        for (auto& level : image.levels) {
+            level = compress_level(image.format, level.data(), compressed_width, compressed_height, options.encode_threads_count);
+            compressed_width = std::max(1u, compressed_width / 2);
+            compressed_height = std::max(1u, compressed_height / 2);
+        }
+    }
+
+    PASS_ERROR(write_ktx2(dst_path, image));
+
+    RAISE_ERROR_OK();
+}
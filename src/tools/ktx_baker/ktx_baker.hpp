@@ -0,0 +1,27 @@
+#pragma once
+
+#include <errors/error_handler.hpp>
+
+#include <cinttypes>
+
+namespace ktx_baker
+{
+    enum compression_type
+    {
+        COMPRESSION_NONE,
+        COMPRESSION_BC1,
+        COMPRESSION_BC3,
+        COMPRESSION_BC7
+    };
+
+    struct bake_options
+    {
+        bool linear = false;
+        bool keep_rgb = false;
+        bool gen_mips = true;
+        compression_type compression = COMPRESSION_NONE;
+        uint32_t encode_threads_count = 1;
+    };
+
+    ERROR_TYPE bake_texture(const char* src_path, const char* dst_path, const bake_options& options);
+}
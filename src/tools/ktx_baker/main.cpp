@@ -0,0 +1,99 @@
+#include "ktx_baker.hpp"
+
+#include <logger/log.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct bake_job
+    {
+        std::string src_path;
+        std::string dst_path;
+    };
+
+    void print_usage()
+    {
+        LOG_INFO("usage: ktx_baker [-o <output dir>] [-j <threads count>] [--linear] [--keep-rgb] [--no-mips] [--bc1|--bc3|--bc7] <images...>");
+    }
+}
+
+
+int main(int argc, const char** argv)
+{
+    ktx_baker::bake_options options{};
+    std::filesystem::path output_dir{};
+    uint32_t threads_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::filesystem::path> src_paths{};
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads_count = std::max(1, std::atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--linear") == 0) {
+            options.linear = true;
+        } else if (strcmp(argv[i], "--keep-rgb") == 0) {
+            options.keep_rgb = true;
+        } else if (strcmp(argv[i], "--no-mips") == 0) {
+            options.gen_mips = false;
+        } else if (strcmp(argv[i], "--bc1") == 0) {
+            options.compression = ktx_baker::COMPRESSION_BC1;
+        } else if (strcmp(argv[i], "--bc3") == 0) {
+            options.compression = ktx_baker::COMPRESSION_BC3;
+        } else if (strcmp(argv[i], "--bc7") == 0) {
+            options.compression = ktx_baker::COMPRESSION_BC7;
+        } else if (argv[i][0] == '-') {
+            print_usage();
+            return 1;
+        } else {
+            src_paths.emplace_back(argv[i]);
+        }
+    }
+
+    if (src_paths.empty()) {
+        print_usage();
+        return 1;
+    }
+
+    if (!output_dir.empty()) {
+        std::filesystem::create_directories(output_dir);
+    }
+
+    std::vector<bake_job> jobs{};
+    jobs.reserve(src_paths.size());
+
+    for (const auto& src_path : src_paths) {
+        auto dst_path = output_dir.empty() ? src_path : output_dir / src_path.filename();
+        dst_path.replace_extension(".ktx2");
+        jobs.push_back({src_path.string(), dst_path.string()});
+    }
+
+    options.encode_threads_count = std::max<uint32_t>(1, threads_count / jobs.size());
+
+    std::atomic_uint32_t next_job{0};
+    std::vector<std::thread> workers{};
+    workers.reserve(threads_count);
+
+    for (uint32_t i = 0; i < std::min<size_t>(threads_count, jobs.size()); ++i) {
+        workers.emplace_back([&jobs, &next_job, &options]() {
+            for (auto job = next_job++; job < jobs.size(); job = next_job++) {
+                HANDLE_ERROR(ktx_baker::bake_texture(jobs[job].src_path.c_str(), jobs[job].dst_path.c_str(), options));
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    LOG_INFO("processed ", jobs.size(), " textures.");
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <vk_utils/pixel_convert.hpp>
+
+#include <logger/log.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct bench_result
+    {
+        double ms{0};
+        double gb_per_sec{0};
+    };
+
+    bench_result run_bench(uint32_t iterations, size_t processed_bytes, const std::function<void()>& func)
+    {
+        func();
+
+        const auto begin = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < iterations; ++i) {
+            func();
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+
+        return {
+            .ms = ms,
+            .gb_per_sec = processed_bytes / (ms * 1e-3) / 1e9,
+        };
+    }
+
+
+    void report(const char* name, const bench_result& scalar, const bench_result& simd, bool match)
+    {
+        LOG_INFO(
+            name, ": scalar ", scalar.ms, " ms (", scalar.gb_per_sec, " GB/s), simd ", simd.ms, " ms (", simd.gb_per_sec, " GB/s), speedup ",
+            scalar.ms / simd.ms, "x", match ? "" : " RESULTS MISMATCH");
+    }
+} // namespace
+
+
+int main(int argc, const char** argv)
+{
+    const uint32_t width = argc > 2 ? std::atoi(argv[1]) : 4096;
+    const uint32_t height = argc > 2 ? std::atoi(argv[2]) : 4096;
+    const uint32_t iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 10;
+    const size_t pixels_count = size_t(width) * height;
+
+    LOG_INFO("converting ", width, "x", height, " pixels, ", iterations, " iterations.");
+
+    std::vector<uint8_t> src(pixels_count * 4);
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<uint32_t> dist{0, 255};
+
+    for (auto& v : src) {
+        v = dist(rng);
+    }
+
+    std::vector<uint8_t> scalar_dst(pixels_count * 4);
+    std::vector<uint8_t> simd_dst(pixels_count * 4);
+
+    const auto memcpy_result = run_bench(iterations, pixels_count * 8, [&]() {
+        std::memcpy(simd_dst.data(), src.data(), pixels_count * 4);
+    });
+
+    LOG_INFO("memcpy rgba: ", memcpy_result.ms, " ms (", memcpy_result.gb_per_sec, " GB/s)");
+
+    {
+        std::vector<uint8_t> rgba_image_buffer;
+
+        const auto scalar = run_bench(iterations, pixels_count * 7, [&]() {
+            rgba_image_buffer.clear();
+            rgba_image_buffer.shrink_to_fit();
+            rgba_image_buffer.reserve(pixels_count * 4);
+
+            for (size_t i = 0; i < pixels_count; ++i) {
+                rgba_image_buffer.push_back(src[i * 3]);
+                rgba_image_buffer.push_back(src[i * 3 + 1]);
+                rgba_image_buffer.push_back(src[i * 3 + 2]);
+                rgba_image_buffer.push_back(255);
+            }
+        });
+
+        const auto simd = run_bench(iterations, pixels_count * 7, [&]() {
+            vk_utils::convert_rgb_to_rgba(src.data(), simd_dst.data(), pixels_count);
+        });
+
+        report("rgb -> rgba", scalar, simd, rgba_image_buffer == simd_dst);
+    }
+
+    {
+        const auto scalar = run_bench(iterations, pixels_count * 5, [&]() {
+            for (size_t i = 0; i < pixels_count; ++i) {
+                scalar_dst[i * 4] = src[i];
+                scalar_dst[i * 4 + 1] = src[i];
+                scalar_dst[i * 4 + 2] = src[i];
+                scalar_dst[i * 4 + 3] = 255;
+            }
+        });
+
+        const auto simd = run_bench(iterations, pixels_count * 5, [&]() {
+            vk_utils::convert_grey_to_rgba(src.data(), simd_dst.data(), pixels_count);
+        });
+
+        report("grey -> rgba", scalar, simd, scalar_dst == simd_dst);
+    }
+
+    {
+        const auto scalar = run_bench(iterations, pixels_count * 6, [&]() {
+            for (size_t i = 0; i < pixels_count; ++i) {
+                scalar_dst[i * 4] = src[i * 2];
+                scalar_dst[i * 4 + 1] = src[i * 2];
+                scalar_dst[i * 4 + 2] = src[i * 2];
+                scalar_dst[i * 4 + 3] = src[i * 2 + 1];
+            }
+        });
+
+        const auto simd = run_bench(iterations, pixels_count * 6, [&]() {
+            vk_utils::convert_grey_alpha_to_rgba(src.data(), simd_dst.data(), pixels_count);
+        });
+
+        report("grey alpha -> rgba", scalar, simd, scalar_dst == simd_dst);
+    }
+
+    {
+        const std::array<uint8_t, 4> bgra{2, 1, 0, 3};
+
+        const auto scalar = run_bench(iterations, pixels_count * 8, [&]() {
+            for (size_t i = 0; i < pixels_count; ++i) {
+                scalar_dst[i * 4] = src[i * 4 + bgra[0]];
+                scalar_dst[i * 4 + 1] = src[i * 4 + bgra[1]];
+                scalar_dst[i * 4 + 2] = src[i * 4 + bgra[2]];
+                scalar_dst[i * 4 + 3] = src[i * 4 + bgra[3]];
+            }
+        });
+
+        const auto simd = run_bench(iterations, pixels_count * 8, [&]() {
+            vk_utils::swizzle_rgba(src.data(), simd_dst.data(), pixels_count, bgra);
+        });
+
+        report("rgba -> bgra", scalar, simd, scalar_dst == simd_dst);
+    }
+
+    {
+        const auto scalar = run_bench(iterations, pixels_count * 8, [&]() {
+            for (size_t i = 0; i < pixels_count; ++i) {
+                const uint32_t a = src[i * 4 + 3];
+
+                for (size_t c = 0; c < 3; ++c) {
+                    scalar_dst[i * 4 + c] = (src[i * 4 + c] * a + 127) / 255;
+                }
+
+                scalar_dst[i * 4 + 3] = a;
+            }
+        });
+
+        const auto simd = run_bench(iterations, pixels_count * 8, [&]() {
+            vk_utils::premultiply_rgba(src.data(), simd_dst.data(), pixels_count);
+        });
+
+        report("premultiply rgba", scalar, simd, scalar_dst == simd_dst);
+    }
+
+    return 0;
+}